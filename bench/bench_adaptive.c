@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "../src/include/fdcache.h"
+#include "../src/include/process.h"
+#include "../src/include/syscount.h"
+#include "bench_util.h"
+
+/*
+ * Steady-state ticks of adaptive sampling against full accuracy, over the
+ * real /proc with idle children plus a couple of busy ones forked first.
+ * Each policy starts from a warm fd cache and a fully read snapshot, as
+ * after a switch with the 'a' key. Syscalls are those made against /proc,
+ * as counted by syscount.
+ *
+ * Usage: bench_adaptive [children]   (default 5000)
+ */
+
+#define TICKS 32
+#define BUSY_CHILDREN 2
+
+static void run(int max_backoff, ProcessTable tables[2])
+{
+	SamplePolicy policy = { .max_backoff = max_backoff, .pinned = NULL };
+	ProcessTable *prev = &tables[0];
+	ProcessTable *curr = &tables[1];
+
+	collect_processes(prev);
+
+	long stale = 0;
+	SysCount before;
+	syscount_get(&before);
+	double t0 = now_ns();
+	for (int i = 0; i < TICKS; i++) {
+		collect_processes_adaptive(curr, prev, &policy);
+		stale += curr->stale_count;
+		ProcessTable *swap = prev;
+		prev = curr;
+		curr = swap;
+	}
+	double elapsed = now_ns() - t0;
+	SysCount after;
+	syscount_get(&after);
+
+	printf("%-8d %8d %12.1f %14.1f %12.2f\n", max_backoff, prev->count,
+	       (double)stale / TICKS,
+	       (double)(after.syscalls - before.syscalls) / TICKS,
+	       elapsed / TICKS / 1e6);
+}
+
+int main(int argc, char **argv)
+{
+	int children = argc > 1 ? atoi(argv[1]) : 5000;
+	pid_t *pids = malloc((size_t)children * sizeof(pid_t));
+	ProcessTable tables[2];
+
+	if (!pids || process_table_init(&tables[0], PROCESS_TABLE_INITIAL_ROWS) != 0 ||
+	    process_table_init(&tables[1], PROCESS_TABLE_INITIAL_ROWS) != 0) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	int busy = children < BUSY_CHILDREN ? children : BUSY_CHILDREN;
+	int forked = spawn_busy_children(pids, busy);
+	if (forked == busy) {
+		forked += spawn_children(pids + forked, children - forked);
+	}
+
+	printf("%d children (%d busy), %d ticks per row\n", forked, busy,
+	       TICKS);
+	printf("%-8s %8s %12s %14s %12s\n", "backoff", "rows", "stale/tick",
+	       "syscalls/tick", "ms/tick");
+
+	static const int backoffs[] = { 1, 2, 4, 8, 16, SAMPLE_MAX_BACKOFF };
+	for (size_t i = 0; i < sizeof(backoffs) / sizeof(backoffs[0]); i++) {
+		run(backoffs[i], tables);
+	}
+
+	reap_children(pids, forked);
+
+	fdcache_cleanup();
+	process_table_free(&tables[0]);
+	process_table_free(&tables[1]);
+	free(pids);
+	return 0;
+}
@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "../src/include/collector.h"
+#include "../src/include/fdcache.h"
+#include "../src/include/process.h"
+#include "bench_util.h"
+
+/*
+ * collect_processes() over the real /proc with 1, 2, 4, ... threads up to
+ * the number of online cores. Idle children are forked first so there is
+ * enough to collect. Cold ticks drop the fd cache before every tick, so
+ * each PID costs an openat() of its stat file; warm ticks re-read cached
+ * descriptors.
+ *
+ * Usage: bench_collect [children [max_threads]]
+ *        (defaults: 5000 children, online cores)
+ */
+
+#define TICKS 20
+
+static double tick_ms(ProcessTable *t, int cold, int *rows)
+{
+	double total = 0.0;
+
+	for (int i = 0; i < TICKS; i++) {
+		if (cold) {
+			fdcache_cleanup();
+		}
+		double t0 = now_ns();
+		*rows = collect_processes(t);
+		total += now_ns() - t0;
+	}
+	return total / TICKS / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+	int children = argc > 1 ? atoi(argv[1]) : 5000;
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	long max_threads = argc > 2 ? atol(argv[2]) : cores;
+	pid_t *pids = malloc((size_t)children * sizeof(pid_t));
+	ProcessTable t;
+
+	if (!pids || process_table_init(&t, PROCESS_TABLE_INITIAL_ROWS) != 0) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	int forked = spawn_children(pids, children);
+
+	printf("%d idle children, %ld online cores, %d ticks per row\n",
+	       forked, cores, TICKS);
+	printf("%-8s %8s %12s %12s %9s\n", "threads", "rows", "cold ms/tick",
+	       "warm ms/tick", "speedup");
+
+	double base = 0.0;
+	for (long threads = 1; ; threads *= 2) {
+		if (threads > max_threads) {
+			threads = max_threads;
+		}
+		collector_start((int)threads);
+
+		int rows;
+		double cold = tick_ms(&t, 1, &rows);
+		double warm = tick_ms(&t, 0, &rows);
+		if (threads == 1) {
+			base = cold;
+		}
+		printf("%-8d %8d %12.2f %12.2f %8.2fx\n", collector_threads(),
+		       rows, cold, warm, base / cold);
+
+		collector_stop();
+		if (threads >= max_threads) {
+			break;
+		}
+	}
+
+	reap_children(pids, forked);
+
+	fdcache_cleanup();
+	process_table_free(&t);
+	free(pids);
+	return 0;
+}
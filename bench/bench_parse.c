@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../src/include/pidstat.h"
+#include "bench_util.h"
+
+/*
+ * Per-PID cost of parsing /proc/[pid]/stat: the old fscanf-based reader
+ * against pidstat_parse(). Two views are measured:
+ *   - parse only: the same in-memory lines fed to sscanf and pidstat_parse
+ *   - read+parse: the full per-PID path including open/read/close
+ */
+
+#define MAX_LINES 8192
+#define PARSE_ROUNDS 200
+#define READ_ROUNDS 20
+
+static char lines[MAX_LINES][PIDSTAT_BUF_SIZE];
+static size_t line_len[MAX_LINES];
+static int pids[MAX_LINES];
+static int line_count;
+
+static volatile uint64_t sink;
+
+static void load_lines(void)
+{
+	DIR *dir = opendir("/proc");
+	if (!dir) {
+		perror("opendir /proc");
+		exit(1);
+	}
+
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL && line_count < MAX_LINES) {
+		if (!isdigit(entry->d_name[0]))
+			continue;
+
+		int pid = atoi(entry->d_name);
+		char path[64];
+		snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+		int fd = open(path, O_RDONLY);
+		if (fd < 0)
+			continue;
+		ssize_t n = read(fd, lines[line_count],
+				 sizeof(lines[line_count]) - 1);
+		close(fd);
+		if (n <= 0)
+			continue;
+
+		lines[line_count][n] = '\0';
+		line_len[line_count] = (size_t)n;
+		pids[line_count] = pid;
+		line_count++;
+	}
+	closedir(dir);
+}
+
+// Format string used by read_process() before the hand-written parser
+#define LEGACY_FORMAT "%d %s %c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u " \
+		      "%lu %lu %*d %*d %*d %*d %*d %*d %llu %*u %lu"
+
+static void legacy_parse(const char *line)
+{
+	char comm[256];
+	int pid;
+	char state;
+	unsigned long utime, stime, rss;
+	unsigned long long starttime;
+
+	if (sscanf(line, LEGACY_FORMAT, &pid, comm, &state, &utime, &stime,
+		   &starttime, &rss) == 7)
+		sink += utime + stime + rss * (uint64_t)sysconf(_SC_PAGESIZE);
+}
+
+static void legacy_read(int pid)
+{
+	char path[256];
+	snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+	FILE *f = fopen(path, "r");
+	if (!f)
+		return;
+
+	char comm[256];
+	int read_pid;
+	char state;
+	unsigned long utime, stime, rss;
+	unsigned long long starttime;
+	int n = fscanf(f, LEGACY_FORMAT, &read_pid, comm, &state, &utime,
+		       &stime, &starttime, &rss);
+	fclose(f);
+
+	if (n == 7) {
+		uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+		sink += rss * page / 1024 + rss * (uint64_t)sysconf(_SC_PAGESIZE);
+		sink += utime + stime;
+	}
+}
+
+#define STAT_FIELDS (PIDSTAT_MASK(PIDSTAT_UTIME) | \
+		     PIDSTAT_MASK(PIDSTAT_STIME) | \
+		     PIDSTAT_MASK(PIDSTAT_STARTTIME) | \
+		     PIDSTAT_MASK(PIDSTAT_RSS))
+
+static void new_parse(const char *line, size_t len)
+{
+	PidStat st;
+	if (pidstat_parse(line, len, STAT_FIELDS, &st) == 0)
+		sink += st.field[PIDSTAT_UTIME] + st.field[PIDSTAT_STIME] +
+			st.field[PIDSTAT_RSS];
+}
+
+static void new_read(int pid)
+{
+	char path[64];
+	snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return;
+
+	char buf[PIDSTAT_BUF_SIZE];
+	ssize_t n = read(fd, buf, sizeof(buf));
+	close(fd);
+	if (n > 0)
+		new_parse(buf, (size_t)n);
+}
+
+int main(void)
+{
+	load_lines();
+	if (line_count == 0) {
+		fprintf(stderr, "no readable /proc/[pid]/stat files\n");
+		return 1;
+	}
+
+	printf("Parsing %d /proc/[pid]/stat lines\n\n", line_count);
+	printf("%-12s %14s %14s %9s\n", "stage", "fscanf ns/pid",
+	       "pidstat ns/pid", "speedup");
+
+	double t0 = now_ns();
+	for (int r = 0; r < PARSE_ROUNDS; r++)
+		for (int i = 0; i < line_count; i++)
+			legacy_parse(lines[i]);
+	double legacy = (now_ns() - t0) / ((double)PARSE_ROUNDS * line_count);
+
+	t0 = now_ns();
+	for (int r = 0; r < PARSE_ROUNDS; r++)
+		for (int i = 0; i < line_count; i++)
+			new_parse(lines[i], line_len[i]);
+	double fresh = (now_ns() - t0) / ((double)PARSE_ROUNDS * line_count);
+
+	printf("%-12s %14.1f %14.1f %8.1fx\n", "parse", legacy, fresh,
+	       legacy / fresh);
+
+	t0 = now_ns();
+	for (int r = 0; r < READ_ROUNDS; r++)
+		for (int i = 0; i < line_count; i++)
+			legacy_read(pids[i]);
+	legacy = (now_ns() - t0) / ((double)READ_ROUNDS * line_count);
+
+	t0 = now_ns();
+	for (int r = 0; r < READ_ROUNDS; r++)
+		for (int i = 0; i < line_count; i++)
+			new_read(pids[i]);
+	fresh = (now_ns() - t0) / ((double)READ_ROUNDS * line_count);
+
+	printf("%-12s %14.1f %14.1f %8.1fx\n", "read+parse", legacy, fresh,
+	       legacy / fresh);
+
+	return 0;
+}
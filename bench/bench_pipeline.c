@@ -0,0 +1,527 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../src/include/display.h"
+#include "../src/include/fdcache.h"
+#include "../src/include/pidstat.h"
+#include "../src/include/procdir.h"
+#include "../src/include/process.h"
+#include "../src/include/sort.h"
+#include "../src/include/syscount.h"
+#include "../src/include/view.h"
+#include "../tools/procfake.h"
+#include "bench_util.h"
+
+/*
+ * Every stage of a tick, one at a time, over synthetic /proc trees of
+ * several sizes (see tools/procfake.h):
+ *   enumerate  procdir_list_pids()
+ *   parse      pidstat_parse() of every stat line, already in memory
+ *   collect    collect_processes(), warm fd cache
+ *   stats      compute_process_stats() between two ticks
+ *   sort_cpu   sort_by_cpu() of the whole table
+ *   sort_mem   sort_by_mem() of the whole table
+ *   filter     a frame drawn with a name filter that matches nothing;
+ *              view_update() sees a new snapshot every time, with the
+ *              verdicts of the previous one to carry over
+ *   render     a frame drawn without a filter (header plus one screenful)
+ * Frames are drawn by ncurses into /dev/null on a 200x50 terminal.
+ *
+ * For every stage and size it reports time, heap allocations and syscalls
+ * per operation (one operation covers every process). Allocations are
+ * the malloc family called from ProcessBrowser code (the link wraps them;
+ * allocations inside libc and ncurses are not seen). Syscalls are those
+ * made against /proc as counted by syscount, plus write-like syscalls of
+ * the calling thread from /proc/thread-self/io, which covers the terminal
+ * output of the frames.
+ *
+ * Results go to stdout as a table and, with -o, to FILE as JSON with one
+ * result per line, so two runs can be compared with diff.
+ *
+ * Usage: bench_pipeline [-o FILE] [-l LABEL] [COUNT]...
+ *        (default counts: 1000 10000 100000)
+ */
+
+#define TERM_LINES "50"
+#define TERM_COLUMNS "200"
+#define FILTER_TERM "no such name"
+
+// Operations per stage and size: about this many rows in total
+#define CPU_ROWS 2000000
+#define IO_ROWS 200000
+#define MIN_ROUNDS 5
+
+static const int default_counts[] = { 1000, 10000, 100000 };
+
+static atomic_uint_fast64_t alloc_calls;
+static atomic_uint_fast64_t alloc_bytes;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void *__real_aligned_alloc(size_t align, size_t size);
+char *__real_strdup(const char *s);
+
+static void count_alloc(size_t size)
+{
+	atomic_fetch_add_explicit(&alloc_calls, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&alloc_bytes, size, memory_order_relaxed);
+}
+
+void *__wrap_malloc(size_t size)
+{
+	count_alloc(size);
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+	count_alloc(n * size);
+	return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+	count_alloc(size);
+	return __real_realloc(ptr, size);
+}
+
+void *__wrap_aligned_alloc(size_t align, size_t size)
+{
+	count_alloc(size);
+	return __real_aligned_alloc(align, size);
+}
+
+char *__wrap_strdup(const char *s)
+{
+	count_alloc(strlen(s) + 1);
+	return __real_strdup(s);
+}
+
+typedef struct {
+	double ns;
+	uint64_t allocs;
+	uint64_t alloc_bytes;
+	uint64_t syscalls;
+} Usage;
+
+static int io_fd = -1;
+
+// syscw of the calling thread, or 0 without I/O accounting
+static uint64_t write_syscalls(void)
+{
+	char buf[256];
+
+	if (io_fd < 0) {
+		return 0;
+	}
+	ssize_t n = pread(io_fd, buf, sizeof(buf) - 1, 0);
+	if (n <= 0) {
+		return 0;
+	}
+	buf[n] = '\0';
+	const char *field = strstr(buf, "syscw:");
+	return field ? strtoull(field + 6, NULL, 10) : 0;
+}
+
+static void usage_get(Usage *u)
+{
+	SysCount sc;
+
+	syscount_get(&sc);
+	u->allocs = atomic_load_explicit(&alloc_calls, memory_order_relaxed);
+	u->alloc_bytes = atomic_load_explicit(&alloc_bytes, memory_order_relaxed);
+	u->syscalls = sc.syscalls + write_syscalls();
+	u->ns = now_ns();
+}
+
+// State shared by the stages of one size
+static struct {
+	int count;
+	PidList pids;
+	char *lines;        // stat lines, back to back
+	size_t *line_end;   // end offset of each line in lines
+	int line_count;
+	ProcessTable tables[2]; // previous and current tick
+	uint64_t total_mem_bytes;
+} bench;
+
+static volatile uint64_t sink;
+
+static void run_enumerate(void)
+{
+	procdir_list_pids(&bench.pids);
+	sink += (uint64_t)bench.pids.count;
+}
+
+static void run_parse(void)
+{
+	PidStat st;
+	size_t start = 0;
+
+	for (int i = 0; i < bench.line_count; i++) {
+		pidstat_parse(bench.lines + start, bench.line_end[i] - start,
+			      PIDSTAT_MASK(PIDSTAT_UTIME) |
+			      PIDSTAT_MASK(PIDSTAT_STIME) |
+			      PIDSTAT_MASK(PIDSTAT_STARTTIME) |
+			      PIDSTAT_MASK(PIDSTAT_RSS), &st);
+		sink += st.field[PIDSTAT_UTIME];
+		start = bench.line_end[i];
+	}
+}
+
+static void run_collect(void)
+{
+	sink += (uint64_t)collect_processes(&bench.tables[1]);
+}
+
+static void run_stats(void)
+{
+	compute_process_stats(&bench.tables[1], &bench.tables[0], 4,
+			      bench.total_mem_bytes);
+}
+
+static void reset_order(void)
+{
+	ProcessTable *t = &bench.tables[1];
+	for (int i = 0; i < t->count; i++) {
+		t->order[i] = (uint32_t)i;
+	}
+}
+
+static void run_sort_cpu(void)
+{
+	sort_by_cpu(&bench.tables[1], false);
+}
+
+static void run_sort_mem(void)
+{
+	sort_by_mem(&bench.tables[1], false);
+}
+
+static FilterView view;
+
+// Alternate between the two ticks so that cells really change
+static void draw_frame(const char *search_term)
+{
+	static int frame;
+	const ProcessTable *t = &bench.tables[frame++ & 1];
+
+	display_begin_frame();
+	display_header(1, 2, 3, 42.0, 1024, 16384, t->count, true, false,
+		       false, 1000);
+	if (search_term[0] != '\0') {
+		int rows = view_update(&view, t, search_term);
+		display_process_info(t, view.rows, rows < 0 ? 0 : rows, 0,
+				     search_term);
+	} else {
+		display_process_info(t, t->order, t->count, 0, search_term);
+	}
+	display_refresh();
+}
+
+static void run_filter(void)
+{
+	draw_frame(FILTER_TERM);
+}
+
+static void run_render(void)
+{
+	draw_frame("");
+}
+
+typedef struct {
+	const char *name;
+	void (*prepare)(void); // untimed, before every operation; or NULL
+	void (*run)(void);
+	int rows;              // CPU_ROWS or IO_ROWS
+} Stage;
+
+static const Stage stages[] = {
+	{ "enumerate", NULL, run_enumerate, IO_ROWS },
+	{ "parse", NULL, run_parse, CPU_ROWS },
+	{ "collect", NULL, run_collect, IO_ROWS },
+	{ "stats", NULL, run_stats, CPU_ROWS },
+	{ "sort_cpu", reset_order, run_sort_cpu, CPU_ROWS },
+	{ "sort_mem", reset_order, run_sort_mem, CPU_ROWS },
+	{ "filter", NULL, run_filter, CPU_ROWS },
+	{ "render", NULL, run_render, CPU_ROWS },
+};
+
+/**
+ * load_lines() - Read every stat file of the tree into memory
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int load_lines(void)
+{
+	size_t cap = (size_t)bench.count * 256;
+	char *lines = malloc(cap);
+	size_t *ends = malloc((size_t)bench.count * sizeof(*ends));
+	size_t len = 0;
+	int n = 0;
+
+	if (!lines || !ends || procdir_list_pids(&bench.pids) < 0) {
+		free(lines);
+		free(ends);
+		return -1;
+	}
+	for (int i = 0; i < bench.pids.count && n < bench.count; i++) {
+		if (cap - len < PIDSTAT_BUF_SIZE) {
+			char *grown = realloc(lines, cap * 2);
+			if (!grown) {
+				break;
+			}
+			lines = grown;
+			cap *= 2;
+		}
+		int fd = procdir_openat(bench.pids.pids[i], "stat");
+		ssize_t got = fd < 0 ? -1 : read(fd, lines + len, PIDSTAT_BUF_SIZE);
+		if (fd >= 0) {
+			close(fd);
+		}
+		if (got > 0) {
+			len += (size_t)got;
+			ends[n++] = len;
+		}
+	}
+
+	bench.lines = lines;
+	bench.line_end = ends;
+	bench.line_count = n;
+	return 0;
+}
+
+/**
+ * setup() - Build a tree of @count processes and read two ticks of it
+ * @pf: Generator state
+ * @dir: Directory for the tree
+ * @count: Number of processes
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int setup(ProcFake *pf, const char *dir, int count)
+{
+	bench.count = count;
+	bench.total_mem_bytes = 16ull << 30;
+	if (procfake_create(pf, dir, count, 1000) != 0 ||
+	    procdir_set_root(dir) != 0 || load_lines() != 0) {
+		return -1;
+	}
+
+	for (int i = 0; i < 2; i++) {
+		if (procfake_step(pf) != 0 ||
+		    collect_processes(&bench.tables[i]) < 0) {
+			return -1;
+		}
+		bench.tables[i].sample_ns = (uint64_t)(i + 1) * 1000000000u;
+	}
+	compute_process_stats(&bench.tables[1], &bench.tables[0], 4,
+			      bench.total_mem_bytes);
+	return 0;
+}
+
+static void teardown(ProcFake *pf, const char *dir)
+{
+	fdcache_cleanup();
+	procdir_close();
+	procfake_remove(pf, dir);
+
+	free(bench.lines);
+	free(bench.line_end);
+	bench.lines = NULL;
+	bench.line_end = NULL;
+}
+
+/**
+ * measure() - Run one stage and report it
+ * @stage: Stage to run
+ * @report: Table output
+ * @json: JSON output, or NULL
+ * @first: Whether this is the first JSON result
+ */
+static void measure(const Stage *stage, FILE *report, FILE *json, bool first)
+{
+	int rounds = stage->rows / bench.count;
+	if (rounds < MIN_ROUNDS) {
+		rounds = MIN_ROUNDS;
+	}
+
+	// Warm caches and grow buffers outside the measurement
+	if (stage->prepare) {
+		stage->prepare();
+	}
+	stage->run();
+
+	Usage total = { 0 };
+	for (int r = 0; r < rounds; r++) {
+		Usage before, after;
+		if (stage->prepare) {
+			stage->prepare();
+		}
+		usage_get(&before);
+		stage->run();
+		usage_get(&after);
+		total.ns += after.ns - before.ns;
+		total.allocs += after.allocs - before.allocs;
+		total.alloc_bytes += after.alloc_bytes - before.alloc_bytes;
+		total.syscalls += after.syscalls - before.syscalls;
+	}
+
+	double ns = total.ns / rounds;
+	double allocs = (double)total.allocs / rounds;
+	double bytes = (double)total.alloc_bytes / rounds;
+	double syscalls = (double)total.syscalls / rounds;
+	fprintf(report, "%-10s %8d %7d %14.0f %10.1f %10.2f %12.0f %11.2f\n",
+		stage->name, bench.count, rounds, ns, ns / bench.count, allocs,
+		bytes, syscalls);
+	fflush(report);
+	if (json) {
+		fprintf(json, "%s    {\"stage\": \"%s\", \"processes\": %d, "
+			"\"rounds\": %d, \"ns_per_op\": %.0f, "
+			"\"ns_per_process\": %.2f, \"allocs_per_op\": %.2f, "
+			"\"alloc_bytes_per_op\": %.0f, \"syscalls_per_op\": %.2f}",
+			first ? "" : ",\n", stage->name, bench.count, rounds, ns,
+			ns / bench.count, allocs, bytes, syscalls);
+	}
+}
+
+/**
+ * open_screen() - Start ncurses on /dev/null with a fixed size
+ *
+ * Frames are written through stdout, so it is pointed at /dev/null
+ * before ncurses takes it over.
+ *
+ * Return: Descriptor of the real stdout, or -1 on error
+ */
+static int open_screen(void)
+{
+	fflush(stdout);
+	int saved = dup(STDOUT_FILENO);
+	int null_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+	if (saved < 0 || null_fd < 0 || dup2(null_fd, STDOUT_FILENO) < 0) {
+		return -1;
+	}
+	close(null_fd);
+
+	setenv("LINES", TERM_LINES, 1);
+	setenv("COLUMNS", TERM_COLUMNS, 1);
+	const char *term = getenv("TERM");
+	if (!term || !*term || strcmp(term, "dumb") == 0) {
+		setenv("TERM", "xterm-256color", 1);
+	}
+	display_init();
+	return saved;
+}
+
+int main(int argc, char **argv)
+{
+	const char *json_path = NULL, *label = "";
+	int opt;
+
+	while ((opt = getopt(argc, argv, "o:l:")) != -1) {
+		switch (opt) {
+		case 'o':
+			json_path = optarg;
+			break;
+		case 'l':
+			label = optarg;
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-o FILE] [-l LABEL] [COUNT]...\n",
+				argv[0]);
+			return 2;
+		}
+	}
+
+	int count_n = argc - optind;
+	int *counts = malloc(sizeof(default_counts) + (size_t)count_n * sizeof(int));
+	if (!counts) {
+		return 1;
+	}
+	if (count_n == 0) {
+		count_n = (int)(sizeof(default_counts) / sizeof(default_counts[0]));
+		memcpy(counts, default_counts, sizeof(default_counts));
+	}
+	for (int i = 0; i < argc - optind; i++) {
+		counts[i] = atoi(argv[optind + i]);
+		if (counts[i] <= 0) {
+			fprintf(stderr, "%s: invalid count '%s'\n", argv[0],
+				argv[optind + i]);
+			return 2;
+		}
+	}
+
+	FILE *json = NULL;
+	if (json_path && !(json = fopen(json_path, "w"))) {
+		perror(json_path);
+		return 1;
+	}
+
+	char dir[] = "/tmp/bench_pipeline_XXXXXX";
+	if (!mkdtemp(dir) ||
+	    process_table_init(&bench.tables[0], PROCESS_TABLE_INITIAL_ROWS) != 0 ||
+	    process_table_init(&bench.tables[1], PROCESS_TABLE_INITIAL_ROWS) != 0) {
+		fprintf(stderr, "%s: cannot set up: %s\n", argv[0], strerror(errno));
+		return 1;
+	}
+	io_fd = open("/proc/thread-self/io", O_RDONLY | O_CLOEXEC);
+
+	int real_stdout = open_screen();
+	if (real_stdout < 0) {
+		fprintf(stderr, "%s: cannot open a screen\n", argv[0]);
+		return 1;
+	}
+	FILE *out = fdopen(real_stdout, "w");
+	if (!out) {
+		return 1;
+	}
+
+	if (json) {
+		fprintf(json, "{\n  \"label\": \"%s\",\n  \"cores\": %ld,\n"
+			"  \"results\": [\n", label, sysconf(_SC_NPROCESSORS_ONLN));
+	}
+	int failed = 0;
+	bool first = true;
+	for (int i = 0; i < count_n && !failed; i++) {
+		ProcFake pf;
+		char sub[sizeof(dir) + 16];
+		snprintf(sub, sizeof(sub), "%s/%d", dir, counts[i]);
+		if (setup(&pf, sub, counts[i]) != 0) {
+			fprintf(stderr, "%s: cannot build %d processes: %s\n", argv[0],
+				counts[i], strerror(errno));
+			failed = 1;
+		}
+
+		if (i == 0) {
+			fprintf(out, "%-10s %8s %7s %14s %10s %10s %12s %11s\n",
+				"stage", "procs", "rounds", "ns/op", "ns/proc",
+				"allocs/op", "bytes/op", "syscalls/op");
+		}
+		for (size_t s = 0; !failed && s < sizeof(stages) / sizeof(stages[0]);
+		     s++) {
+			measure(&stages[s], out, json, first);
+			first = false;
+		}
+		teardown(&pf, sub);
+	}
+	display_cleanup();
+	view_free(&view);
+
+	if (json) {
+		fprintf(json, "\n  ]\n}\n");
+		fclose(json);
+	}
+	fclose(out);
+	rmdir(dir);
+	process_table_free(&bench.tables[0]);
+	process_table_free(&bench.tables[1]);
+	pidlist_free(&bench.pids);
+	free(counts);
+	return failed;
+}
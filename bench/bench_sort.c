@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "../src/include/sort.h"
+#include "bench_util.h"
+
+/*
+ * Full qsort of the order column (sort_by_cpu) against sort_window() for a
+ * screenful of rows, at several table sizes and scroll depths.
+ */
+
+#define WINDOW_HEIGHT 50
+
+static const int sizes[] = { 1000, 10000, 100000 };
+static const int offsets[] = { 0, 200 };
+
+int main(void)
+{
+	printf("%-8s %-7s %14s %14s %9s\n", "rows", "offset", "qsort us/op",
+	       "window us/op", "speedup");
+
+	for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+		int count = sizes[s];
+		double *cpu = malloc(count * sizeof(double));
+		uint32_t *order = malloc(count * sizeof(uint32_t));
+		if (!cpu || !order) {
+			fprintf(stderr, "out of memory\n");
+			return 1;
+		}
+
+		srand(1);
+		for (int i = 0; i < count; i++) {
+			// Mostly idle processes, a few busy ones, like a real host
+			cpu[i] = rand() % 10 ? 0.0 : (double)(rand() % 10000) / 100.0;
+		}
+
+		ProcessTable t = { .count = count, .capacity = count,
+				   .cpu_percent = cpu, .mem_percent = cpu,
+				   .order = order };
+		int rounds = 2000000 / count;
+
+		for (size_t o = 0; o < sizeof(offsets) / sizeof(offsets[0]); o++) {
+			int offset = offsets[o];
+
+			double t0 = now_ns();
+			for (int r = 0; r < rounds; r++)
+				sort_by_cpu(&t, false);
+			double full = (now_ns() - t0) / rounds / 1000.0;
+
+			t0 = now_ns();
+			for (int r = 0; r < rounds; r++)
+				sort_window(&t, SORT_CPU, false, offset,
+					    WINDOW_HEIGHT);
+			double window = (now_ns() - t0) / rounds / 1000.0;
+
+			printf("%-8d %-7d %14.1f %14.1f %8.1fx\n", count, offset,
+			       full, window, full / window);
+		}
+
+		free(cpu);
+		free(order);
+	}
+
+	return 0;
+}
@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "../src/include/fdcache.h"
+#include "../src/include/process.h"
+#include "../src/include/syscount.h"
+#include "../src/include/uring.h"
+#include "bench_util.h"
+
+/*
+ * Steady-state collect_processes() ticks with synchronous pread() against
+ * io_uring batches, over the real /proc with idle children forked first.
+ * One warm-up tick fills the fd cache, so the measured ticks only re-read
+ * cached descriptors. Syscalls are those made against /proc, as counted
+ * by syscount.
+ *
+ * Usage: bench_uring [children]   (default 5000)
+ */
+
+#define TICKS 20
+#define URING_ENTRIES 1024
+
+static void run(const char *backend, ProcessTable *t)
+{
+	fdcache_cleanup();
+	collect_processes(t);
+
+	SysCount before;
+	syscount_get(&before);
+	double t0 = now_ns();
+	for (int i = 0; i < TICKS; i++) {
+		collect_processes(t);
+	}
+	double elapsed = now_ns() - t0;
+	SysCount after;
+	syscount_get(&after);
+
+	printf("%-8s %8d %14.1f %14.1f %12.2f\n", backend, t->count,
+	       (double)(after.syscalls - before.syscalls) / TICKS,
+	       (double)(after.bytes - before.bytes) / TICKS / 1024.0,
+	       elapsed / TICKS / 1e6);
+}
+
+int main(int argc, char **argv)
+{
+	int children = argc > 1 ? atoi(argv[1]) : 5000;
+	pid_t *pids = malloc((size_t)children * sizeof(pid_t));
+	ProcessTable t;
+
+	if (!pids || process_table_init(&t, PROCESS_TABLE_INITIAL_ROWS) != 0) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	int forked = spawn_children(pids, children);
+
+	printf("%d idle children, %d ticks per row\n", forked, TICKS);
+	printf("%-8s %8s %14s %14s %12s\n", "backend", "rows", "syscalls/tick",
+	       "KiB read/tick", "ms/tick");
+
+	run("pread", &t);
+	if (uring_open(URING_ENTRIES) == 0) {
+		run("io_uring", &t);
+		uring_close();
+	} else {
+		printf("%-8s unavailable on this kernel\n", "io_uring");
+	}
+
+	reap_children(pids, forked);
+
+	fdcache_cleanup();
+	process_table_free(&t);
+	free(pids);
+	return 0;
+}
@@ -0,0 +1,85 @@
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/*
+ * Clock and child process helpers shared by the benchmarks. Children are
+ * forked to give the collection benchmarks something to read in the real
+ * /proc, and are killed and reaped once the benchmark is done.
+ */
+
+static inline double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * spawn_children() - Fork children that sleep until killed
+ * @pids: Receives the PIDs of the children
+ * @count: Number of children to fork
+ *
+ * Return: number of children forked, less than @count if fork() failed
+ */
+static inline int spawn_children(pid_t *pids, int count)
+{
+	int forked = 0;
+	while (forked < count) {
+		pid_t pid = fork();
+		if (pid < 0) {
+			break;
+		}
+		if (pid == 0) {
+			pause();
+			_exit(0);
+		}
+		pids[forked++] = pid;
+	}
+	return forked;
+}
+
+/**
+ * spawn_busy_children() - Fork children that spin on the CPU until killed
+ * @pids: Receives the PIDs of the children
+ * @count: Number of children to fork
+ *
+ * Return: number of children forked, less than @count if fork() failed
+ */
+static inline int spawn_busy_children(pid_t *pids, int count)
+{
+	int forked = 0;
+	while (forked < count) {
+		pid_t pid = fork();
+		if (pid < 0) {
+			break;
+		}
+		if (pid == 0) {
+			for (volatile unsigned long n = 0; ; n++) {
+			}
+		}
+		pids[forked++] = pid;
+	}
+	return forked;
+}
+
+/**
+ * reap_children() - Kill and wait for spawned children
+ * @pids: PIDs of the children
+ * @count: Number of children
+ */
+static inline void reap_children(const pid_t *pids, int count)
+{
+	for (int i = 0; i < count; i++) {
+		kill(pids[i], SIGKILL);
+	}
+	for (int i = 0; i < count; i++) {
+		waitpid(pids[i], NULL, 0);
+	}
+}
+
+#endif
@@ -0,0 +1,428 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include "batch.h"
+
+#define BATCH_BUF_SIZE (256 * 1024)
+
+// Most bytes one process or one record header can take in any format
+#define BATCH_ROW_MAX 512
+
+static char out_buf[BATCH_BUF_SIZE];
+static size_t out_len;
+static int out_fd = -1;
+static bool out_owned;   // out_fd was opened here and is closed on exit
+static BatchFormat out_format;
+
+/**
+ * flush() - Write out everything buffered
+ *
+ * Return: 0 on success, -1 on a write error (errno is set)
+ */
+static int flush(void)
+{
+	size_t done = 0;
+
+	while (done < out_len) {
+		ssize_t n = write(out_fd, out_buf + done, out_len - done);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -1;
+		}
+		done += (size_t)n;
+	}
+	out_len = 0;
+	return 0;
+}
+
+/**
+ * reserve() - Make room for one row in the buffer
+ *
+ * Return: Where to format the row, or NULL on a write error
+ */
+static char *reserve(void)
+{
+	if (out_len + BATCH_ROW_MAX > sizeof(out_buf) && flush() != 0) {
+		return NULL;
+	}
+	return out_buf + out_len;
+}
+
+static void commit(const char *end)
+{
+	out_len = (size_t)(end - out_buf);
+}
+
+static char *put_str(char *p, const char *s)
+{
+	size_t len = strlen(s);
+	memcpy(p, s, len);
+	return p + len;
+}
+
+static char *put_u64(char *p, uint64_t v)
+{
+	char digits[20];
+	int n = 0;
+
+	do {
+		digits[n++] = (char)('0' + v % 10);
+		v /= 10;
+	} while (v);
+	while (n) {
+		*p++ = digits[--n];
+	}
+	return p;
+}
+
+// Fixed point with two decimals, as the UI shows percentages
+static char *put_fixed2(char *p, double v)
+{
+	if (v < 0.0) {
+		*p++ = '-';
+		v = -v;
+	}
+	uint64_t hundredths = (uint64_t)(v * 100.0 + 0.5);
+	p = put_u64(p, hundredths / 100);
+	*p++ = '.';
+	*p++ = (char)('0' + hundredths / 10 % 10);
+	*p++ = (char)('0' + hundredths % 10);
+	return p;
+}
+
+static char *put_csv_name(char *p, const char *name)
+{
+	if (!strpbrk(name, ",\"\r\n")) {
+		return put_str(p, name);
+	}
+
+	*p++ = '"';
+	for (; *name; name++) {
+		if (*name == '"') {
+			*p++ = '"';
+		}
+		*p++ = *name;
+	}
+	*p++ = '"';
+	return p;
+}
+
+static char *put_json_name(char *p, const char *name)
+{
+	static const char hex[] = "0123456789abcdef";
+
+	*p++ = '"';
+	for (; *name; name++) {
+		unsigned char c = (unsigned char)*name;
+		if (c == '"' || c == '\\') {
+			*p++ = '\\';
+			*p++ = (char)c;
+		} else if (c < 0x20) {
+			p = put_str(p, "\\u00");
+			*p++ = hex[c >> 4];
+			*p++ = hex[c & 0xf];
+		} else {
+			*p++ = (char)c;
+		}
+	}
+	*p++ = '"';
+	return p;
+}
+
+static char *put_raw(char *p, const void *v, size_t len)
+{
+	memcpy(p, v, len);
+	return p + len;
+}
+
+static int write_csv(const Frame *f, uint64_t time_ms)
+{
+	const ProcessTable *t = &f->table;
+
+	for (int i = 0; i < t->count; i++) {
+		int row = (int)t->order[i];
+		char *p = reserve();
+		if (!p) {
+			return -1;
+		}
+
+		p = put_u64(p, f->seq);
+		*p++ = ',';
+		p = put_u64(p, time_ms);
+		*p++ = ',';
+		p = put_u64(p, (uint64_t)t->pid[row]);
+		*p++ = ',';
+		p = put_csv_name(p, process_name(t, row));
+		*p++ = ',';
+		if (t->flags[row] & PROC_CPU_VALID) {
+			p = put_fixed2(p, t->cpu_percent[row]);
+		}
+		*p++ = ',';
+		p = put_u64(p, t->mem_bytes[row]);
+		*p++ = ',';
+		p = put_fixed2(p, t->mem_percent[row]);
+		*p++ = ',';
+		*p++ = t->flags[row] & PROC_STALE ? '1' : '0';
+		*p++ = '\n';
+		commit(p);
+	}
+	return 0;
+}
+
+// The "self" field: own resource usage and phase percentiles, at most
+// about 400 bytes so it fits one reserve()
+static char *put_json_self(char *p, const SelfStats *self)
+{
+	p = put_str(p, ",\"self\":{\"cpu\":");
+	p = put_fixed2(p, self->cpu_percent);
+	p = put_str(p, ",\"rss_bytes\":");
+	p = put_u64(p, self->rss_bytes);
+	p = put_str(p, ",\"proc_syscalls\":");
+	p = put_u64(p, self->proc_syscalls);
+	p = put_str(p, ",\"proc_bytes\":");
+	p = put_u64(p, self->proc_bytes);
+	p = put_str(p, ",\"log_dropped\":");
+	p = put_u64(p, self->log_dropped);
+	p = put_str(p, ",\"phases\":{");
+
+	bool first = true;
+	for (int i = 0; i < PHASE_COUNT; i++) {
+		if (self->samples[i] == 0) {
+			continue;
+		}
+		p = put_str(p, first ? "\"" : ",\"");
+		p = put_str(p, selfstat_phase_name((Phase)i));
+		p = put_str(p, "\":{\"p50_us\":");
+		p = put_u64(p, self->p50_ns[i] / 1000);
+		p = put_str(p, ",\"p99_us\":");
+		p = put_u64(p, self->p99_ns[i] / 1000);
+		*p++ = '}';
+		first = false;
+	}
+	return put_str(p, "}}");
+}
+
+static int write_json(const Frame *f, uint64_t time_ms, const SelfStats *self)
+{
+	const ProcessTable *t = &f->table;
+	char *p = reserve();
+	if (!p) {
+		return -1;
+	}
+
+	p = put_str(p, "{\"seq\":");
+	p = put_u64(p, f->seq);
+	p = put_str(p, ",\"time_ms\":");
+	p = put_u64(p, time_ms);
+	p = put_str(p, ",\"cpu_load\":");
+	p = put_fixed2(p, f->cpu_load);
+	p = put_str(p, ",\"used_mem_bytes\":");
+	p = put_u64(p, f->used_mem_bytes);
+	commit(p);
+
+	p = reserve();
+	if (!p) {
+		return -1;
+	}
+	if (self) {
+		p = put_json_self(p, self);
+	}
+	p = put_str(p, ",\"processes\":[");
+	commit(p);
+
+	for (int i = 0; i < t->count; i++) {
+		int row = (int)t->order[i];
+		p = reserve();
+		if (!p) {
+			return -1;
+		}
+
+		p = put_str(p, i ? ",{\"pid\":" : "{\"pid\":");
+		p = put_u64(p, (uint64_t)t->pid[row]);
+		p = put_str(p, ",\"name\":");
+		p = put_json_name(p, process_name(t, row));
+		p = put_str(p, ",\"cpu\":");
+		if (t->flags[row] & PROC_CPU_VALID) {
+			p = put_fixed2(p, t->cpu_percent[row]);
+		} else {
+			p = put_str(p, "null");
+		}
+		p = put_str(p, ",\"mem_bytes\":");
+		p = put_u64(p, t->mem_bytes[row]);
+		p = put_str(p, ",\"mem\":");
+		p = put_fixed2(p, t->mem_percent[row]);
+		p = put_str(p, t->flags[row] & PROC_STALE ? ",\"stale\":true}" :
+							    ",\"stale\":false}");
+		commit(p);
+	}
+
+	p = reserve();
+	if (!p) {
+		return -1;
+	}
+	p = put_str(p, "]}\n");
+	commit(p);
+	return 0;
+}
+
+// Bytes of a binary process entry before its name
+#define BINARY_ENTRY_SIZE 24
+
+static int write_binary(const Frame *f, uint64_t time_ms)
+{
+	const ProcessTable *t = &f->table;
+
+	// The length comes first, so size the record before writing it
+	uint32_t length = sizeof(uint32_t) + sizeof(uint64_t) * 3 +
+			  sizeof(float) + sizeof(uint32_t);
+	for (int i = 0; i < t->count; i++) {
+		length += BINARY_ENTRY_SIZE +
+			  (uint32_t)strlen(process_name(t, i));
+	}
+
+	char *p = reserve();
+	if (!p) {
+		return -1;
+	}
+
+	uint32_t magic = BATCH_MAGIC;
+	uint64_t seq = f->seq;
+	uint64_t used = f->used_mem_bytes;
+	float cpu_load = (float)f->cpu_load;
+	uint32_t count = (uint32_t)t->count;
+
+	p = put_raw(p, &length, sizeof(length));
+	p = put_raw(p, &magic, sizeof(magic));
+	p = put_raw(p, &seq, sizeof(seq));
+	p = put_raw(p, &time_ms, sizeof(time_ms));
+	p = put_raw(p, &used, sizeof(used));
+	p = put_raw(p, &cpu_load, sizeof(cpu_load));
+	p = put_raw(p, &count, sizeof(count));
+	commit(p);
+
+	for (int i = 0; i < t->count; i++) {
+		int row = (int)t->order[i];
+		p = reserve();
+		if (!p) {
+			return -1;
+		}
+
+		const char *name = process_name(t, row);
+		int32_t pid = t->pid[row];
+		uint8_t head[4] = { t->flags[row], (uint8_t)strlen(name), 0, 0 };
+		float cpu = (float)t->cpu_percent[row];
+		float mem = (float)t->mem_percent[row];
+
+		p = put_raw(p, &pid, sizeof(pid));
+		p = put_raw(p, head, sizeof(head));
+		p = put_raw(p, &cpu, sizeof(cpu));
+		p = put_raw(p, &mem, sizeof(mem));
+		p = put_raw(p, &t->mem_bytes[row], sizeof(t->mem_bytes[row]));
+		p = put_raw(p, name, head[1]);
+		commit(p);
+	}
+	return 0;
+}
+
+/**
+ * batch_parse_format() - Look up an output format by name
+ * @name: "csv", "json" or "binary"
+ * @out: Parsed format
+ *
+ * Return: 0 on success, -1 if the name is unknown
+ */
+int batch_parse_format(const char *name, BatchFormat *out)
+{
+	if (strcmp(name, "csv") == 0) {
+		*out = BATCH_CSV;
+	} else if (strcmp(name, "json") == 0) {
+		*out = BATCH_JSON;
+	} else if (strcmp(name, "binary") == 0) {
+		*out = BATCH_BINARY;
+	} else {
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * batch_open() - Start writing records
+ * @path: Output file, created or truncated; NULL or "-" for stdout
+ * @format: Record format
+ *
+ * Return: 0 on success, -1 if the file cannot be opened (errno is set)
+ */
+int batch_open(const char *path, BatchFormat format)
+{
+	if (!path || strcmp(path, "-") == 0) {
+		out_fd = STDOUT_FILENO;
+		out_owned = false;
+	} else {
+		out_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+			      0644);
+		if (out_fd < 0) {
+			return -1;
+		}
+		out_owned = true;
+	}
+
+	out_format = format;
+	out_len = 0;
+	if (format == BATCH_CSV) {
+		char *p = put_str(out_buf, "seq,time_ms,pid,name,cpu_percent,"
+					   "mem_bytes,mem_percent,stale\n");
+		commit(p);
+	}
+	return 0;
+}
+
+/**
+ * batch_write() - Write the record of one tick
+ * @f: Frame to write; processes are written in its order column
+ * @time_ms: Wall clock time of the tick, milliseconds since the epoch
+ * @self: Monitor's own cost, written in JSON records only; NULL for none
+ *
+ * Return: 0 on success, -1 on a write error (errno is set; EPIPE means
+ * the reader went away)
+ */
+int batch_write(const Frame *f, uint64_t time_ms, const SelfStats *self)
+{
+	int ret;
+
+	switch (out_format) {
+	case BATCH_CSV:
+		ret = write_csv(f, time_ms);
+		break;
+	case BATCH_JSON:
+		ret = write_json(f, time_ms, self);
+		break;
+	default:
+		ret = write_binary(f, time_ms);
+		break;
+	}
+
+	return ret == 0 ? flush() : -1;
+}
+
+/**
+ * batch_close() - Flush and close the output
+ *
+ * Return: 0 on success, -1 if buffered records could not be written
+ */
+int batch_close(void)
+{
+	if (out_fd < 0) {
+		return 0;
+	}
+
+	int ret = flush();
+	if (out_owned && close(out_fd) != 0) {
+		ret = -1;
+	}
+	out_fd = -1;
+	out_len = 0;
+	return ret;
+}
@@ -0,0 +1,184 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "cmdline.h"
+#include "pidmap.h"
+#include "procdir.h"
+
+#define CMDLINE_MAX_LEN 512
+#define CMDLINE_MIN_CAPACITY 256
+#define CMDLINE_COMM_MAX 40
+
+// Snapshots after which a shown command line is read again
+#define CMDLINE_REFRESH 5
+
+typedef struct {
+	int pid;
+	uint64_t starttime;
+	uint64_t snapshot;    // cmdline_sweep() count when it was read
+	char comm[CMDLINE_COMM_MAX]; // name the process had then
+	char *text;           // NULL if the process has no command line
+} CmdlineEntry;
+
+// Dense array of entries; cmd_index maps (pid, starttime) -> position
+static CmdlineEntry *entries;
+static int entry_count;
+static int entry_capacity;
+static PidMap cmd_index;
+
+// Scratch map used by cmdline_sweep() to mark live processes
+static PidMap live_index;
+
+// Snapshots swept so far
+static uint64_t snapshots;
+
+/**
+ * load_cmdline() - Read /proc/[pid]/cmdline with NULs replaced by spaces
+ * @pid: Process ID
+ *
+ * Return: Newly allocated string, or NULL if it is empty or unreadable
+ */
+static char *load_cmdline(int pid)
+{
+	char buf[CMDLINE_MAX_LEN];
+
+	int fd = procdir_openat(pid, "cmdline");
+	if (fd < 0) {
+		return NULL;
+	}
+
+	ssize_t n = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+
+	if (n <= 0) {
+		return NULL;
+	}
+
+	// Replace null bytes with spaces
+	for (ssize_t i = 0; i < n - 1; i++) {
+		if (buf[i] == '\0') {
+			buf[i] = ' ';
+		}
+	}
+	buf[n] = '\0';
+
+	return strdup(buf);
+}
+
+/**
+ * cmdline_get() - Get the command line of a process, reading it if needed
+ * @pid: Process ID
+ * @starttime: Process start time, so a reused PID is not served a stale
+ *             command line
+ * @comm: Current name of the process
+ *
+ * The first call for a (pid, starttime) reads /proc; later calls return the
+ * cached string. It is read again when @comm changed, as exec() changes
+ * it without a new starttime, and once it is CMDLINE_REFRESH snapshots
+ * old, for processes that rewrite their title. Only rows that are drawn
+ * ask, so refreshing costs a read per visible row every few snapshots.
+ * Kernel threads and exited processes have no command line, and that
+ * result is cached too.
+ *
+ * Return: Command line, or NULL if there is none. The string stays valid
+ * until the next cmdline_get() or cmdline_sweep() for the process.
+ */
+const char *cmdline_get(int pid, uint64_t starttime, const char *comm)
+{
+	int pos = pidmap_find(&cmd_index, pid, starttime);
+	if (pos >= 0) {
+		CmdlineEntry *e = &entries[pos];
+		if (snapshots - e->snapshot < CMDLINE_REFRESH &&
+		    strncmp(e->comm, comm, sizeof(e->comm)) == 0) {
+			return e->text;
+		}
+		free(e->text);
+		e->text = load_cmdline(pid);
+		e->snapshot = snapshots;
+		snprintf(e->comm, sizeof(e->comm), "%s", comm);
+		return e->text;
+	}
+
+	if (entry_count == entry_capacity) {
+		int capacity = entry_capacity ? entry_capacity * 2 :
+			       CMDLINE_MIN_CAPACITY;
+		CmdlineEntry *grown = realloc(entries,
+					      capacity * sizeof(CmdlineEntry));
+		if (!grown) {
+			return NULL;
+		}
+		entries = grown;
+		entry_capacity = capacity;
+	}
+
+	char *text = load_cmdline(pid);
+	if (pidmap_insert(&cmd_index, pid, starttime, entry_count) != 0) {
+		free(text);
+		return NULL;
+	}
+
+	CmdlineEntry *e = &entries[entry_count++];
+	e->pid = pid;
+	e->starttime = starttime;
+	e->snapshot = snapshots;
+	snprintf(e->comm, sizeof(e->comm), "%s", comm);
+	e->text = text;
+	return text;
+}
+
+/**
+ * cmdline_sweep() - Drop command lines of processes not in a snapshot
+ * @t: Current snapshot
+ *
+ * Call once per snapshot, before rendering it; snapshots are also what
+ * cmdline_get() counts to refresh command lines.
+ */
+void cmdline_sweep(const ProcessTable *t)
+{
+	snapshots++;
+	if (entry_count == 0) {
+		return;
+	}
+
+	if (pidmap_reset(&live_index, t->count) != 0) {
+		return; // keep everything rather than drop live entries
+	}
+	for (int i = 0; i < t->count; i++) {
+		pidmap_insert(&live_index, t->pid[i], t->starttime[i], i);
+	}
+
+	int i = 0;
+	while (i < entry_count) {
+		CmdlineEntry *e = &entries[i];
+		if (pidmap_find(&live_index, e->pid, e->starttime) >= 0) {
+			i++;
+			continue;
+		}
+
+		free(e->text);
+		pidmap_remove(&cmd_index, e->pid, e->starttime);
+		entry_count--;
+		if (i != entry_count) {
+			entries[i] = entries[entry_count];
+			pidmap_insert(&cmd_index, entries[i].pid,
+				      entries[i].starttime, i);
+		}
+	}
+}
+
+/**
+ * cmdline_cleanup() - Free every cached command line
+ */
+void cmdline_cleanup(void)
+{
+	for (int i = 0; i < entry_count; i++) {
+		free(entries[i].text);
+	}
+	free(entries);
+	entries = NULL;
+	entry_count = 0;
+	entry_capacity = 0;
+	pidmap_free(&cmd_index);
+	pidmap_free(&live_index);
+}
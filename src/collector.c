@@ -0,0 +1,221 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "collector.h"
+#include "logger.h"
+
+// Chunks dealt to one thread; each on its own cache line
+typedef struct {
+	_Alignas(64) atomic_int next; // next chunk to claim
+	int end;                      // one past the last chunk of the run
+} ChunkRun;
+
+static pthread_t *workers;
+static ChunkRun *runs;
+static int thread_count = 1;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t start_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;
+static unsigned int job_generation; // bumped for every collector_run()
+static int pending;                 // workers still busy with the job
+static bool stopping;
+
+// Current job, published under lock before job_generation changes
+static CollectorFn job_fn;
+static void *job_ctx;
+static int job_items;
+static int job_chunk;
+
+/**
+ * run_chunks() - Process chunks until none are left anywhere
+ * @self: Index of the calling thread; its own run is drained first
+ */
+static void run_chunks(int self)
+{
+	for (int k = 0; k < thread_count; k++) {
+		ChunkRun *run = &runs[(self + k) % thread_count];
+
+		for (;;) {
+			int c = atomic_fetch_add_explicit(&run->next, 1,
+							  memory_order_relaxed);
+			if (c >= run->end) {
+				break;
+			}
+
+			int begin = c * job_chunk;
+			int end = begin + job_chunk;
+			if (end > job_items) {
+				end = job_items;
+			}
+			job_fn(job_ctx, begin, end);
+		}
+	}
+}
+
+static void *worker_main(void *arg)
+{
+	int self = (int)(intptr_t)arg;
+	unsigned int seen = 0;
+
+	pthread_mutex_lock(&lock);
+	for (;;) {
+		while (!stopping && job_generation == seen) {
+			pthread_cond_wait(&start_cond, &lock);
+		}
+		if (stopping) {
+			break;
+		}
+		seen = job_generation;
+		pthread_mutex_unlock(&lock);
+
+		run_chunks(self);
+
+		pthread_mutex_lock(&lock);
+		if (--pending == 0) {
+			pthread_cond_signal(&done_cond);
+		}
+	}
+	pthread_mutex_unlock(&lock);
+	return NULL;
+}
+
+/**
+ * collector_start() - Start the worker pool
+ * @threads: Total threads including the caller; 1 disables the pool
+ *
+ * If some workers cannot be created the pool runs with those that were.
+ *
+ * Return: 0 on success, -1 on allocation failure (the pool stays disabled)
+ */
+int collector_start(int threads)
+{
+	if (threads > COLLECTOR_MAX_THREADS) {
+		threads = COLLECTOR_MAX_THREADS;
+	}
+	if (threads <= 1 || workers) {
+		return 0;
+	}
+
+	runs = aligned_alloc(_Alignof(ChunkRun),
+			     (size_t)threads * sizeof(ChunkRun));
+	workers = calloc((size_t)threads - 1, sizeof(*workers));
+	if (!runs || !workers) {
+		log_error("Failed to allocate collector threads");
+		free(runs);
+		free(workers);
+		runs = NULL;
+		workers = NULL;
+		return -1;
+	}
+
+	stopping = false;
+	job_generation = 0;
+	int started = 0;
+	while (started < threads - 1) {
+		if (pthread_create(&workers[started], NULL, worker_main,
+				   (void *)(intptr_t)(started + 1)) != 0) {
+			break;
+		}
+		started++;
+	}
+	thread_count = started + 1;
+
+	char msg[128];
+	if (started < threads - 1) {
+		snprintf(msg, sizeof(msg),
+			 "Started only %d of %d collector threads",
+			 thread_count, threads);
+		log_warning(msg);
+	} else {
+		snprintf(msg, sizeof(msg), "Collecting with %d threads",
+			 thread_count);
+		log_info(msg);
+	}
+	return 0;
+}
+
+/**
+ * collector_stop() - Stop and join every worker
+ */
+void collector_stop(void)
+{
+	if (!workers) {
+		return;
+	}
+
+	pthread_mutex_lock(&lock);
+	stopping = true;
+	pthread_cond_broadcast(&start_cond);
+	pthread_mutex_unlock(&lock);
+
+	for (int i = 0; i < thread_count - 1; i++) {
+		pthread_join(workers[i], NULL);
+	}
+
+	free(workers);
+	free(runs);
+	workers = NULL;
+	runs = NULL;
+	thread_count = 1;
+}
+
+/**
+ * collector_threads() - Number of threads collector_run() uses
+ *
+ * Return: Threads including the caller; 1 when the pool is not running
+ */
+int collector_threads(void)
+{
+	return thread_count;
+}
+
+/**
+ * collector_run() - Run @fn over [0, @items) on every thread and wait
+ * @items: Number of items
+ * @chunk: Items per chunk, the unit of stealing
+ * @fn: Callback for a range of items
+ * @ctx: Passed to @fn
+ *
+ * Everything @fn wrote is visible to the caller on return.
+ */
+void collector_run(int items, int chunk, CollectorFn fn, void *ctx)
+{
+	if (items <= 0) {
+		return;
+	}
+
+	int chunks = (items + chunk - 1) / chunk;
+	if (thread_count == 1 || chunks == 1) {
+		fn(ctx, 0, items);
+		return;
+	}
+
+	for (int w = 0; w < thread_count; w++) {
+		atomic_store_explicit(&runs[w].next,
+				      (int)((int64_t)chunks * w / thread_count),
+				      memory_order_relaxed);
+		runs[w].end = (int)((int64_t)chunks * (w + 1) / thread_count);
+	}
+
+	pthread_mutex_lock(&lock);
+	job_fn = fn;
+	job_ctx = ctx;
+	job_items = items;
+	job_chunk = chunk;
+	pending = thread_count - 1;
+	job_generation++;
+	pthread_cond_broadcast(&start_cond);
+	pthread_mutex_unlock(&lock);
+
+	run_chunks(0);
+
+	pthread_mutex_lock(&lock);
+	while (pending > 0) {
+		pthread_cond_wait(&done_cond, &lock);
+	}
+	pthread_mutex_unlock(&lock);
+}
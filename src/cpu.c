@@ -1,82 +1,328 @@
-#include <stdio.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include "logger.h"
 #include "cpu.h"
+#include "procdir.h"
+
+// Enough for a few hundred cores; grown when the intr line is longer
+#define CPU_STAT_INITIAL_BUF (64 * 1024)
+
+// /proc/stat is kept open and re-read with pread() at offset 0
+static int stat_fd = -1;
+static char *stat_buf;
+static size_t stat_buf_size;
+
+static const char *skip_spaces(const char *p, const char *end)
+{
+	while (p < end && *p == ' ') {
+		p++;
+	}
+	return p;
+}
+
+static const char *parse_u64(const char *p, const char *end, uint64_t *out)
+{
+	uint64_t value = 0;
+
+	p = skip_spaces(p, end);
+	while (p < end && *p >= '0' && *p <= '9') {
+		value = value * 10 + (uint64_t)(*p - '0');
+		p++;
+	}
+	*out = value;
+	return p;
+}
 
 /**
- * read_total_cpu_time() - Read total CPU time across all cores
+ * parse_cpu_times() - Decode the counters of a "cpu" line
+ * @p: First character after the "cpu"/"cpuN" label
+ * @end: End of the line
+ * @t: Output counters
  *
- * Reads /proc/stat to sum all CPU time counters (user, nice, system, idle,
- * iowait, irq, softirq, steal) from the first line.
+ * Fields missing on older kernels (steal, guest, guest_nice) stay zero.
+ */
+static void parse_cpu_times(const char *p, const char *end, CpuTimes *t)
+{
+	uint64_t v[10] = {0};
+
+	for (int i = 0; i < 10; i++) {
+		p = skip_spaces(p, end);
+		if (p == end) {
+			break;
+		}
+		p = parse_u64(p, end, &v[i]);
+	}
+
+	t->user = v[0];
+	t->nice = v[1];
+	t->system = v[2];
+	t->idle = v[3];
+	t->iowait = v[4];
+	t->irq = v[5];
+	t->softirq = v[6];
+	t->steal = v[7];
+	t->guest = v[8];
+	t->guest_nice = v[9];
+}
+
+/**
+ * core_slot() - Get the counters of core @n, growing the array if needed
+ * @st: Stats being filled
+ * @n: Core number from the "cpuN" label
  *
- * Return: Total CPU time in jiffies, or -1 on error
+ * Return: Slot for the core, or NULL on allocation failure
  */
-long read_total_cpu_time(void)
+static CpuTimes *core_slot(CpuStat *st, int n)
 {
-	FILE *f = fopen("/proc/stat", "r");
-	if (!f) {
-		log_error("Failed to open /proc/stat");
-		return -1;
+	if (n >= st->core_capacity) {
+		int capacity = st->core_capacity ? st->core_capacity : 8;
+		while (capacity <= n) {
+			capacity *= 2;
+		}
+		CpuTimes *cores = realloc(st->cores,
+					  (size_t)capacity * sizeof(*cores));
+		if (!cores) {
+			return NULL;
+		}
+		st->cores = cores;
+		st->core_capacity = capacity;
 	}
 
-    char cpu[5];
-    long user, nice, system, idle, iowait, irq, softirq, steal;
-
-    int n = fscanf(
-        f,
-        "%4s %ld %ld %ld %ld %ld %ld %ld %ld",
-        cpu,
-        &user,
-        &nice,
-        &system,
-        &idle,
-        &iowait,
-        &irq,
-        &softirq,
-        &steal
-    );
-
-    fclose(f);
-
-    if (n < 9) {
-        log_error("Failed to read total CPU time");
-        return -1;
-    }
-
-	return user + nice + system + idle + iowait + irq + softirq + steal;
+	// Cores missing from the file (offline) read as zero
+	if (n >= st->core_count) {
+		memset(&st->cores[st->core_count], 0,
+		       (size_t)(n + 1 - st->core_count) * sizeof(CpuTimes));
+		st->core_count = n + 1;
+	}
+	return &st->cores[n];
+}
+
+static bool has_label(const char *p, const char *end, const char *label,
+		      size_t label_len)
+{
+	return (size_t)(end - p) > label_len &&
+	       memcmp(p, label, label_len) == 0 && p[label_len] == ' ';
 }
 
 /**
- * read_active_cpu_time() - Read active (non-idle) CPU time
+ * cpu_stat_parse() - Parse the contents of /proc/stat
+ * @buf: File contents (not necessarily NUL-terminated)
+ * @len: Number of bytes in @buf
+ * @st: Output stats; the core array is reused across calls
  *
- * Reads /proc/stat and returns only active time (excludes idle and iowait).
- * Used for calculating CPU load percentage.
+ * Only the first number of the intr line (the total) is decoded; the
+ * per-IRQ counts that follow are skipped.
  *
- * Return: Active CPU time in jiffies, or -1 on error
+ * Return: 0 on success, -1 if the aggregate cpu line is missing or the
+ * core array could not grow
  */
-long read_active_cpu_time(void)
+int cpu_stat_parse(const char *buf, size_t len, CpuStat *st)
 {
-	FILE *f = fopen("/proc/stat", "r");
-	if (!f) {
-		log_error("Failed to open /proc/stat");
-		return -1;
+	const char *p = buf;
+	const char *end = buf + len;
+	bool have_total = false;
+
+	st->core_count = 0;
+
+	while (p < end) {
+		const char *eol = memchr(p, '\n', (size_t)(end - p));
+		if (!eol) {
+			eol = end;
+		}
+
+		if (has_label(p, eol, "cpu", 3)) {
+			parse_cpu_times(p + 3, eol, &st->total);
+			have_total = true;
+		} else if (eol - p > 3 && memcmp(p, "cpu", 3) == 0 &&
+			   p[3] >= '0' && p[3] <= '9') {
+			uint64_t n;
+			const char *q = parse_u64(p + 3, eol, &n);
+			CpuTimes *core = n < (1u << 16) ? core_slot(st, (int)n) :
+							 NULL;
+			if (!core) {
+				log_error("Failed to grow per-core CPU stats");
+				return -1;
+			}
+			parse_cpu_times(q, eol, core);
+		} else if (has_label(p, eol, "ctxt", 4)) {
+			parse_u64(p + 4, eol, &st->ctxt);
+		} else if (has_label(p, eol, "intr", 4)) {
+			parse_u64(p + 4, eol, &st->intr);
+		} else if (has_label(p, eol, "processes", 9)) {
+			parse_u64(p + 9, eol, &st->processes);
+		} else if (has_label(p, eol, "procs_running", 13)) {
+			parse_u64(p + 13, eol, &st->procs_running);
+		} else if (has_label(p, eol, "procs_blocked", 13)) {
+			parse_u64(p + 13, eol, &st->procs_blocked);
+		}
+
+		p = eol < end ? eol + 1 : end;
+	}
+
+	return have_total ? 0 : -1;
+}
+
+/**
+ * cpu_stat_read() - Read and parse /proc/stat in a single pass
+ * @st: Output stats; zero-initialize before the first call
+ *
+ * The file is read whole with one pread() on a held descriptor. If it
+ * does not fit, the buffer doubles and the read is repeated.
+ *
+ * Return: 0 on success, -1 on error
+ */
+int cpu_stat_read(CpuStat *st)
+{
+	if (stat_fd < 0) {
+		stat_fd = procdir_open("stat");
+		if (stat_fd < 0) {
+			log_error("Failed to open /proc/stat");
+			return -1;
+		}
 	}
 
-	char cpu[5];
-	long user, nice, system, idle, iowait, irq, softirq, steal;
+	ssize_t len;
+	for (;;) {
+		if (!stat_buf) {
+			size_t size = stat_buf_size ? stat_buf_size * 2 :
+						      CPU_STAT_INITIAL_BUF;
+			stat_buf = malloc(size);
+			if (!stat_buf) {
+				log_error("Failed to allocate /proc/stat buffer");
+				return -1;
+			}
+			stat_buf_size = size;
+		}
 
-	int n = fscanf(f, "%4s %ld %ld %ld %ld %ld %ld %ld %ld",
-		       cpu, &user, &nice, &system, &idle,
-		       &iowait, &irq, &softirq, &steal);
+		len = pread(stat_fd, stat_buf, stat_buf_size, 0);
+		if (len < 0) {
+			log_error("Failed to read /proc/stat");
+			return -1;
+		}
+		if ((size_t)len < stat_buf_size) {
+			break;
+		}
 
-	fclose(f);
+		// Possibly truncated: retry with a larger buffer
+		free(stat_buf);
+		stat_buf = NULL;
+	}
 
-	if (n < 9) {
-		log_error("Failed to read active CPU time");
+	if (cpu_stat_parse(stat_buf, (size_t)len, st) != 0) {
+		log_error("Failed to parse /proc/stat");
 		return -1;
 	}
+	return 0;
+}
+
+/**
+ * cpu_stat_free() - Free the per-core array of a CpuStat
+ * @st: Stats filled by cpu_stat_read() or cpu_stat_parse()
+ */
+void cpu_stat_free(CpuStat *st)
+{
+	free(st->cores);
+	st->cores = NULL;
+	st->core_count = 0;
+	st->core_capacity = 0;
+}
+
+/**
+ * cpu_stat_copy() - Copy a CpuStat, including its per-core counters
+ * @dst: Destination; its core array is reused and grown as needed
+ * @src: Stats to copy
+ *
+ * Return: 0 on success, -1 on allocation failure (dst has no cores)
+ */
+int cpu_stat_copy(CpuStat *dst, const CpuStat *src)
+{
+	CpuTimes *cores = dst->cores;
+	int capacity = dst->core_capacity;
+
+	if (capacity < src->core_count) {
+		cores = realloc(cores, (size_t)src->core_count * sizeof(*cores));
+		if (!cores) {
+			dst->core_count = 0;
+			return -1;
+		}
+		capacity = src->core_count;
+	}
 
-	return user + nice + system + irq + softirq + steal;
+	*dst = *src;
+	dst->cores = cores;
+	dst->core_capacity = capacity;
+	if (src->core_count > 0) {
+		memcpy(cores, src->cores,
+		       (size_t)src->core_count * sizeof(*cores));
+	}
+	return 0;
+}
+
+/**
+ * cpu_stat_close() - Close /proc/stat and free the read buffer
+ */
+void cpu_stat_close(void)
+{
+	if (stat_fd >= 0) {
+		close(stat_fd);
+		stat_fd = -1;
+	}
+	free(stat_buf);
+	stat_buf = NULL;
+	stat_buf_size = 0;
+}
+
+/**
+ * cpu_times_total() - Total CPU time of a cpu line
+ * @t: Counters
+ *
+ * Guest time is already accounted in user and nice, so it is not added
+ * again.
+ *
+ * Return: Total CPU time in jiffies
+ */
+uint64_t cpu_times_total(const CpuTimes *t)
+{
+	return t->user + t->nice + t->system + t->idle + t->iowait +
+	       t->irq + t->softirq + t->steal;
+}
+
+/**
+ * cpu_times_active() - Active (non-idle) CPU time of a cpu line
+ * @t: Counters
+ *
+ * Return: Total time minus idle and iowait, in jiffies
+ */
+uint64_t cpu_times_active(const CpuTimes *t)
+{
+	return t->user + t->nice + t->system + t->irq + t->softirq + t->steal;
+}
+
+/**
+ * cpu_times_load() - Busy percentage between two samples of a cpu line
+ * @prev: Earlier sample
+ * @curr: Later sample
+ *
+ * Return: Active share of the elapsed CPU time (0-100), 0 if no time
+ * elapsed or the counters went backwards (core went offline)
+ */
+double cpu_times_load(const CpuTimes *prev, const CpuTimes *curr)
+{
+	uint64_t total_prev = cpu_times_total(prev);
+	uint64_t total_curr = cpu_times_total(curr);
+	uint64_t active_prev = cpu_times_active(prev);
+	uint64_t active_curr = cpu_times_active(curr);
+
+	if (total_curr <= total_prev || active_curr < active_prev) {
+		return 0.0;
+	}
+
+	double load = (double)(active_curr - active_prev) * 100.0 /
+		      (double)(total_curr - total_prev);
+	return load > 100.0 ? 100.0 : load;
 }
 
 /**
@@ -95,4 +341,3 @@ int get_cpu_cores(void)
 	}
 	return (int)cores;
 }
-
@@ -1,9 +1,67 @@
+#define _GNU_SOURCE // pread() on /proc/thread-self/io
+#include <fcntl.h>
 #include <ncurses.h>
+#include <stdarg.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <time.h>
+#include <unistd.h>
 #include "display.h"
 #include "process.h"
+#include "cmdline.h"
+
+// Text cells per screen line; header lines hold a few fields side by side
+#define CELL_SLOTS 6
+
+// Screen line of the table header; process rows start two lines below
+#define TABLE_LINE 7
+
+// Lines of the self-cost overlay, above the status bar
+#define SELF_LINES 3
+
+// Table column positions, matching "%-8s %-15s %-10s %-10s %-10s %-s"
+static const int column_x[] = { 0, 9, 25, 36, 47, 58 };
+static const int column_width[] = { 9, 16, 11, 11, 11, -1 };
+
+typedef struct {
+	int x;
+	int width;
+	attr_t attr;
+	bool valid;
+} CellInfo;
+
+/*
+ * What was last drawn into every cell of the screen. A frame rewrites
+ * only the cells whose text, attributes or position changed and never
+ * erases the screen, so an idle tick sends almost nothing to the
+ * terminal. A cell that gets shorter is padded with blanks to its width.
+ */
+static struct {
+	int lines;
+	int cols;
+	CellInfo *info;       // lines * CELL_SLOTS
+	char *text;           // lines * CELL_SLOTS strings of cols + 1 bytes
+	char *scratch;        // cols + 1 bytes for formatting a cell
+	int cells_drawn;      // cells rewritten in the frame being built
+	int cells_total;      // cells put in the frame being built
+} screen;
+
+// Output statistics of the last refresh, shown by display_debug()
+static struct {
+	bool measure;         // debug overlay is on
+	int io_fd;            // /proc/thread-self/io of the UI thread
+	uint64_t frame_bytes; // written to the tty by the last refresh
+	int cells_drawn;
+	int cells_total;
+	double bytes_per_s;
+	uint64_t window_bytes;
+	struct timespec window_start;
+} out_stats = { .io_fd = -1 };
+
+// Command lines come from the live /proc, which a replay cannot trust
+static bool show_cmdlines = true;
 
 /**
  * format_memory() - Format memory value with human-readable units
@@ -35,6 +93,116 @@ static void format_memory(uint64_t bytes, char *buf, size_t bufsize)
 	}
 }
 
+static CellInfo *cell_info(int line, int slot)
+{
+	return &screen.info[line * CELL_SLOTS + slot];
+}
+
+static char *cell_text(int line, int slot)
+{
+	return screen.text + ((size_t)line * CELL_SLOTS + slot) *
+			     (size_t)(screen.cols + 1);
+}
+
+// Make every cell of a line be drawn again by its next put_cell()
+static void forget_line(int line)
+{
+	if (line < 0 || line >= screen.lines) {
+		return;
+	}
+	for (int slot = 0; slot < CELL_SLOTS; slot++) {
+		cell_info(line, slot)->valid = false;
+	}
+}
+
+/**
+ * screen_reset() - Size the cell cache to the terminal and forget it
+ *
+ * Return: 0 on success, -1 on allocation failure (nothing is cached and
+ * put_cell() draws nothing)
+ */
+static int screen_reset(void)
+{
+	free(screen.info);
+	free(screen.text);
+	free(screen.scratch);
+	memset(&screen, 0, sizeof(screen));
+
+	int lines = LINES > 0 ? LINES : 1;
+	int cols = COLS > 0 ? COLS : 1;
+	size_t cells = (size_t)lines * CELL_SLOTS;
+
+	screen.info = calloc(cells, sizeof(*screen.info));
+	screen.text = malloc(cells * (size_t)(cols + 1));
+	screen.scratch = malloc((size_t)cols + 1);
+	if (!screen.info || !screen.text || !screen.scratch) {
+		free(screen.info);
+		free(screen.text);
+		free(screen.scratch);
+		memset(&screen, 0, sizeof(screen));
+		return -1;
+	}
+
+	screen.lines = lines;
+	screen.cols = cols;
+	return 0;
+}
+
+/**
+ * put_cell() - Draw formatted text into a cell if it changed
+ * @line: Screen line
+ * @slot: Cell index within the line, 0 to CELL_SLOTS - 1
+ * @x: First column of the cell
+ * @width: Columns the cell covers, or -1 for the rest of the line
+ * @attr: Attributes and color pair
+ * @fmt: printf() format of the text
+ *
+ * Text longer than the cell is cut off; shorter text is padded with
+ * blanks, so whatever the cell showed before is overwritten.
+ */
+static void put_cell(int line, int slot, int x, int width, attr_t attr,
+		     const char *fmt, ...)
+	__attribute__((format(printf, 6, 7)));
+
+static void put_cell(int line, int slot, int x, int width, attr_t attr,
+		     const char *fmt, ...)
+{
+	if (line < 0 || line >= screen.lines || x >= screen.cols) {
+		return;
+	}
+	if (width < 0 || width > screen.cols - x) {
+		width = screen.cols - x;
+	}
+
+	va_list ap;
+	va_start(ap, fmt);
+	vsnprintf(screen.scratch, (size_t)width + 1, fmt, ap);
+	va_end(ap);
+
+	screen.cells_total++;
+	CellInfo *c = cell_info(line, slot);
+	char *text = cell_text(line, slot);
+	if (c->valid && c->x == x && c->width == width && c->attr == attr &&
+	    strcmp(text, screen.scratch) == 0) {
+		return;
+	}
+
+	int len = (int)strlen(screen.scratch);
+	attrset(attr);
+	mvaddstr(line, x, screen.scratch);
+	if (len < width) {
+		hline(' ', width - len);
+	}
+	attrset(A_NORMAL);
+
+	memcpy(text, screen.scratch, (size_t)len + 1);
+	c->x = x;
+	c->width = width;
+	c->attr = attr;
+	c->valid = true;
+	screen.cells_drawn++;
+}
+
 /**
  * display_init() - Initialize ncurses display
  *
@@ -47,11 +215,12 @@ void display_init(void)
 	noecho();
 	curs_set(0);
 	keypad(stdscr, TRUE);
-	timeout(100); // 100ms timeout for getch()
+	nodelay(stdscr, TRUE); // getch() never blocks; main polls stdin
 	start_color();
 	init_pair(1, COLOR_CYAN, COLOR_BLACK);
 	init_pair(2, COLOR_GREEN, COLOR_BLACK);
 	init_pair(3, COLOR_YELLOW, COLOR_BLACK);
+	screen_reset();
 }
 
 /**
@@ -62,6 +231,46 @@ void display_init(void)
 void display_cleanup(void)
 {
 	endwin();
+	free(screen.info);
+	free(screen.text);
+	free(screen.scratch);
+	memset(&screen, 0, sizeof(screen));
+	if (out_stats.io_fd >= 0) {
+		close(out_stats.io_fd);
+		out_stats.io_fd = -1;
+	}
+}
+
+/**
+ * display_begin_frame() - Start drawing a frame
+ *
+ * Call before the display_* functions of every frame. The screen is only
+ * erased when the terminal was resized; otherwise cells keep what they
+ * showed and are rewritten one by one as they change.
+ */
+void display_begin_frame(void)
+{
+	if (LINES != screen.lines || COLS != screen.cols) {
+		screen_reset();
+		erase();
+	}
+	screen.cells_drawn = 0;
+	screen.cells_total = 0;
+}
+
+/**
+ * display_invalidate() - Forget what every cell shows
+ *
+ * For code that draws on the screen behind the cell cache, such as the
+ * input prompts. The next frame rewrites every cell into the ncurses
+ * window; refresh() still only sends what differs from the terminal.
+ */
+void display_invalidate(void)
+{
+	if (screen.info) {
+		memset(screen.info, 0,
+		       (size_t)screen.lines * CELL_SLOTS * sizeof(*screen.info));
+	}
 }
 
 /**
@@ -76,162 +285,367 @@ void display_cleanup(void)
  * @sort_cpu: Sorting by CPU flag
  * @sort_mem: Sorting by memory flag
  * @reversed: Reverse sort flag
+ * @interval_ms: Sampling interval
  *
  * Displays system information at the top of the screen.
  */
 void display_header(int days, int hours, int minutes, double cpu_load,
 		    uint64_t used_mem_mb, uint64_t total_mem_mb,
 		    int process_count, bool sort_cpu, bool sort_mem,
-		    bool reversed)
-{
-	attron(COLOR_PAIR(1) | A_BOLD);
-	mvprintw(0, 0, "Process Monitor");
-	attroff(COLOR_PAIR(1) | A_BOLD);
-
-	attron(COLOR_PAIR(2));
-	mvprintw(1, 0, "Uptime: %d days, %d hours, %d mins", days, hours,
-		 minutes);
-	mvprintw(2, 0, "CPU Load: %.1f/100.0", cpu_load);
-	mvprintw(3, 0, "Processes: %d", process_count);
-	mvprintw(4, 0, "Memory: %.1f/%.1f GB",
+		    bool reversed, int interval_ms)
+{
+	attr_t text = COLOR_PAIR(2);
+
+	put_cell(0, 0, 0, 24, COLOR_PAIR(1) | A_BOLD, "Process Monitor");
+	put_cell(1, 0, 0, -1, text, "Uptime: %d days, %d hours, %d mins",
+		 days, hours, minutes);
+	put_cell(2, 0, 0, 24, text, "CPU Load: %.1f/100.0", cpu_load);
+	put_cell(3, 0, 0, 24, text, "Processes: %d", process_count);
+	put_cell(4, 0, 0, 24, text, "Memory: %.1f/%.1f GB",
 		 used_mem_mb / 1024.0, total_mem_mb / 1024.0);
 
 	// Display sort mode
-	attron(COLOR_PAIR(3) | A_BOLD);
-	mvprintw(5, 0, "Sort: ");
-	attroff(COLOR_PAIR(3) | A_BOLD);
-
+	put_cell(5, 0, 0, 6, COLOR_PAIR(3) | A_BOLD, "Sort: ");
 	if (sort_cpu || sort_mem) {
-		attron(A_BOLD | COLOR_PAIR(2));
-		if (sort_cpu) {
-			printw("CPU");
-		} else {
-			printw("MEM");
-		}
-		attroff(A_BOLD | COLOR_PAIR(2));
-
-		if (reversed) {
-			printw(" ");
-			attron(A_BOLD | COLOR_PAIR(3));
-			printw("(reversed)");
-			attroff(A_BOLD | COLOR_PAIR(3));
-		}
+		put_cell(5, 1, 6, 3, A_BOLD | COLOR_PAIR(2), "%s",
+			 sort_cpu ? "CPU" : "MEM");
 	} else {
-		attron(COLOR_PAIR(1));
-		printw("OFF");
-		attroff(COLOR_PAIR(1));
+		put_cell(5, 1, 6, 3, COLOR_PAIR(1), "OFF");
 	}
+	put_cell(5, 2, 9, 15, A_BOLD | COLOR_PAIR(3), "%s",
+		 (sort_cpu || sort_mem) && reversed ? " (reversed)" : "");
 
-	attroff(COLOR_PAIR(2));
+	put_cell(5, 3, 24, 18, text, "Interval: %.2gs", interval_ms / 1000.0);
 }
 
 /**
- * display_process_info() - Display process information table
- * @processes: Array of ProcessInfo structures
- * @count: Number of processes in the array
- * @scroll_offset: Number of processes to skip from the beginning
- * @search_term: Optional search filter (empty string for no filter)
+ * display_cpu_stats() - Show per-core load and kernel activity rates
+ * @prev: /proc/stat sample from the previous tick
+ * @curr: /proc/stat sample from this tick
+ * @elapsed_s: Seconds between the two samples
  *
- * Displays a formatted table with columns: PID, Name, CPU%, MEM(KB), MEM%.
- * Automatically adjusts number of displayed processes based on terminal height.
- * Name column is 40 characters wide and truncates long process names.
- * Supports scrolling and filtering by process name.
+ * Per-core load goes next to the overall load and is cut off at the
+ * right edge of the terminal; context switch and fork rates go next to
+ * the memory line.
  */
-void display_process_info(ProcessInfo *processes, int count, int scroll_offset,
-			  const char *search_term)
+void display_cpu_stats(const CpuStat *prev, const CpuStat *curr,
+		       double elapsed_s)
 {
-	int header_line = 7;
+	int cores = prev->core_count < curr->core_count ? prev->core_count :
+							  curr->core_count;
+
+	char loads[512] = "Cores:";
+	size_t len = strlen(loads);
+	for (int i = 0; i < cores && 24 + len + 5 <= (size_t)COLS &&
+			len + 6 < sizeof(loads); i++) {
+		len += (size_t)snprintf(loads + len, sizeof(loads) - len,
+					" %3.0f%%",
+					cpu_times_load(&prev->cores[i],
+						       &curr->cores[i]));
+	}
+	put_cell(2, 1, 24, -1, COLOR_PAIR(2), "%s", loads);
 
-	attron(COLOR_PAIR(3) | A_BOLD);
-	mvprintw(header_line, 0, "%-8s %-15s %-10s %-10s %-10s %-s",
-		 "PID", "NAME", "CPU%", "MEM", "MEM%", "COMMAND");
-	attroff(COLOR_PAIR(3) | A_BOLD);
+	double ctxt_rate = 0.0;
+	double fork_rate = 0.0;
+	if (elapsed_s > 0.0) {
+		ctxt_rate = (double)(curr->ctxt - prev->ctxt) / elapsed_s;
+		fork_rate = (double)(curr->processes - prev->processes) /
+			    elapsed_s;
+	}
+	put_cell(4, 1, 24, -1, COLOR_PAIR(2),
+		 "Ctxt/s: %.0f  Forks/s: %.0f  Running: %lu  Blocked: %lu",
+		 ctxt_rate, fork_rate, curr->procs_running,
+		 curr->procs_blocked);
+}
 
-	mvprintw(header_line + 1, 0,
-		 "%-8s %-15s %-10s %-10s %-10s %-s",
-		 "--------", "---------------",
-		 "----------", "----------", "----------",
-		 "-------------------------------------------------------");
+/**
+ * display_proc_events() - Show process events seen during the last tick
+ * @forks: Processes created
+ * @execs: Programs executed
+ * @exits: Processes exited
+ *
+ * Printed next to the process count. Includes processes that lived and
+ * died between two ticks and so never appear in the table.
+ */
+void display_proc_events(uint64_t forks, uint64_t execs, uint64_t exits)
+{
+	put_cell(3, 1, 24, -1, COLOR_PAIR(2),
+		 "Events: %lu forks, %lu execs, %lu exits",
+		 forks, execs, exits);
+}
 
-	// Calculate maximum displayable processes based on terminal height
+/**
+ * display_sampling() - Show how the last tick sampled processes
+ * @stale: Rows carried over without being read
+ * @total: Rows in the table
+ * @adaptive: Adaptive sampling is on
+ *
+ * Printed next to the interval.
+ */
+void display_sampling(int stale, int total, bool adaptive)
+{
+	if (adaptive) {
+		put_cell(5, 4, 42, -1, COLOR_PAIR(2),
+			 "Sampling: adaptive, read %d/%d", total - stale, total);
+	} else {
+		put_cell(5, 4, 42, -1, COLOR_PAIR(2), "Sampling: full");
+	}
+}
+
+/**
+ * display_warning() - Show or clear the warning line below the header
+ * @message: Warning text, or NULL to clear the line
+ */
+void display_warning(const char *message)
+{
+	put_cell(6, 0, 0, -1, COLOR_PAIR(3) | A_BOLD, "%s",
+		 message ? message : "");
+}
+
+/**
+ * display_visible_rows() - Number of table rows that fit on screen
+ *
+ * Return: Rows available for processes, at least 1
+ */
+int display_visible_rows(void)
+{
 	// LINES - header(7) - table_header(2) - status(1) = LINES - 10
 	int max_display = LINES - 11;
+	if (out_stats.measure) {
+		max_display -= SELF_LINES;
+	}
 	if (max_display < 1) {
 		max_display = 1;
 	}
+	return max_display;
+}
 
-	bool has_filter = search_term && search_term[0] != '\0';
-	int displayed = 0;
-	int skipped = 0;
+/**
+ * display_process_info() - Display process information table
+ * @t: Process table
+ * @order: Rows to list, in display order: the table's order column, or
+ *         the sorted matches of a filter
+ * @rows: Number of entries in @order
+ * @scroll_offset: Number of rows to skip from the beginning
+ * @search_term: Filter @order was built with (empty string for none)
+ *
+ * Displays a formatted table with columns: PID, Name, CPU%, MEM(KB), MEM%.
+ * Automatically adjusts number of displayed processes based on terminal height.
+ * Name column is 40 characters wide and truncates long process names.
+ * Supports scrolling; filtering is left to the caller (see view.h), so a
+ * frame touches only the visible rows. Rows carried over
+ * unread by adaptive sampling are dimmed. Every column of every line is
+ * its own cell, so a row whose CPU% changed rewrites only that column.
+ */
+void display_process_info(const ProcessTable *t, const uint32_t *order,
+			  int rows, int scroll_offset, const char *search_term)
+{
+	static const char *const titles[] = {
+		"PID", "NAME", "CPU%", "MEM", "MEM%", "COMMAND",
+	};
+	static const char *const rules[] = {
+		"--------", "---------------", "----------", "----------",
+		"----------",
+		"-------------------------------------------------------",
+	};
 
-	for (int i = 0; i < count && displayed < max_display; i++) {
-		// Apply search filter
-		if (has_filter && strstr(processes[i].name, search_term) == NULL) {
-			continue;
-		}
+	for (int c = 0; c < CELL_SLOTS; c++) {
+		put_cell(TABLE_LINE, c, column_x[c], column_width[c],
+			 COLOR_PAIR(3) | A_BOLD, "%s", titles[c]);
+		put_cell(TABLE_LINE + 1, c, column_x[c], column_width[c],
+			 A_NORMAL, "%s", rules[c]);
+	}
 
-		// Apply scroll offset
-		if (skipped < scroll_offset) {
-			skipped++;
-			continue;
-		}
+	int max_display = display_visible_rows();
 
-		int line = header_line + 2 + displayed;
+	int displayed = 0;
 
-		// Truncate name to 15 chars
-		char name_truncated[16];
-		strncpy(name_truncated, processes[i].name, 15);
-		name_truncated[15] = '\0';
+	for (int i = scroll_offset < 0 ? 0 : scroll_offset;
+	     i < rows && displayed < max_display; i++) {
+		int row = (int)order[i];
+		const char *name = process_name(t, row);
+		int line = TABLE_LINE + 2 + displayed;
+		attr_t attr = t->flags[row] & PROC_STALE ? A_DIM : A_NORMAL;
 
-		mvprintw(line, 0, "%-8d %-15s ",
-			 processes[i].pid, name_truncated);
+		// Name is cut to 15 chars by the column width
+		put_cell(line, 0, column_x[0], column_width[0], attr, "%d",
+			 t->pid[row]);
+		put_cell(line, 1, column_x[1], column_width[1], attr, "%.15s",
+			 name);
 
-		if (processes[i].cpu_valid) {
-			printw("%-10.2f ", processes[i].cpu_percent);
+		if (t->flags[row] & PROC_CPU_VALID) {
+			put_cell(line, 2, column_x[2], column_width[2], attr,
+				 "%.2f", t->cpu_percent[row]);
 		} else {
-			printw("%-10s ", "-");
+			put_cell(line, 2, column_x[2], column_width[2], attr, "-");
 		}
 
-		if (processes[i].mem_valid) {
+		if (t->flags[row] & PROC_MEM_VALID) {
 			char mem_str[16];
-			format_memory(processes[i].mem_bytes, mem_str,
+			format_memory(t->mem_bytes[row], mem_str,
 				      sizeof(mem_str));
-			printw("%-10s %-10.2f ",
-			       mem_str, processes[i].mem_percent);
+			put_cell(line, 3, column_x[3], column_width[3], attr,
+				 "%s", mem_str);
+			put_cell(line, 4, column_x[4], column_width[4], attr,
+				 "%.2f", t->mem_percent[row]);
 		} else {
-			printw("%-10s %-10s ", "-", "-");
+			put_cell(line, 3, column_x[3], column_width[3], attr, "-");
+			put_cell(line, 4, column_x[4], column_width[4], attr, "-");
 		}
 
-		// Print command line
-		if (processes[i].cmd_valid) {
-			printw("%s", processes[i].cmdline);
-		} else {
-			printw("-");
-		}
+		// Print command line, read from /proc only for visible rows
+		const char *cmdline = show_cmdlines ?
+				      cmdline_get(t->pid[row], t->starttime[row],
+						  name) :
+				      NULL;
+		put_cell(line, 5, column_x[5], column_width[5], attr, "%s",
+			 cmdline ? cmdline : "-");
 
 		displayed++;
 	}
 
-	// Clear remaining lines
+	// Blank the remaining lines
 	for (int i = displayed; i < max_display; i++) {
-		int line = header_line + 2 + i;
-		move(line, 0);
-		clrtoeol();
+		int line = TABLE_LINE + 2 + i;
+		for (int c = 0; c < CELL_SLOTS; c++) {
+			put_cell(line, c, column_x[c], column_width[c],
+				 A_NORMAL, "%s", "");
+		}
 	}
 
 	// Display status bar
 	if (search_term && search_term[0] != '\0') {
-		attron(COLOR_PAIR(3) | A_BOLD);
-		mvprintw(LINES - 1, 0,
-			 "Filter: '%s' | ESC:Clear Offset:%d",
-			 search_term, scroll_offset);
-		attroff(COLOR_PAIR(3) | A_BOLD);
+		put_cell(LINES - 1, 0, 0, -1, COLOR_PAIR(3) | A_BOLD,
+			 "Filter: '%s' | %d of %d | ESC:Clear Offset:%d",
+			 search_term, rows, t->count, scroll_offset);
 	} else {
-		mvprintw(LINES - 1, 0,
-			 "q:Quit c:CPU m:MEM r:Rev f:Search k:Kill ESC:Clear Offset:%d",
+		put_cell(LINES - 1, 0, 0, -1, A_NORMAL,
+			 "q:Quit c:CPU m:MEM r:Rev f:Search k:Kill +/-:Interval a:Adaptive d:Debug ESC:Clear Offset:%d",
 			 scroll_offset);
 	}
-	clrtoeol();
+}
+
+/**
+ * thread_wchar() - Bytes the calling thread has passed to write() so far
+ *
+ * Return: wchar of /proc/thread-self/io, or 0 if I/O accounting is
+ * unavailable
+ */
+static uint64_t thread_wchar(void)
+{
+	if (out_stats.io_fd < 0) {
+		out_stats.io_fd = open("/proc/thread-self/io",
+				       O_RDONLY | O_CLOEXEC);
+		if (out_stats.io_fd < 0) {
+			return 0;
+		}
+	}
+
+	char buf[256];
+	ssize_t n = pread(out_stats.io_fd, buf, sizeof(buf) - 1, 0);
+	if (n <= 0) {
+		return 0;
+	}
+	buf[n] = '\0';
+
+	const char *field = strstr(buf, "wchar:");
+	return field ? strtoull(field + 6, NULL, 10) : 0;
+}
+
+/**
+ * display_show_cmdlines() - Turn the COMMAND column on or off
+ * @enabled: Read command lines of visible rows from /proc
+ *
+ * Replay turns it off: the recorded processes may be gone, or their PIDs
+ * reused, so /proc no longer describes them.
+ */
+void display_show_cmdlines(bool enabled)
+{
+	show_cmdlines = enabled;
+}
+
+/**
+ * display_debug() - Show or hide the output statistics overlay
+ * @enabled: Overlay is on
+ *
+ * Shows what the previous refresh sent to the terminal: bytes for the
+ * frame, bytes per second, and cells rewritten out of all cells put.
+ * Bytes are measured only while the overlay is on, from the write()
+ * accounting of the UI thread around refresh(). The overlay also takes
+ * SELF_LINES lines above the status bar for display_self_stats(); call
+ * this before display_visible_rows() in a frame.
+ */
+void display_debug(bool enabled)
+{
+	// The overlay lines switch between one wide cell and table cells
+	bool changed = enabled != out_stats.measure;
+	out_stats.measure = enabled;
+	if (changed) {
+		int table_end = TABLE_LINE + 2 + display_visible_rows();
+		for (int line = LINES - 1 - SELF_LINES; line < LINES - 1; line++) {
+			forget_line(line);
+			// Nothing else draws the lines the table does not reach
+			if (!enabled && line >= table_end) {
+				put_cell(line, 0, 0, -1, A_NORMAL, "%s", "");
+			}
+		}
+	}
+	if (!enabled) {
+		put_cell(0, 1, 24, -1, A_NORMAL, "%s", "");
+		return;
+	}
+
+	put_cell(0, 1, 24, -1, COLOR_PAIR(3),
+		 "tty: %lu B/frame, %.0f B/s, %d/%d cells rewritten",
+		 out_stats.frame_bytes, out_stats.bytes_per_s,
+		 out_stats.cells_drawn, out_stats.cells_total);
+}
+
+// One phase as "name p50/p99" in microseconds, or "name -" if never run
+static int format_phase(char *buf, size_t size, const SelfStats *s, Phase p)
+{
+	if (s->samples[p] == 0) {
+		return snprintf(buf, size, "  %s -", selfstat_phase_name(p));
+	}
+	return snprintf(buf, size, "  %s %lu/%lu", selfstat_phase_name(p),
+			(unsigned long)(s->p50_ns[p] / 1000),
+			(unsigned long)(s->p99_ns[p] / 1000));
+}
+
+/**
+ * display_self_stats() - Show what the monitor itself costs
+ * @s: Snapshot from selfstat_read()
+ *
+ * Part of the debug overlay: draws nothing unless display_debug() turned
+ * it on for this frame. Takes the last lines above the status bar, which
+ * display_visible_rows() leaves out while the overlay is on.
+ */
+void display_self_stats(const SelfStats *s)
+{
+	if (!out_stats.measure) {
+		return;
+	}
+
+	char rss[16], proc_bytes[16];
+	format_memory(s->rss_bytes, rss, sizeof(rss));
+	format_memory(s->proc_bytes, proc_bytes, sizeof(proc_bytes));
+	int line = LINES - 1 - SELF_LINES;
+	put_cell(line, 0, 0, -1, COLOR_PAIR(3),
+		 "Self: CPU %.1f%%  RSS %s  /proc per tick: %lu syscalls, %s  log drops: %lu",
+		 s->cpu_percent, rss, (unsigned long)s->proc_syscalls,
+		 proc_bytes, (unsigned long)s->log_dropped);
+
+	// p50/p99 of each phase, three per line
+	for (int row = 0; row < 2; row++) {
+		char text[256];
+		int len = snprintf(text, sizeof(text), "%s",
+				   row == 0 ? "p50/p99 us:" : "           ");
+		for (int p = row * 3; p < row * 3 + 3 && p < PHASE_COUNT; p++) {
+			len += format_phase(text + len, sizeof(text) - (size_t)len,
+					    s, (Phase)p);
+		}
+		put_cell(line + 1 + row, 0, 0, -1, COLOR_PAIR(3), "%s", text);
+	}
 }
 
 /**
@@ -241,5 +655,30 @@ void display_process_info(ProcessInfo *processes, int count, int scroll_offset,
  */
 void display_refresh(void)
 {
+	out_stats.cells_drawn = screen.cells_drawn;
+	out_stats.cells_total = screen.cells_total;
+
+	if (!out_stats.measure) {
+		refresh();
+		return;
+	}
+
+	uint64_t before = thread_wchar();
 	refresh();
+	out_stats.frame_bytes = thread_wchar() - before;
+
+	// Rate over windows of at least a second
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (out_stats.window_start.tv_sec == 0) {
+		out_stats.window_start = now;
+	}
+	out_stats.window_bytes += out_stats.frame_bytes;
+	double window_s = (double)(now.tv_sec - out_stats.window_start.tv_sec) +
+			  (double)(now.tv_nsec - out_stats.window_start.tv_nsec) / 1e9;
+	if (window_s >= 1.0) {
+		out_stats.bytes_per_s = (double)out_stats.window_bytes / window_s;
+		out_stats.window_bytes = 0;
+		out_stats.window_start = now;
+	}
 }
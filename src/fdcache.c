@@ -0,0 +1,294 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "fdcache.h"
+#include "logger.h"
+#include "pidmap.h"
+#include "procdir.h"
+#include "syscount.h"
+
+// Descriptors left for ncurses, the log file and one-off /proc reads
+#define FDCACHE_RESERVED_FDS 64
+#define FDCACHE_MIN_CAPACITY 256
+
+typedef struct {
+	int pid;
+	int stat_fd;          // -1 when not open
+	unsigned int seen;    // scan generation that last listed this PID
+} FdCacheEntry;
+
+// Dense array of entries; pid_index maps pid -> position in it
+static FdCacheEntry *entries;
+static int entry_count;
+static int entry_capacity;
+static PidMap pid_index;
+
+static unsigned int generation;
+static int max_entries;
+static bool initialized;
+
+/**
+ * fdcache_init() - Size the cache from RLIMIT_NOFILE
+ *
+ * Every cached entry holds one descriptor. The cache never grows past the
+ * soft limit minus FDCACHE_RESERVED_FDS; PIDs beyond that are read with a
+ * plain open/read/close. Called lazily on first use if not called
+ * explicitly.
+ */
+void fdcache_init(void)
+{
+	if (initialized) {
+		return;
+	}
+
+	struct rlimit rl;
+	rlim_t limit = 1024;
+	if (getrlimit(RLIMIT_NOFILE, &rl) == 0) {
+		limit = rl.rlim_cur;
+	}
+	if (limit == RLIM_INFINITY || limit > (1 << 20)) {
+		limit = 1 << 20;
+	}
+
+	max_entries = limit > FDCACHE_RESERVED_FDS ?
+		      (int)(limit - FDCACHE_RESERVED_FDS) : 0;
+	pidmap_init(&pid_index);
+	initialized = true;
+
+	char msg[128];
+	snprintf(msg, sizeof(msg), "fd cache: up to %d cached /proc fds",
+		 max_entries);
+	log_info(msg);
+}
+
+static void entry_release(FdCacheEntry *e)
+{
+	if (e->stat_fd >= 0) {
+		syscount_add(1, 0);
+		close(e->stat_fd);
+		e->stat_fd = -1;
+	}
+}
+
+/**
+ * evict() - Close an entry and remove it from the cache
+ * @pos: Position of the entry in the dense array
+ *
+ * The last entry is moved into the hole, so positions are not stable
+ * across evictions.
+ */
+static void evict(int pos)
+{
+	FdCacheEntry *e = &entries[pos];
+
+	entry_release(e);
+	pidmap_remove(&pid_index, e->pid, 0);
+
+	entry_count--;
+	if (pos != entry_count) {
+		entries[pos] = entries[entry_count];
+		pidmap_insert(&pid_index, entries[pos].pid, 0, pos);
+	}
+}
+
+/**
+ * fdcache_cleanup() - Close every cached descriptor and free the cache
+ */
+void fdcache_cleanup(void)
+{
+	for (int i = 0; i < entry_count; i++) {
+		entry_release(&entries[i]);
+	}
+	free(entries);
+	entries = NULL;
+	entry_count = 0;
+	entry_capacity = 0;
+	pidmap_free(&pid_index);
+	initialized = false;
+}
+
+/**
+ * fdcache_begin_scan() - Start a new /proc listing pass
+ */
+void fdcache_begin_scan(void)
+{
+	fdcache_init();
+	generation++;
+}
+
+/**
+ * fdcache_end_scan() - Evict PIDs that were not listed in this pass
+ */
+void fdcache_end_scan(void)
+{
+	int i = 0;
+	while (i < entry_count) {
+		if (entries[i].seen != generation) {
+			evict(i); // moves another entry into position i
+		} else {
+			i++;
+		}
+	}
+}
+
+/**
+ * lookup_or_add() - Find the entry for a PID, creating it if needed
+ * @pid: Process ID
+ *
+ * Return: Position of the entry, or -1 if the descriptor budget is used up
+ * or memory is exhausted
+ */
+static int lookup_or_add(int pid)
+{
+	int pos = pidmap_find(&pid_index, pid, 0);
+	if (pos >= 0) {
+		return pos;
+	}
+
+	if (entry_count >= max_entries) {
+		return -1;
+	}
+
+	if (entry_count == entry_capacity) {
+		int capacity = entry_capacity ? entry_capacity * 2 :
+			       FDCACHE_MIN_CAPACITY;
+		FdCacheEntry *grown = realloc(entries,
+					      capacity * sizeof(FdCacheEntry));
+		if (!grown) {
+			return -1;
+		}
+		entries = grown;
+		entry_capacity = capacity;
+	}
+
+	pos = entry_count;
+	if (pidmap_insert(&pid_index, pid, 0, pos) != 0) {
+		return -1;
+	}
+
+	entries[pos].pid = pid;
+	entries[pos].stat_fd = -1;
+	entries[pos].seen = generation;
+	entry_count++;
+	return pos;
+}
+
+static ssize_t read_uncached(int pid, const char *name, char *buf,
+			     size_t size)
+{
+	int fd = procdir_openat(pid, name);
+	if (fd < 0) {
+		return -1;
+	}
+
+	ssize_t n = read(fd, buf, size);
+	close(fd);
+	syscount_add(2, n > 0 ? (uint64_t)n : 0);
+	return n;
+}
+
+/**
+ * fdcache_slot() - Resolve the cache slot of a PID for this scan
+ * @pid: Process ID
+ *
+ * Finds or creates the entry and marks the PID as listed in the current
+ * scan. Slots stay valid until the next fdcache_slot(), eviction or
+ * fdcache_end_scan(), so a caller can resolve every PID up front and then
+ * read distinct slots from several threads with fdcache_read_slot().
+ *
+ * Return: Slot, or -1 if the PID has to be read uncached
+ */
+int fdcache_slot(int pid)
+{
+	fdcache_init();
+
+	int pos = lookup_or_add(pid);
+	if (pos >= 0) {
+		entries[pos].seen = generation;
+	}
+	return pos;
+}
+
+/**
+ * fdcache_slot_fd() - Get the cached descriptor of a slot
+ * @slot: Slot from fdcache_slot(), or -1
+ *
+ * Lets a caller issue the read itself (e.g. batched through io_uring) and
+ * fall back to fdcache_read_slot() only if that read fails.
+ *
+ * Return: Open /proc/[pid]/stat descriptor, or -1 if none is cached yet
+ */
+int fdcache_slot_fd(int slot)
+{
+	return slot >= 0 ? entries[slot].stat_fd : -1;
+}
+
+/**
+ * fdcache_read_slot() - Read /proc/[pid]/stat through a resolved slot
+ * @slot: Slot from fdcache_slot(), or -1 for an uncached read
+ * @pid: Process ID the slot was resolved for
+ * @buf: Output buffer (not NUL-terminated)
+ * @size: Buffer size
+ *
+ * Re-samples a cached descriptor with pread(). A read that fails or returns
+ * nothing means the process the descriptor refers to is gone (ESRCH), so
+ * the descriptor is reopened once in case the PID now names a new process.
+ * On failure the descriptor is closed but the entry is kept; only the
+ * slot's own entry is touched, so distinct slots may be read concurrently.
+ *
+ * Return: Number of bytes read, or -1 if the process does not exist
+ */
+ssize_t fdcache_read_slot(int slot, int pid, char *buf, size_t size)
+{
+	if (slot < 0) {
+		return read_uncached(pid, "stat", buf, size);
+	}
+
+	FdCacheEntry *e = &entries[slot];
+
+	if (e->stat_fd >= 0) {
+		ssize_t n = pread(e->stat_fd, buf, size, 0);
+		syscount_add(1, n > 0 ? (uint64_t)n : 0);
+		if (n > 0) {
+			return n;
+		}
+		entry_release(e);
+	}
+
+	e->stat_fd = procdir_openat(pid, "stat");
+	if (e->stat_fd < 0) {
+		return -1;
+	}
+
+	ssize_t n = pread(e->stat_fd, buf, size, 0);
+	syscount_add(1, n > 0 ? (uint64_t)n : 0);
+	if (n <= 0) {
+		entry_release(e);
+		return -1;
+	}
+	return n;
+}
+
+/**
+ * fdcache_read_stat() - Read /proc/[pid]/stat through the cache
+ * @pid: Process ID
+ * @buf: Output buffer (not NUL-terminated)
+ * @size: Buffer size
+ *
+ * Single-threaded shorthand for fdcache_slot() plus fdcache_read_slot()
+ * that also evicts the PID when it turns out to be gone.
+ *
+ * Return: Number of bytes read, or -1 if the process does not exist
+ */
+ssize_t fdcache_read_stat(int pid, char *buf, size_t size)
+{
+	int pos = fdcache_slot(pid);
+	ssize_t n = fdcache_read_slot(pos, pid, buf, size);
+
+	if (n < 0 && pos >= 0) {
+		evict(pos);
+	}
+	return n;
+}
@@ -0,0 +1,840 @@
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "history.h"
+#include "logger.h"
+
+#define MS_PER_DAY (24ull * 60 * 60 * 1000)
+
+// A day's files are named YYYYMMDD plus one of these
+#define DATA_SUFFIX ".pbh"
+#define INDEX_SUFFIX ".pbi"
+#define DAY_NAME_LEN 8
+
+// Most bytes one row can take: a varint of each column, the time as a run
+#define ROW_MAX_BYTES (4 * 10 + 10)
+
+// Bounds-checked cursor over one compressed column
+typedef struct {
+	const uint8_t *p;
+	const uint8_t *end;
+	bool bad;
+} Reader;
+
+// Rows of one block, as columns
+typedef struct {
+	uint64_t *time_ms;
+	int32_t *pid;
+	uint32_t *cpu;
+	uint64_t *rss;       // bytes; whole KiB
+	int count;
+} Columns;
+
+// Writer; touched only by the thread that calls history_append()
+static struct {
+	int dir_fd;
+	int data_fd;
+	int index_fd;
+	uint64_t day;        // of the open files, days since the epoch
+	uint64_t data_end;   // where the next block goes
+	uint64_t index_end;
+
+	Columns rows;        // the block being collected
+	HistoryRange range;
+	uint8_t *buf;        // the block being encoded
+	bool failing;        // the last block failed; logged once
+} hist = { .dir_fd = -1, .data_fd = -1, .index_fd = -1 };
+
+static uint64_t zigzag(int64_t v)
+{
+	return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v)
+{
+	return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static uint8_t *put_varint(uint8_t *p, uint64_t v)
+{
+	while (v >= 0x80) {
+		*p++ = (uint8_t)(v | 0x80);
+		v >>= 7;
+	}
+	*p++ = (uint8_t)v;
+	return p;
+}
+
+static uint64_t get_varint(Reader *r)
+{
+	uint64_t v = 0;
+
+	for (int shift = 0; shift < 64; shift += 7) {
+		if (r->p == r->end) {
+			break;
+		}
+		uint8_t b = *r->p++;
+		v |= (uint64_t)(b & 0x7f) << shift;
+		if (!(b & 0x80)) {
+			return v;
+		}
+	}
+	r->bad = true;
+	return 0;
+}
+
+static int columns_alloc(Columns *c)
+{
+	c->time_ms = malloc(HISTORY_BLOCK_ROWS * sizeof(*c->time_ms));
+	c->pid = malloc(HISTORY_BLOCK_ROWS * sizeof(*c->pid));
+	c->cpu = malloc(HISTORY_BLOCK_ROWS * sizeof(*c->cpu));
+	c->rss = malloc(HISTORY_BLOCK_ROWS * sizeof(*c->rss));
+	c->count = 0;
+	return c->time_ms && c->pid && c->cpu && c->rss ? 0 : -1;
+}
+
+static void columns_free(Columns *c)
+{
+	free(c->time_ms);
+	free(c->pid);
+	free(c->cpu);
+	free(c->rss);
+	memset(c, 0, sizeof(*c));
+}
+
+/**
+ * history_range_all() - Bounds that every row falls within
+ * @r: Range to set
+ */
+void history_range_all(HistoryRange *r)
+{
+	r->time_min = 0;
+	r->time_max = UINT64_MAX;
+	r->pid_min = INT32_MIN;
+	r->pid_max = INT32_MAX;
+	r->cpu_min = 0;
+	r->cpu_max = UINT32_MAX;
+	r->rss_min = 0;
+	r->rss_max = UINT64_MAX;
+}
+
+// Inverted bounds, for widening row by row
+static void range_empty(HistoryRange *r)
+{
+	r->time_min = UINT64_MAX;
+	r->time_max = 0;
+	r->pid_min = INT32_MAX;
+	r->pid_max = INT32_MIN;
+	r->cpu_min = UINT32_MAX;
+	r->cpu_max = 0;
+	r->rss_min = UINT64_MAX;
+	r->rss_max = 0;
+}
+
+static bool range_overlaps(const HistoryRange *a, const HistoryRange *b)
+{
+	return a->time_min <= b->time_max && b->time_min <= a->time_max &&
+	       a->pid_min <= b->pid_max && b->pid_min <= a->pid_max &&
+	       a->cpu_min <= b->cpu_max && b->cpu_min <= a->cpu_max &&
+	       a->rss_min <= b->rss_max && b->rss_min <= a->rss_max;
+}
+
+static bool range_contains(const HistoryRange *r, const Columns *c, int i)
+{
+	return c->time_ms[i] >= r->time_min && c->time_ms[i] <= r->time_max &&
+	       c->pid[i] >= r->pid_min && c->pid[i] <= r->pid_max &&
+	       c->cpu[i] >= r->cpu_min && c->cpu[i] <= r->cpu_max &&
+	       c->rss[i] >= r->rss_min && c->rss[i] <= r->rss_max;
+}
+
+// Widen a range to take in row i
+static void range_add(HistoryRange *r, const Columns *c, int i)
+{
+	r->time_min = c->time_ms[i] < r->time_min ? c->time_ms[i] : r->time_min;
+	r->time_max = c->time_ms[i] > r->time_max ? c->time_ms[i] : r->time_max;
+	r->pid_min = c->pid[i] < r->pid_min ? c->pid[i] : r->pid_min;
+	r->pid_max = c->pid[i] > r->pid_max ? c->pid[i] : r->pid_max;
+	r->cpu_min = c->cpu[i] < r->cpu_min ? c->cpu[i] : r->cpu_min;
+	r->cpu_max = c->cpu[i] > r->cpu_max ? c->cpu[i] : r->cpu_max;
+	r->rss_min = c->rss[i] < r->rss_min ? c->rss[i] : r->rss_min;
+	r->rss_max = c->rss[i] > r->rss_max ? c->rss[i] : r->rss_max;
+}
+
+static void day_name(uint64_t day, char *name, size_t size)
+{
+	time_t t = (time_t)(day * (MS_PER_DAY / 1000));
+	struct tm tm;
+
+	gmtime_r(&t, &tm);
+	strftime(name, size, "%Y%m%d", &tm);
+}
+
+/**
+ * parse_day_name() - Day of a file name such as "20240131.pbi"
+ * @name: Directory entry name
+ * @suffix: Suffix the name must end in
+ * @day: Days since the epoch
+ *
+ * Return: 0 on success, -1 if @name is not a day file
+ */
+static int parse_day_name(const char *name, const char *suffix, uint64_t *day)
+{
+	struct tm tm = { 0 };
+
+	if (strlen(name) != DAY_NAME_LEN + strlen(suffix) ||
+	    strcmp(name + DAY_NAME_LEN, suffix) != 0) {
+		return -1;
+	}
+	for (int i = 0; i < DAY_NAME_LEN; i++) {
+		if (name[i] < '0' || name[i] > '9') {
+			return -1;
+		}
+	}
+
+	int v = atoi(name); // stops at the suffix
+	tm.tm_year = v / 10000 - 1900;
+	tm.tm_mon = v / 100 % 100 - 1;
+	tm.tm_mday = v % 100;
+	time_t t = timegm(&tm);
+	if (t < 0) {
+		return -1;
+	}
+	*day = (uint64_t)t / (MS_PER_DAY / 1000);
+	return 0;
+}
+
+static uint64_t block_size(const HistoryIndexEntry *e)
+{
+	uint64_t size = 0;
+
+	for (int col = 0; col < HISTORY_COLUMNS; col++) {
+		size += e->size[col];
+	}
+	return size;
+}
+
+static bool entry_valid(const HistoryIndexEntry *e, uint64_t data_size)
+{
+	return e->magic == HISTORY_INDEX_MAGIC && e->rows > 0 &&
+	       e->rows <= HISTORY_BLOCK_ROWS && e->offset <= data_size &&
+	       block_size(e) <= data_size - e->offset;
+}
+
+static int write_all(int fd, const void *buf, size_t len, uint64_t offset)
+{
+	const uint8_t *p = buf;
+
+	while (len) {
+		ssize_t n = pwrite(fd, p, len, (off_t)offset);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -1;
+		}
+		p += n;
+		len -= (size_t)n;
+		offset += (uint64_t)n;
+	}
+	return 0;
+}
+
+static void close_day(void)
+{
+	if (hist.data_fd >= 0) {
+		close(hist.data_fd);
+	}
+	if (hist.index_fd >= 0) {
+		close(hist.index_fd);
+	}
+	hist.data_fd = -1;
+	hist.index_fd = -1;
+}
+
+/**
+ * open_day() - Open a day's files for appending
+ * @day: Days since the epoch
+ *
+ * Index entries are written after their block, so the last entry of a
+ * run that was killed may be torn, or its block may lack an entry. Both
+ * are cut off here, leaving the files as of the last complete block.
+ *
+ * Return: 0 on success, -1 on error (errno is set)
+ */
+static int open_day(uint64_t day)
+{
+	char name[DAY_NAME_LEN + sizeof(DATA_SUFFIX)];
+	struct stat st;
+	int err;
+
+	close_day();
+
+	day_name(day, name, sizeof(name));
+	strcpy(name + DAY_NAME_LEN, DATA_SUFFIX);
+	hist.data_fd = openat(hist.dir_fd, name, O_RDWR | O_CREAT | O_CLOEXEC,
+			      0644);
+	strcpy(name + DAY_NAME_LEN, INDEX_SUFFIX);
+	hist.index_fd = openat(hist.dir_fd, name, O_RDWR | O_CREAT | O_CLOEXEC,
+			       0644);
+	if (hist.data_fd < 0 || hist.index_fd < 0 ||
+	    fstat(hist.data_fd, &st) != 0) {
+		goto fail;
+	}
+	uint64_t data_size = (uint64_t)st.st_size;
+	if (fstat(hist.index_fd, &st) != 0) {
+		goto fail;
+	}
+
+	uint64_t entries = (uint64_t)st.st_size / sizeof(HistoryIndexEntry);
+	hist.data_end = 0;
+	while (entries) {
+		HistoryIndexEntry e;
+		uint64_t at = (entries - 1) * sizeof(e);
+		if (pread(hist.index_fd, &e, sizeof(e), (off_t)at) !=
+		    (ssize_t)sizeof(e)) {
+			goto fail;
+		}
+		if (entry_valid(&e, data_size)) {
+			hist.data_end = e.offset + block_size(&e);
+			break;
+		}
+		entries--;
+	}
+	hist.index_end = entries * sizeof(HistoryIndexEntry);
+
+	if ((uint64_t)st.st_size != hist.index_end &&
+	    ftruncate(hist.index_fd, (off_t)hist.index_end) != 0) {
+		goto fail;
+	}
+	if (data_size != hist.data_end &&
+	    ftruncate(hist.data_fd, (off_t)hist.data_end) != 0) {
+		goto fail;
+	}
+	hist.day = day;
+	return 0;
+
+fail:
+	err = errno;
+	close_day();
+	errno = err;
+	return -1;
+}
+
+/**
+ * encode_block() - Compress the collected rows into hist.buf
+ * @e: Index entry to fill in, but for its offset
+ *
+ * Return: Bytes encoded
+ */
+static size_t encode_block(HistoryIndexEntry *e)
+{
+	const Columns *c = &hist.rows;
+	uint8_t *start = hist.buf;
+	uint8_t *p = start;
+
+	// time: (delta, run length) per run of equal values
+	uint64_t prev = 0;
+	for (int i = 0; i < c->count;) {
+		int run = 1;
+		while (i + run < c->count && c->time_ms[i + run] == c->time_ms[i]) {
+			run++;
+		}
+		p = put_varint(p, zigzag((int64_t)(c->time_ms[i] - prev)));
+		p = put_varint(p, (uint64_t)run);
+		prev = c->time_ms[i];
+		i += run;
+	}
+	e->size[HISTORY_COL_TIME] = (uint32_t)(p - start);
+	start = p;
+
+	int64_t last = 0;
+	for (int i = 0; i < c->count; i++) {
+		p = put_varint(p, zigzag(c->pid[i] - last));
+		last = c->pid[i];
+	}
+	e->size[HISTORY_COL_PID] = (uint32_t)(p - start);
+	start = p;
+
+	last = 0;
+	for (int i = 0; i < c->count; i++) {
+		p = put_varint(p, zigzag((int64_t)c->cpu[i] - last));
+		last = c->cpu[i];
+	}
+	e->size[HISTORY_COL_CPU] = (uint32_t)(p - start);
+	start = p;
+
+	last = 0;
+	for (int i = 0; i < c->count; i++) {
+		int64_t kib = (int64_t)(c->rss[i] / 1024);
+		p = put_varint(p, zigzag(kib - last));
+		last = kib;
+	}
+	e->size[HISTORY_COL_RSS] = (uint32_t)(p - start);
+
+	e->magic = HISTORY_INDEX_MAGIC;
+	e->rows = (uint32_t)c->count;
+	e->range = hist.range;
+	return (size_t)(p - hist.buf);
+}
+
+/**
+ * flush_block() - Append the collected rows as a block
+ *
+ * The rows are dropped either way; a block that cannot be written is
+ * lost, and the files are left as of the previous one.
+ *
+ * Return: 0 on success, -1 on error (logged once per run of failures)
+ */
+static int flush_block(void)
+{
+	if (!hist.rows.count) {
+		return 0;
+	}
+
+	HistoryIndexEntry e = { 0 };
+	size_t len = encode_block(&e);
+	e.offset = hist.data_end;
+
+	int ret = -1;
+	if (hist.data_fd < 0 && open_day(hist.day) != 0) {
+		goto out;
+	}
+	if (write_all(hist.data_fd, hist.buf, len, hist.data_end) != 0) {
+		goto out;
+	}
+	if (write_all(hist.index_fd, &e, sizeof(e), hist.index_end) != 0) {
+		// Keep the files consistent for the next block
+		if (ftruncate(hist.index_fd, (off_t)hist.index_end) != 0) {
+			close_day();
+		}
+		goto out;
+	}
+	hist.data_end += len;
+	hist.index_end += sizeof(e);
+	ret = 0;
+
+out:
+	if (ret != 0 && !hist.failing) {
+		char msg[128];
+		snprintf(msg, sizeof(msg), "Failed to write history block: %s",
+			 strerror(errno));
+		log_error(msg);
+	}
+	hist.failing = ret != 0;
+	hist.rows.count = 0;
+	range_empty(&hist.range);
+	return ret;
+}
+
+/**
+ * history_open() - Start writing history to a directory
+ * @dir: Directory of day files; created if missing
+ *
+ * Return: 0 on success, -1 on error (errno is set)
+ */
+int history_open(const char *dir)
+{
+	if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+		return -1;
+	}
+	hist.dir_fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (hist.dir_fd < 0) {
+		return -1;
+	}
+
+	hist.buf = malloc((size_t)HISTORY_BLOCK_ROWS * ROW_MAX_BYTES);
+	if (!hist.buf || columns_alloc(&hist.rows) != 0) {
+		history_close();
+		errno = ENOMEM;
+		return -1;
+	}
+	range_empty(&hist.range);
+	hist.day = UINT64_MAX;
+	hist.failing = false;
+	return 0;
+}
+
+/**
+ * history_active() - Whether history_open() succeeded and is not closed
+ */
+bool history_active(void)
+{
+	return hist.buf != NULL;
+}
+
+/**
+ * history_append() - Add the processes read in a frame
+ * @f: Frame to add
+ * @time_ms: Wall clock time of the frame, milliseconds since the epoch
+ *
+ * Rows flagged PROC_STALE are skipped: adaptive sampling did not read
+ * them, so they would only repeat their last row. Costs a copy of four
+ * numbers per row; a block is compressed and written once it fills up
+ * or the UTC day changes.
+ *
+ * Return: 0 on success, -1 if a block could not be written
+ */
+int history_append(const Frame *f, uint64_t time_ms)
+{
+	if (!hist.buf) {
+		return -1;
+	}
+
+	int ret = 0;
+	uint64_t day = time_ms / MS_PER_DAY;
+	if (day != hist.day) {
+		ret = flush_block();
+		if (open_day(day) != 0) {
+			if (!hist.failing) {
+				char msg[128];
+				snprintf(msg, sizeof(msg),
+					 "Failed to open history files: %s",
+					 strerror(errno));
+				log_error(msg);
+				hist.failing = true;
+			}
+			ret = -1;
+		}
+		hist.day = day;
+	}
+
+	const ProcessTable *t = &f->table;
+	Columns *c = &hist.rows;
+	for (int row = 0; row < t->count; row++) {
+		if (t->flags[row] & PROC_STALE) {
+			continue;
+		}
+		if (c->count == HISTORY_BLOCK_ROWS && flush_block() != 0) {
+			ret = -1;
+		}
+
+		int i = c->count++;
+		double cpu = t->cpu_percent[row] * 100.0 + 0.5;
+		c->time_ms[i] = time_ms;
+		c->pid[i] = t->pid[row];
+		c->cpu[i] = cpu > 0.0 ? (uint32_t)cpu : 0;
+		c->rss[i] = t->mem_bytes[row] / 1024 * 1024;
+
+		range_add(&hist.range, c, i);
+	}
+	return ret;
+}
+
+/**
+ * history_close() - Write the last block and stop writing history
+ *
+ * Return: 0 on success, -1 if the last block could not be written
+ */
+int history_close(void)
+{
+	int ret = 0;
+
+	if (hist.buf) {
+		ret = flush_block();
+	}
+	close_day();
+	if (hist.dir_fd >= 0) {
+		close(hist.dir_fd);
+	}
+	free(hist.buf);
+	columns_free(&hist.rows);
+	memset(&hist, 0, sizeof(hist));
+	hist.dir_fd = -1;
+	hist.data_fd = -1;
+	hist.index_fd = -1;
+	return ret;
+}
+
+/*
+ * Queries
+ */
+
+/**
+ * decode_block() - Decompress a block
+ * @e: Its index entry
+ * @data: The block's bytes
+ * @c: Columns with room for HISTORY_BLOCK_ROWS rows
+ *
+ * Return: 0 on success, -1 if the block is corrupt
+ */
+static int decode_block(const HistoryIndexEntry *e, const uint8_t *data,
+			Columns *c)
+{
+	int rows = (int)e->rows;
+	Reader r[HISTORY_COLUMNS];
+
+	for (int col = 0; col < HISTORY_COLUMNS; col++) {
+		r[col].p = data;
+		r[col].end = data + e->size[col];
+		r[col].bad = false;
+		data = r[col].end;
+	}
+
+	uint64_t prev = 0;
+	for (int i = 0; i < rows;) {
+		prev += (uint64_t)unzigzag(get_varint(&r[HISTORY_COL_TIME]));
+		uint64_t run = get_varint(&r[HISTORY_COL_TIME]);
+		if (run == 0 || run > (uint64_t)(rows - i)) {
+			return -1;
+		}
+		for (; run; run--) {
+			c->time_ms[i++] = prev;
+		}
+	}
+
+	int64_t pid = 0, cpu = 0, kib = 0;
+	for (int i = 0; i < rows; i++) {
+		pid += unzigzag(get_varint(&r[HISTORY_COL_PID]));
+		cpu += unzigzag(get_varint(&r[HISTORY_COL_CPU]));
+		kib += unzigzag(get_varint(&r[HISTORY_COL_RSS]));
+		c->pid[i] = (int32_t)pid;
+		c->cpu[i] = (uint32_t)cpu;
+		c->rss[i] = (uint64_t)kib * 1024;
+	}
+
+	c->count = rows;
+	for (int col = 0; col < HISTORY_COLUMNS; col++) {
+		if (r[col].bad) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * query_block() - Pass the matching rows of one block to the callback
+ * @data_fd: Data file of the block
+ * @e: Its index entry
+ * @want: Query bounds
+ * @c: Scratch columns
+ * @fn: Callback
+ * @ctx: Callback context
+ * @stats: Counters to update
+ *
+ * Only the pages holding the block are mapped.
+ *
+ * Return: 0 to go on, -1 on error, or the callback's non-zero return
+ */
+static int query_block(int data_fd, const HistoryIndexEntry *e,
+		       const HistoryRange *want, Columns *c, HistoryFn fn,
+		       void *ctx, HistoryStats *stats)
+{
+	uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+	uint64_t start = e->offset & ~(page - 1);
+	size_t len = (size_t)(e->offset + block_size(e) - start);
+
+	void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, data_fd,
+			 (off_t)start);
+	if (map == MAP_FAILED) {
+		return -1;
+	}
+	stats->bytes_mapped += len;
+
+	int ret = decode_block(e, (const uint8_t *)map + (e->offset - start), c);
+	munmap(map, len);
+	if (ret != 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	int matched = 0;
+	for (int i = 0; i < c->count; i++) {
+		if (range_contains(want, c, i)) {
+			c->time_ms[matched] = c->time_ms[i];
+			c->pid[matched] = c->pid[i];
+			c->cpu[matched] = c->cpu[i];
+			c->rss[matched] = c->rss[i];
+			matched++;
+		}
+	}
+	stats->rows_read += (uint64_t)c->count;
+	stats->rows_matched += (uint64_t)matched;
+	if (!matched) {
+		return 0;
+	}
+
+	HistoryRows rows = {
+		.time_ms = c->time_ms,
+		.pid = c->pid,
+		.cpu = c->cpu,
+		.rss = c->rss,
+		.count = matched,
+	};
+	return fn(ctx, &rows);
+}
+
+/**
+ * query_day() - Run a query over one day's files
+ * @dir_fd: History directory
+ * @index_name: Name of the day's index file
+ * @want: Query bounds
+ * @c: Scratch columns
+ * @fn: Callback
+ * @ctx: Callback context
+ * @stats: Counters to update
+ *
+ * Index entries past a corrupt one, or past the end of the data file
+ * (a writer may be appending), are ignored.
+ *
+ * Return: 0 to go on, -1 on error, or the callback's non-zero return
+ */
+static int query_day(int dir_fd, const char *index_name,
+		     const HistoryRange *want, Columns *c, HistoryFn fn,
+		     void *ctx, HistoryStats *stats)
+{
+	char data_name[DAY_NAME_LEN + sizeof(DATA_SUFFIX)];
+	struct stat st;
+	int ret = -1;
+
+	memcpy(data_name, index_name, DAY_NAME_LEN);
+	strcpy(data_name + DAY_NAME_LEN, DATA_SUFFIX);
+
+	int index_fd = openat(dir_fd, index_name, O_RDONLY | O_CLOEXEC);
+	if (index_fd < 0) {
+		return -1;
+	}
+	int data_fd = openat(dir_fd, data_name, O_RDONLY | O_CLOEXEC);
+	if (data_fd < 0 || fstat(data_fd, &st) != 0) {
+		goto out;
+	}
+	uint64_t data_size = (uint64_t)st.st_size;
+
+	HistoryIndexEntry entries[64];
+	ret = 0;
+	for (;;) {
+		ssize_t n = read(index_fd, entries, sizeof(entries));
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n < 0) {
+			ret = -1;
+			break;
+		}
+
+		int count = (int)((size_t)n / sizeof(entries[0]));
+		for (int i = 0; i < count && ret == 0; i++) {
+			if (!entry_valid(&entries[i], data_size)) {
+				goto out;
+			}
+			stats->blocks++;
+			if (!range_overlaps(&entries[i].range, want)) {
+				continue;
+			}
+			stats->blocks_read++;
+			ret = query_block(data_fd, &entries[i], want, c, fn, ctx,
+					  stats);
+		}
+		if (ret != 0 || (size_t)n < sizeof(entries)) {
+			break;
+		}
+	}
+
+out:
+	if (data_fd >= 0) {
+		close(data_fd);
+	}
+	close(index_fd);
+	return ret;
+}
+
+static int name_cmp(const void *a, const void *b)
+{
+	return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/**
+ * history_query() - Find the rows within a range
+ * @dir: History directory
+ * @want: Inclusive bounds every returned row falls within
+ * @fn: Called with the matching rows of each block, oldest day first;
+ *	a non-zero return stops the query
+ * @ctx: Passed to @fn
+ * @stats: Counters of the work done; may be NULL
+ *
+ * Day files outside the time range are not opened, and blocks whose
+ * min/max cannot match are skipped using the index alone.
+ *
+ * Return: 0 on success, the non-zero return of @fn if it stopped the
+ * query, or -1 on error (errno is set)
+ */
+int history_query(const char *dir, const HistoryRange *want, HistoryFn fn,
+		  void *ctx, HistoryStats *stats)
+{
+	HistoryStats unused;
+	Columns c = { 0 };
+	char **names = NULL;
+	size_t count = 0, capacity = 0;
+	int ret = -1;
+	int err;
+
+	if (!stats) {
+		stats = &unused;
+	}
+	memset(stats, 0, sizeof(*stats));
+
+	int dir_fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dir_fd < 0) {
+		return -1;
+	}
+	DIR *d = fdopendir(dup(dir_fd));
+	if (!d) {
+		goto out;
+	}
+
+	uint64_t first_day = want->time_min / MS_PER_DAY;
+	uint64_t last_day = want->time_max / MS_PER_DAY;
+	struct dirent *ent;
+	while ((ent = readdir(d))) {
+		uint64_t day;
+		if (parse_day_name(ent->d_name, INDEX_SUFFIX, &day) != 0 ||
+		    day < first_day || day > last_day) {
+			continue;
+		}
+		if (count == capacity) {
+			capacity = capacity ? capacity * 2 : 64;
+			char **grown = realloc(names, capacity * sizeof(*names));
+			if (!grown) {
+				closedir(d);
+				goto out;
+			}
+			names = grown;
+		}
+		names[count] = strdup(ent->d_name);
+		if (!names[count]) {
+			closedir(d);
+			goto out;
+		}
+		count++;
+	}
+	closedir(d);
+
+	// Day names sort by date
+	qsort(names, count, sizeof(*names), name_cmp);
+	if (columns_alloc(&c) != 0) {
+		errno = ENOMEM;
+		goto out;
+	}
+
+	ret = 0;
+	for (size_t i = 0; i < count && ret == 0; i++) {
+		ret = query_day(dir_fd, names[i], want, &c, fn, ctx, stats);
+	}
+
+out:
+	err = errno;
+	for (size_t i = 0; i < count; i++) {
+		free(names[i]);
+	}
+	free(names);
+	columns_free(&c);
+	close(dir_fd);
+	errno = err;
+	return ret;
+}
@@ -0,0 +1,64 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdint.h>
+#include "sampler.h"
+#include "selfstat.h"
+
+/*
+ * Headless output of sampled frames, one record per tick.
+ *
+ * Records are formatted straight into a fixed buffer that is written out
+ * once per tick (and whenever it fills up), so steady-state output never
+ * allocates and costs about one write() per tick.
+ *
+ * CSV: a header line, then one line per process:
+ *   seq,time_ms,pid,name,cpu_percent,mem_bytes,mem_percent,stale
+ * cpu_percent is empty while a process has no previous sample; names
+ * containing commas, quotes or line breaks are quoted.
+ *
+ * JSON Lines: one object per tick:
+ *   {"seq":1,"time_ms":...,"cpu_load":3.25,"used_mem_bytes":...,
+ *    "self":{"cpu":1.20,"rss_bytes":...,"proc_syscalls":...,
+ *            "proc_bytes":...,"log_dropped":0,
+ *            "phases":{"collect":{"p50_us":850,"p99_us":1300},...}},
+ *    "processes":[{"pid":1,"name":"init","cpu":0.00,"mem_bytes":...,
+ *                  "mem":0.10,"stale":false},...]}
+ * cpu is null while a process has no previous sample. "self" is the
+ * monitor's own cost (see selfstat.h) and lists only phases that ran; it
+ * is left out when batch_write() gets none, and CSV and binary records
+ * never carry it.
+ *
+ * Binary: length-prefixed records in host byte order:
+ *   u32 length      bytes after this field
+ *   u32 magic       BATCH_MAGIC
+ *   u64 seq
+ *   u64 time_ms     wall clock, milliseconds since the epoch
+ *   u64 used_mem_bytes
+ *   f32 cpu_load
+ *   u32 count       processes that follow
+ *   count times:
+ *     i32 pid
+ *     u8  flags     PROC_* bits
+ *     u8  name_len
+ *     u16 reserved  zero
+ *     f32 cpu_percent
+ *     f32 mem_percent
+ *     u64 mem_bytes
+ *     name_len bytes of name, not NUL-terminated
+ */
+
+#define BATCH_MAGIC 0x31524250u // "PBR1"
+
+typedef enum {
+	BATCH_CSV,
+	BATCH_JSON,
+	BATCH_BINARY,
+} BatchFormat;
+
+int batch_parse_format(const char *name, BatchFormat *out);
+int batch_open(const char *path, BatchFormat format);
+int batch_write(const Frame *f, uint64_t time_ms, const SelfStats *self);
+int batch_close(void);
+
+#endif
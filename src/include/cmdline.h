@@ -0,0 +1,19 @@
+#ifndef CMDLINE_H
+#define CMDLINE_H
+
+#include <stdint.h>
+#include "process.h"
+
+/*
+ * On-demand cache of /proc/[pid]/cmdline, keyed by (pid, starttime).
+ *
+ * Command lines are only read for rows that are actually rendered. They
+ * are kept until the process disappears from the snapshot, and read again
+ * after an exec() or every few snapshots while the row stays on screen.
+ */
+
+const char *cmdline_get(int pid, uint64_t starttime, const char *comm);
+void cmdline_sweep(const ProcessTable *t);
+void cmdline_cleanup(void);
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef COLLECTOR_H
+#define COLLECTOR_H
+
+/*
+ * Worker pool that splits a range of items across threads.
+ *
+ * collector_run() cuts [0, items) into fixed-size chunks and deals each
+ * thread a contiguous run of them. A thread claims chunks from its own run
+ * with an atomic counter and, once that run is used up, steals from the
+ * runs of the other threads the same way, so a thread stuck on slow /proc
+ * entries does not hold up the rest. The calling thread takes part, so
+ * N threads means N - 1 background workers.
+ */
+
+#define COLLECTOR_MAX_THREADS 256
+
+// Processes items [begin, end); called concurrently for disjoint ranges
+typedef void (*CollectorFn)(void *ctx, int begin, int end);
+
+int collector_start(int threads);
+void collector_stop(void);
+int collector_threads(void);
+void collector_run(int items, int chunk, CollectorFn fn, void *ctx);
+
+#endif
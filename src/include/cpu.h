@@ -1,8 +1,49 @@
 #ifndef CPU_H
 #define CPU_H
 
-long read_total_cpu_time(void);
-long read_active_cpu_time(void);
+#include <stddef.h>
+#include <stdint.h>
+
+// Jiffy counters of one "cpu" line of /proc/stat
+typedef struct {
+	uint64_t user;
+	uint64_t nice;
+	uint64_t system;
+	uint64_t idle;
+	uint64_t iowait;
+	uint64_t irq;
+	uint64_t softirq;
+	uint64_t steal;
+	uint64_t guest;      // already included in user
+	uint64_t guest_nice; // already included in nice
+} CpuTimes;
+
+/*
+ * Everything the header needs from /proc/stat, filled in by one read and
+ * one pass over the file.
+ */
+typedef struct {
+	CpuTimes total;         // aggregate "cpu" line
+	CpuTimes *cores;        // "cpuN" lines indexed by N; offline cores are zero
+	int core_count;
+	int core_capacity;
+	uint64_t ctxt;          // context switches since boot
+	uint64_t intr;          // interrupts serviced since boot
+	uint64_t processes;     // forks since boot
+	uint64_t procs_running;
+	uint64_t procs_blocked;
+} CpuStat;
+
+int cpu_stat_parse(const char *buf, size_t len, CpuStat *st);
+int cpu_stat_read(CpuStat *st);
+int cpu_stat_copy(CpuStat *dst, const CpuStat *src);
+void cpu_stat_free(CpuStat *st);
+void cpu_stat_close(void);
+
+uint64_t cpu_times_total(const CpuTimes *t);
+uint64_t cpu_times_active(const CpuTimes *t);
+double cpu_times_load(const CpuTimes *prev, const CpuTimes *curr);
+
 int get_cpu_cores(void);
 
-#endif
\ No newline at end of file
+#endif
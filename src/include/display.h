@@ -2,16 +2,29 @@
 #define DISPLAY_H
 
 #include <stdint.h>
+#include "cpu.h"
 #include "process.h"
+#include "selfstat.h"
 
 void display_init(void);
 void display_cleanup(void);
+void display_begin_frame(void);
+void display_invalidate(void);
 void display_header(int days, int hours, int minutes, double cpu_load,
 		    uint64_t used_mem_mb, uint64_t total_mem_mb,
 		    int process_count, bool sort_cpu, bool sort_mem,
-		    bool reversed);
-void display_process_info(ProcessInfo *processes, int count, int scroll_offset,
-			  const char *search_term);
+		    bool reversed, int interval_ms);
+void display_cpu_stats(const CpuStat *prev, const CpuStat *curr,
+		       double elapsed_s);
+void display_proc_events(uint64_t forks, uint64_t execs, uint64_t exits);
+void display_sampling(int stale, int total, bool adaptive);
+void display_warning(const char *message);
+int display_visible_rows(void);
+void display_process_info(const ProcessTable *t, const uint32_t *order,
+			  int rows, int scroll_offset, const char *search_term);
+void display_show_cmdlines(bool enabled);
+void display_debug(bool enabled);
+void display_self_stats(const SelfStats *s);
 void display_refresh(void);
 
 #endif
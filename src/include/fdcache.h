@@ -0,0 +1,31 @@
+#ifndef FDCACHE_H
+#define FDCACHE_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/*
+ * Cache of open /proc/[pid]/stat descriptors, keyed by PID.
+ *
+ * A cached descriptor is re-sampled with pread(fd, ..., 0), so a steady-state
+ * tick costs one syscall per process.
+ *
+ * Usage per tick:
+ *   fdcache_begin_scan();
+ *   for each PID listed in /proc: fdcache_read_stat(pid, ...);
+ *   fdcache_end_scan();   // closes PIDs that left the listing
+ *
+ * For parallel reads, resolve every PID with fdcache_slot() on one thread
+ * first, then call fdcache_read_slot() from the workers.
+ */
+
+void fdcache_init(void);
+void fdcache_cleanup(void);
+void fdcache_begin_scan(void);
+void fdcache_end_scan(void);
+int fdcache_slot(int pid);
+int fdcache_slot_fd(int slot);
+ssize_t fdcache_read_slot(int slot, int pid, char *buf, size_t size);
+ssize_t fdcache_read_stat(int pid, char *buf, size_t size);
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sampler.h"
+
+/*
+ * Columnar history of sampled processes, for range queries over days.
+ *
+ * Each tick appends one row per process read that tick: time, pid, CPU
+ * and RSS. Rows carried over unread by adaptive sampling are skipped, as
+ * they repeat the row of their last read. Rows collect in memory until a
+ * block of HISTORY_BLOCK_ROWS is full (or the UTC day changes), then each
+ * column is compressed on its own and the block is appended to the day's
+ * data file, DIR/YYYYMMDD.pbh, followed by one HistoryIndexEntry in
+ * DIR/YYYYMMDD.pbi. The entry holds the block's offset, column sizes and
+ * the min/max of every column, so a query reads the small index files
+ * and maps only blocks whose ranges can match.
+ *
+ * Columns, in block order:
+ *   time   ms since the epoch; runs of equal values as (zigzag delta to
+ *          the previous run, run length) varint pairs
+ *   pid    zigzag varint delta to the previous row
+ *   cpu    hundredths of a percent, zigzag varint delta
+ *   rss    KiB, zigzag varint delta
+ */
+
+#define HISTORY_BLOCK_ROWS 65536
+#define HISTORY_INDEX_MAGIC 0x31494250u // "PBI1"
+
+enum {
+	HISTORY_COL_TIME,
+	HISTORY_COL_PID,
+	HISTORY_COL_CPU,
+	HISTORY_COL_RSS,
+	HISTORY_COLUMNS,
+};
+
+// Inclusive bounds of every column: a block's contents, or a query
+typedef struct {
+	uint64_t time_min;   // ms since the epoch
+	uint64_t time_max;
+	int32_t pid_min;
+	int32_t pid_max;
+	uint32_t cpu_min;    // hundredths of a percent
+	uint32_t cpu_max;
+	uint64_t rss_min;    // bytes
+	uint64_t rss_max;
+} HistoryRange;
+
+// One block in an index file
+typedef struct {
+	uint32_t magic;      // HISTORY_INDEX_MAGIC
+	uint32_t rows;
+	uint64_t offset;     // of the block in the data file
+	uint32_t size[HISTORY_COLUMNS]; // compressed bytes per column
+	HistoryRange range;
+} HistoryIndexEntry;
+
+// Decoded rows of one block that matched a query
+typedef struct {
+	const uint64_t *time_ms;
+	const int32_t *pid;
+	const uint32_t *cpu;  // hundredths of a percent
+	const uint64_t *rss;  // bytes
+	int count;
+} HistoryRows;
+
+typedef struct {
+	uint64_t blocks;      // in the index files read
+	uint64_t blocks_read; // whose ranges overlapped the query
+	uint64_t rows_read;
+	uint64_t rows_matched;
+	uint64_t bytes_mapped;
+} HistoryStats;
+
+typedef int (*HistoryFn)(void *ctx, const HistoryRows *rows);
+
+int history_open(const char *dir);
+bool history_active(void);
+int history_append(const Frame *f, uint64_t time_ms);
+int history_close(void);
+
+void history_range_all(HistoryRange *r);
+int history_query(const char *dir, const HistoryRange *want, HistoryFn fn,
+		  void *ctx, HistoryStats *stats);
+
+#endif
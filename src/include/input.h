@@ -4,17 +4,29 @@
 #include <stdbool.h>
 #include "process.h"
 
+// Replay speed bounds, as powers of two
+#define REPLAY_MIN_SPEED_SHIFT -3
+#define REPLAY_MAX_SPEED_SHIFT 6
+
 typedef struct {
 	bool sort_cpu;
 	bool sort_mem;
 	bool reversed;
 	int scroll_offset;
 	bool should_exit;
+	int interval_ms; // sampling interval, changed with +/-
+	bool full_accuracy; // read every process every tick, toggled with a
+	bool debug_overlay; // show terminal output statistics, toggled with d
+	bool replay;        // browsing a recording; live-only keys are ignored
+	bool paused;        // replay: hold the current frame, toggled with space
+	int seek_frames;    // replay: frames to step, from the arrow keys
+	int seek_s;         // replay: seconds to jump, from [ ] { }
+	int speed_shift;    // replay: speed is 2^speed_shift, changed with < >
 	char search_term[256];
 } InputState;
 
 void input_init(InputState *state);
-void input_handle(InputState *state, ProcessInfo *processes, int count);
+bool input_handle(InputState *state, const ProcessTable *table, int rows);
 
 #endif
 
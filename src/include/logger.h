@@ -7,6 +7,7 @@
 #define LOG_LEVEL_ERROR   40
 #define LOG_LEVEL_FATAL   50
 
+#include <stdint.h>
 
 void log_debug(const char *message);
 void log_info(const char *message);
@@ -14,6 +15,9 @@ void log_warning(const char *message);
 void log_error(const char *message);
 void log_fatal(const char *message);
 
+void log_flush(void);
+uint64_t log_dropped(void);
+
 void set_log_level(int level);
 
 #endif
@@ -0,0 +1,35 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <stdbool.h>
+#include "batch.h"
+
+// Sampling interval bounds, also used by the +/- keys
+#define DEFAULT_INTERVAL_MS 1000
+#define MIN_INTERVAL_MS 50
+#define MAX_INTERVAL_MS 60000
+
+// Ticks a quiet process may go unread by default
+#define DEFAULT_MAX_BACKOFF 8
+
+// Command line options
+typedef struct {
+	int interval_ms;       // sampling interval
+	bool proc_events;      // track processes through the proc connector
+	int collector_threads; // threads reading /proc, including the main one
+	bool no_uring;         // never batch reads through io_uring
+	int max_backoff;       // adaptive sampling backoff; 1 reads every tick
+	bool batch;            // write records instead of running the UI
+	BatchFormat format;    // record format in batch mode
+	const char *output;    // batch output file, NULL for stdout
+	int count;             // ticks to write in batch mode, 0 for no limit
+	const char *record;    // ring file every tick is recorded to, or NULL
+	int record_mb;         // size of a new ring file
+	const char *replay;    // ring file to browse instead of sampling
+	const char *history;   // directory of the columnar history, or NULL
+	const char *proc_root; // tree read instead of /proc, or NULL
+} Options;
+
+int options_parse(int argc, char **argv, Options *opts);
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef PIDMAP_H
+#define PIDMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Open-addressing (linear probing) map from a process identity to a slot
+ * index. A process is identified by PID plus starttime (field 22 of
+ * /proc/[pid]/stat), so a PID reused by a new process is a different key.
+ * pid == 0 marks an empty bucket; /proc never lists PID 0.
+ */
+typedef struct {
+	int pid;
+	int slot;
+	uint64_t starttime;
+} PidMapEntry;
+
+typedef struct {
+	PidMapEntry *entries;
+	size_t capacity; // always a power of two
+	size_t count;
+} PidMap;
+
+void pidmap_init(PidMap *map);
+void pidmap_free(PidMap *map);
+int pidmap_reset(PidMap *map, size_t expected);
+int pidmap_insert(PidMap *map, int pid, uint64_t starttime, int slot);
+int pidmap_find(const PidMap *map, int pid, uint64_t starttime);
+int pidmap_remove(PidMap *map, int pid, uint64_t starttime);
+
+#endif
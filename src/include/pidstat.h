@@ -0,0 +1,40 @@
+#ifndef PIDSTAT_H
+#define PIDSTAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Field numbers of /proc/[pid]/stat as documented in proc(5), 1-based.
+ * Only the ones ProcessBrowser uses are named; any field up to
+ * PIDSTAT_FIELD_COUNT can be requested by number.
+ */
+#define PIDSTAT_FIELD_COUNT 52
+
+#define PIDSTAT_PID        1
+#define PIDSTAT_COMM       2
+#define PIDSTAT_STATE      3
+#define PIDSTAT_PPID       4
+#define PIDSTAT_UTIME      14
+#define PIDSTAT_STIME      15
+#define PIDSTAT_NUM_THREADS 20
+#define PIDSTAT_STARTTIME  22
+#define PIDSTAT_VSIZE      23
+#define PIDSTAT_RSS        24
+
+#define PIDSTAT_MASK(field) (1ULL << (field))
+
+// Longest stat line we expect: 52 fields of up to 20 digits plus comm
+#define PIDSTAT_BUF_SIZE 1536
+
+typedef struct {
+	const char *comm; // points into the parsed buffer, not NUL-terminated
+	size_t comm_len;
+	char state;
+	// Indexed by field number; only fields selected by the mask are written
+	uint64_t field[PIDSTAT_FIELD_COUNT + 1];
+} PidStat;
+
+int pidstat_parse(const char *buf, size_t len, uint64_t mask, PidStat *st);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef PROCDIR_H
+#define PROCDIR_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Enumeration of /proc through a held directory descriptor.
+ *
+ * The directory is opened once and walked with getdents64() into a large
+ * buffer; PIDs are decoded while walking the records. Per-PID files are
+ * opened relative to the same descriptor with openat(), so the hot loop
+ * never resolves an absolute path. System-wide files (stat, meminfo,
+ * uptime) are opened relative to it too, so procdir_set_root() points
+ * every reader at another tree, e.g. a synthetic one for tests.
+ */
+
+#define PROCDIR_DEFAULT_ROOT "/proc"
+
+/*
+ * PIDs with an identity for the process each one stood for when listed:
+ * the inode number of its /proc directory, which procfs never hands to
+ * the next process with the same PID, or a fork count for PIDs tracked
+ * through the proc connector. Equal identities on two ticks mean the
+ * process was not replaced in between.
+ */
+typedef struct {
+	int *pids;
+	uint64_t *ids;
+	int count;
+	int capacity;
+} PidList;
+
+int procdir_set_root(const char *root);
+const char *procdir_root(void);
+int procdir_fd(void);
+int procdir_open(const char *name);
+FILE *procdir_fopen(const char *name);
+void procdir_close(void);
+int procdir_openat(int pid, const char *name);
+int procdir_list_pids(PidList *list);
+int pidlist_push(PidList *list, int pid, uint64_t id);
+void pidlist_free(PidList *list);
+
+#endif
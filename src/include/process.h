@@ -1,40 +1,102 @@
 #ifndef PROCESS_H
 #define PROCESS_H
 
-#define MAX_PROCESSES 4096
+// Rows allocated up front; tables grow geometrically past this
+#define PROCESS_TABLE_INITIAL_ROWS 1024
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include "pidmap.h"
+
+// Per-row flags
+#define PROC_CPU_VALID 0x01 // cpu_percent has a previous sample to diff against
+#define PROC_MEM_VALID 0x02 // mem_percent was computed
+#define PROC_STALE     0x04 // not read this tick; numbers are from read_ns
+
+// Longest backoff adaptive sampling accepts, in ticks
+#define SAMPLE_MAX_BACKOFF 64
+
+/*
+ * Snapshot of all processes, stored as a structure of arrays.
+ *
+ * The hot numeric columns are what collection, stats and sorting touch
+ * every tick; strings live in a separate pool and are referenced by offset.
+ * Rows are never moved: sorting permutes the order column instead, and a
+ * new snapshot replaces the previous one by swapping table pointers.
+ *
+ * All columns are carved from one arena. It doubles whenever a snapshot
+ * needs more rows and is reused for every later tick, so steady-state
+ * collection never allocates.
+ */
 typedef struct {
-    // mem and cpu in percents only 
-    int pid;
-    char name[256];
-    char cmdline[512]; 
+    int count;
+    int capacity;
+    int grow_count;       // arena growths since process_table_init()
+    int stale_count;      // rows carried over unread (PROC_STALE)
+    void *arena;
+    uint64_t sample_ns;   // CLOCK_MONOTONIC time the snapshot was taken
 
-    bool cpu_valid;
-    bool mem_valid;
-    bool cmd_valid;
-    long rss_kb;
+    // Hot columns, indexed by row
+    int32_t *pid;
+    uint64_t *starttime;  // jiffies since boot, tells reused PIDs apart
+    uint64_t *utime;      // user time (jiffies)
+    uint64_t *stime;      // system time (jiffies)
+    uint64_t *mem_bytes;  // absolute memory (bytes) of a process, not total system RAM
+    uint64_t *read_ns;    // sample_ns of the tick the row was last read
+    double *cpu_percent;  // calculated percentage
+    double *mem_percent;  // relative to total system RAM
+    uint8_t *flags;       // PROC_* bits
+    uint8_t *backoff;     // ticks between reads (adaptive sampling)
+    uint8_t *wait;        // ticks left before the next read
+    uint32_t *name;       // offset of the NUL-terminated name in names
 
+    // Display order: row indices, permuted by the sort functions
+    uint32_t *order;
+
+    // Cold string pool; cmdline is fetched on demand with cmdline_get()
+    char *names;
+    size_t names_len;
+    size_t names_cap;
+} ProcessTable;
+
+/*
+ * Adaptive sampling policy for collect_processes_adaptive().
+ *
+ * A process whose CPU time and RSS did not move since its last read is
+ * read again only after a backoff that doubles with every quiet read, up
+ * to max_backoff ticks; any change drops it back to every tick. Rows of
+ * processes skipped in a tick are carried over from the previous snapshot
+ * and flagged PROC_STALE. Pinned PIDs (e.g. rows on screen) are read
+ * every tick, and so is a PID whose process was replaced since the
+ * previous tick.
+ */
+typedef struct {
+    int max_backoff;       // 1 reads every process every tick
+    const PidMap *pinned;  // keyed by PID with starttime 0, or NULL
+} SamplePolicy;
 
-    // CPU usage
-    uint64_t utime;   // user time (jiffies)
-    uint64_t stime;   // system time (jiffies)
-    double cpu_percent;    // calculated percentage
+static inline const char *process_name(const ProcessTable *t, int row)
+{
+    return t->names + t->name[row];
+}
 
-    // Memory usage
-    uint64_t mem_bytes;   // absolute memory (bytes) of a process, not total system RAM
-    double mem_percent;        // relative to total system RAM
-} ProcessInfo;
+int process_table_init(ProcessTable *t, int capacity);
+int process_table_reserve(ProcessTable *t, int rows);
+int process_table_copy(ProcessTable *dst, const ProcessTable *src);
+uint32_t process_table_add_name(ProcessTable *t, const char *name, size_t len);
+void process_table_free(ProcessTable *t);
 
 void compute_process_stats(
-    ProcessInfo *curr, int curr_count,
-    ProcessInfo *prev, int prev_count,
-    uint64_t total_cpu_delta,
+    ProcessTable *curr,
+    const ProcessTable *prev,
+    int cpu_cores,
     uint64_t total_mem_bytes
 );
 
-int read_process(int pid, ProcessInfo *p);
-int collect_processes(ProcessInfo *list, int max);
+int read_process(int pid, ProcessTable *t);
+int collect_processes(ProcessTable *t);
+int collect_processes_adaptive(ProcessTable *t, const ProcessTable *prev,
+                               const SamplePolicy *policy);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,37 @@
+#ifndef PROCEVENTS_H
+#define PROCEVENTS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "procdir.h"
+
+/*
+ * Event-driven process tracking through the kernel proc connector.
+ *
+ * A netlink socket subscribed to PROC_EVENT_FORK/EXEC/EXIT keeps the set of
+ * live PIDs up to date between ticks, so collection only samples known
+ * PIDs instead of listing /proc. Exits are not trusted to drop a PID, as
+ * one is also reported when just the leader thread of a process exits;
+ * they make it be read again, and the collector drops PIDs it cannot
+ * read (see procevents_forget()). Subscribing needs CAP_NET_ADMIN; callers
+ * fall back to the directory scan when procevents_open() fails.
+ */
+
+// Cumulative event counts since procevents_open()
+typedef struct {
+	uint64_t forks;
+	uint64_t execs;
+	uint64_t exits;
+} ProcEventCounts;
+
+int procevents_open(void);
+void procevents_close(void);
+bool procevents_active(void);
+int procevents_drain(void);
+void procevents_seed(const PidList *list);
+void procevents_forget(int pid);
+const PidList *procevents_pids(void);
+bool procevents_is_live(int pid);
+void procevents_counts(ProcEventCounts *out);
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef RECORD_H
+#define RECORD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sampler.h"
+
+/*
+ * Flight recorder: every published frame is appended to a fixed-size,
+ * memory-mapped ring file, and --replay reads it back into Frames.
+ *
+ * File layout: one RECORD_HEADER_SIZE page, then data_size bytes of ring.
+ * The header holds the ring geometry plus head (next write offset), tail
+ * (oldest live record) and the number of live records; it is rewritten
+ * after every record. Records are 8-byte aligned:
+ *   u32 length      whole record, padding included
+ *   u16 magic       RECORD_MAGIC
+ *   u8  kind        RECORD_KEY or RECORD_DELTA
+ *   u8  reserved
+ *   u64 seq         Frame.seq
+ *   u64 time_ms     wall clock, milliseconds since the epoch
+ *   u64 sample_ns   CLOCK_MONOTONIC time of the snapshot
+ *   payload         LEB128 varints, signed values zigzag-encoded
+ * A length of RECORD_WRAP (or fewer than 8 bytes left) means the next
+ * record is at offset 0. The oldest records are overwritten as the ring
+ * fills up.
+ *
+ * Payload: frame numbers (elapsed_us, cpu_load in hundredths of a
+ * percent, used_mem_bytes, uptime minutes, events, table sizes), the
+ * /proc/stat counters, then the row count and rows. Key records store
+ * counters in full; delta records store their difference to the previous
+ * record. Rows are a list of operations:
+ *   RECORD_OP_RUN n      the next n rows of the previous frame, unchanged
+ *   RECORD_OP_NEW ...    pid, starttime, utime, stime, mem_bytes, cpu
+ *                        (hundredths of a percent), flags byte, name
+ *   RECORD_OP_ROW | F    a row of the previous frame, as a zigzag offset
+ *                        from the row after the last one used, followed
+ *                        by the RECORD_F_* fields in F as zigzag
+ *                        differences (a name in full)
+ * Key records use RECORD_OP_NEW only. A name is a varint id of an earlier
+ * name plus one, or 0 followed by the length and bytes of a new one. Ids
+ * restart at every key record, so a delta record only carries names of
+ * processes that appeared or exec()ed since then. mem_percent is not
+ * stored; it follows from mem_bytes and the total in the file header.
+ * A key record is written every RECORD_KEY_INTERVAL frames; replay can
+ * start at any key record, which bounds how far back a seek decodes.
+ */
+
+#define RECORD_HEADER_SIZE 4096
+#define RECORD_MAGIC 0x5250u        // "PR"
+#define RECORD_WRAP 0xffffffffu
+#define RECORD_KEY 1
+#define RECORD_DELTA 2
+#define RECORD_KEY_INTERVAL 64
+
+#define RECORD_OP_RUN 0x00
+#define RECORD_OP_NEW 0x40
+#define RECORD_OP_ROW 0x80
+#define RECORD_F_UTIME 0x01
+#define RECORD_F_STIME 0x02
+#define RECORD_F_MEM   0x04
+#define RECORD_F_CPU   0x08
+#define RECORD_F_FLAGS 0x10
+#define RECORD_F_NAME  0x20
+
+// Ring size bounds for --record-size, in MiB
+#define RECORD_DEFAULT_MB 64
+#define RECORD_MIN_MB 1
+#define RECORD_MAX_MB 4096
+
+int record_open(const char *path, uint64_t size_bytes,
+		uint64_t total_mem_bytes);
+bool record_active(void);
+int record_frame(const Frame *f, uint64_t time_ms);
+void record_close(void);
+
+int replay_open(const char *path);
+int replay_count(void);
+uint64_t replay_time_ms(int index);
+uint64_t replay_total_mem_bytes(void);
+int replay_load(int index, Frame *out);
+void replay_close(void);
+
+#endif
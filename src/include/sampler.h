@@ -0,0 +1,63 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "cpu.h"
+#include "process.h"
+#include "procevents.h"
+
+/*
+ * Background sampling thread.
+ *
+ * A periodic CLOCK_MONOTONIC timerfd drives collection and stats on the
+ * sampler thread, so the tick period does not drift with collection time.
+ * Each finished snapshot is copied into a Frame and published through a
+ * lock-free triple buffer: the sampler always has a frame to write, the UI
+ * always owns the frame it is drawing, and the third holds the latest
+ * published one. Publishing never waits for the UI; frames the UI did not
+ * pick up in time are simply overwritten. An eventfd signals each publish
+ * so the UI can poll() it together with stdin.
+ *
+ * Quiet processes are sampled adaptively (see SamplePolicy); the UI pins
+ * the PIDs it shows with sampler_pin() so they are read every tick.
+ *
+ * While record_open() is active, every frame is also appended to the
+ * recorder's ring file before it is published. The collect and compute
+ * phases of every tick are timed into selfstat.
+ */
+
+typedef struct {
+	ProcessTable table;    // stats computed; the UI may permute order
+	CpuStat cpu_prev;      // /proc/stat at the previous tick
+	CpuStat cpu_curr;      // /proc/stat at this tick
+	double elapsed_s;      // monotonic time between the two samples
+	double cpu_load;       // busy share of all cores (0-100)
+	uint64_t used_mem_bytes;
+	int uptime_days;
+	int uptime_hours;
+	int uptime_minutes;
+	bool have_events;      // proc connector tracking is active
+	ProcEventCounts events; // events during this tick
+	int grow_count;        // process table growths on the sampler side
+	int table_capacity;    // rows of the sampler's tables
+	uint64_t seq;          // tick number, starting at 1
+} Frame;
+
+typedef struct {
+	int interval_ms;          // tick period
+	int cpu_cores;            // online cores, for cpu_percent
+	uint64_t total_mem_bytes; // for mem_percent
+	int max_backoff;          // adaptive sampling backoff; <= 1 reads all
+	bool full_accuracy;       // start with adaptive sampling off
+} SamplerConfig;
+
+int sampler_start(const SamplerConfig *config);
+void sampler_stop(void);
+int sampler_set_interval(int interval_ms);
+void sampler_set_full_accuracy(bool full);
+int sampler_pin(const int32_t *pids, int count);
+int sampler_event_fd(void);
+Frame *sampler_acquire(void);
+
+#endif
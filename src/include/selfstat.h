@@ -0,0 +1,52 @@
+#ifndef SELFSTAT_H
+#define SELFSTAT_H
+
+#include <stdint.h>
+
+/*
+ * What the monitor itself costs.
+ *
+ * Each phase of a tick is timed with CLOCK_MONOTONIC at its boundaries
+ * and recorded into a fixed log-linear histogram (8 buckets per power of
+ * two, so a percentile is off by at most 1/8). Every phase keeps two
+ * histograms of SELFSTAT_WINDOW samples and drops the older one when the
+ * newer fills up, so p50 and p99 cover the last SELFSTAT_WINDOW to
+ * 2 * SELFSTAT_WINDOW samples and follow changes quickly. Recording costs
+ * a clock read and an increment; nothing allocates.
+ *
+ * Each phase must be recorded from one thread only: collect and compute
+ * on the sampler thread, the others on the UI or batch thread. Reading
+ * is safe from any one thread while they record.
+ */
+
+#define SELFSTAT_WINDOW 64
+
+typedef enum {
+	PHASE_COLLECT, // /proc/stat and every process
+	PHASE_COMPUTE, // CPU and memory stats, frame preparation
+	PHASE_SORT,
+	PHASE_FILTER,  // matching names against the search term
+	PHASE_RENDER,  // drawing a frame, or formatting a batch record
+	PHASE_INPUT,   // handling keys
+	PHASE_COUNT,
+} Phase;
+
+typedef struct {
+	uint64_t p50_ns[PHASE_COUNT];
+	uint64_t p99_ns[PHASE_COUNT];
+	uint32_t samples[PHASE_COUNT]; // in the window; 0 if never run
+	double cpu_percent;            // of one core, all threads
+	uint64_t rss_bytes;
+	uint64_t proc_syscalls;        // against /proc in the last tick
+	uint64_t proc_bytes;           // read from /proc in the last tick
+	uint64_t log_dropped;
+} SelfStats;
+
+uint64_t selfstat_now(void);
+void selfstat_record(Phase phase, uint64_t ns);
+void selfstat_end_tick(void);
+void selfstat_read(SelfStats *out);
+const char *selfstat_phase_name(Phase phase);
+void selfstat_reset(void);
+
+#endif
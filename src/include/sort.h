@@ -4,8 +4,18 @@
 #include <stdbool.h>
 #include "process.h"
 
-void sort_by_cpu(ProcessInfo *processes, int count, bool reversed);
-void sort_by_mem(ProcessInfo *processes, int count, bool reversed);
+typedef enum {
+	SORT_CPU,
+	SORT_MEM,
+} SortColumn;
+
+void sort_by_cpu(ProcessTable *t, bool reversed);
+void sort_by_mem(ProcessTable *t, bool reversed);
+void sort_window(ProcessTable *t, SortColumn column, bool reversed,
+		 int offset, int height);
+void sort_rows(const ProcessTable *t, SortColumn column, bool reversed,
+	       const uint32_t *rows, int count, int offset, int height,
+	       uint32_t *out);
 
 #endif
 
@@ -0,0 +1,19 @@
+#ifndef SYSCOUNT_H
+#define SYSCOUNT_H
+
+#include <stdint.h>
+
+/*
+ * Counters of the syscalls made against /proc and the bytes they returned,
+ * for comparing collection backends. Safe to bump from collector threads.
+ */
+
+typedef struct {
+	uint64_t syscalls;
+	uint64_t bytes;
+} SysCount;
+
+void syscount_add(uint64_t calls, uint64_t len);
+void syscount_get(SysCount *out);
+
+#endif
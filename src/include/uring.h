@@ -0,0 +1,26 @@
+#ifndef URING_H
+#define URING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Minimal io_uring ring driven through the raw syscalls, used to batch
+ * reads of /proc files: queue many reads, submit them and wait for all
+ * completions with a single io_uring_enter(), then reap them in bulk.
+ *
+ * There is one ring per process and it is driven from one thread.
+ */
+
+// Called for every completion; @res is bytes read or -errno
+typedef void (*UringCompleteFn)(void *ctx, uint64_t tag, int res);
+
+int uring_open(unsigned int entries);
+void uring_close(void);
+bool uring_active(void);
+unsigned int uring_capacity(void);
+int uring_queue_read(int fd, void *buf, unsigned int len, uint64_t tag);
+int uring_submit_wait(void);
+int uring_reap(UringCompleteFn fn, void *ctx);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef VIEW_H
+#define VIEW_H
+
+#include <stdint.h>
+#include "process.h"
+
+#define VIEW_TERM_MAX 256
+
+/*
+ * Rows of a snapshot that match the search filter.
+ *
+ * view_update() matches names once per snapshot or term change; drawing,
+ * scroll clamping, pinning and the match count then work from the row
+ * list, so a frame drawn after a key costs O(visible rows) plus sorting
+ * the matches, not a strstr() per process.
+ */
+typedef struct {
+	uint32_t *rows;     // matching table rows, in table order
+	uint32_t *order;    // scratch for sorting rows; see sort_rows()
+	int count;          // matches
+	int capacity;       // of rows and order
+
+	// Snapshot and term the rows belong to
+	const ProcessTable *table;
+	uint64_t sample_ns;
+	int table_count;
+	char term[VIEW_TERM_MAX];
+} FilterView;
+
+void view_init(FilterView *v);
+int view_update(FilterView *v, const ProcessTable *t, const char *term);
+void view_free(FilterView *v);
+
+#endif
@@ -2,8 +2,17 @@
 #include <string.h>
 #include <signal.h>
 #include <stdlib.h>
+#include "display.h"
 #include "input.h"
 #include "logger.h"
+#include "options.h"
+
+// Intervals the +/- keys step through
+static const int interval_steps[] = {
+	100, 250, 500, 1000, 2000, 5000, 10000, 30000, MAX_INTERVAL_MS
+};
+#define INTERVAL_STEP_COUNT \
+	((int)(sizeof(interval_steps) / sizeof(interval_steps[0])))
 
 /**
  * input_init() - Initialize input state
@@ -18,9 +27,53 @@ void input_init(InputState *state)
 	state->reversed = false;
 	state->scroll_offset = 0;
 	state->should_exit = false;
+	state->interval_ms = DEFAULT_INTERVAL_MS;
+	state->full_accuracy = false;
+	state->debug_overlay = false;
+	state->replay = false;
+	state->paused = false;
+	state->seek_frames = 0;
+	state->seek_s = 0;
+	state->speed_shift = 0;
 	memset(state->search_term, 0, sizeof(state->search_term));
 }
 
+/**
+ * step_interval() - Move the sampling interval to the next preset
+ * @state: Input state structure
+ * @slower: true for the next longer interval, false for the next shorter
+ *
+ * Intervals set with --interval that are not a preset step to the nearest
+ * preset in the requested direction.
+ */
+static void step_interval(InputState *state, bool slower)
+{
+	int next = state->interval_ms;
+
+	if (slower) {
+		for (int i = 0; i < INTERVAL_STEP_COUNT; i++) {
+			if (interval_steps[i] > state->interval_ms) {
+				next = interval_steps[i];
+				break;
+			}
+		}
+	} else {
+		for (int i = INTERVAL_STEP_COUNT - 1; i >= 0; i--) {
+			if (interval_steps[i] < state->interval_ms) {
+				next = interval_steps[i];
+				break;
+			}
+		}
+	}
+
+	if (next != state->interval_ms) {
+		state->interval_ms = next;
+		char log_msg[64];
+		snprintf(log_msg, sizeof(log_msg), "Interval set to %d ms", next);
+		log_info(log_msg);
+	}
+}
+
 /**
  * handle_search_interactive() - Interactive search mode
  * @state: Input state structure
@@ -69,7 +122,8 @@ static void handle_search_interactive(InputState *state)
 
 	noecho();
 	curs_set(0);
-	timeout(100); // Restore normal timeout
+	timeout(0); // Restore non-blocking reads
+	display_invalidate(); // the prompt drew over the status bar
 
 	char log_msg[300];
 	snprintf(log_msg, sizeof(log_msg), "Search term: '%s'",
@@ -79,14 +133,12 @@ static void handle_search_interactive(InputState *state)
 
 /**
  * handle_kill() - Handle kill functionality
- * @processes: Array of processes
- * @count: Number of processes
+ * @table: Current process table
  * @offset: Current scroll offset
  *
  * Prompts for PID and sends SIGTERM signal to the process.
  */
-static void handle_kill(ProcessInfo *processes __attribute__((unused)),
-			int count __attribute__((unused)),
+static void handle_kill(const ProcessTable *table __attribute__((unused)),
 			int offset __attribute__((unused)))
 {
 	echo();
@@ -130,7 +182,8 @@ static void handle_kill(ProcessInfo *processes __attribute__((unused)),
 
 	noecho();
 	curs_set(0);
-	timeout(100); // Restore normal timeout
+	timeout(0); // Restore non-blocking reads
+	display_invalidate(); // the prompt drew over the status bar
 
 	if (cancelled || buf_pos == 0) {
 		return;
@@ -156,19 +209,23 @@ static void handle_kill(ProcessInfo *processes __attribute__((unused)),
 }
 
 /**
- * input_handle() - Handle user input
+ * input_handle() - Handle one pending key
  * @state: Input state structure
- * @processes: Array of processes
- * @count: Number of processes
+ * @table: Current process table
+ * @rows: Rows that can be scrolled through: the search matches while a
+ *        filter is set, else every process
+ *
+ * Processes keyboard input and updates state accordingly. Never blocks;
+ * call it until it returns false to drain every pending key.
  *
- * Processes keyboard input and updates state accordingly.
+ * Return: true if a key was handled, false if none was pending
  */
-void input_handle(InputState *state, ProcessInfo *processes, int count)
+bool input_handle(InputState *state, const ProcessTable *table, int rows)
 {
 	int ch = getch();
 
 	if (ch == ERR) {
-		return;
+		return false;
 	}
 
 	switch (ch) {
@@ -204,6 +261,93 @@ void input_handle(InputState *state, ProcessInfo *processes, int count)
 		log_info(state->reversed ? "Sort reversed" : "Sort normal");
 		break;
 
+	case '+':
+	case '=':
+		if (!state->replay) {
+			step_interval(state, true);
+		}
+		break;
+
+	case '-':
+	case '_':
+		if (!state->replay) {
+			step_interval(state, false);
+		}
+		break;
+
+	case 'a':
+	case 'A':
+		if (!state->replay) {
+			state->full_accuracy = !state->full_accuracy;
+			log_info(state->full_accuracy ?
+				 "Sampling every process every tick" :
+				 "Adaptive sampling enabled");
+		}
+		break;
+
+	case ' ':
+		if (state->replay) {
+			state->paused = !state->paused;
+		}
+		break;
+
+	case KEY_LEFT:
+		if (state->replay) {
+			state->seek_frames--;
+			state->paused = true;
+		}
+		break;
+
+	case KEY_RIGHT:
+		if (state->replay) {
+			state->seek_frames++;
+			state->paused = true;
+		}
+		break;
+
+	case '[':
+		if (state->replay) {
+			state->seek_s -= 60;
+		}
+		break;
+
+	case ']':
+		if (state->replay) {
+			state->seek_s += 60;
+		}
+		break;
+
+	case '{':
+		if (state->replay) {
+			state->seek_s -= 600;
+		}
+		break;
+
+	case '}':
+		if (state->replay) {
+			state->seek_s += 600;
+		}
+		break;
+
+	case '<':
+	case ',':
+		if (state->replay && state->speed_shift > REPLAY_MIN_SPEED_SHIFT) {
+			state->speed_shift--;
+		}
+		break;
+
+	case '>':
+	case '.':
+		if (state->replay && state->speed_shift < REPLAY_MAX_SPEED_SHIFT) {
+			state->speed_shift++;
+		}
+		break;
+
+	case 'd':
+	case 'D':
+		state->debug_overlay = !state->debug_overlay;
+		break;
+
 	case KEY_UP:
 		if (state->scroll_offset > 0) {
 			state->scroll_offset--;
@@ -233,7 +377,10 @@ void input_handle(InputState *state, ProcessInfo *processes, int count)
 	case KEY_F(9):
 	case 'k': // Alternative for F9
 	case 'K':
-		handle_kill(processes, count, state->scroll_offset);
+		// PIDs of a recording may belong to other processes by now
+		if (!state->replay) {
+			handle_kill(table, state->scroll_offset);
+		}
 		break;
 
 	case 'q':
@@ -258,11 +405,12 @@ void input_handle(InputState *state, ProcessInfo *processes, int count)
 	if (state->scroll_offset < 0) {
 		state->scroll_offset = 0;
 	}
-	if (state->scroll_offset >= count) {
-		state->scroll_offset = count - 1;
+	if (state->scroll_offset >= rows) {
+		state->scroll_offset = rows - 1;
 		if (state->scroll_offset < 0) {
 			state->scroll_offset = 0;
 		}
 	}
+	return true;
 }
 
@@ -1,15 +1,59 @@
 #include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <sys/stat.h>
-#include <sys/time.h>
+#include <sys/syscall.h>
 #include <time.h>
 #include <string.h>
 #include <stdio.h>
+#include <unistd.h>
+#include <linux/futex.h>
 #include "logger.h"
 
+/*
+ * Messages are pushed into a bounded lock-free MPSC ring (Vyukov's
+ * queue: each slot carries a sequence number telling whose turn it is)
+ * and formatted and written by a background thread, one write() per
+ * batch. Callers never block: when the ring is full the message is
+ * dropped and counted, and the count is logged once there is room. The
+ * consumer side is serialized by drain_lock, so log_flush() can drain the
+ * ring on the caller's thread.
+ */
+
+#define LOG_RING_SLOTS 1024 // power of two
+#define LOG_MESSAGE_MAX 240 // longer messages are cut
+#define LOG_LINE_MAX (LOG_MESSAGE_MAX + 64)
+#define LOG_BATCH_BYTES (64 * 1024)
+
+// How long the writer lets a burst collect after being woken
+#define LOG_BATCH_DELAY_NS (10 * 1000 * 1000)
+
+typedef struct {
+	atomic_size_t seq;
+	int level;
+	struct timespec time;
+	char message[LOG_MESSAGE_MAX];
+} LogSlot;
+
 int LEVEL = LOG_LEVEL_INFO;
 
-static FILE *log_file = NULL;
+static LogSlot ring[LOG_RING_SLOTS];
+static atomic_size_t enqueue_pos;
+static size_t dequeue_pos;          // under drain_lock
+static atomic_uint_fast64_t dropped;
+static uint64_t dropped_reported;   // under drain_lock
+static atomic_uint writer_sleeping; // futex word
+
+static pthread_mutex_t drain_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t start_once = PTHREAD_ONCE_INIT;
+static bool writer_running;
+
+static int log_fd = -1;
 static bool log_file_initialized = false;
 
 static void ensure_logs_folder(void)
@@ -33,44 +77,255 @@ static void ensure_log_file(void)
 
 	log_file_initialized = true;
 	ensure_logs_folder();
-	log_file = fopen("logs/log1.log", "a");
-	if (!log_file) {
+	log_fd = open("logs/log1.log", O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+		      0644);
+	if (log_fd < 0) {
 		fprintf(stderr, "logger: cannot open logs/log1.log (%s)\n",
 			strerror(errno));
 	}
 }
 
+static const char *level_name(int level)
+{
+	switch (level) {
+	case LOG_LEVEL_DEBUG:
+		return "DEBUG";
+	case LOG_LEVEL_INFO:
+		return "INFO";
+	case LOG_LEVEL_WARNING:
+		return "WARNING";
+	case LOG_LEVEL_ERROR:
+		return "ERROR";
+	default:
+		return "FATAL";
+	}
+}
 
-void log_message(const char *severity,
-		 const char *color __attribute__((unused)),
-		 const char *message)
+/**
+ * format_line() - Format one log line
+ * @out: At least LOG_LINE_MAX bytes
+ * @level: LOG_LEVEL_* of the message
+ * @time: When the message was logged (CLOCK_REALTIME)
+ * @message: The message
+ *
+ * Return: Length of the line
+ */
+static size_t format_line(char *out, int level, const struct timespec *time,
+			  const char *message)
 {
+	// Consecutive lines mostly fall in the same second
+	static time_t cached_sec = -1;
+	static char cached[32];
+	static size_t cached_len;
+
+	if (time->tv_sec != cached_sec) {
+		struct tm tm;
+		localtime_r(&time->tv_sec, &tm);
+		cached_len = strftime(cached, sizeof(cached), "%a %b %d %H:%M:%S",
+				      &tm);
+		if (cached_len == 0) {
+			cached_len = strlen(strcpy(cached, "unknown time"));
+		}
+		cached_sec = time->tv_sec;
+	}
+
+	int len = snprintf(out, LOG_LINE_MAX, "[%s] %.*s.%03d: %s\n",
+			   level_name(level), (int)cached_len, cached,
+			   (int)(time->tv_nsec / 1000000), message);
+	return len < 0 ? 0 : len >= LOG_LINE_MAX ? LOG_LINE_MAX - 1 : (size_t)len;
+}
+
+static void write_batch(const char *buf, size_t len)
+{
+	while (len && log_fd >= 0) {
+		ssize_t n = write(log_fd, buf, len);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return;
+		}
+		buf += n;
+		len -= (size_t)n;
+	}
+}
+
+/**
+ * drain() - Format and write every message in the ring
+ *
+ * Must be called with drain_lock held. Stops early at a slot whose
+ * producer has claimed it but not finished writing; that message goes
+ * out with the next batch.
+ */
+static void drain(void)
+{
+	static char batch[LOG_BATCH_BYTES];
+	size_t len = 0;
+
 	ensure_log_file();
+	for (;;) {
+		LogSlot *slot = &ring[dequeue_pos & (LOG_RING_SLOTS - 1)];
+		if (atomic_load_explicit(&slot->seq, memory_order_acquire) !=
+		    dequeue_pos + 1) {
+			break;
+		}
+
+		if (len + LOG_LINE_MAX > sizeof(batch)) {
+			write_batch(batch, len);
+			len = 0;
+		}
+		len += format_line(batch + len, slot->level, &slot->time,
+				   slot->message);
+		atomic_store_explicit(&slot->seq, dequeue_pos + LOG_RING_SLOTS,
+				      memory_order_release);
+		dequeue_pos++;
+	}
+
+	uint64_t lost = atomic_load_explicit(&dropped, memory_order_relaxed);
+	if (lost != dropped_reported) {
+		if (len + LOG_LINE_MAX > sizeof(batch)) {
+			write_batch(batch, len);
+			len = 0;
+		}
+		char message[64];
+		struct timespec now;
+		clock_gettime(CLOCK_REALTIME, &now);
+		snprintf(message, sizeof(message),
+			 "%llu log messages dropped (queue full)",
+			 (unsigned long long)(lost - dropped_reported));
+		len += format_line(batch + len, LOG_LEVEL_WARNING, &now, message);
+		dropped_reported = lost;
+	}
+	write_batch(batch, len);
+}
+
+static bool ring_empty(void)
+{
+	const LogSlot *slot = &ring[dequeue_pos & (LOG_RING_SLOTS - 1)];
+	return atomic_load(&slot->seq) != dequeue_pos + 1;
+}
 
-	struct timeval now_tv;
-	gettimeofday(&now_tv, NULL);
-	struct tm tm;
-	localtime_r(&now_tv.tv_sec, &tm);
-	char timestamp[64];
-	size_t ts_len = strftime(timestamp, sizeof(timestamp),
-				 "%a %b %d %H:%M:%S", &tm);
-	if (ts_len == 0) {
-		strcpy(timestamp, "unknown time");
-	} else {
-		int ms = now_tv.tv_usec / 1000;
-		snprintf(timestamp + ts_len, sizeof(timestamp) - ts_len,
-			 ".%03d", ms);
+static void *writer_main(void *arg)
+{
+	(void)arg;
+
+	for (;;) {
+		pthread_mutex_lock(&drain_lock);
+		drain();
+		// Announce the sleep before looking: a producer either sees it
+		// or its message is seen here
+		atomic_store(&writer_sleeping, 1);
+		bool empty = ring_empty();
+		pthread_mutex_unlock(&drain_lock);
+
+		if (empty) {
+			syscall(SYS_futex, &writer_sleeping, FUTEX_WAIT_PRIVATE, 1,
+				NULL, NULL, 0);
+		}
+		atomic_store(&writer_sleeping, 0);
+
+		// Let the rest of a burst arrive, to write it in one go
+		struct timespec delay = { 0, LOG_BATCH_DELAY_NS };
+		nanosleep(&delay, NULL);
+	}
+	return NULL;
+}
+
+static void start_writer(void)
+{
+	pthread_t thread;
+	sigset_t all, old;
+
+	for (size_t i = 0; i < LOG_RING_SLOTS; i++) {
+		atomic_init(&ring[i].seq, i);
 	}
 
-	char line[512];
-	int len = snprintf(line, sizeof(line), "[%s] %s: %s\n",
-			   severity, timestamp, message);
-	if (len > 0 && log_file) {
-		fwrite(line, 1, len, log_file);
-		fflush(log_file);
+	// Signals are for the threads that handle them, not this one
+	sigfillset(&all);
+	pthread_sigmask(SIG_BLOCK, &all, &old);
+	writer_running = pthread_create(&thread, NULL, writer_main, NULL) == 0;
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	if (writer_running) {
+		pthread_detach(thread);
+		atexit(log_flush);
 	}
 }
 
+/**
+ * log_message() - Queue a message for the writer thread
+ * @level: LOG_LEVEL_* of the message
+ * @message: The message; cut to LOG_MESSAGE_MAX - 1 bytes
+ *
+ * Costs a clock read, a copy and, if the writer is asleep, one wakeup.
+ * Without a writer thread the message is written right away.
+ *
+ * Return: true if queued, false if dropped because the queue was full
+ */
+bool log_message(int level, const char *message)
+{
+	pthread_once(&start_once, start_writer);
+
+	size_t pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+	LogSlot *slot;
+	for (;;) {
+		slot = &ring[pos & (LOG_RING_SLOTS - 1)];
+		size_t seq = atomic_load_explicit(&slot->seq,
+						  memory_order_acquire);
+		intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+		if (diff == 0) {
+			if (atomic_compare_exchange_weak_explicit(
+				    &enqueue_pos, &pos, pos + 1,
+				    memory_order_relaxed, memory_order_relaxed)) {
+				break;
+			}
+		} else if (diff < 0) {
+			// Full: the writer has not caught up
+			atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+			return false;
+		} else {
+			pos = atomic_load_explicit(&enqueue_pos,
+						   memory_order_relaxed);
+		}
+	}
+
+	slot->level = level;
+	clock_gettime(CLOCK_REALTIME, &slot->time);
+	size_t len = strnlen(message, LOG_MESSAGE_MAX - 1);
+	memcpy(slot->message, message, len);
+	slot->message[len] = '\0';
+	atomic_store(&slot->seq, pos + 1);
+
+	if (!writer_running) {
+		log_flush();
+	} else if (atomic_load(&writer_sleeping) &&
+		   atomic_exchange(&writer_sleeping, 0)) {
+		syscall(SYS_futex, &writer_sleeping, FUTEX_WAKE_PRIVATE, 1,
+			NULL, NULL, 0);
+	}
+	return true;
+}
+
+/**
+ * log_flush() - Write every queued message before returning
+ *
+ * Runs on the caller's thread, so it works whether or not the writer
+ * thread is running. Registered with atexit().
+ */
+void log_flush(void)
+{
+	pthread_mutex_lock(&drain_lock);
+	drain();
+	pthread_mutex_unlock(&drain_lock);
+}
+
+/**
+ * log_dropped() - Messages dropped so far because the queue was full
+ */
+uint64_t log_dropped(void)
+{
+	return atomic_load_explicit(&dropped, memory_order_relaxed);
+}
+
 int check_level(const int level)
 {
 	return level >= LEVEL;
@@ -79,28 +334,28 @@ int check_level(const int level)
 void log_debug(const char *message)
 {
 	if (check_level(LOG_LEVEL_DEBUG)) {
-		log_message("DEBUG", "\033[32m", message);
+		log_message(LOG_LEVEL_DEBUG, message);
 	}
 }
 
 void log_info(const char *message)
 {
 	if (check_level(LOG_LEVEL_INFO)) {
-		log_message("INFO", "", message);
+		log_message(LOG_LEVEL_INFO, message);
 	}
 }
 
 void log_warning(const char *message)
 {
 	if (check_level(LOG_LEVEL_WARNING)) {
-		log_message("WARNING", "\033[33m", message);
+		log_message(LOG_LEVEL_WARNING, message);
 	}
 }
 
 void log_error(const char *message)
 {
 	if (check_level(LOG_LEVEL_ERROR)) {
-		log_message("ERROR", "\033[31m", message);
+		log_message(LOG_LEVEL_ERROR, message);
 	}
 }
 
@@ -111,11 +366,17 @@ void log_error(const char *message)
  * Writes the message to both the log file and console (stdout) with red color.
  * This function should be used for critical errors that require immediate attention.
  * Always outputs regardless of log level setting to ensure fatal errors are visible.
+ * The queue is flushed before returning, as the caller is usually about to exit.
  */
 void log_fatal(const char *message)
 {
 	if (check_level(LOG_LEVEL_FATAL)) {
-		log_message("FATAL", "\033[31m", message);
+		if (!log_message(LOG_LEVEL_FATAL, message)) {
+			// Never drop this one: make room and queue it again
+			log_flush();
+			log_message(LOG_LEVEL_FATAL, message);
+		}
+		log_flush();
 		printf("\033[31m[FATAL] : %s\033[0m\n", message);
 		fflush(stdout);
 	}
@@ -127,8 +388,7 @@ void set_log_level(int level)
 		fprintf(stderr, "logger: invalid log level: %d\n", level);
 		return;
 	}
-	
+
 	LEVEL = level;
-	
-}
 
+}
@@ -1,3 +1,6 @@
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -6,134 +9,682 @@
 #include <time.h>
 #include <ncurses.h>
 #include "logger.h"
+#include "batch.h"
 #include "cpu.h"
 #include "mem.h"
 #include "process.h"
+#include "history.h"
+#include "record.h"
+#include "fdcache.h"
+#include "cmdline.h"
+#include "procdir.h"
+#include "procevents.h"
+#include "options.h"
+#include "collector.h"
+#include "uring.h"
+#include "sampler.h"
+#include "selfstat.h"
 #include "display.h"
 #include "sort.h"
 #include "system.h"
 #include "input.h"
+#include "view.h"
 
-#define REFRESH_INTERVAL_MS 1000 // 1000 is max, after 1000 will be overflow
+#define GROW_WARNING_TICKS 5
+#define URING_ENTRIES 1024 // stat reads per io_uring batch
 
-int main(void)
+// Longest wait between two replayed frames, whatever the recorded gap
+#define REPLAY_MAX_GAP_MS 5000
+
+// UI-side bookkeeping across frames
+typedef struct {
+	char grow_warning[128];
+	int grow_warning_ticks;
+	int grow_count_seen;
+	int32_t *pins;         // PIDs handed to sampler_pin()
+	int pin_capacity;
+	char status[192];      // replay position, shown instead of warnings
+	FilterView view;       // search matches of the frame on screen
+} UiState;
+
+// Rows the user scrolls through: the search matches, or every process
+static int scroll_rows(const UiState *ui, const InputState *input_state,
+		       const ProcessTable *t)
 {
-	log_info("Process monitor started");
+	return input_state->search_term[0] != '\0' ? ui->view.count : t->count;
+}
 
-	int cpu_cores = get_cpu_cores();
-	if (cpu_cores == -1) {
-		log_fatal("Failed to get CPU core count");
-		return 1;
+/**
+ * note_frame() - Update UI state for a newly acquired frame
+ * @ui: UI state
+ * @f: Frame just taken from the sampler
+ *
+ * Drops cached command lines of processes that are gone and counts down
+ * the table growth warning, which stays up for a few ticks.
+ */
+static void note_frame(UiState *ui, const Frame *f)
+{
+	cmdline_sweep(&f->table);
+
+	if (ui->grow_warning_ticks > 0) {
+		ui->grow_warning_ticks--;
+	}
+	if (f->grow_count != ui->grow_count_seen) {
+		ui->grow_count_seen = f->grow_count;
+		ui->grow_warning_ticks = GROW_WARNING_TICKS;
+		snprintf(ui->grow_warning, sizeof(ui->grow_warning),
+			 "Warning: process table grew to %d rows (%d processes)",
+			 f->table_capacity, f->table.count);
 	}
+}
 
-	uint64_t total_mem_bytes = read_total_mem_bytes();
-	if (total_mem_bytes == 0) {
-		log_fatal("Failed to read total memory bytes");
-		return 1;
+/**
+ * pin_shown() - Keep the processes the user is looking at fresh
+ * @t: Sorted table of the frame just drawn
+ * @input_state: Filter and scroll settings
+ * @ui: UI state holding the PID buffer and the search matches
+ *
+ * Pins every search match, or the visible window when there is no
+ * filter, so adaptive sampling reads them every tick.
+ */
+static void pin_shown(const ProcessTable *t, const InputState *input_state,
+		      UiState *ui)
+{
+	if (t->count > ui->pin_capacity) {
+		int32_t *pins = realloc(ui->pins, (size_t)t->count * sizeof(*pins));
+		if (!pins) {
+			return;
+		}
+		ui->pins = pins;
+		ui->pin_capacity = t->count;
 	}
 
-	char init_msg[256];
-	snprintf(init_msg, sizeof(init_msg),
-		 "System initialized: %d cores, %lu MB RAM",
-		 cpu_cores, total_mem_bytes / (1024 * 1024));
-	log_info(init_msg);
+	int count = 0;
+	if (input_state->search_term[0] != '\0') {
+		for (int i = 0; i < ui->view.count; i++) {
+			ui->pins[count++] = t->pid[ui->view.rows[i]];
+		}
+	} else {
+		int end = input_state->scroll_offset + display_visible_rows();
+		for (int i = input_state->scroll_offset; i < end && i < t->count;
+		     i++) {
+			ui->pins[count++] = t->pid[t->order[i]];
+		}
+	}
+	sampler_pin(ui->pins, count);
+}
+
+/**
+ * render() - Sort and draw a frame
+ * @f: Frame to draw; its order column is permuted
+ * @input_state: Sort, filter and scroll settings
+ * @ui: UI state
+ * @total_mem_bytes: Total system memory
+ *
+ * Called for every new frame and after every key, so it must stay cheap:
+ * names are matched against the filter once per snapshot, and only the rows
+ * up to the visible window are sorted, of the matches when filtering.
+ * Filtering, sorting and drawing are timed into selfstat.
+ */
+static void render(Frame *f, InputState *input_state, UiState *ui,
+		   uint64_t total_mem_bytes)
+{
+	ProcessTable *t = &f->table;
+
+	// Check for conflicting sort flags
+	if (input_state->sort_cpu && input_state->sort_mem) {
+		log_warning("Both sort_cpu and sort_mem are true; using CPU sort");
+		input_state->sort_mem = false;
+	}
+
+	// The overlay changes how many rows are visible
+	display_begin_frame();
+	display_debug(input_state->debug_overlay);
+	int height = display_visible_rows();
+
+	FilterView *view = &ui->view;
+	bool filtered = input_state->search_term[0] != '\0';
+	uint64_t start_ns = selfstat_now();
+	view_update(view, t, input_state->search_term);
+	if (filtered) {
+		uint64_t matched_ns = selfstat_now();
+		selfstat_record(PHASE_FILTER, matched_ns - start_ns);
+		start_ns = matched_ns;
+	}
+
+	// The table or the matches may have shrunk since the last key
+	int rows = scroll_rows(ui, input_state, t);
+	if (input_state->scroll_offset >= rows) {
+		input_state->scroll_offset = rows > 0 ? rows - 1 : 0;
+	}
+
+	if (input_state->sort_cpu || input_state->sort_mem) {
+		SortColumn column = input_state->sort_cpu ? SORT_CPU : SORT_MEM;
+		if (filtered) {
+			sort_rows(t, column, input_state->reversed, view->rows,
+				  rows, input_state->scroll_offset, height,
+				  view->order);
+		} else {
+			sort_window(t, column, input_state->reversed,
+				    input_state->scroll_offset, height);
+		}
+	} else if (filtered) {
+		if (rows > 0) {
+			memcpy(view->order, view->rows,
+			       (size_t)rows * sizeof(*view->order));
+		}
+	} else {
+		for (int i = 0; i < t->count; i++) {
+			t->order[i] = (uint32_t)i;
+		}
+	}
+	uint64_t sorted_ns = selfstat_now();
+	selfstat_record(PHASE_SORT, sorted_ns - start_ns);
 
+	display_header(f->uptime_days, f->uptime_hours, f->uptime_minutes,
+		       f->cpu_load, f->used_mem_bytes / (1024 * 1024),
+		       total_mem_bytes / (1024 * 1024), t->count,
+		       input_state->sort_cpu, input_state->sort_mem,
+		       input_state->reversed, input_state->interval_ms);
+	display_sampling(t->stale_count, t->count, !input_state->full_accuracy);
+	display_cpu_stats(&f->cpu_prev, &f->cpu_curr, f->elapsed_s);
+	if (f->have_events) {
+		display_proc_events(f->events.forks, f->events.execs,
+				    f->events.exits);
+	}
+	if (ui->status[0] != '\0') {
+		display_warning(ui->status);
+	} else {
+		display_warning(ui->grow_warning_ticks > 0 ? ui->grow_warning :
+							     NULL);
+	}
+	display_process_info(t, filtered ? view->order : t->order, rows,
+			     input_state->scroll_offset, input_state->search_term);
+	if (input_state->debug_overlay) {
+		SelfStats self;
+		selfstat_read(&self);
+		display_self_stats(&self);
+	}
+	display_refresh();
+	selfstat_record(PHASE_RENDER, selfstat_now() - sorted_ns);
+}
 
+/**
+ * run_ui() - Draw frames and handle keys until the user quits
+ * @opts: Command line options
+ * @total_mem_bytes: Total system memory
+ *
+ * Return: Exit status
+ */
+static int run_ui(const Options *opts, uint64_t total_mem_bytes)
+{
 	display_init();
 	InputState input_state;
 	input_init(&input_state);
+	input_state.interval_ms = opts->interval_ms;
+	input_state.full_accuracy = opts->max_backoff <= 1;
 
-	// Use malloc instead of stack to avoid overflow with large arrays
-	ProcessInfo *prev_processes = malloc(MAX_PROCESSES * sizeof(ProcessInfo));
-	ProcessInfo *curr_processes = malloc(MAX_PROCESSES * sizeof(ProcessInfo));
-
-	if (!prev_processes || !curr_processes) {
-		log_fatal("Failed to allocate memory for process arrays");
-		display_cleanup();
-		free(prev_processes);
-		free(curr_processes);
-		return 1;
+	// Block for the first frame; the sampler's first tick fires at once
+	int event_fd = sampler_event_fd();
+	uint64_t published;
+	Frame *frame = NULL;
+	while (!frame) {
+		if (read(event_fd, &published, sizeof(published)) < 0 &&
+		    errno != EINTR) {
+			// Give the terminal back first so the message is readable
+			display_cleanup();
+			log_fatal("Failed to wait for the first frame");
+			return 1;
+		}
+		frame = sampler_acquire();
 	}
 
-	int prev_count = collect_processes(prev_processes, MAX_PROCESSES);
-	long total_cpu_prev = read_total_cpu_time();
-	long active_cpu_prev = read_active_cpu_time();
+	// Header warning shown for a few ticks after a table arena grows
+	UiState ui = {0};
+	view_init(&ui.view);
+	note_frame(&ui, frame);
+
+	struct pollfd fds[2] = {
+		{ .fd = STDIN_FILENO, .events = POLLIN },
+		{ .fd = event_fd, .events = POLLIN },
+	};
 
-	bool first_iteration = true;
+	int status = 0;
+	bool redraw = true;
 	while (!input_state.should_exit) {
-		if (first_iteration) {
-			first_iteration = false;
-		} else {
-			// wait 1 sec in total, track user input 10 times/sec
-			for (int i = 0; i < 10; i++) {
-				input_handle(&input_state, curr_processes, prev_count);
-				struct timespec ts = {0, REFRESH_INTERVAL_MS * 100000}; // 100ms
-				nanosleep(&ts, NULL);
+		if (redraw) {
+			render(frame, &input_state, &ui, total_mem_bytes);
+			pin_shown(&frame->table, &input_state, &ui);
+			redraw = false;
+		}
+
+		int ready = poll(fds, 2, -1);
+		if (ready < 0 && errno != EINTR) {
+			log_error("poll failed");
+			status = 1;
+			break;
+		}
+
+		if (ready > 0 && (fds[1].revents & POLLIN)) {
+			if (read(event_fd, &published, sizeof(published)) > 0) {
+				Frame *next = sampler_acquire();
+				if (next) {
+					frame = next;
+					note_frame(&ui, frame);
+					redraw = true;
+				}
+			}
+		}
+
+		// Also after EINTR: a resize arrives as SIGWINCH + KEY_RESIZE
+		if (ready < 0 || (fds[0].revents & POLLIN)) {
+			int interval_ms = input_state.interval_ms;
+			bool full_accuracy = input_state.full_accuracy;
+			uint64_t start_ns = selfstat_now();
+			while (input_handle(&input_state, &frame->table,
+					    scroll_rows(&ui, &input_state,
+							&frame->table))) {
+				redraw = true;
+			}
+			selfstat_record(PHASE_INPUT, selfstat_now() - start_ns);
+			if (input_state.interval_ms != interval_ms) {
+				sampler_set_interval(input_state.interval_ms);
+			}
+			if (input_state.full_accuracy != full_accuracy) {
+				sampler_set_full_accuracy(input_state.full_accuracy);
 			}
 		}
+	}
+
+	display_cleanup();
+	free(ui.pins);
+	view_free(&ui.view);
+	return status;
+}
 
-		long total_cpu_curr = read_total_cpu_time();
-		long active_cpu_curr = read_active_cpu_time();
-		int curr_count = collect_processes(curr_processes,
-						   MAX_PROCESSES);
+static volatile sig_atomic_t stop_requested;
 
-		uint64_t total_cpu_delta = total_cpu_curr - total_cpu_prev;
-		uint64_t active_cpu_delta = active_cpu_curr - active_cpu_prev;
+static void request_stop(int sig __attribute__((unused)))
+{
+	stop_requested = 1;
+}
 
-		compute_process_stats(curr_processes, curr_count,
-				      prev_processes, prev_count,
-				      total_cpu_delta, total_mem_bytes);
+/**
+ * run_batch() - Write every sampled tick as a record
+ * @opts: Command line options
+ *
+ * Runs the same sampling, stats and CPU sort as the UI, without ncurses,
+ * until --count ticks were written, SIGINT or SIGTERM arrives, or the
+ * reader of the output goes away.
+ *
+ * Return: Exit status
+ */
+static int run_batch(const Options *opts)
+{
+	if (batch_open(opts->output, opts->format) != 0) {
+		fprintf(stderr, "Cannot open %s: %s\n", opts->output,
+			strerror(errno));
+		return 1;
+	}
+
+	// No SA_RESTART: a signal must interrupt the wait for the next frame
+	struct sigaction sa = { .sa_handler = request_stop };
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	signal(SIGPIPE, SIG_IGN);
 
-		// Check for conflicting sort flags
-		if (input_state.sort_cpu && input_state.sort_mem) {
-			log_warning("Both sort_cpu and sort_mem are true; using CPU sort");
-			input_state.sort_mem = false;
+	int status = 0;
+	int event_fd = sampler_event_fd();
+	int written = 0;
+	while (!stop_requested && (opts->count == 0 || written < opts->count)) {
+		uint64_t published;
+		if (read(event_fd, &published, sizeof(published)) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			log_error("Failed to wait for a frame");
+			status = 1;
+			break;
 		}
 
-		// Sort processes
-		if (input_state.sort_cpu) {
-			sort_by_cpu(curr_processes, curr_count,
-				    input_state.reversed);
-		} else if (input_state.sort_mem) {
-			sort_by_mem(curr_processes, curr_count,
-				    input_state.reversed);
+		Frame *frame = sampler_acquire();
+		if (!frame) {
+			continue;
 		}
+		uint64_t start_ns = selfstat_now();
+		sort_by_cpu(&frame->table, false);
+		uint64_t sorted_ns = selfstat_now();
+		selfstat_record(PHASE_SORT, sorted_ns - start_ns);
 
-		// Calculate CPU load (use active_cpu_delta for load)
-		double cpu_load = calculate_cpu_load(active_cpu_delta,
-						      REFRESH_INTERVAL_MS,
-						      cpu_cores);
+		struct timespec now;
+		clock_gettime(CLOCK_REALTIME, &now);
+		uint64_t time_ms = (uint64_t)now.tv_sec * 1000u +
+				   (uint64_t)now.tv_nsec / 1000000u;
+		SelfStats self;
+		selfstat_read(&self);
+		int failed = batch_write(frame, time_ms, &self);
+		selfstat_record(PHASE_RENDER, selfstat_now() - sorted_ns);
+		if (failed != 0) {
+			if (errno != EPIPE) {
+				log_error("Failed to write batch output");
+				status = 1;
+			}
+			break;
+		}
+		written++;
+	}
 
-		// Read actual system memory usage (not sum of all processes!)
-		uint64_t used_mem_bytes = read_used_mem_bytes();
-		uint64_t used_mem_mb = used_mem_bytes / (1024 * 1024);
-		uint64_t total_mem_mb = total_mem_bytes / (1024 * 1024);
+	if (batch_close() != 0 && status == 0 && errno != EPIPE) {
+		log_error("Failed to write batch output");
+		status = 1;
+	}
+	return status;
+}
 
-		// Get uptime
-		int days, hours, minutes;
-		read_uptime(&days, &hours, &minutes);
+/**
+ * replay_seek() - Find the frame a jump in recorded time lands on
+ * @index: Current frame
+ * @seek_s: Seconds to jump, negative to go back
+ *
+ * Return: The last frame at or before the target time when going back,
+ * the first one at or after it when going forward
+ */
+static int replay_seek(int index, int seek_s)
+{
+	int64_t target = (int64_t)replay_time_ms(index) + (int64_t)seek_s * 1000;
 
-		// Clear and display
-		clear();
-		display_header(days, hours, minutes, cpu_load,
-			       used_mem_mb, total_mem_mb, curr_count,
-			       input_state.sort_cpu, input_state.sort_mem,
-			       input_state.reversed);
-		display_process_info(curr_processes, curr_count,
-				     input_state.scroll_offset,
-				     input_state.search_term);
-		display_refresh();
+	if (seek_s < 0) {
+		while (index > 0 && (int64_t)replay_time_ms(index) > target) {
+			index--;
+		}
+	} else {
+		while (index < replay_count() - 1 &&
+		       (int64_t)replay_time_ms(index) < target) {
+			index++;
+		}
+	}
+	return index;
+}
 
-		memcpy(prev_processes, curr_processes,
-		       curr_count * sizeof(ProcessInfo));
-		prev_count = curr_count;
-		total_cpu_prev = total_cpu_curr;
-		active_cpu_prev = active_cpu_curr;
+/**
+ * replay_wait_ms() - Time the current frame stays up during playback
+ * @index: Current frame
+ * @speed_shift: Playback speed as a power of two
+ *
+ * Return: Milliseconds, or -1 if playback stops at this frame
+ */
+static int replay_wait_ms(int index, int speed_shift)
+{
+	if (index + 1 >= replay_count()) {
+		return -1;
+	}
+
+	uint64_t now = replay_time_ms(index);
+	uint64_t next = replay_time_ms(index + 1);
+	uint64_t gap = next > now ? next - now : 0;
+	if (gap > REPLAY_MAX_GAP_MS) {
+		gap = REPLAY_MAX_GAP_MS;
+	}
+	return (int)(speed_shift >= 0 ? gap >> speed_shift : gap << -speed_shift);
+}
+
+static double ms_since(const struct timespec *start)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)(now.tv_sec - start->tv_sec) * 1e3 +
+	       (double)(now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+/**
+ * replay_status() - Describe the replay position for the warning line
+ * @ui: UI state receiving the text
+ * @index: Current frame
+ * @loaded: The frame could be decoded
+ * @input_state: Pause and speed settings
+ */
+static void replay_status(UiState *ui, int index, bool loaded,
+			  const InputState *input_state)
+{
+	char when[32] = "";
+	time_t secs = (time_t)(replay_time_ms(index) / 1000);
+	struct tm tm;
+	if (localtime_r(&secs, &tm)) {
+		strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &tm);
+	}
+
+	char speed[16];
+	if (input_state->speed_shift >= 0) {
+		snprintf(speed, sizeof(speed), "%dx", 1 << input_state->speed_shift);
+	} else {
+		snprintf(speed, sizeof(speed), "1/%dx",
+			 1 << -input_state->speed_shift);
+	}
+
+	const char *state = !loaded ? "frame overwritten" :
+			    input_state->paused ? "paused" :
+			    index + 1 >= replay_count() ? "end" : "playing";
+	snprintf(ui->status, sizeof(ui->status),
+		 "Replay %d/%d %s %s %s | space:Pause <-/->:Step [ ]:1min { }:10min < >:Speed",
+		 index + 1, replay_count(), when, speed, state);
+}
+
+/**
+ * run_replay() - Browse a recording with the live UI
+ * @opts: Command line options
+ *
+ * Frames come from the ring file instead of the sampler and are drawn by
+ * the same render(); sorting, search and scrolling work as live. Playback
+ * follows the recorded timestamps scaled by the speed, and the arrow and
+ * bracket keys step or jump through it.
+ *
+ * Return: Exit status
+ */
+static int run_replay(const Options *opts)
+{
+	if (replay_open(opts->replay) != 0) {
+		fprintf(stderr, "Cannot replay %s: %s\n", opts->replay,
+			strerror(errno));
+		return 1;
+	}
+	if (replay_count() == 0) {
+		fprintf(stderr, "%s holds no complete recording\n", opts->replay);
+		replay_close();
+		return 1;
+	}
+
+	Frame frame = {0};
+	if (process_table_init(&frame.table, PROCESS_TABLE_INITIAL_ROWS) != 0) {
+		log_fatal("Failed to allocate memory for the replay");
+		replay_close();
+		return 1;
+	}
+	uint64_t total_mem_bytes = replay_total_mem_bytes();
+
+	display_init();
+	display_show_cmdlines(false);
+	InputState input_state;
+	input_init(&input_state);
+	input_state.replay = true;
+
+	UiState ui = {0};
+	view_init(&ui.view);
+	int status = 0;
+	int index = 0;
+	int shown = -1;
+	bool loaded = false;
+	struct timespec shown_at;
+	clock_gettime(CLOCK_MONOTONIC, &shown_at);
+
+	while (!input_state.should_exit) {
+		if (index != shown) {
+			loaded = replay_load(index, &frame) == 0;
+			if (loaded) {
+				note_frame(&ui, &frame);
+				input_state.interval_ms =
+					(int)(frame.elapsed_s * 1000.0 + 0.5);
+			}
+			shown = index;
+			clock_gettime(CLOCK_MONOTONIC, &shown_at);
+		}
+		replay_status(&ui, index, loaded, &input_state);
+		render(&frame, &input_state, &ui, total_mem_bytes);
+
+		int timeout = -1;
+		int wait_ms = replay_wait_ms(index, input_state.speed_shift);
+		if (!input_state.paused && wait_ms >= 0) {
+			double left = wait_ms - ms_since(&shown_at);
+			timeout = left > 0.0 ? (int)left + 1 : 0;
+		}
+
+		struct pollfd fd = { .fd = STDIN_FILENO, .events = POLLIN };
+		int ready = poll(&fd, 1, timeout);
+		if (ready < 0 && errno != EINTR) {
+			log_error("poll failed");
+			status = 1;
+			break;
+		}
+		if (ready == 0) {
+			index++;
+			continue;
+		}
+
+		// Also after EINTR: a resize arrives as SIGWINCH + KEY_RESIZE
+		bool paused = input_state.paused;
+		int speed_shift = input_state.speed_shift;
+		uint64_t start_ns = selfstat_now();
+		while (input_handle(&input_state, &frame.table,
+				    scroll_rows(&ui, &input_state, &frame.table))) {
+			// drain every pending key; the loop redraws anyway
+		}
+		selfstat_record(PHASE_INPUT, selfstat_now() - start_ns);
+		if (input_state.seek_frames != 0 || input_state.seek_s != 0) {
+			int next = index + input_state.seek_frames;
+			next = next < 0 ? 0 : next;
+			next = next >= replay_count() ? replay_count() - 1 : next;
+			if (input_state.seek_s != 0) {
+				next = replay_seek(next, input_state.seek_s);
+			}
+			input_state.seek_frames = 0;
+			input_state.seek_s = 0;
+			index = next;
+		}
+		// Resuming or changing speed restarts the current frame's time
+		if (input_state.paused != paused ||
+		    input_state.speed_shift != speed_shift) {
+			clock_gettime(CLOCK_MONOTONIC, &shown_at);
+		}
 	}
 
 	display_cleanup();
-	free(prev_processes);
-	free(curr_processes);
+	process_table_free(&frame.table);
+	cpu_stat_free(&frame.cpu_prev);
+	cpu_stat_free(&frame.cpu_curr);
+	replay_close();
+	free(ui.pins);
+	view_free(&ui.view);
+	return status;
+}
+
+int main(int argc, char **argv)
+{
+	Options opts;
+	int parsed = options_parse(argc, argv, &opts);
+	if (parsed != 0) {
+		return parsed > 0 ? 0 : 2;
+	}
+
+	log_info("Process monitor started");
+
+	if (opts.replay) {
+		int status = run_replay(&opts);
+		cmdline_cleanup();
+		log_info("Process monitor stopped");
+		return status;
+	}
+
+	if (opts.proc_root && procdir_set_root(opts.proc_root) != 0) {
+		fprintf(stderr, "Cannot read processes from %s: %s\n",
+			opts.proc_root, strerror(errno));
+		log_fatal("Failed to open the proc root");
+		return 1;
+	}
+
+	int cpu_cores = get_cpu_cores();
+	if (cpu_cores == -1) {
+		log_fatal("Failed to get CPU core count");
+		return 1;
+	}
+
+	uint64_t total_mem_bytes = read_total_mem_bytes();
+	if (total_mem_bytes == 0) {
+		log_fatal("Failed to read total memory bytes");
+		return 1;
+	}
+
+	char init_msg[256];
+	snprintf(init_msg, sizeof(init_msg),
+		 "System initialized: %d cores, %lu MB RAM",
+		 cpu_cores, total_mem_bytes / (1024 * 1024));
+	log_info(init_msg);
+
+	if (opts.record &&
+	    record_open(opts.record, (uint64_t)opts.record_mb * 1024 * 1024,
+			total_mem_bytes) != 0) {
+		fprintf(stderr, "Cannot record to %s: %s\n", opts.record,
+			strerror(errno));
+		log_fatal("Failed to open the recording");
+		return 1;
+	}
+	if (opts.history && history_open(opts.history) != 0) {
+		fprintf(stderr, "Cannot keep history in %s: %s\n", opts.history,
+			strerror(errno));
+		log_fatal("Failed to open the history");
+		record_close();
+		return 1;
+	}
+
+	// Subscribe before the first scan so no fork falls in between
+	if (opts.proc_events && procevents_open() != 0) {
+		log_warning("Proc connector unavailable; scanning /proc instead");
+	}
+	collector_start(opts.collector_threads);
+	if (!opts.no_uring && uring_open(URING_ENTRIES) != 0) {
+		log_info("io_uring unavailable; reading /proc with read()");
+	}
+
+	SamplerConfig sampler_config = {
+		.interval_ms = opts.interval_ms,
+		.cpu_cores = cpu_cores,
+		.total_mem_bytes = total_mem_bytes,
+		// --max-backoff 1 starts in full accuracy; 'a' uses the default
+		.max_backoff = opts.max_backoff > 1 ? opts.max_backoff :
+						      DEFAULT_MAX_BACKOFF,
+		.full_accuracy = opts.max_backoff <= 1,
+	};
+	if (sampler_start(&sampler_config) != 0) {
+		log_fatal("Failed to start sampler");
+		record_close();
+		history_close();
+		collector_stop();
+		uring_close();
+		procevents_close();
+		return 1;
+	}
+
+	int status = opts.batch ? run_batch(&opts) :
+				  run_ui(&opts, total_mem_bytes);
+
+	sampler_stop();
+	record_close();
+	history_close();
+	collector_stop();
+	uring_close();
+	fdcache_cleanup();
+	cmdline_cleanup();
+	procevents_close();
+	procdir_close();
 	log_info("Process monitor stopped");
-	return 0;
+	return status;
 }
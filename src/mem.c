@@ -5,6 +5,7 @@
 #include <string.h>
 #include "logger.h"
 #include "mem.h"
+#include "procdir.h"
 
 /**
  * read_total_mem_bytes() - Read total system memory in bytes
@@ -15,7 +16,7 @@
  */
 uint64_t read_total_mem_bytes(void)
 {
-	FILE *f = fopen("/proc/meminfo", "r");
+	FILE *f = procdir_fopen("meminfo");
 	if (!f) {
 		log_error("Failed to open /proc/meminfo");
 		return 0;
@@ -50,7 +51,7 @@ uint64_t read_total_mem_bytes(void)
  */
 uint64_t read_used_mem_bytes(void)
 {
-	FILE *f = fopen("/proc/meminfo", "r");
+	FILE *f = procdir_fopen("meminfo");
 	if (!f) {
 		log_error("Failed to open /proc/meminfo");
 		return 0;
@@ -88,17 +89,23 @@ uint64_t read_used_mem_bytes(void)
 /**
  * get_page_size() - Get system page size
  *
- * Returns the system page size in bytes using sysconf().
+ * Returns the system page size in bytes using sysconf(). The value cannot
+ * change while we run, so it is queried once and cached.
  *
  * Return: Page size in bytes
  */
 uint64_t get_page_size(void)
 {
-	long page_size = sysconf(_SC_PAGESIZE);
-	if (page_size <= 0) {
-		log_error("Failed to get page size");
-		return 4096; // fallback to common value
+	static uint64_t cached_page_size;
+
+	if (cached_page_size == 0) {
+		long page_size = sysconf(_SC_PAGESIZE);
+		if (page_size <= 0) {
+			log_error("Failed to get page size");
+			page_size = 4096; // fallback to common value
+		}
+		cached_page_size = (uint64_t)page_size;
 	}
-	return (uint64_t)page_size;
+	return cached_page_size;
 }
 
@@ -0,0 +1,225 @@
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "collector.h"
+#include "options.h"
+#include "process.h"
+#include "record.h"
+
+static void print_usage(FILE *out, const char *prog)
+{
+	fprintf(out,
+		"Usage: %s [OPTION]...\n"
+		"\n"
+		"  -B, --batch                  write every tick to stdout or --output\n"
+		"                               instead of running the UI\n"
+		"  -f, --format FORMAT          batch record format: csv (default),\n"
+		"                               json (JSON Lines) or binary\n"
+		"  -o, --output FILE            batch output file (default stdout)\n"
+		"  -n, --count N                stop batch mode after N ticks\n"
+		"  -r, --record FILE            append every tick to the ring file\n"
+		"                               FILE, overwriting the oldest ticks\n"
+		"  -R, --record-size MB         size of a new ring file (%d-%d,\n"
+		"                               default %d)\n"
+		"  -p, --replay FILE            browse the ticks recorded in FILE\n"
+		"                               instead of sampling\n"
+		"  -H, --history DIR            keep a columnar history of every\n"
+		"                               process in DIR, for pbquery\n"
+		"  -b, --max-backoff N          read quiet processes only every N\n"
+		"                               ticks at most (1-%d, default %d;\n"
+		"                               1 reads every process every tick)\n"
+		"  -d, --interval MS            sample every MS milliseconds\n"
+		"                               (%d-%d, default %d)\n"
+		"  -P, --proc-root DIR          read processes and system counters\n"
+		"                               from DIR instead of /proc\n"
+		"  -e, --proc-events            track processes through the kernel\n"
+		"                               proc connector (needs CAP_NET_ADMIN;\n"
+		"                               falls back to scanning /proc)\n"
+		"  -j, --collector-threads N    read /proc with N threads (default 1)\n"
+		"  -U, --no-uring               read /proc with read() even if\n"
+		"                               io_uring is available\n"
+		"  -h, --help                   show this help and exit\n",
+		prog, RECORD_MIN_MB, RECORD_MAX_MB, RECORD_DEFAULT_MB,
+		SAMPLE_MAX_BACKOFF, DEFAULT_MAX_BACKOFF, MIN_INTERVAL_MS, MAX_INTERVAL_MS, DEFAULT_INTERVAL_MS);
+}
+
+/**
+ * parse_int() - Parse a whole decimal option argument within a range
+ * @arg: Option argument
+ * @min: Smallest accepted value
+ * @max: Largest accepted value
+ * @out: Parsed value
+ *
+ * Return: 0 on success, -1 if @arg is not a number in [@min, @max]
+ */
+static int parse_int(const char *arg, long min, long max, int *out)
+{
+	char *end;
+	long value = strtol(arg, &end, 10);
+	if (end == arg || *end != '\0' || value < min || value > max) {
+		return -1;
+	}
+	*out = (int)value;
+	return 0;
+}
+
+/**
+ * options_parse() - Parse command line options
+ * @argc: Argument count from main()
+ * @argv: Argument vector from main()
+ * @opts: Output options, reset to defaults first
+ *
+ * Return: 0 to continue, 1 if help was printed and the program should
+ * exit successfully, -1 on invalid usage (already reported on stderr)
+ */
+int options_parse(int argc, char **argv, Options *opts)
+{
+	static const struct option long_opts[] = {
+		{"batch", no_argument, NULL, 'B'},
+		{"format", required_argument, NULL, 'f'},
+		{"output", required_argument, NULL, 'o'},
+		{"count", required_argument, NULL, 'n'},
+		{"record", required_argument, NULL, 'r'},
+		{"record-size", required_argument, NULL, 'R'},
+		{"replay", required_argument, NULL, 'p'},
+		{"history", required_argument, NULL, 'H'},
+		{"max-backoff", required_argument, NULL, 'b'},
+		{"interval", required_argument, NULL, 'd'},
+		{"proc-root", required_argument, NULL, 'P'},
+		{"proc-events", no_argument, NULL, 'e'},
+		{"collector-threads", required_argument, NULL, 'j'},
+		{"no-uring", no_argument, NULL, 'U'},
+		{"help", no_argument, NULL, 'h'},
+		{NULL, 0, NULL, 0},
+	};
+
+	memset(opts, 0, sizeof(*opts));
+	opts->interval_ms = DEFAULT_INTERVAL_MS;
+	opts->collector_threads = 1;
+	opts->max_backoff = DEFAULT_MAX_BACKOFF;
+	opts->format = BATCH_CSV;
+	opts->record_mb = RECORD_DEFAULT_MB;
+
+	bool batch_only = false; // an option that needs --batch was given
+	bool record_size = false;
+	int c;
+	while ((c = getopt_long(argc, argv, "Bf:o:n:r:R:p:H:b:d:P:ej:Uh", long_opts, NULL)) != -1) {
+		switch (c) {
+		case 'B':
+			opts->batch = true;
+			break;
+		case 'f':
+			batch_only = true;
+			if (batch_parse_format(optarg, &opts->format) != 0) {
+				fprintf(stderr, "%s: --format must be csv, json or binary\n",
+					argv[0]);
+				return -1;
+			}
+			break;
+		case 'o':
+			batch_only = true;
+			opts->output = optarg;
+			break;
+		case 'n':
+			batch_only = true;
+			if (parse_int(optarg, 1, INT32_MAX, &opts->count) != 0) {
+				fprintf(stderr, "%s: --count must be a positive number\n",
+					argv[0]);
+				return -1;
+			}
+			break;
+		case 'r':
+			opts->record = optarg;
+			break;
+		case 'R':
+			record_size = true;
+			if (parse_int(optarg, RECORD_MIN_MB, RECORD_MAX_MB,
+				      &opts->record_mb) != 0) {
+				fprintf(stderr, "%s: --record-size must be %d-%d MB\n",
+					argv[0], RECORD_MIN_MB, RECORD_MAX_MB);
+				return -1;
+			}
+			break;
+		case 'p':
+			opts->replay = optarg;
+			break;
+		case 'H':
+			opts->history = optarg;
+			break;
+		case 'b':
+			if (parse_int(optarg, 1, SAMPLE_MAX_BACKOFF,
+				      &opts->max_backoff) != 0) {
+				fprintf(stderr, "%s: --max-backoff must be 1-%d\n",
+					argv[0], SAMPLE_MAX_BACKOFF);
+				return -1;
+			}
+			break;
+		case 'd':
+			if (parse_int(optarg, MIN_INTERVAL_MS, MAX_INTERVAL_MS,
+				      &opts->interval_ms) != 0) {
+				fprintf(stderr, "%s: --interval must be %d-%d ms\n",
+					argv[0], MIN_INTERVAL_MS, MAX_INTERVAL_MS);
+				return -1;
+			}
+			break;
+		case 'P':
+			opts->proc_root = optarg;
+			break;
+		case 'e':
+			opts->proc_events = true;
+			break;
+		case 'j':
+			if (parse_int(optarg, 1, COLLECTOR_MAX_THREADS,
+				      &opts->collector_threads) != 0) {
+				fprintf(stderr, "%s: --collector-threads must be 1-%d\n",
+					argv[0], COLLECTOR_MAX_THREADS);
+				return -1;
+			}
+			break;
+		case 'U':
+			opts->no_uring = true;
+			break;
+		case 'h':
+			print_usage(stdout, argv[0]);
+			return 1;
+		default:
+			print_usage(stderr, argv[0]);
+			return -1;
+		}
+	}
+
+	if (batch_only && !opts->batch) {
+		fprintf(stderr, "%s: --format, --output and --count need --batch\n",
+			argv[0]);
+		return -1;
+	}
+
+	if (record_size && !opts->record) {
+		fprintf(stderr, "%s: --record-size needs --record\n", argv[0]);
+		return -1;
+	}
+
+	if (opts->replay && (opts->batch || opts->record || opts->history)) {
+		fprintf(stderr, "%s: --replay cannot be combined with --batch, --record or --history\n",
+			argv[0]);
+		return -1;
+	}
+
+	// The proc connector reports the live system, not another tree
+	if (opts->proc_root && opts->proc_events) {
+		fprintf(stderr, "%s: --proc-events cannot be combined with --proc-root\n",
+			argv[0]);
+		return -1;
+	}
+
+	if (optind < argc) {
+		fprintf(stderr, "%s: unexpected argument '%s'\n", argv[0],
+			argv[optind]);
+		print_usage(stderr, argv[0]);
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,203 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pidmap.h"
+
+#define PIDMAP_MIN_CAPACITY 64
+
+static size_t pidmap_hash(int pid, uint64_t starttime, size_t mask)
+{
+	// Fibonacci hashing; starttime only perturbs the bucket of reused PIDs
+	uint64_t key = (uint64_t)(uint32_t)pid ^ (starttime << 32) ^
+		       (starttime >> 32);
+	return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+}
+
+/**
+ * pidmap_init() - Initialize an empty map
+ * @map: Map to initialize
+ *
+ * No memory is allocated until pidmap_reset() or pidmap_insert().
+ */
+void pidmap_init(PidMap *map)
+{
+	map->entries = NULL;
+	map->capacity = 0;
+	map->count = 0;
+}
+
+/**
+ * pidmap_free() - Release map storage
+ * @map: Map to free
+ */
+void pidmap_free(PidMap *map)
+{
+	free(map->entries);
+	pidmap_init(map);
+}
+
+/**
+ * pidmap_reset() - Clear the map and size it for a new snapshot
+ * @map: Map to reset
+ * @expected: Number of entries that are about to be inserted
+ *
+ * Keeps the load factor at or below 50%. Storage only grows, so a map that
+ * is rebuilt every tick stops allocating once it has seen the largest
+ * snapshot.
+ *
+ * Return: 0 on success, -1 on allocation failure
+ */
+int pidmap_reset(PidMap *map, size_t expected)
+{
+	size_t want = PIDMAP_MIN_CAPACITY;
+	while (want < expected * 2) {
+		want *= 2;
+	}
+
+	if (want > map->capacity) {
+		PidMapEntry *entries = malloc(want * sizeof(PidMapEntry));
+		if (!entries) {
+			// Never leave stale entries behind a failed reset
+			pidmap_free(map);
+			return -1;
+		}
+		free(map->entries);
+		map->entries = entries;
+		map->capacity = want;
+	}
+
+	memset(map->entries, 0, map->capacity * sizeof(PidMapEntry));
+	map->count = 0;
+	return 0;
+}
+
+/**
+ * pidmap_insert() - Insert or update a (pid, starttime) -> slot mapping
+ * @map: Map to insert into
+ * @pid: Process ID (must be > 0)
+ * @starttime: Process start time in jiffies since boot
+ * @slot: Value to associate with the key
+ *
+ * Grows the table if inserting would exceed a 50% load factor.
+ *
+ * Return: 0 on success, -1 on invalid pid or allocation failure
+ */
+int pidmap_insert(PidMap *map, int pid, uint64_t starttime, int slot)
+{
+	if (pid <= 0) {
+		return -1;
+	}
+
+	if ((map->count + 1) * 2 > map->capacity) {
+		PidMap grown;
+		pidmap_init(&grown);
+		if (pidmap_reset(&grown, map->count + 1) != 0) {
+			return -1;
+		}
+		for (size_t i = 0; i < map->capacity; i++) {
+			PidMapEntry *e = &map->entries[i];
+			if (e->pid != 0) {
+				pidmap_insert(&grown, e->pid, e->starttime,
+					      e->slot);
+			}
+		}
+		free(map->entries);
+		*map = grown;
+	}
+
+	size_t mask = map->capacity - 1;
+	size_t i = pidmap_hash(pid, starttime, mask);
+
+	while (map->entries[i].pid != 0) {
+		PidMapEntry *e = &map->entries[i];
+		if (e->pid == pid && e->starttime == starttime) {
+			e->slot = slot;
+			return 0;
+		}
+		i = (i + 1) & mask;
+	}
+
+	map->entries[i].pid = pid;
+	map->entries[i].starttime = starttime;
+	map->entries[i].slot = slot;
+	map->count++;
+	return 0;
+}
+
+/**
+ * pidmap_find() - Look up the slot of a (pid, starttime) key
+ * @map: Map to search
+ * @pid: Process ID
+ * @starttime: Process start time in jiffies since boot
+ *
+ * Return: Slot index, or -1 if the key is not present
+ */
+int pidmap_find(const PidMap *map, int pid, uint64_t starttime)
+{
+	if (map->capacity == 0 || pid <= 0) {
+		return -1;
+	}
+
+	size_t mask = map->capacity - 1;
+	size_t i = pidmap_hash(pid, starttime, mask);
+
+	while (map->entries[i].pid != 0) {
+		const PidMapEntry *e = &map->entries[i];
+		if (e->pid == pid && e->starttime == starttime) {
+			return e->slot;
+		}
+		i = (i + 1) & mask;
+	}
+
+	return -1;
+}
+
+/**
+ * pidmap_remove() - Remove a (pid, starttime) key
+ * @map: Map to remove from
+ * @pid: Process ID
+ * @starttime: Process start time in jiffies since boot
+ *
+ * Uses backward-shift deletion, so lookups never need tombstones.
+ *
+ * Return: 0 if the key was removed, -1 if it was not present
+ */
+int pidmap_remove(PidMap *map, int pid, uint64_t starttime)
+{
+	if (map->capacity == 0 || pid <= 0) {
+		return -1;
+	}
+
+	size_t mask = map->capacity - 1;
+	size_t i = pidmap_hash(pid, starttime, mask);
+
+	while (map->entries[i].pid != pid ||
+	       map->entries[i].starttime != starttime) {
+		if (map->entries[i].pid == 0) {
+			return -1;
+		}
+		i = (i + 1) & mask;
+	}
+
+	size_t j = i;
+	for (;;) {
+		j = (j + 1) & mask;
+		PidMapEntry *e = &map->entries[j];
+		if (e->pid == 0) {
+			break;
+		}
+
+		// Move e into the hole unless its home bucket lies in (i, j]
+		size_t home = pidmap_hash(e->pid, e->starttime, mask);
+		bool stays = (i <= j) ? (i < home && home <= j)
+				      : (i < home || home <= j);
+		if (!stays) {
+			map->entries[i] = *e;
+			i = j;
+		}
+	}
+
+	map->entries[i].pid = 0;
+	map->count--;
+	return 0;
+}
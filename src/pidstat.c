@@ -0,0 +1,110 @@
+#include <stdbool.h>
+#include <string.h>
+#include "pidstat.h"
+
+#define PIDSTAT_VALID_MASK \
+	(((PIDSTAT_MASK(PIDSTAT_FIELD_COUNT) - 1) << 1) | 1ULL)
+
+/**
+ * scan_u64() - Decode a decimal integer at *pos
+ * @pos: In/out cursor, advanced past the digits
+ * @end: End of the buffer
+ * @out: Decoded value; negative numbers are stored in two's complement
+ *
+ * Return: true if at least one digit was consumed
+ */
+static inline bool scan_u64(const char **pos, const char *end, uint64_t *out)
+{
+	const char *s = *pos;
+	bool negative = false;
+
+	if (s < end && *s == '-') {
+		negative = true;
+		s++;
+	}
+
+	const char *digits = s;
+	uint64_t value = 0;
+	while (s < end && (unsigned char)(*s - '0') < 10) {
+		value = value * 10 + (uint64_t)(*s - '0');
+		s++;
+	}
+
+	if (s == digits) {
+		return false;
+	}
+
+	*out = negative ? 0 - value : value;
+	*pos = s;
+	return true;
+}
+
+/**
+ * pidstat_parse() - Parse a /proc/[pid]/stat line without copying it
+ * @buf: Raw file contents (need not be NUL-terminated)
+ * @len: Number of valid bytes in buf
+ * @mask: PIDSTAT_MASK() bits of the numeric fields to decode
+ * @st: Output; comm points into buf
+ *
+ * pid, comm and state are always filled in. comm is delimited by the first
+ * '(' and the last ')', so names containing spaces or parentheses are
+ * handled. Scanning stops after the highest requested field; unrequested
+ * fields are skipped without being decoded.
+ *
+ * Return: 0 on success, -1 if the line is malformed or truncated before a
+ * requested field
+ */
+int pidstat_parse(const char *buf, size_t len, uint64_t mask, PidStat *st)
+{
+	const char *end = buf + len;
+	const char *pos = buf;
+
+	if (!scan_u64(&pos, end, &st->field[PIDSTAT_PID])) {
+		return -1;
+	}
+
+	const char *open = memchr(pos, '(', (size_t)(end - pos));
+	const char *close = end;
+	while (close > buf && close[-1] != ')') {
+		close--;
+	}
+	if (!open || close <= open + 1) {
+		return -1;
+	}
+	close--; // now points at the last ')'
+
+	st->comm = open + 1;
+	st->comm_len = (size_t)(close - open - 1);
+
+	pos = close + 1;
+	if (end - pos < 2 || pos[0] != ' ') {
+		return -1;
+	}
+	st->state = pos[1];
+	pos += 2;
+
+	uint64_t remaining = mask & PIDSTAT_VALID_MASK &
+			     ~(PIDSTAT_MASK(0) | PIDSTAT_MASK(PIDSTAT_PID) |
+			       PIDSTAT_MASK(PIDSTAT_COMM) |
+			       PIDSTAT_MASK(PIDSTAT_STATE));
+
+	for (int field = PIDSTAT_PPID; remaining; field++) {
+		if (pos >= end || *pos != ' ') {
+			return -1;
+		}
+		pos++;
+
+		if (remaining & PIDSTAT_MASK(field)) {
+			if (!scan_u64(&pos, end, &st->field[field])) {
+				return -1;
+			}
+			remaining &= ~PIDSTAT_MASK(field);
+		} else {
+			while (pos < end && *pos != ' ') {
+				pos++;
+			}
+		}
+	}
+
+	return 0;
+}
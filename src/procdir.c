@@ -0,0 +1,284 @@
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "logger.h"
+#include "procdir.h"
+#include "syscount.h"
+
+#define PROCDIR_BUF_SIZE (128 * 1024)
+#define PIDLIST_MIN_CAPACITY 1024
+
+// Record layout returned by getdents64(2)
+struct linux_dirent64 {
+	uint64_t d_ino;
+	int64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[];
+};
+
+static const char *proc_root = PROCDIR_DEFAULT_ROOT;
+static int proc_dirfd = -1;
+static _Alignas(8) char dirent_buf[PROCDIR_BUF_SIZE];
+
+/**
+ * procdir_set_root() - Read a different tree instead of /proc
+ * @root: Directory laid out like /proc (e.g. built by mkproc); the string
+ *	  must stay valid
+ *
+ * Every reader goes through the root descriptor, so this redirects
+ * process listing, per-PID files and the system files alike. Call it
+ * before anything is read; a held descriptor is closed.
+ *
+ * Return: 0 on success, -1 if @root cannot be opened as a directory
+ */
+int procdir_set_root(const char *root)
+{
+	procdir_close();
+	proc_root = root;
+	return procdir_fd() < 0 ? -1 : 0;
+}
+
+/**
+ * procdir_root() - Path of the tree read instead of /proc, or "/proc"
+ */
+const char *procdir_root(void)
+{
+	return proc_root;
+}
+
+/**
+ * procdir_fd() - Get the descriptor of /proc, opening it on first use
+ *
+ * Return: Directory descriptor, or -1 if /proc cannot be opened
+ */
+int procdir_fd(void)
+{
+	if (proc_dirfd < 0) {
+		proc_dirfd = open(proc_root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (proc_dirfd < 0) {
+			char msg[256];
+			snprintf(msg, sizeof(msg), "Failed to open %s", proc_root);
+			log_error(msg);
+		}
+	}
+	return proc_dirfd;
+}
+
+/**
+ * procdir_open() - Open a system-wide file such as "stat" or "meminfo"
+ * @name: File name inside /proc
+ *
+ * Return: File descriptor, or -1 on error
+ */
+int procdir_open(const char *name)
+{
+	int dirfd = procdir_fd();
+	if (dirfd < 0) {
+		return -1;
+	}
+	return openat(dirfd, name, O_RDONLY | O_CLOEXEC);
+}
+
+/**
+ * procdir_fopen() - Open a system-wide file for stdio reading
+ * @name: File name inside /proc
+ *
+ * Return: Stream, or NULL on error
+ */
+FILE *procdir_fopen(const char *name)
+{
+	int fd = procdir_open(name);
+	if (fd < 0) {
+		return NULL;
+	}
+
+	FILE *f = fdopen(fd, "r");
+	if (!f) {
+		close(fd);
+	}
+	return f;
+}
+
+/**
+ * procdir_close() - Close the held /proc descriptor
+ */
+void procdir_close(void)
+{
+	if (proc_dirfd >= 0) {
+		close(proc_dirfd);
+		proc_dirfd = -1;
+	}
+}
+
+/**
+ * format_pid_path() - Write "<pid>/<name>" into buf without snprintf
+ * @buf: Output buffer, at least 12 bytes plus strlen(name) + 1
+ * @pid: Process ID (> 0)
+ * @name: File name inside the PID directory
+ */
+static void format_pid_path(char *buf, int pid, const char *name)
+{
+	char digits[12];
+	int n = 0;
+	unsigned int value = (unsigned int)pid;
+
+	do {
+		digits[n++] = (char)('0' + value % 10);
+		value /= 10;
+	} while (value);
+
+	while (n) {
+		*buf++ = digits[--n];
+	}
+	*buf++ = '/';
+	while (*name) {
+		*buf++ = *name++;
+	}
+	*buf = '\0';
+}
+
+/**
+ * procdir_openat() - Open a per-PID file relative to the /proc descriptor
+ * @pid: Process ID
+ * @name: File name inside /proc/[pid], e.g. "stat"
+ *
+ * Return: File descriptor, or -1 on error
+ */
+int procdir_openat(int pid, const char *name)
+{
+	int dirfd = procdir_fd();
+	if (dirfd < 0 || pid <= 0) {
+		return -1;
+	}
+
+	char path[64];
+	format_pid_path(path, pid, name);
+	syscount_add(1, 0);
+	return openat(dirfd, path, O_RDONLY | O_CLOEXEC);
+}
+
+/**
+ * parse_pid() - Decode a directory name that consists only of digits
+ * @name: NUL-terminated directory name
+ *
+ * Return: PID, or 0 if the name is not a PID
+ */
+static inline int parse_pid(const char *name)
+{
+	int pid = 0;
+
+	if (*name == '\0') {
+		return 0;
+	}
+	for (; *name; name++) {
+		unsigned int digit = (unsigned char)*name - '0';
+		if (digit > 9 || pid > 99999999) {
+			return 0;
+		}
+		pid = pid * 10 + (int)digit;
+	}
+	return pid;
+}
+
+/**
+ * pidlist_push() - Append a PID to a list, growing it geometrically
+ * @list: List to append to
+ * @pid: Process ID
+ * @id: Identity of the process (see PidList)
+ *
+ * Return: 0 on success, -1 on allocation failure
+ */
+int pidlist_push(PidList *list, int pid, uint64_t id)
+{
+	if (list->count == list->capacity) {
+		int capacity = list->capacity ? list->capacity * 2 :
+			       PIDLIST_MIN_CAPACITY;
+		int *grown = realloc(list->pids, capacity * sizeof(int));
+		if (grown) {
+			list->pids = grown;
+		}
+		uint64_t *ids = realloc(list->ids, capacity * sizeof(uint64_t));
+		if (ids) {
+			list->ids = ids;
+		}
+		if (!grown || !ids) {
+			return -1;
+		}
+		list->capacity = capacity;
+	}
+	list->pids[list->count] = pid;
+	list->ids[list->count] = id;
+	list->count++;
+	return 0;
+}
+
+/**
+ * procdir_list_pids() - List every PID currently present in /proc
+ * @list: Output list; its storage is reused and grown as needed
+ *
+ * Rewinds the held descriptor and walks it with getdents64(). Entries that
+ * are not directories or whose names are not all digits are skipped. The
+ * directory's inode number is recorded as the identity of each PID.
+ *
+ * Return: Number of PIDs listed, or -1 on error
+ */
+int procdir_list_pids(PidList *list)
+{
+	list->count = 0;
+
+	int dirfd = procdir_fd();
+	if (dirfd < 0 || lseek(dirfd, 0, SEEK_SET) < 0) {
+		return -1;
+	}
+	syscount_add(1, 0);
+
+	for (;;) {
+		long n = syscall(SYS_getdents64, dirfd, dirent_buf,
+				 sizeof(dirent_buf));
+		syscount_add(1, n > 0 ? (uint64_t)n : 0);
+		if (n < 0) {
+			log_error("getdents64 on /proc failed");
+			return -1;
+		}
+		if (n == 0) {
+			break;
+		}
+
+		for (long off = 0; off < n;) {
+			struct linux_dirent64 *d =
+				(struct linux_dirent64 *)(dirent_buf + off);
+			off += d->d_reclen;
+
+			if (d->d_type != DT_DIR && d->d_type != DT_UNKNOWN) {
+				continue;
+			}
+
+			int pid = parse_pid(d->d_name);
+			if (pid > 0 && pidlist_push(list, pid, d->d_ino) != 0) {
+				log_error("Failed to grow PID list");
+				return list->count;
+			}
+		}
+	}
+
+	return list->count;
+}
+
+/**
+ * pidlist_free() - Release the storage of a PID list
+ * @list: List to free
+ */
+void pidlist_free(PidList *list)
+{
+	free(list->pids);
+	free(list->ids);
+	list->pids = NULL;
+	list->ids = NULL;
+	list->count = 0;
+	list->capacity = 0;
+}
@@ -1,216 +1,979 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <dirent.h>
-#include <ctype.h>
+#include <time.h>
 #include <unistd.h>
-#include <fcntl.h>
+#include "collector.h"
 #include "logger.h"
 #include "process.h"
+#include "fdcache.h"
+#include "pidmap.h"
+#include "pidstat.h"
+#include "procdir.h"
+#include "procevents.h"
+#include "uring.h"
 #include "mem.h"
 
+// Index over the previous snapshot, rebuilt once per compute_process_stats()
+static PidMap prev_index;
+
+// PIDs listed by the latest scan; storage is reused between ticks
+static PidList pid_list;
+
+// Index by PID alone over the previous snapshot, for adaptive sampling
+static PidMap sched_index;
+
+// PIDs with their listing identity (see PidList) on the last adaptive
+// tick and this one; listed holds nothing usable unless listed_valid
+static PidMap listed, listed_next;
+static bool listed_valid;
+
+// Rows of the previous snapshot carried over unread this tick
+static struct {
+	int *rows;
+	int count;
+	int capacity;
+} carried;
+
+// Fields of /proc/[pid]/stat that read_process() needs
+#define STAT_FIELDS (PIDSTAT_MASK(PIDSTAT_UTIME) | \
+		     PIDSTAT_MASK(PIDSTAT_STIME) | \
+		     PIDSTAT_MASK(PIDSTAT_STARTTIME) | \
+		     PIDSTAT_MASK(PIDSTAT_RSS))
+
+// Longer comm values are truncated
+#define PROCESS_NAME_MAX 40
+
+// PIDs per chunk handed to a collector thread
+#define COLLECT_CHUNK 64
+
+/*
+ * Per-PID results of a parallel collection. Numeric columns go straight
+ * into the table row of the same index; names are staged here because the
+ * string pool can only be appended to from one thread.
+ */
+static struct {
+	int32_t *slot;                        // fdcache slot of each PID
+	int8_t *name_len;                     // -1 if the PID could not be read
+	char (*name)[PROCESS_NAME_MAX];
+	int capacity;
+} scratch;
+
+// Initial name pool size per row; comm is at most 16 bytes for most tasks
+#define NAME_BYTES_PER_ROW 16
+
+// Bytes of all columns for one row
+#define ROW_BYTES (sizeof(uint64_t) * 5 + sizeof(double) * 2 + \
+		   sizeof(int32_t) + sizeof(uint32_t) * 2 + sizeof(uint8_t) * 3)
+
+/**
+ * carve_columns() - Point every column of a table into an arena
+ * @t: Table whose column pointers are set
+ * @arena: Block of at least capacity * ROW_BYTES bytes
+ * @capacity: Rows per column
+ *
+ * Columns are laid out by decreasing alignment so none needs padding.
+ */
+static void carve_columns(ProcessTable *t, char *arena, int capacity)
+{
+	size_t rows = (size_t)capacity;
+
+	t->starttime = (uint64_t *)arena;
+	t->utime = t->starttime + rows;
+	t->stime = t->utime + rows;
+	t->mem_bytes = t->stime + rows;
+	t->read_ns = t->mem_bytes + rows;
+	t->cpu_percent = (double *)(t->read_ns + rows);
+	t->mem_percent = t->cpu_percent + rows;
+	t->pid = (int32_t *)(t->mem_percent + rows);
+	t->name = (uint32_t *)(t->pid + rows);
+	t->order = t->name + rows;
+	t->flags = (uint8_t *)(t->order + rows);
+	t->backoff = t->flags + rows;
+	t->wait = t->backoff + rows;
+}
+
 /**
- * read_cmdline() - Read process command line from /proc/[pid]/cmdline
- * @pid: Process ID
- * @buf: Output buffer
- * @size: Buffer size
+ * process_table_reserve() - Make room for at least @rows rows
+ * @t: Table to grow
+ * @rows: Number of rows needed
  *
- * Reads cmdline and replaces null bytes with spaces.
+ * Grows the arena geometrically and keeps the first t->count rows. Each
+ * growth is logged as a warning and counted in t->grow_count.
  *
- * Return: 0 on success, -1 on error
+ * Return: 0 on success, -1 on allocation failure (the table is unchanged)
+ */
+int process_table_reserve(ProcessTable *t, int rows)
+{
+	if (rows <= t->capacity) {
+		return 0;
+	}
+
+	int capacity = t->capacity > 0 ? t->capacity : PROCESS_TABLE_INITIAL_ROWS;
+	while (capacity < rows) {
+		if (capacity > INT32_MAX / 2) {
+			return -1;
+		}
+		capacity *= 2;
+	}
+
+	char *arena = malloc((size_t)capacity * ROW_BYTES);
+	if (!arena) {
+		log_error("Failed to grow process table");
+		return -1;
+	}
+
+	ProcessTable grown = *t;
+	carve_columns(&grown, arena, capacity);
+	grown.arena = arena;
+	grown.capacity = capacity;
+
+	size_t n = (size_t)t->count;
+	if (n > 0) {
+		memcpy(grown.pid, t->pid, n * sizeof(*t->pid));
+		memcpy(grown.starttime, t->starttime, n * sizeof(*t->starttime));
+		memcpy(grown.utime, t->utime, n * sizeof(*t->utime));
+		memcpy(grown.stime, t->stime, n * sizeof(*t->stime));
+		memcpy(grown.mem_bytes, t->mem_bytes, n * sizeof(*t->mem_bytes));
+		memcpy(grown.read_ns, t->read_ns, n * sizeof(*t->read_ns));
+		memcpy(grown.cpu_percent, t->cpu_percent,
+		       n * sizeof(*t->cpu_percent));
+		memcpy(grown.mem_percent, t->mem_percent,
+		       n * sizeof(*t->mem_percent));
+		memcpy(grown.flags, t->flags, n * sizeof(*t->flags));
+		memcpy(grown.backoff, t->backoff, n * sizeof(*t->backoff));
+		memcpy(grown.wait, t->wait, n * sizeof(*t->wait));
+		memcpy(grown.name, t->name, n * sizeof(*t->name));
+		memcpy(grown.order, t->order, n * sizeof(*t->order));
+	}
+
+	if (t->arena) {
+		grown.grow_count++;
+		char msg[128];
+		snprintf(msg, sizeof(msg),
+			 "Process table grew from %d to %d rows",
+			 t->capacity, capacity);
+		log_warning(msg);
+	}
+
+	free(t->arena);
+	*t = grown;
+	return 0;
+}
+
+/**
+ * process_table_init() - Allocate the columns of a process table
+ * @t: Table to initialize
+ * @capacity: Number of rows to allocate up front
+ *
+ * Return: 0 on success, -1 on allocation failure
  */
-static int read_cmdline(int pid, char *buf, size_t size)
+int process_table_init(ProcessTable *t, int capacity)
 {
-	char path[64];
-	snprintf(path, sizeof(path), "/proc/%d/cmdline", pid);
+	memset(t, 0, sizeof(*t));
 
-	int fd = open(path, O_RDONLY);
-	if (fd < 0) {
+	t->names_cap = (size_t)(capacity > 0 ? capacity : 1) * NAME_BYTES_PER_ROW;
+	t->names = malloc(t->names_cap);
+
+	if (!t->names || process_table_reserve(t, capacity > 0 ? capacity : 1) != 0) {
+		process_table_free(t);
 		return -1;
 	}
 
-	ssize_t n = read(fd, buf, size - 1);
-	close(fd);
+	return 0;
+}
+
+/**
+ * process_table_free() - Free the columns of a process table
+ * @t: Table to free
+ */
+void process_table_free(ProcessTable *t)
+{
+	free(t->arena);
+	free(t->names);
+	memset(t, 0, sizeof(*t));
+}
 
-	if (n <= 0) {
+/**
+ * process_table_copy() - Copy every row and name of a table into another
+ * @dst: Initialized table; grown as needed, previous rows are discarded
+ * @src: Table to copy
+ *
+ * Used to hand a finished snapshot to another thread. dst->grow_count
+ * counts only dst's own growths.
+ *
+ * Return: 0 on success, -1 on allocation failure (dst is left empty)
+ */
+int process_table_copy(ProcessTable *dst, const ProcessTable *src)
+{
+	dst->count = 0;
+	dst->names_len = 0;
+	if (process_table_reserve(dst, src->count) != 0) {
 		return -1;
 	}
 
-	// Replace null bytes with spaces
-	for (ssize_t i = 0; i < n - 1; i++) {
-		if (buf[i] == '\0') {
-			buf[i] = ' ';
+	if (dst->names_cap < src->names_len) {
+		char *names = realloc(dst->names, src->names_cap);
+		if (!names) {
+			return -1;
 		}
+		dst->names = names;
+		dst->names_cap = src->names_cap;
+	}
+	memcpy(dst->names, src->names, src->names_len);
+	dst->names_len = src->names_len;
+
+	size_t n = (size_t)src->count;
+	memcpy(dst->pid, src->pid, n * sizeof(*src->pid));
+	memcpy(dst->starttime, src->starttime, n * sizeof(*src->starttime));
+	memcpy(dst->utime, src->utime, n * sizeof(*src->utime));
+	memcpy(dst->stime, src->stime, n * sizeof(*src->stime));
+	memcpy(dst->mem_bytes, src->mem_bytes, n * sizeof(*src->mem_bytes));
+	memcpy(dst->read_ns, src->read_ns, n * sizeof(*src->read_ns));
+	memcpy(dst->cpu_percent, src->cpu_percent, n * sizeof(*src->cpu_percent));
+	memcpy(dst->mem_percent, src->mem_percent, n * sizeof(*src->mem_percent));
+	memcpy(dst->flags, src->flags, n * sizeof(*src->flags));
+	memcpy(dst->backoff, src->backoff, n * sizeof(*src->backoff));
+	memcpy(dst->wait, src->wait, n * sizeof(*src->wait));
+	memcpy(dst->name, src->name, n * sizeof(*src->name));
+	memcpy(dst->order, src->order, n * sizeof(*src->order));
+	dst->count = src->count;
+	dst->stale_count = src->stale_count;
+	dst->sample_ns = src->sample_ns;
+	return 0;
+}
+
+/**
+ * process_table_add_name() - Copy a name into the string pool of a table
+ * @t: Table whose pool receives the name
+ * @name: Name bytes (not NUL-terminated)
+ * @len: Length of name
+ *
+ * Return: Offset of the stored name, or 0 (the empty string) on allocation
+ * failure
+ */
+uint32_t process_table_add_name(ProcessTable *t, const char *name, size_t len)
+{
+	if (t->names_len + len + 1 > t->names_cap) {
+		size_t cap = t->names_cap * 2;
+		while (t->names_len + len + 1 > cap) {
+			cap *= 2;
+		}
+		char *grown = realloc(t->names, cap);
+		if (!grown) {
+			return 0;
+		}
+		t->names = grown;
+		t->names_cap = cap;
+	}
+
+	uint32_t off = (uint32_t)t->names_len;
+	memcpy(t->names + off, name, len);
+	t->names[off + len] = '\0';
+	t->names_len += len + 1;
+	return off;
+}
+
+/**
+ * fill_numbers() - Fill the numeric columns of a row from /proc/[pid]/stat
+ * @t: Table to fill
+ * @row: Row to fill
+ * @buf: Raw stat line
+ * @len: Number of bytes in buf
+ * @st: Output parse result; comm is left for the caller to store
+ *
+ * Touches only @row, so distinct rows may be filled concurrently. The row
+ * is scheduled to be read again next tick.
+ *
+ * Return: 0 on success, -1 if the line could not be parsed
+ */
+static int fill_numbers(ProcessTable *t, int row, const char *buf,
+			size_t len, PidStat *st)
+{
+	if (pidstat_parse(buf, len, STAT_FIELDS, st) != 0) {
+		return -1;
+	}
+
+	t->pid[row] = (int32_t)st->field[PIDSTAT_PID];
+	t->starttime[row] = st->field[PIDSTAT_STARTTIME];
+	t->utime[row] = st->field[PIDSTAT_UTIME];
+	t->stime[row] = st->field[PIDSTAT_STIME];
+	t->mem_bytes[row] = st->field[PIDSTAT_RSS] * get_page_size();
+
+	t->read_ns[row] = t->sample_ns;
+	t->backoff[row] = 1;
+	t->wait[row] = 0;
+
+	t->flags[row] = PROC_MEM_VALID;
+	t->cpu_percent[row] = 0.0;
+	t->mem_percent[row] = 0.0;
+
+	return 0;
+}
+
+static size_t name_length(const PidStat *st)
+{
+	return st->comm_len < PROCESS_NAME_MAX ? st->comm_len :
+						 PROCESS_NAME_MAX;
+}
+
+/**
+ * fill_from_stat() - Fill a table row from raw /proc/[pid]/stat contents
+ * @t: Table to fill
+ * @row: Row to fill
+ * @buf: Raw stat line
+ * @len: Number of bytes in buf
+ *
+ * Return: 0 on success, -1 if the line could not be parsed
+ */
+static int fill_from_stat(ProcessTable *t, int row, const char *buf,
+			  size_t len)
+{
+	PidStat st;
+	if (fill_numbers(t, row, buf, len, &st) != 0) {
+		return -1;
 	}
-	buf[n] = '\0';
 
+	t->name[row] = process_table_add_name(t, st.comm, name_length(&st));
 	return 0;
 }
 
 /**
  * read_process() - Read process information from /proc/[pid]/stat
  * @pid: Process ID to read
- * @p: Pointer to ProcessInfo structure to fill
+ * @t: Table to append the process to
  *
- * Parses /proc/[pid]/stat to extract pid, name, utime, stime, and rss.
- * Sets cpu_valid and mem_valid to false; these are computed later.
+ * Reads /proc/[pid]/stat through the fd cache (one pread() for a known
+ * PID) into a stack buffer and parses pid, name, utime, stime, starttime
+ * and rss from it in place. The command line is not read here; see
+ * cmdline_get().
+ * Clears PROC_CPU_VALID; percentages are computed later.
  *
  * Return: 0 on success, -1 on error
  */
-int read_process(int pid, ProcessInfo *p)
+int read_process(int pid, ProcessTable *t)
+{
+	if (t->count >= t->capacity &&
+	    process_table_reserve(t, t->count + 1) != 0) {
+		return -1;
+	}
+
+	char buf[PIDSTAT_BUF_SIZE];
+	ssize_t n = fdcache_read_stat(pid, buf, sizeof(buf));
+
+	if (n <= 0 || fill_from_stat(t, t->count, buf, (size_t)n) != 0) {
+		return -1;
+	}
+
+	t->order[t->count] = (uint32_t)t->count;
+	t->count++;
+	return 0;
+}
+
+/**
+ * list_pids() - Decide which PIDs to sample this tick
+ *
+ * With proc connector tracking active, the live set maintained from fork
+ * and exit events is used and /proc is only listed when that set needs
+ * (re)seeding. Otherwise /proc is listed with getdents64().
+ *
+ * Return: 0 on success, -1 if no PID list could be produced
+ */
+static int list_pids(void)
 {
-	char path[256];
-	snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+	if (procevents_active() && procevents_drain() == 0) {
+		const PidList *live = procevents_pids();
+		pid_list.count = 0;
+		for (int i = 0; i < live->count; i++) {
+			if (pidlist_push(&pid_list, live->pids[i],
+					 live->ids[i]) != 0) {
+				return -1;
+			}
+		}
+		return 0;
+	}
 
-	FILE *f = fopen(path, "r");
-	if (!f) {
+	if (procdir_list_pids(&pid_list) < 0) {
 		return -1;
-    }
-    
-	char comm[256];
-	int read_pid;
-	char state;
-	unsigned long utime, stime, rss;
-
-	// Parse /proc/[pid]/stat fields up to rss (field 24)
-	int n = fscanf(f,
-		       "%d %s %c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u "
-		       "%lu %lu %*d %*d %*d %*d %*d %*d %*u %*u %lu",
-		       &read_pid, comm, &state, &utime, &stime, &rss);
-
-	fclose(f);
-
-	if (n < 6)
+	}
+	if (procevents_active()) {
+		procevents_seed(&pid_list);
+	}
+	return 0;
+}
+
+static int scratch_reserve(int count)
+{
+	if (count <= scratch.capacity) {
+		return 0;
+	}
+
+	int capacity = scratch.capacity ? scratch.capacity : PROCESS_TABLE_INITIAL_ROWS;
+	while (capacity < count) {
+		capacity *= 2;
+	}
+
+	int32_t *slot = realloc(scratch.slot, (size_t)capacity * sizeof(*slot));
+	if (slot) {
+		scratch.slot = slot;
+	}
+	int8_t *name_len = realloc(scratch.name_len,
+				   (size_t)capacity * sizeof(*name_len));
+	if (name_len) {
+		scratch.name_len = name_len;
+	}
+	char (*name)[PROCESS_NAME_MAX] = realloc(scratch.name,
+						 (size_t)capacity * sizeof(*name));
+	if (name) {
+		scratch.name = name;
+	}
+	if (!slot || !name_len || !name) {
 		return -1;
+	}
+
+	scratch.capacity = capacity;
+	return 0;
+}
+
+/**
+ * stage_row() - Fill row @i from stat contents read for pid_list.pids[i]
+ * @t: Table being collected
+ * @i: PID index, also the row
+ * @buf: Raw stat line
+ * @n: Bytes read, <= 0 if the read failed
+ *
+ * The name is staged in scratch until merge_rows() runs.
+ */
+static void stage_row(ProcessTable *t, int i, const char *buf, ssize_t n)
+{
+	PidStat st;
+
+	if (n <= 0 || fill_numbers(t, i, buf, (size_t)n, &st) != 0) {
+		scratch.name_len[i] = -1;
+		return;
+	}
 
-	p->pid = read_pid;
+	size_t len = name_length(&st);
+	memcpy(scratch.name[i], st.comm, len);
+	scratch.name_len[i] = (int8_t)len;
+}
 
-	// Strip parentheses from comm and safely copy to name (max 40 chars)
-	size_t len = strlen(comm);
-	if (len > 2 && comm[0] == '(' && comm[len - 1] == ')') {
-		size_t name_len = len - 2;
-		if (name_len > 40) {
-			name_len = 40;
+static void read_row(ProcessTable *t, int i)
+{
+	char buf[PIDSTAT_BUF_SIZE];
+	ssize_t n = fdcache_read_slot(scratch.slot[i], pid_list.pids[i], buf,
+				      sizeof(buf));
+	stage_row(t, i, buf, n);
+}
+
+/**
+ * collect_chunk() - Read a range of listed PIDs on a collector thread
+ * @ctx: Table being collected; row i receives pid_list.pids[i]
+ * @begin: First PID index
+ * @end: One past the last PID index
+ */
+static void collect_chunk(void *ctx, int begin, int end)
+{
+	ProcessTable *t = ctx;
+
+	for (int i = begin; i < end; i++) {
+		read_row(t, i);
+	}
+}
+
+static void move_row(ProcessTable *t, int from, int to)
+{
+	t->pid[to] = t->pid[from];
+	t->starttime[to] = t->starttime[from];
+	t->utime[to] = t->utime[from];
+	t->stime[to] = t->stime[from];
+	t->mem_bytes[to] = t->mem_bytes[from];
+	t->read_ns[to] = t->read_ns[from];
+	t->cpu_percent[to] = t->cpu_percent[from];
+	t->mem_percent[to] = t->mem_percent[from];
+	t->flags[to] = t->flags[from];
+	t->backoff[to] = t->backoff[from];
+	t->wait[to] = t->wait[from];
+}
+
+/**
+ * merge_rows() - Compact staged rows over PIDs that vanished
+ * @t: Table whose row i was staged for pid_list.pids[i]
+ *
+ * Runs on the collecting thread; names are appended to the pool here.
+ */
+static void merge_rows(ProcessTable *t)
+{
+	int rows = 0;
+	for (int i = 0; i < pid_list.count; i++) {
+		if (scratch.name_len[i] < 0) {
+			procevents_forget(pid_list.pids[i]);
+			continue;
 		}
-		memcpy(p->name, comm + 1, name_len);
-		p->name[name_len] = '\0';
-	} else {
-		size_t name_len = strlen(comm);
-		if (name_len > 40) {
-			name_len = 40;
+		if (rows != i) {
+			move_row(t, i, rows);
 		}
-		memcpy(p->name, comm, name_len);
-		p->name[name_len] = '\0';
+		t->name[rows] = process_table_add_name(
+			t, scratch.name[i], (size_t)scratch.name_len[i]);
+		t->order[rows] = (uint32_t)rows;
+		rows++;
+	}
+	t->count = rows;
+}
+
+/**
+ * resolve_slots() - Prepare shared state before rows are staged
+ *
+ * Resolves the fdcache slot of every listed PID and touches lazily
+ * initialized state, so staging never modifies anything shared.
+ */
+static void resolve_slots(void)
+{
+	for (int i = 0; i < pid_list.count; i++) {
+		scratch.slot[i] = fdcache_slot(pid_list.pids[i]);
 	}
+	procdir_fd();
+	get_page_size();
+}
 
-	p->utime = utime;
-	p->stime = stime;
-	p->rss_kb = rss * get_page_size() / 1024;
-	p->mem_bytes = rss * get_page_size();
+/**
+ * collect_parallel() - Read every listed PID on the collector threads
+ * @t: Table with room for pid_list.count rows
+ *
+ * Workers fill the row matching each PID's list index without locks;
+ * merge_rows() then compacts them.
+ */
+static void collect_parallel(ProcessTable *t)
+{
+	resolve_slots();
+	collector_run(pid_list.count, COLLECT_CHUNK, collect_chunk, t);
+	merge_rows(t);
+}
+
+// Read buffers of the batch in flight, one per ring entry
+static char (*uring_bufs)[PIDSTAT_BUF_SIZE];
+static unsigned int uring_bufs_count;
+static int uring_batch_start;
 
-	p->cpu_valid = false;
-	p->mem_valid = true;
-	p->cpu_percent = 0.0;
-	p->mem_percent = 0.0;
+static void uring_complete(void *ctx, uint64_t tag, int res)
+{
+	ProcessTable *t = ctx;
+	int i = (int)tag;
 
-	// Read command line
-	if (read_cmdline(read_pid, p->cmdline, sizeof(p->cmdline)) == 0) {
-		p->cmd_valid = true;
+	if (res > 0) {
+		stage_row(t, i, uring_bufs[i - uring_batch_start], res);
 	} else {
-		p->cmdline[0] = '\0';
-		p->cmd_valid = false;
+		read_row(t, i); // reopens the descriptor if the PID was reused
+	}
+}
+
+/**
+ * collect_uring() - Read every listed PID in io_uring batches
+ * @t: Table with room for pid_list.count rows
+ *
+ * PIDs with a cached stat descriptor are read in batches of up to
+ * uring_capacity(), each submitted and waited for with one
+ * io_uring_enter(). PIDs seen for the first time have no descriptor yet
+ * and are opened and read synchronously; from the next tick on they are
+ * batched too.
+ *
+ * Return: 0 on success, -1 if the ring failed (no rows were merged)
+ */
+static int collect_uring(ProcessTable *t)
+{
+	unsigned int batch = uring_capacity();
+	if (uring_bufs_count < batch) {
+		void *bufs = realloc(uring_bufs, (size_t)batch * PIDSTAT_BUF_SIZE);
+		if (!bufs) {
+			return -1;
+		}
+		uring_bufs = bufs;
+		uring_bufs_count = batch;
+	}
+
+	resolve_slots();
+
+	for (int start = 0; start < pid_list.count; start += (int)batch) {
+		int end = start + (int)batch;
+		if (end > pid_list.count) {
+			end = pid_list.count;
+		}
+
+		for (int i = start; i < end; i++) {
+			int fd = fdcache_slot_fd(scratch.slot[i]);
+			if (fd < 0) {
+				read_row(t, i);
+				continue;
+			}
+			uring_queue_read(fd, uring_bufs[i - start],
+					 PIDSTAT_BUF_SIZE, (uint64_t)i);
+		}
+
+		uring_batch_start = start;
+		if (uring_submit_wait() < 0) {
+			return -1;
+		}
+		uring_reap(uring_complete, t);
+	}
+
+	merge_rows(t);
+	return 0;
+}
+
+/**
+ * collect_staged() - Collect through io_uring or the collector threads
+ * @t: Table to fill
+ *
+ * Return: true if the table was filled, false if the caller has to read
+ * the PIDs one by one
+ */
+static bool collect_staged(ProcessTable *t)
+{
+	if (!uring_active() && collector_threads() <= 1) {
+		return false;
+	}
+	if (t->capacity < pid_list.count ||
+	    scratch_reserve(pid_list.count) != 0) {
+		return false;
 	}
 
+	if (uring_active()) {
+		if (collect_uring(t) == 0) {
+			return true;
+		}
+		log_warning("io_uring collection failed; falling back to read()");
+		uring_close();
+		if (collector_threads() <= 1) {
+			return false;
+		}
+	}
+
+	collect_parallel(t);
+	return true;
+}
+
+static int carried_reserve(int count)
+{
+	if (count <= carried.capacity) {
+		return 0;
+	}
+
+	int capacity = carried.capacity ? carried.capacity : PROCESS_TABLE_INITIAL_ROWS;
+	while (capacity < count) {
+		capacity *= 2;
+	}
+
+	int *rows = realloc(carried.rows, (size_t)capacity * sizeof(*rows));
+	if (!rows) {
+		return -1;
+	}
+	carried.rows = rows;
+	carried.capacity = capacity;
 	return 0;
 }
 
+/**
+ * plan_reads() - Pick the listed PIDs that are due for a read
+ * @prev: Previous snapshot
+ * @policy: Adaptive sampling policy
+ *
+ * Compacts pid_list to the PIDs to read this tick and records in carried
+ * the rows of @prev that stand in for the others. Only a PID listed with
+ * the same identity on the previous tick is carried: one that exited and
+ * was reused in between has a new /proc directory, and its row would be
+ * the old process's. Leaves @prev indexed by PID in sched_index for
+ * schedule_rows().
+ *
+ * Return: 0 on success, -1 on allocation failure (every PID stays listed)
+ */
+static int plan_reads(const ProcessTable *prev, const SamplePolicy *policy)
+{
+	carried.count = 0;
+	if (pidmap_reset(&sched_index, (size_t)prev->count) != 0 ||
+	    pidmap_reset(&listed_next, (size_t)pid_list.count) != 0 ||
+	    carried_reserve(pid_list.count) != 0) {
+		return -1;
+	}
+	for (int j = 0; j < prev->count; j++) {
+		pidmap_insert(&sched_index, prev->pid[j], 0, j);
+	}
+
+	int due = 0;
+	for (int i = 0; i < pid_list.count; i++) {
+		int pid = pid_list.pids[i];
+		uint64_t id = pid_list.ids[i];
+		int j = pidmap_find(&sched_index, pid, 0);
+
+		pidmap_insert(&listed_next, pid, id, 0);
+		if (j >= 0 && prev->wait[j] > 0 && listed_valid &&
+		    pidmap_find(&listed, pid, id) >= 0 &&
+		    !(policy->pinned && pidmap_find(policy->pinned, pid, 0) >= 0)) {
+			carried.rows[carried.count++] = j;
+		} else {
+			pid_list.pids[due++] = pid;
+		}
+	}
+	pid_list.count = due;
+
+	PidMap tmp = listed;
+	listed = listed_next;
+	listed_next = tmp;
+	listed_valid = true;
+	return 0;
+}
+
+/**
+ * schedule_rows() - Set the next read of every row read this tick
+ * @t: Table whose rows were all just read
+ * @prev: Previous snapshot, indexed in sched_index
+ * @max_backoff: Longest gap between reads, in ticks
+ *
+ * A process whose CPU time and RSS match its last read doubles its
+ * backoff; anything else, including a new process or a reused PID, keeps
+ * the every-tick schedule fill_numbers() gave it.
+ */
+static void schedule_rows(ProcessTable *t, const ProcessTable *prev,
+			  int max_backoff)
+{
+	if (max_backoff > SAMPLE_MAX_BACKOFF) {
+		max_backoff = SAMPLE_MAX_BACKOFF;
+	}
+
+	for (int i = 0; i < t->count; i++) {
+		int j = pidmap_find(&sched_index, t->pid[i], 0);
+		if (j < 0 || prev->starttime[j] != t->starttime[i] ||
+		    prev->utime[j] != t->utime[i] ||
+		    prev->stime[j] != t->stime[i] ||
+		    prev->mem_bytes[j] != t->mem_bytes[i]) {
+			continue;
+		}
+
+		int backoff = prev->backoff[j] * 2;
+		if (backoff < 2) {
+			backoff = 2;
+		} else if (backoff > max_backoff) {
+			backoff = max_backoff;
+		}
+		t->backoff[i] = (uint8_t)backoff;
+		t->wait[i] = (uint8_t)(backoff - 1);
+	}
+}
+
+/**
+ * carry_rows() - Append the rows of processes skipped this tick
+ * @t: Table being collected
+ * @prev: Previous snapshot the carried rows are copied from
+ *
+ * Carried rows keep the numbers of their last read and are flagged
+ * PROC_STALE. Their cached descriptors are kept open for the next read.
+ */
+static void carry_rows(ProcessTable *t, const ProcessTable *prev)
+{
+	for (int k = 0; k < carried.count; k++) {
+		int j = carried.rows[k];
+		int row = t->count;
+		if (row >= t->capacity &&
+		    process_table_reserve(t, row + 1) != 0) {
+			break;
+		}
+
+		fdcache_slot(prev->pid[j]);
+
+		t->pid[row] = prev->pid[j];
+		t->starttime[row] = prev->starttime[j];
+		t->utime[row] = prev->utime[j];
+		t->stime[row] = prev->stime[j];
+		t->mem_bytes[row] = prev->mem_bytes[j];
+		t->read_ns[row] = prev->read_ns[j];
+		t->cpu_percent[row] = prev->cpu_percent[j];
+		t->mem_percent[row] = prev->mem_percent[j];
+		t->flags[row] = prev->flags[j] | PROC_STALE;
+		t->backoff[row] = prev->backoff[j];
+		t->wait[row] = prev->wait[j] - 1;
+		const char *name = process_name(prev, j);
+		t->name[row] = process_table_add_name(t, name, strlen(name));
+		t->order[row] = (uint32_t)row;
+		t->count++;
+		t->stale_count++;
+	}
+}
+
 /**
  * collect_processes() - Collect all running processes
- * @list: Array of ProcessInfo to fill
- * @max: Maximum number of processes to collect
+ * @t: Table to fill; previous contents are discarded
  *
- * Scans /proc for numeric directories and reads process info for each.
+ * Lists PIDs (see list_pids()) and reads process info for each. The table
+ * is grown up front to the number of listed PIDs, so there is no upper
+ * limit on the process count. Cached descriptors of PIDs that are no
+ * longer listed are closed. PIDs are read in io_uring batches when a ring
+ * is set up (see uring_open()), in parallel when collector threads are
+ * running (see collector_start()), and one by one otherwise.
  *
  * Return: Number of processes collected
  */
-int collect_processes(ProcessInfo *list, int max)
+int collect_processes(ProcessTable *t)
 {
-	DIR *dir = opendir("/proc");
-	if (!dir) {
-		log_error("Failed to open /proc");
+	return collect_processes_adaptive(t, NULL, NULL);
+}
+
+/**
+ * collect_processes_adaptive() - Collect processes, skipping quiet ones
+ * @t: Table to fill; previous contents are discarded
+ * @prev: Previous snapshot, or NULL to read every process
+ * @policy: Sampling policy, or NULL to read every process
+ *
+ * Like collect_processes(), but processes that were quiet at their last
+ * reads are only read once their backoff expires (see SamplePolicy); until
+ * then their rows are copied from @prev. A process that becomes active is
+ * noticed at its next read, at most policy->max_backoff ticks later, and
+ * its CPU usage is then averaged over the whole time since the read
+ * before. @t and @prev must be distinct tables.
+ *
+ * Return: Number of processes collected, including carried rows
+ */
+int collect_processes_adaptive(ProcessTable *t, const ProcessTable *prev,
+			       const SamplePolicy *policy)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	t->sample_ns = (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+
+	t->count = 0;
+	t->stale_count = 0;
+	t->names_len = 0;
+	process_table_add_name(t, "", 0); // offset 0 is the empty name
+
+	if (list_pids() != 0) {
+		log_error("Failed to list processes in /proc");
 		return 0;
 	}
 
-	struct dirent *entry;
-	int count = 0;
+	bool adaptive = prev && policy && policy->max_backoff > 1 &&
+			plan_reads(prev, policy) == 0;
+	if (!adaptive) {
+		// The next adaptive tick has no listing to compare with
+		listed_valid = false;
+	}
 
-	while ((entry = readdir(dir)) != NULL && count < max) {
-		// Check if directory name is numeric (PID)
-		if (!isdigit(entry->d_name[0]))
-			continue;
+	// On failure read_process() still grows the table one row at a time
+	process_table_reserve(t, pid_list.count +
+				 (adaptive ? carried.count : 0));
 
-		int pid = atoi(entry->d_name);
-		if (read_process(pid, &list[count]) == 0) {
-			count++;
+	fdcache_begin_scan();
+	if (!collect_staged(t)) {
+		for (int i = 0; i < pid_list.count; i++) {
+			if (read_process(pid_list.pids[i], t) != 0) {
+				// Gone without an exit event we saw; stop tracking it
+				procevents_forget(pid_list.pids[i]);
+			}
 		}
 	}
+	if (adaptive) {
+		schedule_rows(t, prev, policy->max_backoff);
+		carry_rows(t, prev);
+	}
+	fdcache_end_scan();
 
-	closedir(dir);
-	return count;
+	return t->count;
+}
+
+/**
+ * clock_ticks() - Kernel clock ticks per second used by /proc (USER_HZ)
+ *
+ * Return: sysconf(_SC_CLK_TCK), cached; 100 if it cannot be queried
+ */
+static double clock_ticks(void)
+{
+	static double ticks;
+
+	if (ticks == 0.0) {
+		long hz = sysconf(_SC_CLK_TCK);
+		ticks = hz > 0 ? (double)hz : 100.0;
+	}
+	return ticks;
 }
 
 /**
  * compute_process_stats() - Calculate CPU and memory percentages
- * @curr: Current process snapshot array
- * @curr_count: Number of processes in curr
- * @prev: Previous process snapshot array
- * @prev_count: Number of processes in prev
- * @total_cpu_delta: Total CPU time delta across all cores
- * @cpu_cores: Number of CPU cores
+ * @curr: Current snapshot
+ * @prev: Previous snapshot
+ * @cpu_cores: Number of online cores
  * @total_mem_bytes: Total system memory in bytes
  *
  * For each process in curr, finds its previous state in prev and calculates
- * cpu_percent based on the delta in utime+stime relative to total_cpu_delta.
- * Also calculates mem_percent relative to total system memory.
+ * cpu_percent from the delta in utime+stime, converted to seconds with
+ * _SC_CLK_TCK, over the CPU time all cores had between the two sample
+ * timestamps. Measured time is used rather than the nominal interval, so
+ * a late tick does not inflate CPU usage. A process skipped by adaptive
+ * sampling is averaged over the time since its last read instead, and a
+ * row carried over unread (PROC_STALE) keeps its previous CPU usage. Also
+ * calculates mem_percent relative to total system memory.
+ *
+ * prev is indexed once by (pid, starttime) so matching is O(n), and a PID
+ * reused by a new process never inherits the previous owner's jiffies.
  */
-void compute_process_stats(ProcessInfo *curr, int curr_count,
-			   ProcessInfo *prev, int prev_count,
-			   uint64_t total_cpu_delta,
+void compute_process_stats(ProcessTable *curr, const ProcessTable *prev,
+			   int cpu_cores,
 			   uint64_t total_mem_bytes)
 {
-	for (int i = 0; i < curr_count; i++) {
+	int prev_count = prev->count;
+
+	// Clock ticks every core together could use per nanosecond
+	double ticks_per_ns = cpu_cores > 0 ? clock_ticks() * cpu_cores / 1e9 : 0.0;
+
+	if (pidmap_reset(&prev_index, prev_count) != 0) {
+		log_error("Failed to allocate PID index; CPU usage unavailable");
+		prev_count = 0;
+	}
+	for (int j = 0; j < prev_count; j++) {
+		pidmap_insert(&prev_index, prev->pid[j], prev->starttime[j], j);
+	}
+
+	for (int i = 0; i < curr->count; i++) {
 		// Find matching process in prev
-		ProcessInfo *prev_proc = NULL;
-		for (int j = 0; j < prev_count; j++) {
-			if (prev[j].pid == curr[i].pid) {
-				prev_proc = &prev[j];
-				break;
-			}
+		int slot = pidmap_find(&prev_index, curr->pid[i],
+				       curr->starttime[i]);
+		uint8_t flags = curr->flags[i] & ~PROC_MEM_VALID;
+
+		// A carried row keeps the CPU usage of its last read
+		if (curr->flags[i] & PROC_STALE) {
+			slot = -1;
+		} else {
+			flags &= ~PROC_CPU_VALID;
+			curr->cpu_percent[i] = 0.0;
+		}
+
+		// A carried previous row was last read before prev's tick
+		uint64_t since_ns = 0;
+		if (slot >= 0) {
+			since_ns = prev->flags[slot] & PROC_STALE ?
+				   prev->read_ns[slot] : prev->sample_ns;
 		}
 
-		if (prev_proc && total_cpu_delta > 0) {
+		if (slot >= 0 && curr->sample_ns > since_ns) {
 			uint64_t proc_cpu_delta =
-				(curr[i].utime + curr[i].stime) -
-				(prev_proc->utime + prev_proc->stime);
+				(curr->utime[i] + curr->stime[i]) -
+				(prev->utime[slot] + prev->stime[slot]);
+			double capacity_ticks =
+				(double)(curr->sample_ns - since_ns) * ticks_per_ns;
 
 			// 100% means all cores fully loaded
-			curr[i].cpu_percent =
-				(double)proc_cpu_delta / (double)total_cpu_delta *
-				100.0;
-			curr[i].cpu_valid = true;
-		} else {
-			curr[i].cpu_percent = 0.0;
-			curr[i].cpu_valid = false;
+			if (capacity_ticks > 0.0) {
+				curr->cpu_percent[i] =
+					(double)proc_cpu_delta / capacity_ticks * 100.0;
+				flags |= PROC_CPU_VALID;
+			}
 		}
 
 		if (total_mem_bytes > 0) {
-			curr[i].mem_percent =
-				(double)curr[i].mem_bytes /
+			curr->mem_percent[i] =
+				(double)curr->mem_bytes[i] /
 				(double)total_mem_bytes * 100.0;
-			curr[i].mem_valid = true;
+			flags |= PROC_MEM_VALID;
 		} else {
-			curr[i].mem_percent = 0.0;
-			curr[i].mem_valid = false;
+			curr->mem_percent[i] = 0.0;
 		}
+
+		curr->flags[i] = flags;
 	}
 }
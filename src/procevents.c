@@ -0,0 +1,303 @@
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include "logger.h"
+#include "pidmap.h"
+#include "procevents.h"
+
+#define PROCEVENTS_RCVBUF (4 * 1024 * 1024)
+#define PROCEVENTS_BUF_SIZE (64 * 1024)
+
+static int nl_fd = -1;
+static ProcEventCounts counts;
+static bool need_rescan; // live set is empty or events were lost
+
+// Live process set: dense PID list plus an index of positions in it
+static PidList live;
+static PidMap live_index;
+
+// Identity of a forked PID: a fork count, tagged apart from inode numbers
+#define FORK_ID_TAG (1ull << 63)
+static uint64_t forks_seen;
+
+/**
+ * send_mcast_op() - Tell the connector to start or stop sending events
+ * @op: PROC_CN_MCAST_LISTEN or PROC_CN_MCAST_IGNORE
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int send_mcast_op(enum proc_cn_mcast_op op)
+{
+	// cn_msg ends in a flexible array, so lay the request out by hand
+	_Alignas(struct nlmsghdr) char req[NLMSG_SPACE(sizeof(struct cn_msg) +
+						     sizeof(op))];
+	memset(req, 0, sizeof(req));
+
+	struct nlmsghdr *hdr = (struct nlmsghdr *)req;
+	hdr->nlmsg_len = NLMSG_LENGTH(sizeof(struct cn_msg) + sizeof(op));
+	hdr->nlmsg_type = NLMSG_DONE;
+	hdr->nlmsg_pid = (uint32_t)getpid();
+
+	struct cn_msg *msg = NLMSG_DATA(hdr);
+	msg->id.idx = CN_IDX_PROC;
+	msg->id.val = CN_VAL_PROC;
+	msg->len = sizeof(op);
+	memcpy(msg->data, &op, sizeof(op));
+
+	return send(nl_fd, req, hdr->nlmsg_len, 0) < 0 ? -1 : 0;
+}
+
+/**
+ * procevents_open() - Subscribe to process events
+ *
+ * The live set starts empty; seed it with procevents_seed() from a full
+ * scan taken after this call, so no process can slip between the scan and
+ * the subscription.
+ *
+ * Return: 0 on success, -1 if the connector is unavailable (e.g. missing
+ * CAP_NET_ADMIN)
+ */
+int procevents_open(void)
+{
+	if (nl_fd >= 0) {
+		return 0;
+	}
+
+	nl_fd = socket(PF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+		       NETLINK_CONNECTOR);
+	if (nl_fd < 0) {
+		return -1;
+	}
+
+	struct sockaddr_nl addr = {
+		.nl_family = AF_NETLINK,
+		.nl_groups = CN_IDX_PROC,
+		.nl_pid = 0,
+	};
+	if (bind(nl_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		procevents_close();
+		return -1;
+	}
+
+	// A deep queue lets fork storms survive until the next drain
+	int rcvbuf = PROCEVENTS_RCVBUF;
+	if (setsockopt(nl_fd, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf,
+		       sizeof(rcvbuf)) < 0) {
+		setsockopt(nl_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf,
+			   sizeof(rcvbuf));
+	}
+
+	if (send_mcast_op(PROC_CN_MCAST_LISTEN) != 0) {
+		procevents_close();
+		return -1;
+	}
+
+	memset(&counts, 0, sizeof(counts));
+	live.count = 0;
+	pidmap_reset(&live_index, 0);
+	need_rescan = true;
+	log_info("Subscribed to proc connector events");
+	return 0;
+}
+
+/**
+ * procevents_close() - Unsubscribe and free the live set
+ */
+void procevents_close(void)
+{
+	if (nl_fd >= 0) {
+		send_mcast_op(PROC_CN_MCAST_IGNORE);
+		close(nl_fd);
+		nl_fd = -1;
+	}
+	pidlist_free(&live);
+	pidmap_free(&live_index);
+}
+
+/**
+ * procevents_active() - Check whether event tracking is running
+ *
+ * Return: true if procevents_open() succeeded and was not closed since
+ */
+bool procevents_active(void)
+{
+	return nl_fd >= 0;
+}
+
+// Add a PID, or give a tracked one the identity of the process now behind it
+static void live_add(int pid, uint64_t id)
+{
+	int pos = pidmap_find(&live_index, pid, 0);
+	if (pos >= 0) {
+		live.ids[pos] = id;
+		return;
+	}
+	if (pidlist_push(&live, pid, id) != 0 ||
+	    pidmap_insert(&live_index, pid, 0, live.count - 1) != 0) {
+		log_error("Failed to track new process");
+	}
+}
+
+/*
+ * An exit event of a leader thread is sent when only that thread exited,
+ * too, so the PID is kept: a new identity gets it read on the next tick,
+ * and the collector forgets it if that read fails.
+ */
+static void live_renew(int pid)
+{
+	int pos = pidmap_find(&live_index, pid, 0);
+	if (pos >= 0) {
+		live.ids[pos] = FORK_ID_TAG | ++forks_seen;
+	}
+}
+
+/**
+ * procevents_forget() - Drop a PID from the live set
+ * @pid: Process ID
+ *
+ * Used by the collector when a tracked PID turns out to be gone, after its
+ * exit event or in case that was lost.
+ */
+void procevents_forget(int pid)
+{
+	int pos = pidmap_find(&live_index, pid, 0);
+	if (pos < 0) {
+		return;
+	}
+
+	pidmap_remove(&live_index, pid, 0);
+	live.count--;
+	if (pos != live.count) {
+		live.pids[pos] = live.pids[live.count];
+		live.ids[pos] = live.ids[live.count];
+		pidmap_insert(&live_index, live.pids[pos], 0, pos);
+	}
+}
+
+/**
+ * procevents_seed() - Replace the live set with the result of a full scan
+ * @list: PIDs currently listed in /proc
+ */
+void procevents_seed(const PidList *list)
+{
+	live.count = 0;
+	pidmap_reset(&live_index, (size_t)list->count);
+	for (int i = 0; i < list->count; i++) {
+		live_add(list->pids[i], list->ids[i]);
+	}
+	need_rescan = false;
+}
+
+static void handle_event(const struct proc_event *ev)
+{
+	switch (ev->what) {
+	case PROC_EVENT_FORK:
+		// Threads share the tgid of their process; only count processes
+		if (ev->event_data.fork.child_pid ==
+		    ev->event_data.fork.child_tgid) {
+			counts.forks++;
+			live_add(ev->event_data.fork.child_tgid,
+				 FORK_ID_TAG | ++forks_seen);
+		}
+		break;
+	case PROC_EVENT_EXEC:
+		counts.execs++;
+		break;
+	case PROC_EVENT_EXIT:
+		if (ev->event_data.exit.process_pid ==
+		    ev->event_data.exit.process_tgid) {
+			counts.exits++;
+			live_renew(ev->event_data.exit.process_tgid);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * procevents_drain() - Apply every queued event to the live set
+ *
+ * Never blocks. Right after procevents_open(), or if the socket queue
+ * overflowed and events were lost, the live set cannot be trusted until it
+ * is seeded from a full scan again.
+ *
+ * Return: 0 on success, 1 if the caller must rescan /proc and call
+ * procevents_seed(), -1 if tracking is not active
+ */
+int procevents_drain(void)
+{
+	static _Alignas(struct nlmsghdr) char buf[PROCEVENTS_BUF_SIZE];
+
+	if (nl_fd < 0) {
+		return -1;
+	}
+
+	for (;;) {
+		ssize_t len = recv(nl_fd, buf, sizeof(buf), 0);
+		if (len < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if (errno == ENOBUFS) {
+				log_warning("Proc connector queue overflowed; rescanning /proc");
+				need_rescan = true;
+				continue;
+			}
+			break; // EAGAIN: queue is empty
+		}
+
+		int remaining = (int)len;
+		for (struct nlmsghdr *nh = (struct nlmsghdr *)buf;
+		     NLMSG_OK(nh, remaining); nh = NLMSG_NEXT(nh, remaining)) {
+			if (nh->nlmsg_type == NLMSG_ERROR ||
+			    nh->nlmsg_type == NLMSG_NOOP) {
+				continue;
+			}
+			struct cn_msg *msg = NLMSG_DATA(nh);
+			if (msg->id.idx != CN_IDX_PROC ||
+			    msg->id.val != CN_VAL_PROC) {
+				continue;
+			}
+			handle_event((const struct proc_event *)msg->data);
+		}
+	}
+
+	return need_rescan ? 1 : 0;
+}
+
+/**
+ * procevents_pids() - Get the PIDs currently believed to be alive
+ *
+ * Return: Live set; valid until the next drain, seed or forget
+ */
+const PidList *procevents_pids(void)
+{
+	return &live;
+}
+
+/**
+ * procevents_is_live() - Check whether a PID is in the live set
+ * @pid: Process ID
+ *
+ * Return: true if the PID was forked or listed and has not been forgotten
+ * since; an exited PID stays until the collector fails to read it
+ */
+bool procevents_is_live(int pid)
+{
+	return pidmap_find(&live_index, pid, 0) >= 0;
+}
+
+/**
+ * procevents_counts() - Get cumulative fork/exec/exit counts
+ * @out: Output counts
+ */
+void procevents_counts(ProcEventCounts *out)
+{
+	*out = counts;
+}
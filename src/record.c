@@ -0,0 +1,1380 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "logger.h"
+#include "pidmap.h"
+#include "record.h"
+
+#define RECORD_FILE_MAGIC "PBREC001"
+#define RECORD_VERSION 1
+#define RECORD_ALIGN 8
+
+// length, magic, kind, reserved, seq, time_ms, sample_ns
+#define RECORD_FIXED_SIZE 32
+
+// Most bytes one row takes, not counting its name
+#define ROW_MAX_BYTES 128
+
+// Most bytes the frame numbers and one set of CPU counters take
+#define FRAME_MAX_BYTES 256
+#define CPU_TIMES_MAX_BYTES 128
+
+#define NAME_MIN_BUCKETS 256
+
+// Sanity bounds for decoding
+#define MAX_CORES 65536
+#define MAX_ROWS (1 << 24)
+
+#define CPU_TIMES_FIELDS (sizeof(CpuTimes) / sizeof(uint64_t))
+
+// First page of the file; rewritten after every record
+typedef struct {
+	char magic[8];            // RECORD_FILE_MAGIC
+	uint32_t version;
+	uint32_t header_size;     // RECORD_HEADER_SIZE
+	uint64_t data_size;       // bytes of ring after the header
+	uint64_t head;            // where the next record goes
+	uint64_t tail;            // oldest live record
+	uint64_t live;            // records from tail to head
+	uint64_t written;         // records ever appended
+	uint64_t total_mem_bytes; // for mem_percent on replay
+} RingHeader;
+
+// Numbers of one row as recorded
+typedef struct {
+	int32_t pid;
+	uint8_t flags;
+	uint32_t name;       // interned name id
+	uint32_t cpu;        // hundredths of a percent
+	uint64_t starttime;
+	uint64_t utime;
+	uint64_t stime;
+	uint64_t mem_bytes;
+} RowState;
+
+// Everything one record describes
+typedef struct {
+	RowState *rows;
+	int count;
+	int capacity;
+	CpuStat cpu;
+	uint64_t seq;
+	uint64_t time_ms;
+	uint64_t sample_ns;
+	uint64_t elapsed_us;
+	uint64_t cpu_load;   // hundredths of a percent
+	uint64_t used_mem_bytes;
+	uint64_t uptime_minutes;
+	bool have_events;
+	ProcEventCounts events;
+	uint64_t grow_count;
+	uint64_t table_capacity;
+	uint64_t stale_count;
+} FrameState;
+
+/*
+ * Names seen since the last key record, by id. The pool holds them
+ * NUL-terminated in id order; buckets (encoder only) map a name to id + 1.
+ */
+typedef struct {
+	char *pool;
+	size_t len;
+	size_t cap;
+	uint32_t *offset;
+	uint32_t count;
+	uint32_t capacity;
+	uint32_t *buckets;
+	uint32_t bucket_count; // power of two, or 0 without buckets
+} NameTable;
+
+// Bounds-checked cursor over a record payload
+typedef struct {
+	const uint8_t *p;
+	const uint8_t *end;
+	bool bad;
+} Reader;
+
+// Recorder; touched only by the thread that calls record_frame()
+static struct {
+	int fd;
+	uint8_t *map;
+	size_t map_size;
+	RingHeader *hdr;
+	uint8_t *data;
+	size_t page_size;
+
+	uint8_t *buf;        // the record being encoded
+	size_t len;
+	size_t cap;
+	FrameState frames[2]; // frames[last] was recorded last
+	int last;
+	PidMap index;        // (pid, starttime) -> row of frames[last]
+	NameTable names;
+	int since_key;       // records since the last key record
+	bool force_key;      // the previous record is missing or unusable
+	bool failing;        // the last record failed; logged once
+} rec = { .fd = -1 };
+
+// Replay; UI thread only
+static struct {
+	int fd;
+	uint8_t *map;
+	size_t map_size;
+	RingHeader hdr;      // copied once, as a recorder may be updating it
+	const uint8_t *data;
+
+	uint64_t *offset;    // records from the first key record on
+	uint8_t *kind;
+	int count;
+
+	FrameState frames[2]; // frames[last] holds record decoded
+	int last;
+	int decoded;         // -1 if nothing is decoded
+	bool have_prev;      // frames[last ^ 1] holds record decoded - 1
+	NameTable names;
+} rp = { .fd = -1, .decoded = -1 };
+
+static uint32_t load_u32(const uint8_t *p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static uint64_t load_u64(const uint8_t *p)
+{
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static uint64_t zigzag(int64_t v)
+{
+	return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v)
+{
+	return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static uint32_t name_hash(const char *name, size_t len)
+{
+	uint32_t h = 2166136261u; // FNV-1a
+
+	for (size_t i = 0; i < len; i++) {
+		h = (h ^ (uint8_t)name[i]) * 16777619u;
+	}
+	return h;
+}
+
+static const char *names_get(const NameTable *nt, uint32_t id, size_t *len)
+{
+	uint32_t off = nt->offset[id];
+	uint32_t end = id + 1 < nt->count ? nt->offset[id + 1] :
+					    (uint32_t)nt->len;
+	*len = end - off - 1;
+	return nt->pool + off;
+}
+
+static void names_reset(NameTable *nt)
+{
+	nt->len = 0;
+	nt->count = 0;
+	if (nt->buckets) {
+		memset(nt->buckets, 0, nt->bucket_count * sizeof(*nt->buckets));
+	}
+}
+
+static void names_free(NameTable *nt)
+{
+	free(nt->pool);
+	free(nt->offset);
+	free(nt->buckets);
+	memset(nt, 0, sizeof(*nt));
+}
+
+/**
+ * names_rehash() - Size the buckets for the next name and rebuild them
+ * @nt: Name table with buckets
+ *
+ * Return: 0 on success, -1 on allocation failure
+ */
+static int names_rehash(NameTable *nt)
+{
+	uint32_t want = nt->bucket_count ? nt->bucket_count : NAME_MIN_BUCKETS;
+	while (want < (nt->count + 1) * 2) {
+		want *= 2;
+	}
+	if (want == nt->bucket_count) {
+		return 0;
+	}
+
+	uint32_t *buckets = calloc(want, sizeof(*buckets));
+	if (!buckets) {
+		return -1;
+	}
+	for (uint32_t id = 0; id < nt->count; id++) {
+		size_t len;
+		const char *name = names_get(nt, id, &len);
+		uint32_t b = name_hash(name, len) & (want - 1);
+		while (buckets[b]) {
+			b = (b + 1) & (want - 1);
+		}
+		buckets[b] = id + 1;
+	}
+	free(nt->buckets);
+	nt->buckets = buckets;
+	nt->bucket_count = want;
+	return 0;
+}
+
+/**
+ * names_add() - Give a name the next id
+ * @nt: Name table
+ * @name: Name bytes
+ * @len: Length of name
+ *
+ * Return: The new id, or UINT32_MAX on allocation failure
+ */
+static uint32_t names_add(NameTable *nt, const char *name, size_t len)
+{
+	if (nt->count == nt->capacity) {
+		uint32_t capacity = nt->capacity ? nt->capacity * 2 : 256;
+		uint32_t *offset = realloc(nt->offset, capacity * sizeof(*offset));
+		if (!offset) {
+			return UINT32_MAX;
+		}
+		nt->offset = offset;
+		nt->capacity = capacity;
+	}
+	if (nt->len + len + 1 > nt->cap) {
+		size_t cap = nt->cap ? nt->cap * 2 : 4096;
+		while (nt->len + len + 1 > cap) {
+			cap *= 2;
+		}
+		char *pool = realloc(nt->pool, cap);
+		if (!pool) {
+			return UINT32_MAX;
+		}
+		nt->pool = pool;
+		nt->cap = cap;
+	}
+
+	uint32_t id = nt->count++;
+	nt->offset[id] = (uint32_t)nt->len;
+	memcpy(nt->pool + nt->len, name, len);
+	nt->pool[nt->len + len] = '\0';
+	nt->len += len + 1;
+	return id;
+}
+
+/**
+ * names_intern() - Look up a name, adding it if it is new
+ * @nt: Name table with buckets
+ * @name: NUL-terminated name
+ * @added: Set to true if the name got a new id
+ *
+ * Return: The name's id, or UINT32_MAX on allocation failure
+ */
+static uint32_t names_intern(NameTable *nt, const char *name, bool *added)
+{
+	size_t len = strlen(name);
+	uint32_t hash = name_hash(name, len);
+
+	*added = false;
+	if (nt->bucket_count) {
+		uint32_t mask = nt->bucket_count - 1;
+		for (uint32_t b = hash & mask; nt->buckets[b];
+		     b = (b + 1) & mask) {
+			size_t known_len;
+			uint32_t id = nt->buckets[b] - 1;
+			const char *known = names_get(nt, id, &known_len);
+			if (known_len == len && memcmp(known, name, len) == 0) {
+				return id;
+			}
+		}
+	}
+
+	if (names_rehash(nt) != 0) {
+		return UINT32_MAX;
+	}
+	uint32_t id = names_add(nt, name, len);
+	if (id == UINT32_MAX) {
+		return id;
+	}
+
+	uint32_t mask = nt->bucket_count - 1;
+	uint32_t b = hash & mask;
+	while (nt->buckets[b]) {
+		b = (b + 1) & mask;
+	}
+	nt->buckets[b] = id + 1;
+	*added = true;
+	return id;
+}
+
+static int frame_state_reserve(FrameState *s, int rows)
+{
+	if (rows <= s->capacity) {
+		return 0;
+	}
+
+	int capacity = s->capacity ? s->capacity : PROCESS_TABLE_INITIAL_ROWS;
+	while (capacity < rows) {
+		capacity *= 2;
+	}
+	RowState *grown = realloc(s->rows, (size_t)capacity * sizeof(*grown));
+	if (!grown) {
+		return -1;
+	}
+	s->rows = grown;
+	s->capacity = capacity;
+	return 0;
+}
+
+static void frame_state_free(FrameState *s)
+{
+	free(s->rows);
+	cpu_stat_free(&s->cpu);
+	memset(s, 0, sizeof(*s));
+}
+
+/*
+ * Encoding. Callers make sure the buffer has room (out_room()) before a
+ * batch of puts, so the puts themselves never fail.
+ */
+
+static int out_room(size_t n)
+{
+	if (rec.len + n <= rec.cap) {
+		return 0;
+	}
+
+	size_t cap = rec.cap ? rec.cap * 2 : 64 * 1024;
+	while (rec.len + n > cap) {
+		cap *= 2;
+	}
+	uint8_t *buf = realloc(rec.buf, cap);
+	if (!buf) {
+		return -1;
+	}
+	rec.buf = buf;
+	rec.cap = cap;
+	return 0;
+}
+
+static void put_byte(uint8_t v)
+{
+	rec.buf[rec.len++] = v;
+}
+
+static void put_varint(uint64_t v)
+{
+	while (v >= 0x80) {
+		rec.buf[rec.len++] = (uint8_t)(v | 0x80);
+		v >>= 7;
+	}
+	rec.buf[rec.len++] = (uint8_t)v;
+}
+
+static void put_zigzag(int64_t v)
+{
+	put_varint(zigzag(v));
+}
+
+static void put_raw(const void *v, size_t len)
+{
+	memcpy(rec.buf + rec.len, v, len);
+	rec.len += len;
+}
+
+// A name id, or the name itself if it was just interned
+static void put_name(uint32_t id, bool added)
+{
+	if (added) {
+		size_t len;
+		const char *name = names_get(&rec.names, id, &len);
+		put_varint(0);
+		put_varint(len);
+		put_raw(name, len);
+	} else {
+		put_varint((uint64_t)id + 1);
+	}
+}
+
+static void put_cpu_times(const CpuTimes *base, const CpuTimes *t)
+{
+	uint64_t b[CPU_TIMES_FIELDS];
+	uint64_t v[CPU_TIMES_FIELDS];
+
+	memcpy(b, base, sizeof(b));
+	memcpy(v, t, sizeof(v));
+	for (size_t i = 0; i < CPU_TIMES_FIELDS; i++) {
+		put_zigzag((int64_t)(v[i] - b[i]));
+	}
+}
+
+/**
+ * put_cpu_stat() - Encode /proc/stat counters
+ * @base: Counters of the previous record, or NULL for a key record
+ * @st: Counters to encode
+ *
+ * Return: 0 on success, -1 on allocation failure
+ */
+static int put_cpu_stat(const CpuStat *base, const CpuStat *st)
+{
+	static const CpuTimes zero;
+
+	if (out_room(CPU_TIMES_MAX_BYTES * ((size_t)st->core_count + 2)) != 0) {
+		return -1;
+	}
+
+	put_varint((uint64_t)st->core_count);
+	put_cpu_times(base ? &base->total : &zero, &st->total);
+	for (int i = 0; i < st->core_count; i++) {
+		put_cpu_times(base && i < base->core_count ? &base->cores[i] :
+							     &zero,
+			      &st->cores[i]);
+	}
+
+	CpuStat none = {0};
+	if (!base) {
+		base = &none;
+	}
+	put_zigzag((int64_t)(st->ctxt - base->ctxt));
+	put_zigzag((int64_t)(st->intr - base->intr));
+	put_zigzag((int64_t)(st->processes - base->processes));
+	put_zigzag((int64_t)(st->procs_running - base->procs_running));
+	put_zigzag((int64_t)(st->procs_blocked - base->procs_blocked));
+	return 0;
+}
+
+static uint32_t hundredths(double percent)
+{
+	if (!(percent > 0.0)) {
+		return 0;
+	}
+	double v = percent * 100.0 + 0.5;
+	return v < (double)UINT32_MAX ? (uint32_t)v : UINT32_MAX;
+}
+
+static void flush_run(uint64_t *run)
+{
+	if (*run > 0) {
+		put_byte(RECORD_OP_RUN);
+		put_varint(*run);
+		*run = 0;
+	}
+}
+
+/**
+ * put_rows() - Encode the rows of a table against the last recorded frame
+ * @t: Table to encode
+ * @key: Encode every row in full
+ *
+ * Fills the other entry of rec.frames with the rows as recorded.
+ *
+ * Return: 0 on success, -1 on allocation failure
+ */
+static int put_rows(const ProcessTable *t, bool key)
+{
+	const FrameState *prev = &rec.frames[rec.last];
+	FrameState *curr = &rec.frames[rec.last ^ 1];
+
+	if (frame_state_reserve(curr, t->count) != 0 ||
+	    out_room(ROW_MAX_BYTES) != 0) {
+		return -1;
+	}
+	put_varint((uint64_t)t->count);
+
+	int cursor = 0;   // the previous row a run would continue with
+	uint64_t run = 0; // unchanged rows not written yet
+	for (int i = 0; i < t->count; i++) {
+		RowState *row = &curr->rows[i];
+		bool added;
+
+		row->pid = t->pid[i];
+		row->flags = t->flags[i];
+		row->cpu = hundredths(t->cpu_percent[i]);
+		row->starttime = t->starttime[i];
+		row->utime = t->utime[i];
+		row->stime = t->stime[i];
+		row->mem_bytes = t->mem_bytes[i];
+		row->name = names_intern(&rec.names, process_name(t, i), &added);
+		if (row->name == UINT32_MAX ||
+		    out_room(ROW_MAX_BYTES + strlen(process_name(t, i))) != 0) {
+			return -1;
+		}
+
+		int j = key ? -1 : pidmap_find(&rec.index, row->pid,
+					       row->starttime);
+		if (j < 0) {
+			flush_run(&run);
+			put_byte(RECORD_OP_NEW);
+			put_varint((uint32_t)row->pid);
+			put_varint(row->starttime);
+			put_varint(row->utime);
+			put_varint(row->stime);
+			put_varint(row->mem_bytes);
+			put_varint(row->cpu);
+			put_byte(row->flags);
+			put_name(row->name, added);
+			continue;
+		}
+
+		const RowState *old = &prev->rows[j];
+		uint8_t changed = 0;
+		changed |= row->utime != old->utime ? RECORD_F_UTIME : 0;
+		changed |= row->stime != old->stime ? RECORD_F_STIME : 0;
+		changed |= row->mem_bytes != old->mem_bytes ? RECORD_F_MEM : 0;
+		changed |= row->cpu != old->cpu ? RECORD_F_CPU : 0;
+		changed |= row->flags != old->flags ? RECORD_F_FLAGS : 0;
+		changed |= row->name != old->name ? RECORD_F_NAME : 0;
+
+		if (!changed && j == cursor) {
+			run++;
+			cursor++;
+			continue;
+		}
+
+		flush_run(&run);
+		put_byte(RECORD_OP_ROW | changed);
+		put_zigzag((int64_t)j - cursor);
+		if (changed & RECORD_F_UTIME) {
+			put_zigzag((int64_t)(row->utime - old->utime));
+		}
+		if (changed & RECORD_F_STIME) {
+			put_zigzag((int64_t)(row->stime - old->stime));
+		}
+		if (changed & RECORD_F_MEM) {
+			put_zigzag((int64_t)(row->mem_bytes - old->mem_bytes));
+		}
+		if (changed & RECORD_F_CPU) {
+			put_zigzag((int64_t)row->cpu - (int64_t)old->cpu);
+		}
+		if (changed & RECORD_F_FLAGS) {
+			put_byte(row->flags);
+		}
+		if (changed & RECORD_F_NAME) {
+			put_name(row->name, added);
+		}
+		cursor = j + 1;
+	}
+	flush_run(&run);
+	curr->count = t->count;
+
+	// Index the rows just written for the next record
+	if (pidmap_reset(&rec.index, (size_t)curr->count) != 0) {
+		return -1;
+	}
+	for (int i = 0; i < curr->count; i++) {
+		pidmap_insert(&rec.index, curr->rows[i].pid,
+			      curr->rows[i].starttime, i);
+	}
+	return 0;
+}
+
+/**
+ * encode() - Encode a frame as the next record into rec.buf
+ * @f: Frame to encode
+ * @time_ms: Wall clock time of the frame
+ * @key: Write a key record
+ *
+ * Return: 0 on success, -1 on allocation failure
+ */
+static int encode(const Frame *f, uint64_t time_ms, bool key)
+{
+	const FrameState *prev = &rec.frames[rec.last];
+
+	rec.len = 0;
+	if (out_room(RECORD_FIXED_SIZE + FRAME_MAX_BYTES) != 0) {
+		return -1;
+	}
+	if (key) {
+		names_reset(&rec.names);
+	}
+
+	uint32_t length = 0; // patched below
+	uint16_t magic = RECORD_MAGIC;
+	uint8_t kind[2] = { key ? RECORD_KEY : RECORD_DELTA, 0 };
+	put_raw(&length, sizeof(length));
+	put_raw(&magic, sizeof(magic));
+	put_raw(kind, sizeof(kind));
+	put_raw(&f->seq, sizeof(f->seq));
+	put_raw(&time_ms, sizeof(time_ms));
+	put_raw(&f->table.sample_ns, sizeof(f->table.sample_ns));
+
+	put_varint(f->elapsed_s > 0.0 ? (uint64_t)(f->elapsed_s * 1e6 + 0.5) : 0);
+	put_varint(hundredths(f->cpu_load));
+	put_varint(f->used_mem_bytes);
+	put_varint((uint64_t)f->uptime_days * 1440 +
+		   (uint64_t)f->uptime_hours * 60 +
+		   (uint64_t)f->uptime_minutes);
+	put_byte(f->have_events);
+	put_varint(f->events.forks);
+	put_varint(f->events.execs);
+	put_varint(f->events.exits);
+	put_varint((uint64_t)f->grow_count);
+	put_varint((uint64_t)f->table_capacity);
+	put_varint((uint64_t)f->table.stale_count);
+
+	if (put_cpu_stat(key ? NULL : &prev->cpu, &f->cpu_curr) != 0 ||
+	    put_rows(&f->table, key) != 0 ||
+	    cpu_stat_copy(&rec.frames[rec.last ^ 1].cpu, &f->cpu_curr) != 0 ||
+	    out_room(RECORD_ALIGN) != 0) {
+		return -1;
+	}
+
+	while (rec.len % RECORD_ALIGN) {
+		put_byte(0);
+	}
+	length = (uint32_t)rec.len;
+	memcpy(rec.buf, &length, sizeof(length));
+	return 0;
+}
+
+/*
+ * Ring file. Live records run from tail to head, wrapping at the end of
+ * the data area; head == tail with live records means the ring is full.
+ */
+
+static bool header_valid(const RingHeader *h, uint64_t file_size)
+{
+	return memcmp(h->magic, RECORD_FILE_MAGIC, sizeof(h->magic)) == 0 &&
+	       h->version == RECORD_VERSION &&
+	       h->header_size == RECORD_HEADER_SIZE &&
+	       h->data_size % RECORD_ALIGN == 0 &&
+	       h->data_size <= file_size - RECORD_HEADER_SIZE &&
+	       h->head <= h->data_size && h->tail < h->data_size &&
+	       h->head % RECORD_ALIGN == 0 && h->tail % RECORD_ALIGN == 0;
+}
+
+// Offset of the record stored at @off, following a wrap marker
+static uint64_t resolve(const RingHeader *h, const uint8_t *data,
+			uint64_t off)
+{
+	if (off + RECORD_ALIGN > h->data_size ||
+	    load_u32(data + off) == RECORD_WRAP) {
+		return 0;
+	}
+	return off;
+}
+
+/**
+ * check_record() - Validate the fixed part of the record at @off
+ *
+ * Return: Length of the record, or 0 if it is not a record
+ */
+static uint32_t check_record(const RingHeader *h, const uint8_t *data,
+			     uint64_t off)
+{
+	if (off + RECORD_FIXED_SIZE > h->data_size) {
+		return 0;
+	}
+
+	uint32_t len = load_u32(data + off);
+	uint16_t magic;
+	memcpy(&magic, data + off + 4, sizeof(magic));
+	uint8_t kind = data[off + 6];
+	if (len < RECORD_FIXED_SIZE || len % RECORD_ALIGN ||
+	    len > h->data_size - off || magic != RECORD_MAGIC ||
+	    (kind != RECORD_KEY && kind != RECORD_DELTA)) {
+		return 0;
+	}
+	return len;
+}
+
+/**
+ * walk_records() - Find the live records from tail to head
+ * @h: Ring header
+ * @data: Ring data
+ * @offset: Receives the offset of each record, or NULL
+ * @kind: Receives the kind of each record, or NULL
+ *
+ * Return: Number of valid records before the first invalid one
+ */
+static uint64_t walk_records(const RingHeader *h, const uint8_t *data,
+			     uint64_t *offset, uint8_t *kind)
+{
+	uint64_t off = h->tail;
+	uint64_t n = 0;
+
+	while (n < h->live) {
+		off = resolve(h, data, off);
+		uint32_t len = check_record(h, data, off);
+		if (!len) {
+			break;
+		}
+		if (offset) {
+			offset[n] = off;
+			kind[n] = data[off + 6];
+		}
+		off += len;
+		n++;
+	}
+	return n;
+}
+
+static void ring_init(RingHeader *h, uint64_t data_size)
+{
+	memset(h, 0, sizeof(*h));
+	memcpy(h->magic, RECORD_FILE_MAGIC, sizeof(h->magic));
+	h->version = RECORD_VERSION;
+	h->header_size = RECORD_HEADER_SIZE;
+	h->data_size = data_size;
+}
+
+/**
+ * evict_until() - Drop live records that start before @limit
+ * @limit: End of the range about to be overwritten, which starts at head
+ */
+static void evict_until(uint64_t limit)
+{
+	RingHeader *h = rec.hdr;
+
+	while (h->live > 0 && h->tail >= h->head && h->tail < limit) {
+		if (resolve(h, rec.data, h->tail) != h->tail) {
+			h->tail = 0;
+			continue;
+		}
+		h->tail += load_u32(rec.data + h->tail);
+		h->live--;
+		if (h->tail == h->data_size) {
+			h->tail = 0;
+		}
+	}
+}
+
+/**
+ * ring_append() - Store the encoded record, overwriting the oldest ones
+ *
+ * The header's tail moves before the old records are overwritten and its
+ * head only after the new one is complete, so a crash in between never
+ * leaves a live record half-written. Pages the record filled are dropped
+ * from this process's page tables: the data stays in the page cache and
+ * is written back, but a long-running recorder does not keep the whole
+ * ring resident.
+ *
+ * Return: 0 on success, -1 if the record is too large for the ring
+ */
+static int ring_append(void)
+{
+	RingHeader *h = rec.hdr;
+	uint64_t len = rec.len;
+
+	if (len > h->data_size / 2) {
+		return -1;
+	}
+
+	if (h->head + len > h->data_size) {
+		evict_until(h->data_size);
+		if (h->head + sizeof(uint32_t) <= h->data_size) {
+			uint32_t wrap = RECORD_WRAP;
+			memcpy(rec.data + h->head, &wrap, sizeof(wrap));
+		}
+		h->head = 0;
+	}
+	evict_until(h->head + len);
+
+	uint64_t start = h->head;
+	memcpy(rec.data + start, rec.buf, len);
+	if (h->live == 0) {
+		h->tail = start;
+	}
+	h->head = start + len;
+	h->live++;
+	h->written++;
+
+	uint64_t first = start / rec.page_size * rec.page_size;
+	uint64_t end = h->head / rec.page_size * rec.page_size;
+	if (end > first) {
+		madvise(rec.data + first, end - first, MADV_DONTNEED);
+	}
+	return 0;
+}
+
+/**
+ * record_open() - Start recording frames to a ring file
+ * @path: Ring file; created if missing
+ * @size_bytes: Bytes of ring data, not counting the header page
+ * @total_mem_bytes: Total system memory, stored for replay
+ *
+ * An existing ring of the same size keeps its records and is appended
+ * to; anything else at @path is replaced. The whole file is allocated up
+ * front, so a full disk fails here instead of on a later write.
+ *
+ * Return: 0 on success, -1 on error (errno is set)
+ */
+int record_open(const char *path, uint64_t size_bytes,
+		uint64_t total_mem_bytes)
+{
+	size_bytes -= size_bytes % RECORD_ALIGN;
+	size_t map_size = RECORD_HEADER_SIZE + size_bytes;
+	int err;
+
+	int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		return -1;
+	}
+
+	struct stat st;
+	bool reuse = fstat(fd, &st) == 0 && (uint64_t)st.st_size == map_size;
+	if (!reuse && ftruncate(fd, 0) != 0) {
+		goto fail;
+	}
+	err = posix_fallocate(fd, 0, (off_t)map_size);
+	if (err != 0) {
+		errno = err;
+		goto fail;
+	}
+
+	void *map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			 fd, 0);
+	if (map == MAP_FAILED) {
+		goto fail;
+	}
+
+	rec.fd = fd;
+	rec.map = map;
+	rec.map_size = map_size;
+	rec.hdr = map;
+	rec.data = rec.map + RECORD_HEADER_SIZE;
+	rec.page_size = (size_t)sysconf(_SC_PAGESIZE);
+
+	if (!reuse || !header_valid(rec.hdr, map_size) ||
+	    rec.hdr->data_size != size_bytes ||
+	    walk_records(rec.hdr, rec.data, NULL, NULL) != rec.hdr->live) {
+		ring_init(rec.hdr, size_bytes);
+	}
+	rec.hdr->total_mem_bytes = total_mem_bytes;
+
+	pidmap_init(&rec.index);
+	rec.last = 0;
+	rec.frames[0].count = 0;
+	rec.force_key = true;
+	rec.failing = false;
+	return 0;
+
+fail:
+	err = errno;
+	close(fd);
+	errno = err;
+	return -1;
+}
+
+/**
+ * record_active() - Whether record_open() succeeded and is not closed
+ */
+bool record_active(void)
+{
+	return rec.map != NULL;
+}
+
+/**
+ * record_frame() - Append a frame to the ring
+ * @f: Frame to record; rows are recorded in row order
+ * @time_ms: Wall clock time of the frame, milliseconds since the epoch
+ *
+ * Costs one pass over the rows with a hash lookup each, plus a copy of
+ * the (mostly few kilobytes) record into the mapping; no system calls
+ * besides an occasional madvise(). A frame that cannot be recorded is
+ * skipped, and the next one becomes a key record.
+ *
+ * Return: 0 on success, -1 on error (logged once per run of failures)
+ */
+int record_frame(const Frame *f, uint64_t time_ms)
+{
+	if (!rec.map) {
+		return -1;
+	}
+
+	bool key = rec.force_key || rec.since_key + 1 >= RECORD_KEY_INTERVAL;
+	if (encode(f, time_ms, key) != 0 || ring_append() != 0) {
+		if (!rec.failing) {
+			log_error("Failed to record frame; recording resumes with the next one");
+			rec.failing = true;
+		}
+		rec.force_key = true;
+		return -1;
+	}
+
+	rec.last ^= 1;
+	rec.since_key = key ? 0 : rec.since_key + 1;
+	rec.force_key = false;
+	rec.failing = false;
+	return 0;
+}
+
+/**
+ * record_close() - Stop recording and release the ring
+ */
+void record_close(void)
+{
+	if (rec.map) {
+		munmap(rec.map, rec.map_size);
+		close(rec.fd);
+	}
+	free(rec.buf);
+	frame_state_free(&rec.frames[0]);
+	frame_state_free(&rec.frames[1]);
+	pidmap_free(&rec.index);
+	names_free(&rec.names);
+	memset(&rec, 0, sizeof(rec));
+	rec.fd = -1;
+}
+
+/*
+ * Decoding. Reads past the end of a record set r->bad and return zero.
+ */
+
+static uint8_t get_byte(Reader *r)
+{
+	if (r->p >= r->end) {
+		r->bad = true;
+		return 0;
+	}
+	return *r->p++;
+}
+
+static uint64_t get_varint(Reader *r)
+{
+	uint64_t v = 0;
+
+	for (int shift = 0; shift < 64; shift += 7) {
+		uint8_t b = get_byte(r);
+		v |= (uint64_t)(b & 0x7f) << shift;
+		if (!(b & 0x80)) {
+			return v;
+		}
+	}
+	r->bad = true;
+	return 0;
+}
+
+static int64_t get_zigzag(Reader *r)
+{
+	return unzigzag(get_varint(r));
+}
+
+static uint32_t get_name(Reader *r)
+{
+	uint64_t v = get_varint(r);
+
+	if (v > 0) {
+		if (v > rp.names.count) {
+			r->bad = true;
+			return 0;
+		}
+		return (uint32_t)(v - 1);
+	}
+
+	uint64_t len = get_varint(r);
+	if (r->bad || len > (uint64_t)(r->end - r->p)) {
+		r->bad = true;
+		return 0;
+	}
+	uint32_t id = names_add(&rp.names, (const char *)r->p, len);
+	r->p += len;
+	if (id == UINT32_MAX) {
+		r->bad = true;
+		return 0;
+	}
+	return id;
+}
+
+static void get_cpu_times(Reader *r, const CpuTimes *base, CpuTimes *t)
+{
+	uint64_t v[CPU_TIMES_FIELDS];
+
+	memcpy(v, base, sizeof(v));
+	for (size_t i = 0; i < CPU_TIMES_FIELDS; i++) {
+		v[i] += (uint64_t)get_zigzag(r);
+	}
+	memcpy(t, v, sizeof(v));
+}
+
+static int get_cpu_stat(Reader *r, const CpuStat *base, CpuStat *st)
+{
+	static const CpuTimes zero;
+
+	uint64_t cores = get_varint(r);
+	if (cores > MAX_CORES) {
+		return -1;
+	}
+	if ((int)cores > st->core_capacity) {
+		CpuTimes *grown = realloc(st->cores, cores * sizeof(*grown));
+		if (!grown) {
+			return -1;
+		}
+		st->cores = grown;
+		st->core_capacity = (int)cores;
+	}
+	st->core_count = (int)cores;
+
+	get_cpu_times(r, base ? &base->total : &zero, &st->total);
+	for (int i = 0; i < st->core_count; i++) {
+		get_cpu_times(r, base && i < base->core_count ? &base->cores[i] :
+								&zero,
+			      &st->cores[i]);
+	}
+
+	CpuStat none = {0};
+	if (!base) {
+		base = &none;
+	}
+	st->ctxt = base->ctxt + (uint64_t)get_zigzag(r);
+	st->intr = base->intr + (uint64_t)get_zigzag(r);
+	st->processes = base->processes + (uint64_t)get_zigzag(r);
+	st->procs_running = base->procs_running + (uint64_t)get_zigzag(r);
+	st->procs_blocked = base->procs_blocked + (uint64_t)get_zigzag(r);
+	return r->bad ? -1 : 0;
+}
+
+static int get_rows(Reader *r, const FrameState *prev, FrameState *curr,
+		    bool key)
+{
+	// Rows take a byte each, except those copied by runs
+	uint64_t count = get_varint(r);
+	if (count > (uint64_t)prev->count + (uint64_t)(r->end - r->p) ||
+	    count > MAX_ROWS || frame_state_reserve(curr, (int)count) != 0) {
+		return -1;
+	}
+
+	int cursor = 0;
+	int i = 0;
+	while (i < (int)count && !r->bad) {
+		uint8_t op = get_byte(r);
+		RowState *row = &curr->rows[i];
+
+		if (op == RECORD_OP_NEW) {
+			row->pid = (int32_t)get_varint(r);
+			row->starttime = get_varint(r);
+			row->utime = get_varint(r);
+			row->stime = get_varint(r);
+			row->mem_bytes = get_varint(r);
+			row->cpu = (uint32_t)get_varint(r);
+			row->flags = get_byte(r);
+			row->name = get_name(r);
+			i++;
+		} else if (key) {
+			return -1;
+		} else if (op == RECORD_OP_RUN) {
+			uint64_t n = get_varint(r);
+			if (n > (uint64_t)(prev->count - cursor) ||
+			    n > count - (uint64_t)i) {
+				return -1;
+			}
+			memcpy(row, &prev->rows[cursor], n * sizeof(*row));
+			cursor += (int)n;
+			i += (int)n;
+		} else if (op & RECORD_OP_ROW) {
+			int64_t j = cursor + get_zigzag(r);
+			if (j < 0 || j >= prev->count) {
+				return -1;
+			}
+			*row = prev->rows[j];
+			if (op & RECORD_F_UTIME) {
+				row->utime += (uint64_t)get_zigzag(r);
+			}
+			if (op & RECORD_F_STIME) {
+				row->stime += (uint64_t)get_zigzag(r);
+			}
+			if (op & RECORD_F_MEM) {
+				row->mem_bytes += (uint64_t)get_zigzag(r);
+			}
+			if (op & RECORD_F_CPU) {
+				row->cpu += (uint32_t)get_zigzag(r);
+			}
+			if (op & RECORD_F_FLAGS) {
+				row->flags = get_byte(r);
+			}
+			if (op & RECORD_F_NAME) {
+				row->name = get_name(r);
+			}
+			cursor = (int)j + 1;
+			i++;
+		} else {
+			return -1;
+		}
+	}
+	curr->count = (int)count;
+	return r->bad ? -1 : 0;
+}
+
+/**
+ * decode() - Decode a record into the spare frame state
+ * @index: Record to decode; a delta record needs @index - 1 decoded
+ *
+ * Return: 0 on success, -1 if the record is damaged or was overwritten
+ */
+static int decode(int index)
+{
+	uint64_t off = rp.offset[index];
+	uint32_t len = check_record(&rp.hdr, rp.data, off);
+	bool key = rp.kind[index] == RECORD_KEY;
+	if (!len || rp.data[off + 6] != rp.kind[index] ||
+	    (!key && rp.decoded != index - 1)) {
+		return -1;
+	}
+
+	const FrameState *prev = &rp.frames[rp.last];
+	FrameState *s = &rp.frames[rp.last ^ 1];
+	const uint8_t *p = rp.data + off;
+	Reader r = { p + RECORD_FIXED_SIZE, p + len, false };
+
+	if (key) {
+		names_reset(&rp.names);
+	}
+	s->seq = load_u64(p + 8);
+	s->time_ms = load_u64(p + 16);
+	s->sample_ns = load_u64(p + 24);
+	s->elapsed_us = get_varint(&r);
+	s->cpu_load = get_varint(&r);
+	s->used_mem_bytes = get_varint(&r);
+	s->uptime_minutes = get_varint(&r);
+	s->have_events = get_byte(&r) != 0;
+	s->events.forks = get_varint(&r);
+	s->events.execs = get_varint(&r);
+	s->events.exits = get_varint(&r);
+	s->grow_count = get_varint(&r);
+	s->table_capacity = get_varint(&r);
+	s->stale_count = get_varint(&r);
+
+	bool have_prev = rp.decoded == index - 1 && rp.decoded >= 0;
+	if (r.bad || get_cpu_stat(&r, key ? NULL : &prev->cpu, &s->cpu) != 0 ||
+	    get_rows(&r, prev, s, key) != 0) {
+		rp.decoded = -1;
+		return -1;
+	}
+
+	rp.last ^= 1;
+	rp.decoded = index;
+	rp.have_prev = have_prev;
+	return 0;
+}
+
+/**
+ * fill_frame() - Turn the last decoded record into a Frame
+ * @out: Frame to fill; its table and CPU stats are reused
+ *
+ * Return: 0 on success, -1 on allocation failure
+ */
+static int fill_frame(Frame *out)
+{
+	const FrameState *s = &rp.frames[rp.last];
+	const FrameState *prev = rp.have_prev ? &rp.frames[rp.last ^ 1] : s;
+	ProcessTable *t = &out->table;
+	uint64_t total_mem = rp.hdr.total_mem_bytes;
+
+	t->count = 0;
+	t->names_len = 0;
+	if (process_table_reserve(t, s->count) != 0) {
+		return -1;
+	}
+	process_table_add_name(t, "", 0);
+
+	for (int i = 0; i < s->count; i++) {
+		const RowState *row = &s->rows[i];
+		size_t len;
+		const char *name = names_get(&rp.names, row->name, &len);
+
+		t->pid[i] = row->pid;
+		t->starttime[i] = row->starttime;
+		t->utime[i] = row->utime;
+		t->stime[i] = row->stime;
+		t->mem_bytes[i] = row->mem_bytes;
+		t->read_ns[i] = s->sample_ns;
+		t->cpu_percent[i] = row->cpu / 100.0;
+		t->mem_percent[i] = total_mem ? (double)row->mem_bytes /
+						(double)total_mem * 100.0 : 0.0;
+		t->flags[i] = row->flags;
+		t->backoff[i] = 1;
+		t->wait[i] = 0;
+		t->name[i] = process_table_add_name(t, name, len);
+		t->order[i] = (uint32_t)i;
+	}
+	t->count = s->count;
+	t->stale_count = (int)s->stale_count;
+	t->sample_ns = s->sample_ns;
+
+	if (cpu_stat_copy(&out->cpu_prev, &prev->cpu) != 0 ||
+	    cpu_stat_copy(&out->cpu_curr, &s->cpu) != 0) {
+		return -1;
+	}
+	out->elapsed_s = s->elapsed_us / 1e6;
+	out->cpu_load = s->cpu_load / 100.0;
+	out->used_mem_bytes = s->used_mem_bytes;
+	out->uptime_days = (int)(s->uptime_minutes / 1440);
+	out->uptime_hours = (int)(s->uptime_minutes / 60 % 24);
+	out->uptime_minutes = (int)(s->uptime_minutes % 60);
+	out->have_events = s->have_events;
+	out->events = s->events;
+	out->grow_count = (int)s->grow_count;
+	out->table_capacity = (int)s->table_capacity;
+	out->seq = s->seq;
+	return 0;
+}
+
+/**
+ * replay_open() - Open a ring file for replay
+ * @path: File written by record_open()
+ *
+ * Indexes the records that are live when it is called, starting at the
+ * oldest key record. A file that is still being recorded may be replayed;
+ * records the recorder overwrites afterwards fail to load.
+ *
+ * Return: 0 on success, -1 on error (errno is set; EINVAL if @path is not
+ * a ring file)
+ */
+int replay_open(const char *path)
+{
+	int err;
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return -1;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		goto fail;
+	}
+	if ((uint64_t)st.st_size < RECORD_HEADER_SIZE) {
+		errno = EINVAL;
+		goto fail;
+	}
+
+	void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		goto fail;
+	}
+	rp.fd = fd;
+	rp.map = map;
+	rp.map_size = (size_t)st.st_size;
+	rp.data = rp.map + RECORD_HEADER_SIZE;
+	memcpy(&rp.hdr, rp.map, sizeof(rp.hdr));
+
+	const RingHeader *h = &rp.hdr;
+	if (!header_valid(h, rp.map_size) ||
+	    h->live > h->data_size / RECORD_FIXED_SIZE) {
+		replay_close();
+		errno = EINVAL;
+		return -1;
+	}
+
+	rp.offset = malloc((h->live + 1) * sizeof(*rp.offset));
+	rp.kind = malloc(h->live + 1);
+	if (!rp.offset || !rp.kind) {
+		replay_close();
+		errno = ENOMEM;
+		return -1;
+	}
+
+	int n = (int)walk_records(h, rp.data, rp.offset, rp.kind);
+	int first = 0;
+	while (first < n && rp.kind[first] != RECORD_KEY) {
+		first++;
+	}
+	rp.count = n - first;
+	memmove(rp.offset, rp.offset + first, (size_t)rp.count * sizeof(*rp.offset));
+	memmove(rp.kind, rp.kind + first, (size_t)rp.count);
+	rp.decoded = -1;
+	return 0;
+
+fail:
+	err = errno;
+	close(fd);
+	errno = err;
+	return -1;
+}
+
+/**
+ * replay_count() - Number of frames that can be replayed
+ */
+int replay_count(void)
+{
+	return rp.count;
+}
+
+/**
+ * replay_time_ms() - Wall clock time a frame was recorded at
+ * @index: Frame, 0 to replay_count() - 1
+ *
+ * Return: Milliseconds since the epoch, or 0 if @index is out of range
+ */
+uint64_t replay_time_ms(int index)
+{
+	if (index < 0 || index >= rp.count) {
+		return 0;
+	}
+	return load_u64(rp.data + rp.offset[index] + 16);
+}
+
+/**
+ * replay_total_mem_bytes() - Total system memory of the recorded machine
+ */
+uint64_t replay_total_mem_bytes(void)
+{
+	return rp.hdr.total_mem_bytes;
+}
+
+/**
+ * replay_load() - Reconstruct a recorded frame
+ * @index: Frame, 0 to replay_count() - 1
+ * @out: Frame to fill; initialize its table with process_table_init()
+ *
+ * Loading the frame after the last one loaded decodes a single record;
+ * any other jump decodes forward from the nearest key record, at most
+ * 2 * RECORD_KEY_INTERVAL records. cpu_prev is the frame before @index,
+ * so per-core loads and rates match what was shown live.
+ *
+ * Return: 0 on success, -1 if the frame is damaged, was overwritten by a
+ * running recorder, or out of range
+ */
+int replay_load(int index, Frame *out)
+{
+	if (index < 0 || index >= rp.count) {
+		return -1;
+	}
+
+	if (rp.decoded != index) {
+		// Start one frame early when possible, for cpu_prev
+		int key = index > 0 ? index - 1 : index;
+		while (key > 0 && rp.kind[key] != RECORD_KEY) {
+			key--;
+		}
+		int start = rp.decoded >= key && rp.decoded < index ?
+			    rp.decoded + 1 : key;
+		for (int i = start; i <= index; i++) {
+			if (decode(i) != 0) {
+				return -1;
+			}
+		}
+	}
+	return fill_frame(out);
+}
+
+/**
+ * replay_close() - Release the replayed file
+ */
+void replay_close(void)
+{
+	if (rp.map) {
+		munmap(rp.map, rp.map_size);
+	}
+	if (rp.fd >= 0) {
+		close(rp.fd);
+	}
+	free(rp.offset);
+	free(rp.kind);
+	frame_state_free(&rp.frames[0]);
+	frame_state_free(&rp.frames[1]);
+	names_free(&rp.names);
+	memset(&rp, 0, sizeof(rp));
+	rp.fd = -1;
+	rp.decoded = -1;
+}
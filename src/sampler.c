@@ -0,0 +1,444 @@
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include "logger.h"
+#include "mem.h"
+#include "history.h"
+#include "record.h"
+#include "sampler.h"
+#include "selfstat.h"
+#include "system.h"
+
+#define FRAME_FRESH 0x4u // set in the middle slot until the UI takes it
+
+static Frame frames[3];
+static atomic_uint middle;    // spare frame index | FRAME_FRESH
+static unsigned int back = 0;  // written by the sampler thread only
+static unsigned int front = 1; // read by the UI thread only
+
+static pthread_t thread;
+static bool running;
+static int timer_fd = -1;
+static int event_fd = -1;     // counts published frames
+static int stop_fd = -1;      // wakes the sampler for shutdown
+
+// Sampler-side state; only the sampler thread touches it once started
+static ProcessTable tables[2];
+static CpuStat cpu_stats[2];
+static SamplerConfig cfg;
+static uint64_t seq;
+static PidMap pinned;
+
+// Set from the UI thread, applied by the sampler at its next tick
+static atomic_bool full_accuracy;
+static pthread_mutex_t pin_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct {
+	int32_t *pids;
+	int count;
+	int capacity;
+	bool changed;
+} pin_request;
+
+static double seconds_between(const struct timespec *a,
+			      const struct timespec *b)
+{
+	return (double)(b->tv_sec - a->tv_sec) +
+	       (double)(b->tv_nsec - a->tv_nsec) / 1e9;
+}
+
+/**
+ * publish() - Hand the back frame to the UI
+ *
+ * The back frame becomes the fresh middle one and the previous middle
+ * frame, read or not, becomes the new back frame.
+ */
+static void publish(void)
+{
+	unsigned int prev = atomic_exchange_explicit(&middle,
+						     back | FRAME_FRESH,
+						     memory_order_acq_rel);
+	back = prev & ~FRAME_FRESH;
+
+	uint64_t one = 1;
+	if (write(event_fd, &one, sizeof(one)) < 0) {
+		log_error("Failed to signal new frame");
+	}
+}
+
+/**
+ * fill_frame() - Copy the latest snapshot and header data into a frame
+ * @f: Back frame
+ * @curr: Snapshot just computed
+ * @cpu_prev: /proc/stat at the previous tick
+ * @cpu_curr: /proc/stat at this tick
+ * @elapsed_s: Seconds between the two samples
+ * @events: Proc connector events during the tick
+ */
+static void fill_frame(Frame *f, const ProcessTable *curr,
+		       const CpuStat *cpu_prev, const CpuStat *cpu_curr,
+		       double elapsed_s, const ProcEventCounts *events)
+{
+	if (process_table_copy(&f->table, curr) != 0) {
+		log_error("Failed to copy snapshot for display");
+	}
+	cpu_stat_copy(&f->cpu_prev, cpu_prev);
+	cpu_stat_copy(&f->cpu_curr, cpu_curr);
+	f->elapsed_s = elapsed_s;
+	f->cpu_load = cpu_times_load(&cpu_prev->total, &cpu_curr->total);
+
+	// Actual system memory usage (not sum of all processes!)
+	f->used_mem_bytes = read_used_mem_bytes();
+	read_uptime(&f->uptime_days, &f->uptime_hours, &f->uptime_minutes);
+
+	f->have_events = procevents_active();
+	f->events = *events;
+	f->grow_count = tables[0].grow_count + tables[1].grow_count;
+	f->table_capacity = curr->capacity;
+	f->seq = ++seq;
+}
+
+/**
+ * update_pins() - Take over the PIDs the UI pinned since the last tick
+ */
+static void update_pins(void)
+{
+	pthread_mutex_lock(&pin_lock);
+	if (pin_request.changed) {
+		if (pidmap_reset(&pinned, (size_t)pin_request.count) == 0) {
+			for (int i = 0; i < pin_request.count; i++) {
+				pidmap_insert(&pinned, pin_request.pids[i], 0, i);
+			}
+		}
+		pin_request.changed = false;
+	}
+	pthread_mutex_unlock(&pin_lock);
+}
+
+static void *sampler_main(void *arg __attribute__((unused)))
+{
+	ProcessTable *prev_table = &tables[0];
+	ProcessTable *curr_table = &tables[1];
+	CpuStat *cpu_prev = &cpu_stats[0];
+	CpuStat *cpu_curr = &cpu_stats[1];
+
+	struct timespec sample_prev;
+	clock_gettime(CLOCK_MONOTONIC, &sample_prev);
+	ProcEventCounts events_prev;
+	procevents_counts(&events_prev);
+
+	struct pollfd fds[2] = {
+		{ .fd = timer_fd, .events = POLLIN },
+		{ .fd = stop_fd, .events = POLLIN },
+	};
+
+	for (;;) {
+		if (poll(fds, 2, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			log_error("Sampler poll failed");
+			break;
+		}
+		if (fds[1].revents & POLLIN) {
+			break;
+		}
+		if (!(fds[0].revents & POLLIN)) {
+			continue;
+		}
+
+		// Missed expirations are dropped; deltas use measured time
+		uint64_t expirations;
+		if (read(timer_fd, &expirations, sizeof(expirations)) < 0) {
+			continue;
+		}
+
+		uint64_t start_ns = selfstat_now();
+		cpu_stat_read(cpu_curr);
+		struct timespec sample_curr;
+		clock_gettime(CLOCK_MONOTONIC, &sample_curr);
+		update_pins();
+		SamplePolicy policy = {
+			.max_backoff = atomic_load(&full_accuracy) ? 1 :
+				       cfg.max_backoff,
+			.pinned = &pinned,
+		};
+		collect_processes_adaptive(curr_table, prev_table, &policy);
+		uint64_t collected_ns = selfstat_now();
+		selfstat_record(PHASE_COLLECT, collected_ns - start_ns);
+
+		compute_process_stats(curr_table, prev_table, cfg.cpu_cores,
+				      cfg.total_mem_bytes);
+
+		ProcEventCounts events_curr, events;
+		procevents_counts(&events_curr);
+		events.forks = events_curr.forks - events_prev.forks;
+		events.execs = events_curr.execs - events_prev.execs;
+		events.exits = events_curr.exits - events_prev.exits;
+
+		fill_frame(&frames[back], curr_table, cpu_prev, cpu_curr,
+			   seconds_between(&sample_prev, &sample_curr),
+			   &events);
+		selfstat_record(PHASE_COMPUTE, selfstat_now() - collected_ns);
+		selfstat_end_tick();
+		if (record_active() || history_active()) {
+			struct timespec now;
+			clock_gettime(CLOCK_REALTIME, &now);
+			uint64_t now_ms = (uint64_t)now.tv_sec * 1000u +
+					  (uint64_t)now.tv_nsec / 1000000u;
+			if (record_active()) {
+				record_frame(&frames[back], now_ms);
+			}
+			if (history_active()) {
+				history_append(&frames[back], now_ms);
+			}
+		}
+		publish();
+
+		// The current snapshot becomes the previous one; no copying
+		ProcessTable *swap = prev_table;
+		prev_table = curr_table;
+		curr_table = swap;
+		CpuStat *cpu_swap = cpu_prev;
+		cpu_prev = cpu_curr;
+		cpu_curr = cpu_swap;
+		sample_prev = sample_curr;
+		events_prev = events_curr;
+	}
+
+	return NULL;
+}
+
+static void release_resources(void)
+{
+	for (int i = 0; i < 3; i++) {
+		process_table_free(&frames[i].table);
+		cpu_stat_free(&frames[i].cpu_prev);
+		cpu_stat_free(&frames[i].cpu_curr);
+	}
+	for (int i = 0; i < 2; i++) {
+		process_table_free(&tables[i]);
+		cpu_stat_free(&cpu_stats[i]);
+	}
+	cpu_stat_close();
+	pidmap_free(&pinned);
+
+	pthread_mutex_lock(&pin_lock);
+	free(pin_request.pids);
+	memset(&pin_request, 0, sizeof(pin_request));
+	pthread_mutex_unlock(&pin_lock);
+
+	int *fds[] = { &timer_fd, &event_fd, &stop_fd };
+	for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++) {
+		if (*fds[i] >= 0) {
+			close(*fds[i]);
+			*fds[i] = -1;
+		}
+	}
+}
+
+/**
+ * arm_timer() - (Re)program the tick timer
+ * @interval_ms: Tick period
+ * @first_ns: Delay before the first tick
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int arm_timer(int interval_ms, long first_ns)
+{
+	struct itimerspec spec = {
+		.it_interval = { interval_ms / 1000,
+				 (long)(interval_ms % 1000) * 1000000 },
+		.it_value = { first_ns / 1000000000, first_ns % 1000000000 },
+	};
+	return timerfd_settime(timer_fd, 0, &spec, NULL);
+}
+
+/**
+ * sampler_start() - Take the first sample and start the sampler thread
+ * @config: Tick period and system constants; copied
+ *
+ * The first sample is taken on the calling thread. The thread's first
+ * tick fires right away, so a frame is available almost immediately.
+ *
+ * Return: 0 on success, -1 on error (nothing is left running)
+ */
+int sampler_start(const SamplerConfig *config)
+{
+	memset(frames, 0, sizeof(frames));
+	back = 0;
+	front = 1;
+	atomic_store(&middle, 2);
+	cfg = *config;
+	seq = 0;
+	atomic_store(&full_accuracy, config->full_accuracy);
+
+	bool ok = true;
+	for (int i = 0; i < 3; i++) {
+		ok &= process_table_init(&frames[i].table,
+					 PROCESS_TABLE_INITIAL_ROWS) == 0;
+	}
+	for (int i = 0; i < 2; i++) {
+		ok &= process_table_init(&tables[i],
+					 PROCESS_TABLE_INITIAL_ROWS) == 0;
+	}
+	if (!ok) {
+		log_error("Failed to allocate memory for process tables");
+		release_resources();
+		return -1;
+	}
+
+	timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+	event_fd = eventfd(0, EFD_CLOEXEC);
+	stop_fd = eventfd(0, EFD_CLOEXEC);
+	if (timer_fd < 0 || event_fd < 0 || stop_fd < 0) {
+		log_error("Failed to create sampler descriptors");
+		release_resources();
+		return -1;
+	}
+
+	if (arm_timer(cfg.interval_ms, 1) < 0) {
+		log_error("Failed to arm sampler timer");
+		release_resources();
+		return -1;
+	}
+
+	collect_processes(&tables[0]);
+	cpu_stat_read(&cpu_stats[0]);
+
+	if (pthread_create(&thread, NULL, sampler_main, NULL) != 0) {
+		log_error("Failed to start sampler thread");
+		release_resources();
+		return -1;
+	}
+	running = true;
+	return 0;
+}
+
+/**
+ * sampler_stop() - Stop the sampler thread and free all frames
+ *
+ * Frames returned by sampler_acquire() are invalid afterwards.
+ */
+void sampler_stop(void)
+{
+	if (!running) {
+		return;
+	}
+
+	uint64_t one = 1;
+	if (write(stop_fd, &one, sizeof(one)) < 0) {
+		log_error("Failed to signal sampler shutdown");
+	}
+	pthread_join(thread, NULL);
+	running = false;
+	release_resources();
+}
+
+/**
+ * sampler_set_interval() - Change the tick period of the running sampler
+ * @interval_ms: New period
+ *
+ * Safe to call from the UI thread. The next tick comes one new period
+ * from now; CPU usage stays correct across the change because it is
+ * computed from the measured time between samples.
+ *
+ * Return: 0 on success, -1 on error
+ */
+int sampler_set_interval(int interval_ms)
+{
+	if (timer_fd < 0 || arm_timer(interval_ms, interval_ms * 1000000L) < 0) {
+		log_error("Failed to change sampling interval");
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * sampler_set_full_accuracy() - Turn adaptive sampling off or back on
+ * @full: true to read every process every tick
+ *
+ * Safe to call from the UI thread; takes effect at the next tick.
+ */
+void sampler_set_full_accuracy(bool full)
+{
+	atomic_store(&full_accuracy, full);
+}
+
+/**
+ * sampler_pin() - Set the PIDs that must be read every tick
+ * @pids: PIDs on screen or matching the search; copied
+ * @count: Number of PIDs
+ *
+ * Safe to call from the UI thread; replaces the previous set from the
+ * next tick on.
+ *
+ * Return: 0 on success, -1 on allocation failure (the old set is kept)
+ */
+int sampler_pin(const int32_t *pids, int count)
+{
+	int ret = 0;
+
+	pthread_mutex_lock(&pin_lock);
+	if (count > pin_request.capacity) {
+		int32_t *grown = realloc(pin_request.pids,
+					 (size_t)count * sizeof(*grown));
+		if (grown) {
+			pin_request.pids = grown;
+			pin_request.capacity = count;
+		} else {
+			ret = -1;
+		}
+	}
+	if (ret == 0) {
+		if (count > 0) {
+			memcpy(pin_request.pids, pids,
+			       (size_t)count * sizeof(*pids));
+		}
+		pin_request.count = count;
+		pin_request.changed = true;
+	}
+	pthread_mutex_unlock(&pin_lock);
+	return ret;
+}
+
+/**
+ * sampler_event_fd() - Descriptor that becomes readable on every publish
+ *
+ * Read it (8 bytes) to reset it before calling sampler_acquire().
+ *
+ * Return: eventfd, or -1 if the sampler is not running
+ */
+int sampler_event_fd(void)
+{
+	return event_fd;
+}
+
+/**
+ * sampler_acquire() - Take the latest published frame
+ *
+ * UI thread only. The returned frame stays valid and unchanged until the
+ * next call that returns non-NULL; the caller may modify it (e.g. sort its
+ * order column).
+ *
+ * Return: The new frame, or NULL if nothing was published since the last
+ * call
+ */
+Frame *sampler_acquire(void)
+{
+	if (!(atomic_load_explicit(&middle, memory_order_acquire) &
+	      FRAME_FRESH)) {
+		return NULL;
+	}
+
+	unsigned int prev = atomic_exchange_explicit(&middle, front,
+						     memory_order_acq_rel);
+	front = prev & ~FRAME_FRESH;
+	return &frames[front];
+}
@@ -0,0 +1,251 @@
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "logger.h"
+#include "mem.h"
+#include "selfstat.h"
+#include "syscount.h"
+
+// Log-linear buckets: values below SUB exactly, then SUB per power of two
+#define SUB_BITS 3
+#define SUB (1u << SUB_BITS)
+#define BUCKETS ((64 - SUB_BITS + 1) * (int)SUB)
+
+// Shortest span self CPU usage is averaged over
+#define CPU_WINDOW_NS 500000000ull
+
+typedef struct {
+	atomic_uint count[2][BUCKETS];
+	atomic_uint filled[2];
+	atomic_uint current;   // window being filled
+} PhaseHist;
+
+static PhaseHist hist[PHASE_COUNT];
+
+// Written by selfstat_end_tick() on the sampler thread
+static atomic_uint_fast64_t tick_syscalls;
+static atomic_uint_fast64_t tick_bytes;
+static SysCount tick_prev;
+
+// Reader state, see selfstat_read()
+static struct {
+	int statm_fd;
+	uint64_t wall_ns;
+	uint64_t cpu_ns;
+	double cpu_percent;
+} reader = { .statm_fd = -1 };
+
+static const char *const phase_names[PHASE_COUNT] = {
+	[PHASE_COLLECT] = "collect",
+	[PHASE_COMPUTE] = "compute",
+	[PHASE_SORT] = "sort",
+	[PHASE_FILTER] = "filter",
+	[PHASE_RENDER] = "render",
+	[PHASE_INPUT] = "input",
+};
+
+static int bucket_of(uint64_t ns)
+{
+	if (ns < SUB) {
+		return (int)ns;
+	}
+	int e = 63 - __builtin_clzll(ns);
+	return (e - SUB_BITS + 1) * (int)SUB +
+	       (int)((ns >> (e - SUB_BITS)) & (SUB - 1));
+}
+
+// Middle of a bucket's range
+static uint64_t bucket_value(int b)
+{
+	if (b < (int)SUB) {
+		return (uint64_t)b;
+	}
+	int e = b / (int)SUB + SUB_BITS - 1;
+	uint64_t width = 1ull << (e - SUB_BITS);
+	return ((uint64_t)(SUB + (unsigned)b % SUB) << (e - SUB_BITS)) + width / 2;
+}
+
+/**
+ * selfstat_now() - Current CLOCK_MONOTONIC time
+ *
+ * Return: Nanoseconds
+ */
+uint64_t selfstat_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * selfstat_record() - Add one run of a phase
+ * @phase: Phase that ran
+ * @ns: Time it took
+ */
+void selfstat_record(Phase phase, uint64_t ns)
+{
+	PhaseHist *h = &hist[phase];
+	unsigned int cur = atomic_load_explicit(&h->current, memory_order_relaxed);
+
+	if (atomic_load_explicit(&h->filled[cur], memory_order_relaxed) >=
+	    SELFSTAT_WINDOW) {
+		// Start over in the older window
+		cur ^= 1;
+		for (int b = 0; b < BUCKETS; b++) {
+			atomic_store_explicit(&h->count[cur][b], 0,
+					      memory_order_relaxed);
+		}
+		atomic_store_explicit(&h->filled[cur], 0, memory_order_relaxed);
+		atomic_store_explicit(&h->current, cur, memory_order_relaxed);
+	}
+	atomic_fetch_add_explicit(&h->count[cur][bucket_of(ns)], 1,
+				  memory_order_relaxed);
+	atomic_fetch_add_explicit(&h->filled[cur], 1, memory_order_relaxed);
+}
+
+/**
+ * selfstat_end_tick() - Note the /proc traffic of the tick just finished
+ *
+ * Called by the sampler thread once per tick.
+ */
+void selfstat_end_tick(void)
+{
+	SysCount now;
+
+	syscount_get(&now);
+	atomic_store_explicit(&tick_syscalls, now.syscalls - tick_prev.syscalls,
+			      memory_order_relaxed);
+	atomic_store_explicit(&tick_bytes, now.bytes - tick_prev.bytes,
+			      memory_order_relaxed);
+	tick_prev = now;
+}
+
+static void read_percentiles(const PhaseHist *h, SelfStats *out, Phase phase)
+{
+	uint32_t merged[BUCKETS];
+	uint64_t total = 0;
+
+	for (int b = 0; b < BUCKETS; b++) {
+		merged[b] = atomic_load_explicit(&h->count[0][b],
+						 memory_order_relaxed) +
+			    atomic_load_explicit(&h->count[1][b],
+						 memory_order_relaxed);
+		total += merged[b];
+	}
+	out->samples[phase] = (uint32_t)total;
+	out->p50_ns[phase] = 0;
+	out->p99_ns[phase] = 0;
+	if (total == 0) {
+		return;
+	}
+
+	// Smallest values with at least 50% and 99% of samples at or below
+	uint64_t rank50 = (total * 50 + 99) / 100;
+	uint64_t rank99 = (total * 99 + 99) / 100;
+	uint64_t seen = 0;
+	for (int b = 0; b < BUCKETS; b++) {
+		if (merged[b] == 0) {
+			continue;
+		}
+		seen += merged[b];
+		if (out->p50_ns[phase] == 0 && seen >= rank50) {
+			out->p50_ns[phase] = bucket_value(b);
+		}
+		if (seen >= rank99) {
+			out->p99_ns[phase] = bucket_value(b);
+			break;
+		}
+	}
+}
+
+// Resident set of this process from the real /proc, whatever --proc-root
+static uint64_t self_rss(void)
+{
+	char buf[128];
+
+	if (reader.statm_fd < 0) {
+		reader.statm_fd = open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+		if (reader.statm_fd < 0) {
+			return 0;
+		}
+	}
+	ssize_t n = pread(reader.statm_fd, buf, sizeof(buf) - 1, 0);
+	if (n <= 0) {
+		return 0;
+	}
+	buf[n] = '\0';
+
+	char *p = strchr(buf, ' ');
+	return p ? strtoull(p + 1, NULL, 10) * get_page_size() : 0;
+}
+
+/**
+ * selfstat_read() - Take a snapshot of the monitor's own cost
+ * @out: Percentiles of every phase, and resource usage
+ *
+ * CPU usage is averaged since the previous call at least half a second
+ * ago, so frequent calls do not make it jumpy. Call from one thread.
+ */
+void selfstat_read(SelfStats *out)
+{
+	for (int p = 0; p < PHASE_COUNT; p++) {
+		read_percentiles(&hist[p], out, (Phase)p);
+	}
+
+	uint64_t wall = selfstat_now();
+	struct rusage ru;
+	if (getrusage(RUSAGE_SELF, &ru) == 0) {
+		uint64_t cpu = (uint64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) *
+			       1000000000u +
+			       (uint64_t)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) *
+			       1000u;
+		if (reader.wall_ns == 0) {
+			reader.wall_ns = wall;
+			reader.cpu_ns = cpu;
+		} else if (wall - reader.wall_ns >= CPU_WINDOW_NS) {
+			reader.cpu_percent = (double)(cpu - reader.cpu_ns) /
+					     (double)(wall - reader.wall_ns) * 100.0;
+			reader.wall_ns = wall;
+			reader.cpu_ns = cpu;
+		}
+	}
+	out->cpu_percent = reader.cpu_percent;
+	out->rss_bytes = self_rss();
+	out->proc_syscalls = atomic_load_explicit(&tick_syscalls,
+						  memory_order_relaxed);
+	out->proc_bytes = atomic_load_explicit(&tick_bytes, memory_order_relaxed);
+	out->log_dropped = log_dropped();
+}
+
+/**
+ * selfstat_phase_name() - Short lowercase name of a phase
+ */
+const char *selfstat_phase_name(Phase phase)
+{
+	return phase >= 0 && phase < PHASE_COUNT ? phase_names[phase] : "?";
+}
+
+/**
+ * selfstat_reset() - Forget every sample; not safe while phases record
+ */
+void selfstat_reset(void)
+{
+	for (int p = 0; p < PHASE_COUNT; p++) {
+		for (int w = 0; w < 2; w++) {
+			for (int b = 0; b < BUCKETS; b++) {
+				atomic_store(&hist[p].count[w][b], 0);
+			}
+			atomic_store(&hist[p].filled[w], 0);
+		}
+		atomic_store(&hist[p].current, 0);
+	}
+	syscount_get(&tick_prev);
+	atomic_store(&tick_syscalls, 0);
+	atomic_store(&tick_bytes, 0);
+	reader.wall_ns = 0;
+	reader.cpu_percent = 0.0;
+}
@@ -1,71 +1,249 @@
 #include <stdlib.h>
+#include "logger.h"
 #include "sort.h"
 
-static int compare_cpu_asc(const void *a, const void *b)
+/*
+ * Sorting never moves table rows. The sort key of every row is gathered
+ * into a compact (key, row) scratch array, that array is sorted, and the
+ * resulting row indices are written to the table's order column.
+ */
+typedef struct {
+	double key;
+	uint32_t row;
+} SortKey;
+
+static SortKey *scratch;
+static int scratch_capacity;
+
+static int compare_key_asc(const void *a, const void *b)
+{
+	const SortKey *k1 = (const SortKey *)a;
+	const SortKey *k2 = (const SortKey *)b;
+
+	if (k1->key < k2->key)
+		return -1;
+	if (k1->key > k2->key)
+		return 1;
+	// Ties keep table order so equal rows do not jump between ticks
+	return (k1->row > k2->row) - (k1->row < k2->row);
+}
+
+static int compare_key_desc(const void *a, const void *b)
 {
-	const ProcessInfo *p1 = (const ProcessInfo *)a;
-	const ProcessInfo *p2 = (const ProcessInfo *)b;
+	const SortKey *k1 = (const SortKey *)a;
+	const SortKey *k2 = (const SortKey *)b;
 
-	if (p1->cpu_percent < p2->cpu_percent)
+	if (k1->key > k2->key)
 		return -1;
-	if (p1->cpu_percent > p2->cpu_percent)
+	if (k1->key < k2->key)
 		return 1;
+	return (k1->row > k2->row) - (k1->row < k2->row);
+}
+
+static int (*const compare_for[2])(const void *, const void *) = {
+	compare_key_desc, compare_key_asc,
+};
+
+static int ensure_scratch(int count)
+{
+	if (count > scratch_capacity) {
+		SortKey *grown = realloc(scratch, count * sizeof(SortKey));
+		if (!grown) {
+			log_error("Failed to allocate sort scratch; order unchanged");
+			return -1;
+		}
+		scratch = grown;
+		scratch_capacity = count;
+	}
 	return 0;
 }
 
-static int compare_cpu_desc(const void *a, const void *b)
+// Row of position i of a row subset, or row i when there is no subset
+static inline uint32_t row_at(const uint32_t *rows, int i)
 {
-	return -compare_cpu_asc(a, b);
+	return rows ? rows[i] : (uint32_t)i;
 }
 
-static int compare_mem_asc(const void *a, const void *b)
+/**
+ * sort_full() - Order rows by a numeric column
+ * @column: Sort key per table row
+ * @reversed: If false, biggest values first; if true, smallest first
+ * @rows: Rows to order, or NULL for rows 0 .. count - 1
+ * @count: Number of rows
+ * @out: Receives the ordered row indices
+ */
+static void sort_full(const double *column, bool reversed,
+		      const uint32_t *rows, int count, uint32_t *out)
 {
-	const ProcessInfo *p1 = (const ProcessInfo *)a;
-	const ProcessInfo *p2 = (const ProcessInfo *)b;
+	if (ensure_scratch(count) != 0) {
+		return;
+	}
 
-	if (p1->mem_percent < p2->mem_percent)
-		return -1;
-	if (p1->mem_percent > p2->mem_percent)
-		return 1;
-	return 0;
+	for (int i = 0; i < count; i++) {
+		uint32_t row = row_at(rows, i);
+		scratch[i].key = column[row];
+		scratch[i].row = row;
+	}
+
+	qsort(scratch, count, sizeof(SortKey), compare_for[reversed]);
+
+	for (int i = 0; i < count; i++) {
+		out[i] = scratch[i].row;
+	}
 }
 
-static int compare_mem_desc(const void *a, const void *b)
+// Order every row of a table into its order column
+static void sort_by_column(ProcessTable *t, const double *column,
+			   bool reversed)
 {
-	return -compare_mem_asc(a, b);
+	sort_full(column, reversed, NULL, t->count, t->order);
 }
 
 /**
  * sort_by_cpu() - Sort processes by CPU usage
- * @processes: Array of ProcessInfo structures
- * @count: Number of processes in the array
+ * @t: Process table
  * @reversed: If false (default), biggest values first; if true, smallest first
  *
- * Sorts the process array in-place by CPU percentage.
+ * Permutes the order column of the table by CPU percentage.
  */
-void sort_by_cpu(ProcessInfo *processes, int count, bool reversed)
+void sort_by_cpu(ProcessTable *t, bool reversed)
 {
-	if (reversed) {
-		qsort(processes, count, sizeof(ProcessInfo), compare_cpu_asc);
-	} else {
-		qsort(processes, count, sizeof(ProcessInfo), compare_cpu_desc);
-	}
+	sort_by_column(t, t->cpu_percent, reversed);
 }
 
 /**
  * sort_by_mem() - Sort processes by memory usage
- * @processes: Array of ProcessInfo structures
- * @count: Number of processes in the array
+ * @t: Process table
+ * @reversed: If false (default), biggest values first; if true, smallest first
+ *
+ * Permutes the order column of the table by memory percentage.
+ */
+void sort_by_mem(ProcessTable *t, bool reversed)
+{
+	sort_by_column(t, t->mem_percent, reversed);
+}
+
+/*
+ * Window sorting: only rows [offset, offset + height) of the final order
+ * are needed on screen. The best k = offset + height rows are selected with
+ * a bounded heap whose root is the worst row kept so far, in O(n log k),
+ * then only those k rows are sorted. A full sort is used once k is a large
+ * fraction of the table, where selection stops paying off.
+ */
+#define SORT_WINDOW_FULL_FRACTION 4 // full sort once k > count / 4
+
+static inline bool comes_before(const SortKey *a, const SortKey *b,
+				bool reversed)
+{
+	return compare_for[reversed](a, b) < 0;
+}
+
+static void heap_sift_down(SortKey *heap, int size, int i, bool reversed)
+{
+	for (;;) {
+		int worst = i;
+		int left = 2 * i + 1;
+		int right = left + 1;
+
+		if (left < size &&
+		    comes_before(&heap[worst], &heap[left], reversed))
+			worst = left;
+		if (right < size &&
+		    comes_before(&heap[worst], &heap[right], reversed))
+			worst = right;
+		if (worst == i)
+			return;
+
+		SortKey tmp = heap[i];
+		heap[i] = heap[worst];
+		heap[worst] = tmp;
+		i = worst;
+	}
+}
+
+/**
+ * sort_rows() - Order some rows of a table, only as far as a window needs
+ * @t: Table holding the sort keys
+ * @column: Column to sort by
  * @reversed: If false (default), biggest values first; if true, smallest first
+ * @rows: Rows to order, e.g. the matches of a filter; NULL for every row
+ * @count: Number of @rows, or of table rows if @rows is NULL
+ * @offset: Index of the first visible row in sorted order
+ * @height: Number of visible rows
+ * @out: Receives @count row indices; must not be @rows
  *
- * Sorts the process array in-place by memory percentage.
+ * Afterwards out[0 .. offset + height) holds the same rows, in the same
+ * order, as a full sort of @rows would; the rest of @out is a permutation
+ * of the remaining rows in unspecified order.
  */
-void sort_by_mem(ProcessInfo *processes, int count, bool reversed)
+void sort_rows(const ProcessTable *t, SortColumn column, bool reversed,
+	       const uint32_t *rows, int count, int offset, int height,
+	       uint32_t *out)
 {
-	if (reversed) {
-		qsort(processes, count, sizeof(ProcessInfo), compare_mem_asc);
-	} else {
-		qsort(processes, count, sizeof(ProcessInfo), compare_mem_desc);
+	const double *keys = column == SORT_MEM ? t->mem_percent :
+						  t->cpu_percent;
+	long wanted = (long)(offset < 0 ? 0 : offset) + (height < 1 ? 1 : height);
+
+	if (wanted * SORT_WINDOW_FULL_FRACTION > count) {
+		sort_full(keys, reversed, rows, count, out);
+		return;
+	}
+
+	int k = (int)wanted;
+	if (ensure_scratch(k) != 0) {
+		return;
+	}
+
+	SortKey *heap = scratch;
+	for (int i = 0; i < k; i++) {
+		heap[i].row = row_at(rows, i);
+		heap[i].key = keys[heap[i].row];
+	}
+	for (int i = k / 2 - 1; i >= 0; i--) {
+		heap_sift_down(heap, k, i, reversed);
+	}
+
+	for (int i = k; i < count; i++) {
+		uint32_t row = row_at(rows, i);
+		SortKey candidate = { keys[row], row };
+		if (comes_before(&candidate, &heap[0], reversed)) {
+			heap[0] = candidate;
+			heap_sift_down(heap, k, 0, reversed);
+		}
+	}
+
+	// The k-th best row is the heap root; everything after it is not kept
+	SortKey threshold = heap[0];
+
+	qsort(heap, k, sizeof(SortKey), compare_for[reversed]);
+	for (int i = 0; i < k; i++) {
+		out[i] = heap[i].row;
+	}
+
+	int next = k;
+	for (int i = 0; i < count; i++) {
+		uint32_t row = row_at(rows, i);
+		SortKey candidate = { keys[row], row };
+		if (comes_before(&threshold, &candidate, reversed)) {
+			out[next++] = row;
+		}
 	}
 }
 
+/**
+ * sort_window() - Order only the rows needed for a visible window
+ * @t: Process table whose order column is rewritten
+ * @column: Column to sort by
+ * @reversed: If false (default), biggest values first; if true, smallest first
+ * @offset: Index of the first visible row in sorted order
+ * @height: Number of visible rows
+ *
+ * Afterwards t->order[0 .. offset + height) holds the same rows, in the same
+ * order, as a full sort would; the rest of the order column is a
+ * permutation of the remaining rows in unspecified order.
+ */
+void sort_window(ProcessTable *t, SortColumn column, bool reversed,
+		 int offset, int height)
+{
+	sort_rows(t, column, reversed, NULL, t->count, offset, height, t->order);
+}
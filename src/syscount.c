@@ -0,0 +1,28 @@
+#include <stdatomic.h>
+#include "syscount.h"
+
+static atomic_uint_fast64_t syscalls;
+static atomic_uint_fast64_t bytes;
+
+/**
+ * syscount_add() - Account for syscalls made against /proc
+ * @calls: Number of syscalls
+ * @len: Bytes they returned
+ */
+void syscount_add(uint64_t calls, uint64_t len)
+{
+	atomic_fetch_add_explicit(&syscalls, calls, memory_order_relaxed);
+	if (len) {
+		atomic_fetch_add_explicit(&bytes, len, memory_order_relaxed);
+	}
+}
+
+/**
+ * syscount_get() - Read the cumulative counters
+ * @out: Output counters
+ */
+void syscount_get(SysCount *out)
+{
+	out->syscalls = atomic_load_explicit(&syscalls, memory_order_relaxed);
+	out->bytes = atomic_load_explicit(&bytes, memory_order_relaxed);
+}
@@ -0,0 +1,261 @@
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include "logger.h"
+#include "syscount.h"
+#include "uring.h"
+
+static int ring_fd = -1;
+
+// Submission queue
+static void *sq_ring;
+static size_t sq_ring_size;
+static unsigned int *sq_tail;
+static unsigned int sq_mask;
+static unsigned int *sq_array;
+static struct io_uring_sqe *sqes;
+static size_t sqes_size;
+static unsigned int sq_entries;
+static unsigned int queued; // SQEs filled but not yet submitted
+
+// Completion queue (shares the SQ mapping with IORING_FEAT_SINGLE_MMAP)
+static void *cq_ring;
+static size_t cq_ring_size;
+static unsigned int *cq_head;
+static unsigned int *cq_tail;
+static unsigned int cq_mask;
+static struct io_uring_cqe *cqes;
+
+/**
+ * uring_open() - Create the ring
+ * @entries: Submission queue size, rounded up to a power of two by the
+ *           kernel; also the largest batch uring_submit_wait() handles
+ *
+ * Return: 0 on success, -1 if io_uring is unavailable (old kernel,
+ * seccomp, kernel.io_uring_disabled) or the rings cannot be mapped
+ */
+int uring_open(unsigned int entries)
+{
+	if (ring_fd >= 0) {
+		return 0;
+	}
+
+	struct io_uring_params p;
+	memset(&p, 0, sizeof(p));
+	int fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+	if (fd < 0) {
+		return -1;
+	}
+
+	sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+	cq_ring_size = p.cq_off.cqes +
+		       p.cq_entries * sizeof(struct io_uring_cqe);
+	bool single_mmap = p.features & IORING_FEAT_SINGLE_MMAP;
+	if (single_mmap && cq_ring_size > sq_ring_size) {
+		sq_ring_size = cq_ring_size;
+	}
+
+	sq_ring = mmap(NULL, sq_ring_size, PROT_READ | PROT_WRITE,
+		       MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if (sq_ring == MAP_FAILED) {
+		sq_ring = NULL;
+		close(fd);
+		return -1;
+	}
+	ring_fd = fd;
+
+	if (single_mmap) {
+		cq_ring = sq_ring;
+	} else {
+		cq_ring = mmap(NULL, cq_ring_size, PROT_READ | PROT_WRITE,
+			       MAP_SHARED | MAP_POPULATE, fd,
+			       IORING_OFF_CQ_RING);
+		if (cq_ring == MAP_FAILED) {
+			cq_ring = NULL;
+			uring_close();
+			return -1;
+		}
+	}
+
+	sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	sqes = mmap(NULL, sqes_size, PROT_READ | PROT_WRITE,
+		    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if (sqes == MAP_FAILED) {
+		sqes = NULL;
+		uring_close();
+		return -1;
+	}
+
+	char *sq = sq_ring;
+	char *cq = cq_ring;
+	sq_tail = (unsigned int *)(sq + p.sq_off.tail);
+	sq_mask = *(unsigned int *)(sq + p.sq_off.ring_mask);
+	sq_array = (unsigned int *)(sq + p.sq_off.array);
+	sq_entries = p.sq_entries;
+	cq_head = (unsigned int *)(cq + p.cq_off.head);
+	cq_tail = (unsigned int *)(cq + p.cq_off.tail);
+	cq_mask = *(unsigned int *)(cq + p.cq_off.ring_mask);
+	cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+	queued = 0;
+
+	char msg[128];
+	snprintf(msg, sizeof(msg), "io_uring ready with %u entries",
+		 sq_entries);
+	log_info(msg);
+	return 0;
+}
+
+/**
+ * uring_close() - Unmap the rings and close the ring descriptor
+ */
+void uring_close(void)
+{
+	if (sqes) {
+		munmap(sqes, sqes_size);
+		sqes = NULL;
+	}
+	if (cq_ring && cq_ring != sq_ring) {
+		munmap(cq_ring, cq_ring_size);
+	}
+	cq_ring = NULL;
+	if (sq_ring) {
+		munmap(sq_ring, sq_ring_size);
+		sq_ring = NULL;
+	}
+	if (ring_fd >= 0) {
+		close(ring_fd);
+		ring_fd = -1;
+	}
+	sq_entries = 0;
+	queued = 0;
+}
+
+/**
+ * uring_active() - Check whether the ring is set up
+ *
+ * Return: true after a successful uring_open()
+ */
+bool uring_active(void)
+{
+	return ring_fd >= 0;
+}
+
+/**
+ * uring_capacity() - Largest number of reads one batch can hold
+ *
+ * Return: Submission queue size, 0 if the ring is not set up
+ */
+unsigned int uring_capacity(void)
+{
+	return sq_entries;
+}
+
+/**
+ * uring_queue_read() - Queue a read from offset 0 of a file
+ * @fd: Descriptor to read
+ * @buf: Destination; must stay valid until the completion is reaped
+ * @len: Bytes to read at most
+ * @tag: Value handed back with the completion
+ *
+ * Return: 0 on success, -1 if uring_capacity() reads are already queued
+ */
+int uring_queue_read(int fd, void *buf, unsigned int len, uint64_t tag)
+{
+	if (queued >= sq_entries) {
+		return -1;
+	}
+
+	// Only this thread writes the tail, so a plain read is enough
+	unsigned int tail = *sq_tail + queued;
+	unsigned int index = tail & sq_mask;
+	struct io_uring_sqe *sqe = &sqes[index];
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_READ;
+	sqe->fd = fd;
+	sqe->addr = (uint64_t)(uintptr_t)buf;
+	sqe->len = len;
+	sqe->off = 0;
+	sqe->user_data = tag;
+	sq_array[index] = index;
+
+	queued++;
+	return 0;
+}
+
+/**
+ * uring_submit_wait() - Submit every queued read and wait for all of them
+ *
+ * Normally one io_uring_enter() both submits and waits; the loop only
+ * repeats if the kernel takes fewer entries than offered or a signal
+ * interrupts the wait. Completions must be reaped with uring_reap()
+ * before the next batch is queued.
+ *
+ * Return: Number of reads submitted, or -1 on error
+ */
+int uring_submit_wait(void)
+{
+	unsigned int total = queued;
+	if (total == 0) {
+		return 0;
+	}
+
+	__atomic_store_n(sq_tail, *sq_tail + total, __ATOMIC_RELEASE);
+	queued = 0;
+
+	unsigned int to_submit = total;
+	for (;;) {
+		unsigned int ready = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE) -
+				     *cq_head;
+		unsigned int wait = ready >= total ? 0 : total - ready;
+
+		if (to_submit == 0 && wait == 0) {
+			break;
+		}
+
+		int ret = (int)syscall(__NR_io_uring_enter, ring_fd, to_submit,
+				       wait, IORING_ENTER_GETEVENTS, NULL, 0);
+		syscount_add(1, 0);
+		if (ret < 0) {
+			if (errno == EINTR || errno == EAGAIN ||
+			    errno == EBUSY) {
+				continue;
+			}
+			log_error("io_uring_enter failed");
+			return -1;
+		}
+		to_submit -= (unsigned int)ret < to_submit ? (unsigned int)ret :
+							     to_submit;
+	}
+
+	return (int)total;
+}
+
+/**
+ * uring_reap() - Hand every available completion to a callback
+ * @fn: Called once per completion
+ * @ctx: Passed to @fn
+ *
+ * Return: Number of completions reaped
+ */
+int uring_reap(UringCompleteFn fn, void *ctx)
+{
+	unsigned int head = *cq_head;
+	unsigned int tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+	int reaped = 0;
+
+	for (; head != tail; head++, reaped++) {
+		const struct io_uring_cqe *cqe = &cqes[head & cq_mask];
+		if (cqe->res > 0) {
+			syscount_add(0, (uint64_t)cqe->res);
+		}
+		fn(ctx, cqe->user_data, cqe->res);
+	}
+
+	__atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+	return reaped;
+}
@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "logger.h"
+#include "view.h"
+
+/**
+ * grow() - Make room for the matches of @rows processes
+ * @v: View
+ * @rows: Rows of the snapshot
+ *
+ * Storage only grows, so steady-state updates do not allocate.
+ *
+ * Return: 0 on success, -1 on allocation failure
+ */
+static int grow(FilterView *v, int rows)
+{
+	if (rows <= v->capacity) {
+		return 0;
+	}
+
+	uint32_t *r = realloc(v->rows, (size_t)rows * sizeof(*r));
+	if (r) {
+		v->rows = r;
+	}
+	uint32_t *o = realloc(v->order, (size_t)rows * sizeof(*o));
+	if (o) {
+		v->order = o;
+	}
+	if (!r || !o) {
+		return -1;
+	}
+	v->capacity = rows;
+	return 0;
+}
+
+/**
+ * view_init() - Initialize an empty view
+ * @v: View to initialize
+ */
+void view_init(FilterView *v)
+{
+	memset(v, 0, sizeof(*v));
+}
+
+/**
+ * view_update() - Find the rows of a snapshot that match a term
+ * @v: View
+ * @t: Snapshot; rows are not moved, so its order may change afterwards
+ * @term: Substring of the process name; "" for no filter
+ *
+ * Does nothing if @t was already matched against @term: a snapshot is
+ * told apart by its table, sample_ns and row count.
+ *
+ * Return: Number of matches (0 without a term), or -1 on allocation
+ * failure, after which the view is empty
+ */
+int view_update(FilterView *v, const ProcessTable *t, const char *term)
+{
+	if (strcmp(term, v->term) != 0) {
+		snprintf(v->term, sizeof(v->term), "%s", term);
+	} else if (v->table == t && v->sample_ns == t->sample_ns &&
+		   v->table_count == t->count) {
+		return v->count;
+	}
+	v->table = t;
+	v->sample_ns = t->sample_ns;
+	v->table_count = t->count;
+	v->count = 0;
+	if (term[0] == '\0') {
+		return 0;
+	}
+
+	if (grow(v, t->count) != 0) {
+		log_error("Failed to allocate the filter view; showing no matches");
+		v->table = NULL;
+		return -1;
+	}
+
+	for (int row = 0; row < t->count; row++) {
+		if (strstr(process_name(t, row), term)) {
+			v->rows[v->count++] = (uint32_t)row;
+		}
+	}
+	return v->count;
+}
+
+/**
+ * view_free() - Release the storage of a view
+ * @v: View
+ */
+void view_free(FilterView *v)
+{
+	free(v->rows);
+	free(v->order);
+	view_init(v);
+}
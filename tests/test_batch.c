@@ -0,0 +1,262 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../src/include/batch.h"
+
+#define TIME_MS 1700000000123u
+
+static char path[] = "/tmp/test_batch_XXXXXX";
+
+static uint32_t append(ProcessTable *t, const char *name)
+{
+	uint32_t off = (uint32_t)t->names_len;
+	size_t len = strlen(name) + 1;
+	memcpy(t->names + off, name, len);
+	t->names_len += len;
+	return off;
+}
+
+static void set_row(ProcessTable *t, int row, int pid, const char *name,
+		    double cpu, uint64_t mem_bytes, double mem, uint8_t flags)
+{
+	t->pid[row] = pid;
+	t->name[row] = append(t, name);
+	t->cpu_percent[row] = cpu;
+	t->mem_bytes[row] = mem_bytes;
+	t->mem_percent[row] = mem;
+	t->flags[row] = flags;
+	t->order[row] = (uint32_t)row;
+	t->count = row + 1;
+}
+
+// Frame with a plain name, one that needs quoting and an unsampled row
+static int make_frame(Frame *f)
+{
+	memset(f, 0, sizeof(*f));
+	if (process_table_init(&f->table, 4) != 0) {
+		return -1;
+	}
+
+	ProcessTable *t = &f->table;
+	t->names_len = 0;
+	append(t, "");
+	set_row(t, 0, 1, "init", 1.5, 4096, 0.25,
+		PROC_CPU_VALID | PROC_MEM_VALID);
+	set_row(t, 1, 42, "a,\"b\"", 12.345, 8192, 0.5,
+		PROC_CPU_VALID | PROC_MEM_VALID | PROC_STALE);
+	set_row(t, 2, 7, "new", 0.0, 0, 0.0, PROC_MEM_VALID);
+
+	f->seq = 3;
+	f->cpu_load = 12.5;
+	f->used_mem_bytes = 1000;
+	return 0;
+}
+
+// Write one frame twice in @format and read back the whole file
+static char *write_frame(BatchFormat format, const Frame *f,
+			 const SelfStats *self, size_t *len)
+{
+	static char buf[4096];
+
+	if (batch_open(path, format) != 0 ||
+	    batch_write(f, TIME_MS, self) != 0 ||
+	    batch_write(f, TIME_MS, self) != 0 || batch_close() != 0) {
+		return NULL;
+	}
+
+	FILE *in = fopen(path, "rb");
+	if (!in) {
+		return NULL;
+	}
+	*len = fread(buf, 1, sizeof(buf) - 1, in);
+	buf[*len] = '\0';
+	fclose(in);
+	return buf;
+}
+
+// Test: CSV has one header and quotes names with commas and quotes
+static int test_csv(const Frame *f)
+{
+	static const char expected[] =
+		"seq,time_ms,pid,name,cpu_percent,mem_bytes,mem_percent,stale\n"
+		"3,1700000000123,1,init,1.50,4096,0.25,0\n"
+		"3,1700000000123,42,\"a,\"\"b\"\"\",12.35,8192,0.50,1\n"
+		"3,1700000000123,7,new,,0,0.00,0\n"
+		"3,1700000000123,1,init,1.50,4096,0.25,0\n"
+		"3,1700000000123,42,\"a,\"\"b\"\"\",12.35,8192,0.50,1\n"
+		"3,1700000000123,7,new,,0,0.00,0\n";
+
+	size_t len;
+	const char *out = write_frame(BATCH_CSV, f, NULL, &len);
+	if (!out || strcmp(out, expected) != 0) {
+		fprintf(stderr, "FAIL: csv - got:\n%s", out ? out : "(error)\n");
+		return 1;
+	}
+
+	printf("PASS: csv\n");
+	return 0;
+}
+
+// Test: JSON Lines writes one escaped object per tick
+static int test_json(const Frame *f)
+{
+	static const char line[] =
+		"{\"seq\":3,\"time_ms\":1700000000123,\"cpu_load\":12.50,"
+		"\"used_mem_bytes\":1000,\"processes\":["
+		"{\"pid\":1,\"name\":\"init\",\"cpu\":1.50,\"mem_bytes\":4096,"
+		"\"mem\":0.25,\"stale\":false},"
+		"{\"pid\":42,\"name\":\"a,\\\"b\\\"\",\"cpu\":12.35,"
+		"\"mem_bytes\":8192,\"mem\":0.50,\"stale\":true},"
+		"{\"pid\":7,\"name\":\"new\",\"cpu\":null,\"mem_bytes\":0,"
+		"\"mem\":0.00,\"stale\":false}]}\n";
+
+	char expected[2 * sizeof(line)];
+	snprintf(expected, sizeof(expected), "%s%s", line, line);
+
+	size_t len;
+	const char *out = write_frame(BATCH_JSON, f, NULL, &len);
+	if (!out || strcmp(out, expected) != 0) {
+		fprintf(stderr, "FAIL: json - got:\n%s", out ? out : "(error)\n");
+		return 1;
+	}
+
+	printf("PASS: json\n");
+	return 0;
+}
+
+// Test: the monitor's own cost goes before the processes, phases that
+// never ran are left out, and CSV ignores it
+static int test_json_self(const Frame *f)
+{
+	SelfStats self = {
+		.cpu_percent = 1.25,
+		.rss_bytes = 3 << 20,
+		.proc_syscalls = 40,
+		.proc_bytes = 12000,
+		.log_dropped = 2,
+	};
+	self.samples[PHASE_COLLECT] = 64;
+	self.p50_ns[PHASE_COLLECT] = 850000;
+	self.p99_ns[PHASE_COLLECT] = 1300500;
+	self.samples[PHASE_RENDER] = 3;
+	self.p50_ns[PHASE_RENDER] = 90000;
+	self.p99_ns[PHASE_RENDER] = 120000;
+
+	static const char self_field[] =
+		"\"used_mem_bytes\":1000,\"self\":{\"cpu\":1.25,"
+		"\"rss_bytes\":3145728,\"proc_syscalls\":40,"
+		"\"proc_bytes\":12000,\"log_dropped\":2,\"phases\":{"
+		"\"collect\":{\"p50_us\":850,\"p99_us\":1300},"
+		"\"render\":{\"p50_us\":90,\"p99_us\":120}}},"
+		"\"processes\":[{\"pid\":1,";
+
+	size_t len;
+	const char *out = write_frame(BATCH_JSON, f, &self, &len);
+	const char *first = out ? strstr(out, self_field) : NULL;
+	if (!first || !strstr(first + 1, self_field)) {
+		fprintf(stderr, "FAIL: json self - got:\n%s",
+			out ? out : "(error)\n");
+		return 1;
+	}
+
+	out = write_frame(BATCH_CSV, f, &self, &len);
+	if (!out || strstr(out, "self") || strstr(out, "1.25")) {
+		fprintf(stderr, "FAIL: json self - CSV changed\n");
+		return 1;
+	}
+
+	printf("PASS: json self\n");
+	return 0;
+}
+
+// Test: binary records are length-prefixed and decode to the same rows
+static int test_binary(const Frame *f)
+{
+	size_t len;
+	const char *out = write_frame(BATCH_BINARY, f, NULL, &len);
+	if (!out) {
+		fprintf(stderr, "FAIL: binary - write failed\n");
+		return 1;
+	}
+
+	int records = 0;
+	int failed = 0;
+	size_t pos = 0;
+	while (pos + 4 <= len && !failed) {
+		uint32_t length, magic, count;
+		uint64_t seq, time_ms;
+		memcpy(&length, out + pos, 4);
+		const char *r = out + pos + 4;
+		memcpy(&magic, r, 4);
+		memcpy(&seq, r + 4, 8);
+		memcpy(&time_ms, r + 12, 8);
+		memcpy(&count, r + 32, 4);
+		failed |= magic != BATCH_MAGIC || seq != 3 ||
+			  time_ms != TIME_MS || count != 3;
+
+		const char *e = r + 36;
+		for (uint32_t i = 0; i < count && !failed; i++) {
+			int32_t pid;
+			float cpu;
+			memcpy(&pid, e, 4);
+			memcpy(&cpu, e + 8, 4);
+			uint8_t name_len = (uint8_t)e[5];
+			const char *name = process_name(&f->table, (int)i);
+			failed |= pid != f->table.pid[i] ||
+				  (uint8_t)e[4] != f->table.flags[i] ||
+				  name_len != strlen(name) ||
+				  memcmp(e + 24, name, name_len) != 0 ||
+				  (float)f->table.cpu_percent[i] != cpu;
+			e += 24 + name_len;
+		}
+		failed |= (size_t)(e - r) != length;
+		pos += 4 + length;
+		records++;
+	}
+
+	if (failed || records != 2 || pos != len) {
+		fprintf(stderr, "FAIL: binary - records do not decode\n");
+		return 1;
+	}
+
+	printf("PASS: binary\n");
+	return 0;
+}
+
+int main(void)
+{
+	int failures = 0;
+
+	printf("Running unit tests for batch output...\n");
+
+	int fd = mkstemp(path);
+	if (fd < 0) {
+		fprintf(stderr, "FAIL: cannot create temporary file\n");
+		return 1;
+	}
+	close(fd);
+
+	Frame f;
+	if (make_frame(&f) != 0) {
+		fprintf(stderr, "FAIL: out of memory\n");
+		unlink(path);
+		return 1;
+	}
+
+	failures += test_csv(&f);
+	failures += test_json(&f);
+	failures += test_json_self(&f);
+	failures += test_binary(&f);
+
+	process_table_free(&f.table);
+	unlink(path);
+
+	if (failures == 0) {
+		printf("All batch output tests passed.\n");
+		return 0;
+	} else {
+		fprintf(stderr, "%d test(s) failed.\n", failures);
+		return 1;
+	}
+}
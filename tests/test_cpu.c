@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/include/cpu.h"
+
+static const char *sample_stat =
+	"cpu  1000 20 300 5000 40 5 6 7 80 9\n"
+	"cpu0 600 10 200 2000 20 3 4 5 80 9\n"
+	"cpu1 400 10 100 3000 20 2 2 2 0 0\n"
+	"intr 123456 0 9 0 0 0 0 0 0 1 0 0 0 0 0 0 0\n"
+	"ctxt 987654\n"
+	"btime 1700000000\n"
+	"processes 4321\n"
+	"procs_running 3\n"
+	"procs_blocked 1\n"
+	"softirq 5555 0 1 2 3 4 5 6 7 8 9\n";
+
+// Test: one pass fills the aggregate, per-core and kernel counters
+static int test_parse_all(void)
+{
+	CpuStat st = {0};
+	int failed = 0;
+
+	if (cpu_stat_parse(sample_stat, strlen(sample_stat), &st) != 0) {
+		fprintf(stderr, "FAIL: parse_all - rejected\n");
+		return 1;
+	}
+
+	if (st.total.user != 1000 || st.total.steal != 7 ||
+	    st.total.guest != 80 || st.total.guest_nice != 9 ||
+	    st.core_count != 2 || st.cores[0].user != 600 ||
+	    st.cores[1].idle != 3000 || st.cores[0].guest != 80) {
+		fprintf(stderr, "FAIL: parse_all - wrong cpu counters\n");
+		failed = 1;
+	} else if (st.intr != 123456 || st.ctxt != 987654 ||
+		   st.processes != 4321 || st.procs_running != 3 ||
+		   st.procs_blocked != 1) {
+		fprintf(stderr, "FAIL: parse_all - wrong kernel counters\n");
+		failed = 1;
+	} else if (cpu_times_total(&st.total) != 6378 ||
+		   cpu_times_active(&st.total) != 1338) {
+		// Guest time is part of user/nice and must not count twice
+		fprintf(stderr, "FAIL: parse_all - wrong totals\n");
+		failed = 1;
+	}
+
+	cpu_stat_free(&st);
+	if (!failed) {
+		printf("PASS: parse_all\n");
+	}
+	return failed;
+}
+
+// Test: short lines from older kernels and gaps in core numbering
+static int test_old_kernel_and_gaps(void)
+{
+	const char *stat =
+		"cpu  10 0 10 80\n"
+		"cpu0 10 0 10 80\n"
+		"cpu37 1 2 3 4 5\n";
+	CpuStat st = {0};
+	int failed = 0;
+
+	if (cpu_stat_parse(stat, strlen(stat), &st) != 0 ||
+	    st.total.iowait != 0 || st.total.guest != 0 ||
+	    st.core_count != 38 || st.cores[5].user != 0 ||
+	    st.cores[37].iowait != 5) {
+		fprintf(stderr, "FAIL: old_kernel_and_gaps\n");
+		failed = 1;
+	}
+
+	// The core array is reused and shrinks to what the file lists
+	const char *fewer = "cpu  1 1 1 1\ncpu0 1 1 1 1\n";
+	if (!failed && (cpu_stat_parse(fewer, strlen(fewer), &st) != 0 ||
+			st.core_count != 1)) {
+		fprintf(stderr, "FAIL: old_kernel_and_gaps - reparse\n");
+		failed = 1;
+	}
+
+	cpu_stat_free(&st);
+	if (!failed) {
+		printf("PASS: old_kernel_and_gaps\n");
+	}
+	return failed;
+}
+
+// Test: load is the active share of elapsed time
+static int test_load(void)
+{
+	CpuTimes prev = {.user = 100, .system = 100, .idle = 800};
+	CpuTimes curr = {.user = 130, .system = 120, .idle = 850};
+
+	if (cpu_times_load(&prev, &curr) != 50.0 ||
+	    cpu_times_load(&prev, &prev) != 0.0 ||
+	    cpu_times_load(&curr, &prev) != 0.0) {
+		fprintf(stderr, "FAIL: load\n");
+		return 1;
+	}
+
+	printf("PASS: load\n");
+	return 0;
+}
+
+// Test: the real /proc/stat parses
+static int test_read_proc(void)
+{
+	CpuStat st = {0};
+	int failed = cpu_stat_read(&st) != 0 || st.core_count < 1 ||
+		     cpu_times_total(&st.total) == 0 || st.processes == 0;
+
+	cpu_stat_free(&st);
+	cpu_stat_close();
+	if (failed) {
+		fprintf(stderr, "FAIL: read_proc\n");
+		return 1;
+	}
+
+	printf("PASS: read_proc\n");
+	return 0;
+}
+
+int main(void)
+{
+	int failures = 0;
+
+	printf("Running unit tests for /proc/stat parsing...\n");
+
+	failures += test_parse_all();
+	failures += test_old_kernel_and_gaps();
+	failures += test_load();
+	failures += test_read_proc();
+
+	if (failures == 0) {
+		printf("All /proc/stat tests passed.\n");
+		return 0;
+	} else {
+		fprintf(stderr, "%d test(s) failed.\n", failures);
+		return 1;
+	}
+}
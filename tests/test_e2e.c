@@ -0,0 +1,843 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <pty.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+
+/*
+ * End-to-end test of the UI: runs ProcessBrowser on a pseudo-terminal
+ * next to thousands of children that wake up and spin now and then,
+ * sends keys and follows what reaches the terminal with a small VT100/
+ * xterm emulator. It measures how long each key takes to show up on the
+ * screen and how regularly frames arrive, and reads the UI's own render
+ * percentiles from the debug overlay. Any of them above the limit fails,
+ * as does an overlay line left on screen once the overlay is off.
+ */
+
+#define ROWS 50
+#define COLS 132
+#define MAX_PARAMS 16
+#define MAX_SAMPLES 4096
+#define SPIN_NAME "e2espin"
+
+// Output separated by this much silence starts a new frame
+#define FRAME_GAP_MS 5.0
+
+static struct {
+	char cell[ROWS][COLS];
+	int row, col;
+	int top, bottom;       // scrolling region
+	int saved_row, saved_col;
+	bool wrap_pending;
+	char last;             // last printed character, for REP
+	// Parser
+	enum { GROUND, ESC, CSI, CHARSET, OSC, OSC_ESC } state;
+	int params[MAX_PARAMS];
+	int nparams;
+	bool private_mode;
+} term;
+
+static int master_fd = -1;
+static pid_t ui_pid = -1;
+static pid_t *children;
+static int child_count;
+
+// Start times of frames, in ms since the start of the test
+static double frames[MAX_SAMPLES];
+static int frame_count;
+static double last_output_ms = -1e9;
+
+static double now_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static void clear_cells(int row, int from, int to)
+{
+	if (from < to) {
+		memset(&term.cell[row][from], ' ', (size_t)(to - from));
+	}
+}
+
+// Move the lines of the scrolling region up (n > 0) or down (n < 0)
+static void scroll_region(int top, int n)
+{
+	int height = term.bottom - top + 1;
+	int count = n > 0 ? n : -n;
+	if (count > height) {
+		count = height;
+	}
+	size_t keep = (size_t)(height - count) * COLS;
+	if (n > 0) {
+		memmove(term.cell[top], term.cell[top + count], keep);
+		for (int r = term.bottom - count + 1; r <= term.bottom; r++) {
+			clear_cells(r, 0, COLS);
+		}
+	} else {
+		memmove(term.cell[top + count], term.cell[top], keep);
+		for (int r = top; r < top + count; r++) {
+			clear_cells(r, 0, COLS);
+		}
+	}
+}
+
+static void line_feed(void)
+{
+	term.wrap_pending = false;
+	if (term.row == term.bottom) {
+		scroll_region(term.top, 1);
+	} else if (term.row < ROWS - 1) {
+		term.row++;
+	}
+}
+
+static void put_char(char ch)
+{
+	if (term.wrap_pending) {
+		term.col = 0;
+		line_feed();
+	}
+	term.cell[term.row][term.col] = ch;
+	term.last = ch;
+	if (term.col == COLS - 1) {
+		term.wrap_pending = true;
+	} else {
+		term.col++;
+	}
+}
+
+static int clamp(int v, int lo, int hi)
+{
+	return v < lo ? lo : v > hi ? hi : v;
+}
+
+static void reset_term(void)
+{
+	for (int r = 0; r < ROWS; r++) {
+		clear_cells(r, 0, COLS);
+	}
+	term.row = term.col = 0;
+	term.top = 0;
+	term.bottom = ROWS - 1;
+	term.wrap_pending = false;
+	term.state = GROUND;
+}
+
+static void csi_dispatch(char final)
+{
+	int p0 = term.nparams > 0 ? term.params[0] : 0;
+	int p1 = term.nparams > 1 ? term.params[1] : 0;
+	int n = p0 > 0 ? p0 : 1;
+
+	if (term.private_mode) {
+		// Only the alternate screen matters: it starts out blank
+		if (p0 == 1049 && (final == 'h' || final == 'l')) {
+			reset_term();
+		}
+		return;
+	}
+
+	term.wrap_pending = false;
+	switch (final) {
+	case 'A':
+		term.row = clamp(term.row - n, 0, ROWS - 1);
+		break;
+	case 'B':
+		term.row = clamp(term.row + n, 0, ROWS - 1);
+		break;
+	case 'C':
+		term.col = clamp(term.col + n, 0, COLS - 1);
+		break;
+	case 'D':
+		term.col = clamp(term.col - n, 0, COLS - 1);
+		break;
+	case 'E':
+		term.row = clamp(term.row + n, 0, ROWS - 1);
+		term.col = 0;
+		break;
+	case 'F':
+		term.row = clamp(term.row - n, 0, ROWS - 1);
+		term.col = 0;
+		break;
+	case 'G':
+	case '`':
+		term.col = clamp(n - 1, 0, COLS - 1);
+		break;
+	case 'd':
+		term.row = clamp(n - 1, 0, ROWS - 1);
+		break;
+	case 'H':
+	case 'f':
+		term.row = clamp((p0 > 0 ? p0 : 1) - 1, 0, ROWS - 1);
+		term.col = clamp((p1 > 0 ? p1 : 1) - 1, 0, COLS - 1);
+		break;
+	case 'J':
+		if (p0 == 0) {
+			clear_cells(term.row, term.col, COLS);
+			for (int r = term.row + 1; r < ROWS; r++) {
+				clear_cells(r, 0, COLS);
+			}
+		} else if (p0 == 1) {
+			for (int r = 0; r < term.row; r++) {
+				clear_cells(r, 0, COLS);
+			}
+			clear_cells(term.row, 0, term.col + 1);
+		} else {
+			for (int r = 0; r < ROWS; r++) {
+				clear_cells(r, 0, COLS);
+			}
+		}
+		break;
+	case 'K':
+		if (p0 == 0) {
+			clear_cells(term.row, term.col, COLS);
+		} else if (p0 == 1) {
+			clear_cells(term.row, 0, term.col + 1);
+		} else {
+			clear_cells(term.row, 0, COLS);
+		}
+		break;
+	case 'L':
+	case 'M':
+		if (term.row >= term.top && term.row <= term.bottom) {
+			scroll_region(term.row, final == 'M' ? n : -n);
+		}
+		break;
+	case 'P': {
+		n = clamp(n, 0, COLS - term.col);
+		char *line = term.cell[term.row];
+		memmove(line + term.col, line + term.col + n,
+			(size_t)(COLS - term.col - n));
+		clear_cells(term.row, COLS - n, COLS);
+		break;
+	}
+	case '@': {
+		n = clamp(n, 0, COLS - term.col);
+		char *line = term.cell[term.row];
+		memmove(line + term.col + n, line + term.col,
+			(size_t)(COLS - term.col - n));
+		clear_cells(term.row, term.col, term.col + n);
+		break;
+	}
+	case 'X':
+		clear_cells(term.row, term.col, clamp(term.col + n, 0, COLS));
+		break;
+	case 'S':
+		scroll_region(term.top, n);
+		break;
+	case 'T':
+		scroll_region(term.top, -n);
+		break;
+	case 'b':
+		for (int i = 0; i < n; i++) {
+			put_char(term.last);
+		}
+		break;
+	case 'r':
+		term.top = clamp((p0 > 0 ? p0 : 1) - 1, 0, ROWS - 1);
+		term.bottom = clamp((p1 > 0 ? p1 : ROWS) - 1, term.top, ROWS - 1);
+		term.row = term.col = 0;
+		break;
+	default:
+		// Attributes, modes and reports do not change the text
+		break;
+	}
+}
+
+/**
+ * term_feed() - Apply terminal output to the emulated screen
+ * @buf: Bytes written by the UI
+ * @len: Length of @buf
+ */
+static void term_feed(const char *buf, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		char ch = buf[i];
+
+		switch (term.state) {
+		case GROUND:
+			if (ch == '\033') {
+				term.state = ESC;
+			} else if (ch == '\r') {
+				term.col = 0;
+				term.wrap_pending = false;
+			} else if (ch == '\n' || ch == '\v' || ch == '\f') {
+				line_feed();
+			} else if (ch == '\b') {
+				if (term.col > 0) {
+					term.col--;
+				}
+				term.wrap_pending = false;
+			} else if (ch == '\t') {
+				term.col = clamp((term.col / 8 + 1) * 8, 0, COLS - 1);
+			} else if ((unsigned char)ch >= ' ' && ch != 0x7f) {
+				put_char(ch);
+			}
+			break;
+		case ESC:
+			term.state = GROUND;
+			if (ch == '[') {
+				term.state = CSI;
+				term.nparams = 0;
+				term.params[0] = 0;
+				term.private_mode = false;
+			} else if (ch == ']') {
+				term.state = OSC;
+			} else if (ch == '(' || ch == ')' || ch == '*' || ch == '+') {
+				term.state = CHARSET;
+			} else if (ch == 'M') {
+				term.wrap_pending = false;
+				if (term.row == term.top) {
+					scroll_region(term.top, -1);
+				} else if (term.row > 0) {
+					term.row--;
+				}
+			} else if (ch == 'D') {
+				line_feed();
+			} else if (ch == 'E') {
+				term.col = 0;
+				line_feed();
+			} else if (ch == '7') {
+				term.saved_row = term.row;
+				term.saved_col = term.col;
+			} else if (ch == '8') {
+				term.row = term.saved_row;
+				term.col = term.saved_col;
+				term.wrap_pending = false;
+			} else if (ch == 'c') {
+				reset_term();
+			}
+			break;
+		case CSI:
+			if (ch >= '0' && ch <= '9') {
+				if (term.nparams == 0) {
+					term.nparams = 1;
+				}
+				int *p = &term.params[term.nparams - 1];
+				*p = *p * 10 + (ch - '0');
+			} else if (ch == ';') {
+				if (term.nparams == 0) {
+					term.nparams = 1;
+				}
+				if (term.nparams < MAX_PARAMS) {
+					term.params[term.nparams++] = 0;
+				}
+			} else if (ch == '?' || ch == '>' || ch == '=' || ch == '<') {
+				term.private_mode = true;
+			} else if (ch >= 0x40 && ch <= 0x7e) {
+				csi_dispatch(ch);
+				term.state = GROUND;
+			}
+			break;
+		case CHARSET:
+			term.state = GROUND;
+			break;
+		case OSC:
+			if (ch == '\a') {
+				term.state = GROUND;
+			} else if (ch == '\033') {
+				term.state = OSC_ESC;
+			}
+			break;
+		case OSC_ESC:
+			term.state = ch == '\\' ? GROUND : OSC;
+			break;
+		}
+	}
+}
+
+/**
+ * screen_line() - Text of one emulated screen line
+ * @row: Line, negative counts from the bottom
+ *
+ * Return: NUL-terminated copy in a static buffer
+ */
+static const char *screen_line(int row)
+{
+	static char text[COLS + 1];
+
+	if (row < 0) {
+		row += ROWS;
+	}
+	memcpy(text, term.cell[row], COLS);
+	text[COLS] = '\0';
+	return text;
+}
+
+static bool line_has(int row, const char *needle)
+{
+	return strstr(screen_line(row), needle) != NULL;
+}
+
+/**
+ * pump() - Read what the UI writes until @done holds or time runs out
+ * @done: Condition on the emulated screen, NULL to just read
+ * @arg: Passed to @done
+ * @timeout_ms: Longest wait
+ *
+ * Return: Milliseconds until @done held, or -1 on timeout or EOF
+ */
+static double pump(bool (*done)(const void *), const void *arg,
+		   double timeout_ms)
+{
+	double start = now_ms();
+	char buf[65536];
+
+	for (;;) {
+		if (done && done(arg)) {
+			return now_ms() - start;
+		}
+		double left = timeout_ms - (now_ms() - start);
+		if (left <= 0) {
+			return -1;
+		}
+
+		struct pollfd pfd = { .fd = master_fd, .events = POLLIN };
+		int ready = poll(&pfd, 1, (int)left + 1);
+		if (ready < 0 && errno != EINTR) {
+			return -1;
+		}
+		if (ready <= 0) {
+			continue;
+		}
+		ssize_t n = read(master_fd, buf, sizeof(buf));
+		if (n <= 0) {
+			return -1;
+		}
+
+		double t = now_ms();
+		if (t - last_output_ms >= FRAME_GAP_MS &&
+		    frame_count < MAX_SAMPLES) {
+			frames[frame_count++] = t;
+		}
+		last_output_ms = t;
+		term_feed(buf, (size_t)n);
+	}
+}
+
+static bool sort_shows(const void *arg)
+{
+	return strncmp(screen_line(5) + 6, arg, 3) == 0;
+}
+
+static bool status_has(const void *arg)
+{
+	return line_has(-1, arg);
+}
+
+// The first process row is one of the spinning children
+static bool filtered(const void *arg)
+{
+	return line_has(-1, "Filter: '" SPIN_NAME "'") &&
+	       strncmp(screen_line(9) + 9, arg, strlen(arg)) == 0;
+}
+
+static bool first_frame(const void *arg __attribute__((unused)))
+{
+	return line_has(0, "Process Monitor") && line_has(7, "PID") &&
+	       line_has(-1, "q:Quit");
+}
+
+static bool overlay_has_render(const void *arg __attribute__((unused)))
+{
+	for (int row = ROWS - 4; row < ROWS - 1; row++) {
+		const char *render = strstr(screen_line(row), "render ");
+		if (render && render[7] >= '0' && render[7] <= '9') {
+			return true;
+		}
+	}
+	return false;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile; sorts @v
+static double percentile(double *v, int n, double p)
+{
+	if (n == 0) {
+		return 0.0;
+	}
+	qsort(v, (size_t)n, sizeof(*v), compare_double);
+	int rank = (int)(p / 100.0 * n + 0.999999);
+	return v[clamp(rank, 1, n) - 1];
+}
+
+// The overlay is gone, and the line between table and status bar is blank
+static bool overlay_cleared(const void *arg __attribute__((unused)))
+{
+	for (int row = ROWS - 4; row < ROWS - 1; row++) {
+		if (line_has(row, "Self:") || line_has(row, "render ")) {
+			return false;
+		}
+	}
+	return strspn(screen_line(ROWS - 2), " ") == COLS;
+}
+
+static int send_key(const char *key)
+{
+	size_t len = strlen(key);
+	return write(master_fd, key, len) == (ssize_t)len ? 0 : -1;
+}
+
+/**
+ * key_latency() - Send a key and time it until its effect is on screen
+ * @key: Bytes the terminal sends for the key
+ * @done: Condition that shows the key was handled
+ * @arg: Passed to @done
+ * @limit_ms: Longest acceptable latency
+ * @out: Latency in ms
+ *
+ * Return: 0 on success, -1 if the effect never showed up
+ */
+static int key_latency(const char *key, bool (*done)(const void *),
+		       const void *arg, double limit_ms, double *out)
+{
+	// Before write(): on a busy CPU the UI may draw before it returns
+	double start = now_ms();
+	if (send_key(key) != 0) {
+		return -1;
+	}
+	// Allow much more than the limit so slow frames are measured, not lost
+	if (pump(done, arg, limit_ms * 10 + 2000) < 0) {
+		return -1;
+	}
+	*out = now_ms() - start;
+	return 0;
+}
+
+static int report(const char *what, double *v, int n, double limit_ms)
+{
+	double max = n ? percentile(v, n, 100) : 0.0;
+	double p50 = percentile(v, n, 50);
+	double p99 = percentile(v, n, 99);
+
+	if (n == 0 || p99 > limit_ms) {
+		fprintf(stderr, "FAIL: %s - %d samples, p50 %.1f ms, p99 %.1f ms "
+			"(limit %.0f ms)\n", what, n, p50, p99, limit_ms);
+		return 1;
+	}
+	printf("PASS: %s (%d samples, p50 %.1f ms, p99 %.1f ms, max %.1f ms)\n",
+	       what, n, p50, p99, max);
+	return 0;
+}
+
+// Test: sorting keys redraw the header at once
+static int test_sort_keys(double limit_ms)
+{
+	double lat[40];
+	int n = 0;
+
+	for (int i = 0; i < 20; i++) {
+		if (key_latency("m", sort_shows, "MEM", limit_ms, &lat[n]) != 0 ||
+		    key_latency("c", sort_shows, "CPU", limit_ms, &lat[n + 1]) != 0) {
+			fprintf(stderr, "FAIL: sort keys - no redraw after %d keys\n",
+				n);
+			return 1;
+		}
+		n += 2;
+	}
+	return report("sort keys 'm'/'c'", lat, n, limit_ms);
+}
+
+// Test: PgDn scrolls by ten rows, PgUp back
+static int test_page_keys(double limit_ms)
+{
+	double lat[40];
+	int n = 0;
+	char offset[32];
+
+	for (int i = 1; i <= 10; i++) {
+		snprintf(offset, sizeof(offset), "Offset:%d ", i * 10);
+		if (key_latency("\033[6~", status_has, offset, limit_ms,
+				&lat[n++]) != 0) {
+			fprintf(stderr, "FAIL: page keys - no %s\n", offset);
+			return 1;
+		}
+	}
+	for (int i = 9; i >= 0; i--) {
+		snprintf(offset, sizeof(offset), "Offset:%d ", i * 10);
+		if (key_latency("\033[5~", status_has, offset, limit_ms,
+				&lat[n++]) != 0) {
+			fprintf(stderr, "FAIL: page keys - no %s\n", offset);
+			return 1;
+		}
+	}
+	return report("page keys PgDn/PgUp", lat, n, limit_ms);
+}
+
+// Test: 'f' opens the prompt, Enter filters to the spinning children
+static int test_search(double limit_ms)
+{
+	double lat[30];
+	int n = 0;
+
+	for (int i = 0; i < 10; i++) {
+		if (key_latency("f", status_has, "Search: ", limit_ms,
+				&lat[n++]) != 0) {
+			fprintf(stderr, "FAIL: search - no prompt\n");
+			return 1;
+		}
+		if (key_latency(SPIN_NAME, status_has, "Search: " SPIN_NAME,
+				limit_ms, &lat[n++]) != 0) {
+			fprintf(stderr, "FAIL: search - term not echoed\n");
+			return 1;
+		}
+		if (key_latency("\r", filtered, SPIN_NAME, limit_ms,
+				&lat[n++]) != 0) {
+			fprintf(stderr, "FAIL: search - table not filtered:\n%s\n",
+				screen_line(9));
+			return 1;
+		}
+		// ESC clears the filter again
+		double cleared;
+		if (key_latency("\033", status_has, "q:Quit", limit_ms,
+				&cleared) != 0) {
+			fprintf(stderr, "FAIL: search - filter not cleared\n");
+			return 1;
+		}
+	}
+	return report("search 'f', term, Enter", lat, n, limit_ms);
+}
+
+// Test: frames keep coming at the sampling interval
+static int test_frame_interval(int interval_ms, double limit_ms)
+{
+	frame_count = 0;
+	pump(NULL, NULL, 3000);
+
+	double gaps[MAX_SAMPLES];
+	int n = 0;
+	for (int i = 1; i < frame_count; i++) {
+		gaps[n++] = frames[i] - frames[i - 1];
+	}
+	return report("frame interval", gaps, n, interval_ms + limit_ms);
+}
+
+// Test: the debug overlay reports the UI's own render time
+static int test_render_time(double limit_ms)
+{
+	double lat;
+	if (key_latency("d", overlay_has_render, NULL, limit_ms, &lat) != 0) {
+		fprintf(stderr, "FAIL: render time - no overlay\n");
+		return 1;
+	}
+	// Let the percentiles fill with frames drawn under the overlay
+	pump(NULL, NULL, 2000);
+
+	unsigned long p50 = 0, p99 = 0;
+	const char *render = NULL;
+	for (int row = ROWS - 4; row < ROWS - 1 && !render; row++) {
+		render = strstr(screen_line(row), "render ");
+	}
+	if (!render || sscanf(render, "render %lu/%lu", &p50, &p99) != 2 ||
+	    p99 / 1000.0 > limit_ms) {
+		fprintf(stderr, "FAIL: render time - '%s'\n",
+			render ? render : "missing");
+		return 1;
+	}
+	if (key_latency("d", overlay_cleared, NULL, limit_ms, &lat) != 0) {
+		fprintf(stderr, "FAIL: render time - overlay left '%s'\n",
+			screen_line(ROWS - 2));
+		return 1;
+	}
+	printf("PASS: render time (p50 %.2f ms, p99 %.2f ms)\n", p50 / 1000.0,
+	       p99 / 1000.0);
+	return 0;
+}
+
+// Child that sleeps and spins in turns, like a busy service
+static void spin_child(unsigned int seed)
+{
+	prctl(PR_SET_PDEATHSIG, SIGKILL);
+	prctl(PR_SET_NAME, SPIN_NAME);
+	for (;;) {
+		struct timespec nap = {
+			.tv_nsec = (long)(100 + rand_r(&seed) % 200) * 1000000,
+		};
+		nanosleep(&nap, NULL);
+		double until = now_ms() + 0.05;
+		while (now_ms() < until) {
+			// spin
+		}
+	}
+}
+
+static int start_children(int count)
+{
+	children = calloc((size_t)count, sizeof(*children));
+	if (!children) {
+		return -1;
+	}
+	for (int i = 0; i < count; i++) {
+		pid_t pid = fork();
+		if (pid < 0) {
+			return -1;
+		}
+		if (pid == 0) {
+			spin_child((unsigned int)i);
+			_exit(0);
+		}
+		children[child_count++] = pid;
+	}
+	return 0;
+}
+
+static void stop_children(void)
+{
+	for (int i = 0; i < child_count; i++) {
+		kill(children[i], SIGKILL);
+	}
+	for (int i = 0; i < child_count; i++) {
+		waitpid(children[i], NULL, 0);
+	}
+	free(children);
+}
+
+static int start_ui(const char *path, int interval_ms)
+{
+	struct winsize ws = { .ws_row = ROWS, .ws_col = COLS };
+	char interval[16];
+
+	snprintf(interval, sizeof(interval), "%d", interval_ms);
+	ui_pid = forkpty(&master_fd, NULL, NULL, &ws);
+	if (ui_pid < 0) {
+		return -1;
+	}
+	if (ui_pid == 0) {
+		setenv("TERM", "xterm", 1);
+		setenv("LANG", "C", 1);
+		unsetenv("LINES");
+		unsetenv("COLUMNS");
+		// Lone ESC clears the filter; don't wait for a sequence
+		setenv("ESCDELAY", "10", 1);
+		execl(path, path, "--interval", interval, (char *)NULL);
+		_exit(127);
+	}
+	reset_term();
+	return 0;
+}
+
+// Quit with 'q'; returns the exit status, or -1 if the UI hung
+static int stop_ui(void)
+{
+	int status;
+
+	send_key("q");
+	for (int i = 0; i < 200; i++) {
+		// Returns at once when the terminal is closed
+		if (pump(NULL, NULL, 10) < 0) {
+			usleep(10000);
+		}
+		if (waitpid(ui_pid, &status, WNOHANG) == ui_pid) {
+			close(master_fd);
+			return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+		}
+	}
+	kill(ui_pid, SIGKILL);
+	waitpid(ui_pid, &status, 0);
+	close(master_fd);
+	return -1;
+}
+
+static void print_usage(FILE *out, const char *prog)
+{
+	fprintf(out,
+		"Usage: %s [-n CHILDREN] [-l LIMIT_MS] [-i INTERVAL_MS] PROGRAM\n"
+		"Drive PROGRAM on a pseudo-terminal and time its UI.\n"
+		"\n"
+		"  -n CHILDREN     spinning children to start (default 2000)\n"
+		"  -l LIMIT_MS     highest p99 key-to-frame latency (default 250)\n"
+		"  -i INTERVAL_MS  sampling interval of PROGRAM (default 250)\n",
+		prog);
+}
+
+int main(int argc, char **argv)
+{
+	int count = 2000, interval_ms = 250;
+	double limit_ms = 250.0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:l:i:h")) != -1) {
+		switch (opt) {
+		case 'n':
+			count = atoi(optarg);
+			break;
+		case 'l':
+			limit_ms = atof(optarg);
+			break;
+		case 'i':
+			interval_ms = atoi(optarg);
+			break;
+		case 'h':
+			print_usage(stdout, argv[0]);
+			return 0;
+		default:
+			print_usage(stderr, argv[0]);
+			return 2;
+		}
+	}
+	if (optind != argc - 1 || count < 1 || limit_ms <= 0 || interval_ms < 100) {
+		print_usage(stderr, argv[0]);
+		return 2;
+	}
+
+	printf("Running end-to-end UI tests with %d spinning children...\n",
+	       count);
+	signal(SIGPIPE, SIG_IGN);
+	if (start_children(count) != 0) {
+		fprintf(stderr, "FAIL: cannot start children\n");
+		stop_children();
+		return 1;
+	}
+	if (start_ui(argv[optind], interval_ms) != 0) {
+		fprintf(stderr, "FAIL: cannot start %s\n", argv[optind]);
+		stop_children();
+		return 1;
+	}
+
+	int failures = 0;
+	double startup = pump(first_frame, NULL, 10000);
+	if (startup < 0) {
+		fprintf(stderr, "FAIL: no first frame; screen:\n%s\n",
+			screen_line(0));
+		failures++;
+	} else {
+		printf("PASS: first frame (%.1f ms)\n", startup);
+		failures += test_sort_keys(limit_ms);
+		failures += test_page_keys(limit_ms);
+		failures += test_search(limit_ms);
+		failures += test_frame_interval(interval_ms, limit_ms);
+		failures += test_render_time(limit_ms);
+	}
+
+	int status = stop_ui();
+	if (status != 0) {
+		fprintf(stderr, "FAIL: exit status %d\n", status);
+		failures++;
+	}
+	stop_children();
+
+	if (failures == 0) {
+		printf("All end-to-end tests passed.\n");
+		return 0;
+	} else {
+		fprintf(stderr, "%d test(s) failed.\n", failures);
+		return 1;
+	}
+}
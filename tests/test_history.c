@@ -0,0 +1,389 @@
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../src/include/history.h"
+
+#define ROWS 500
+#define TICKS 300
+#define TIME_MS 1700000000000ull // 2023-11-14 22:13:20 UTC
+#define MS_PER_DAY (24ull * 60 * 60 * 1000)
+
+static char dir[] = "/tmp/test_history_XXXXXX";
+static Frame frame;
+
+// Every non-stale row appended, in order
+static struct {
+	uint64_t *time_ms;
+	int32_t *pid;
+	uint32_t *cpu;
+	uint64_t *rss;
+	int count;
+} expect;
+
+static uint32_t rng = 4321;
+
+static uint32_t next_random(void)
+{
+	rng = rng * 1103515245u + 12345u;
+	return rng >> 8;
+}
+
+// Fill the frame of one tick and append its rows to the expected list
+static void make_tick(int tick)
+{
+	ProcessTable *t = &frame.table;
+
+	for (int i = 0; i < ROWS; i++) {
+		t->pid[i] = 100 + i * 3;
+		// A handful of busy processes, the rest near idle
+		double cpu = i % 50 == 0 ? 60.0 + next_random() % 4000 / 100.0 :
+					   next_random() % 300 / 100.0;
+		t->cpu_percent[i] = cpu;
+		t->mem_bytes[i] = 4096u * (1000u + (uint64_t)i * 7 +
+					   (uint64_t)tick);
+		t->flags[i] = PROC_CPU_VALID | PROC_MEM_VALID |
+			      ((i + tick) % 9 == 0 ? PROC_STALE : 0);
+		t->order[i] = (uint32_t)i;
+
+		if (t->flags[i] & PROC_STALE) {
+			continue;
+		}
+		int n = expect.count++;
+		expect.time_ms[n] = TIME_MS + (uint64_t)tick * 1000;
+		expect.pid[n] = t->pid[i];
+		expect.cpu[n] = (uint32_t)(cpu * 100.0 + 0.5);
+		expect.rss[n] = t->mem_bytes[i];
+	}
+	t->count = ROWS;
+	frame.seq = (uint64_t)tick;
+}
+
+static int append_ticks(int first, int count)
+{
+	int failed = 0;
+
+	for (int tick = first; tick < first + count; tick++) {
+		make_tick(tick);
+		failed |= history_append(&frame, TIME_MS + (uint64_t)tick * 1000);
+	}
+	return failed;
+}
+
+static void remove_files(void)
+{
+	DIR *d = opendir(dir);
+	struct dirent *ent;
+
+	while (d && (ent = readdir(d))) {
+		if (ent->d_name[0] != '.') {
+			unlinkat(dirfd(d), ent->d_name, 0);
+		}
+	}
+	if (d) {
+		closedir(d);
+	}
+	expect.count = 0;
+}
+
+static bool row_matches(const HistoryRange *r, int i)
+{
+	return expect.time_ms[i] >= r->time_min &&
+	       expect.time_ms[i] <= r->time_max &&
+	       expect.pid[i] >= r->pid_min && expect.pid[i] <= r->pid_max &&
+	       expect.cpu[i] >= r->cpu_min && expect.cpu[i] <= r->cpu_max &&
+	       expect.rss[i] >= r->rss_min && expect.rss[i] <= r->rss_max;
+}
+
+// Query results checked row by row against the expected list
+typedef struct {
+	const HistoryRange *want;
+	int next;            // expected row to look at next
+	int checked;
+	bool mismatch;
+} Check;
+
+static int check_rows(void *ctx, const HistoryRows *rows)
+{
+	Check *c = ctx;
+
+	for (int i = 0; i < rows->count; i++) {
+		while (c->next < expect.count && !row_matches(c->want, c->next)) {
+			c->next++;
+		}
+		int n = c->next++;
+		if (n >= expect.count || rows->time_ms[i] != expect.time_ms[n] ||
+		    rows->pid[i] != expect.pid[n] || rows->cpu[i] != expect.cpu[n] ||
+		    rows->rss[i] != expect.rss[n]) {
+			c->mismatch = true;
+			return 1;
+		}
+		c->checked++;
+	}
+	return 0;
+}
+
+/**
+ * run_query() - Query the history and compare with a brute force scan
+ * @want: Query bounds
+ * @stats: Query statistics
+ *
+ * Return: Rows returned, or -1 if they differ from the brute force scan
+ */
+static int run_query(const HistoryRange *want, HistoryStats *stats)
+{
+	Check c = { .want = want };
+	int brute = 0;
+
+	for (int i = 0; i < expect.count; i++) {
+		brute += row_matches(want, i);
+	}
+	if (history_query(dir, want, check_rows, &c, stats) != 0 ||
+	    c.mismatch || c.checked != brute ||
+	    stats->rows_matched != (uint64_t)brute) {
+		return -1;
+	}
+	return c.checked;
+}
+
+// Test: every row comes back, in order, with RSS kept to the KiB
+static int test_round_trip(void)
+{
+	HistoryRange all;
+	HistoryStats stats;
+
+	remove_files();
+	int failed = history_open(dir) != 0;
+	failed |= append_ticks(0, TICKS) != 0;
+	failed |= history_close() != 0;
+
+	history_range_all(&all);
+	int rows = run_query(&all, &stats);
+	if (failed || rows != expect.count || stats.blocks < 2) {
+		fprintf(stderr, "FAIL: round trip - %d of %d rows\n", rows,
+			expect.count);
+		return 1;
+	}
+
+	printf("PASS: round trip (%d rows in %lu blocks)\n", rows,
+	       (unsigned long)stats.blocks);
+	return 0;
+}
+
+// Test: stale rows are not stored
+static int test_skips_stale(void)
+{
+	if (expect.count >= ROWS * TICKS || expect.count <= ROWS * TICKS * 8 / 9) {
+		fprintf(stderr, "FAIL: skips stale - %d rows\n", expect.count);
+		return 1;
+	}
+
+	printf("PASS: skips stale\n");
+	return 0;
+}
+
+// Test: time range plus predicates match a brute force scan and skip blocks
+static int test_range_query(void)
+{
+	HistoryRange want;
+	HistoryStats stats, busy_stats;
+
+	history_range_all(&want);
+	want.time_min = TIME_MS + 20 * 1000;
+	want.time_max = TIME_MS + 40 * 1000;
+	want.cpu_min = 8000;
+	int busy = run_query(&want, &busy_stats);
+	if (busy <= 0 || busy_stats.blocks_read >= busy_stats.blocks) {
+		fprintf(stderr, "FAIL: range query - %d rows, %lu of %lu blocks\n",
+			busy, (unsigned long)busy_stats.blocks_read,
+			(unsigned long)busy_stats.blocks);
+		return 1;
+	}
+
+	// No row ever reaches this much CPU: nothing is read at all
+	history_range_all(&want);
+	want.cpu_min = 20000;
+	if (run_query(&want, &stats) != 0 || stats.blocks_read != 0 ||
+	    stats.bytes_mapped != 0) {
+		fprintf(stderr, "FAIL: range query - impossible predicate read %lu blocks\n",
+			(unsigned long)stats.blocks_read);
+		return 1;
+	}
+
+	history_range_all(&want);
+	want.pid_min = 400;
+	want.pid_max = 400;
+	want.rss_min = 4096u * 2000;
+	if (run_query(&want, &stats) < 0) {
+		fprintf(stderr, "FAIL: range query - pid and rss\n");
+		return 1;
+	}
+
+	printf("PASS: range query (%d busy rows, %lu of %lu blocks read)\n",
+	       busy, (unsigned long)busy_stats.blocks_read,
+	       (unsigned long)busy_stats.blocks);
+	return 0;
+}
+
+static int count_files(void)
+{
+	DIR *d = opendir(dir);
+	struct dirent *ent;
+	int count = 0;
+
+	while (d && (ent = readdir(d))) {
+		count += ent->d_name[0] != '.';
+	}
+	if (d) {
+		closedir(d);
+	}
+	return count;
+}
+
+// Test: a new UTC day goes to new files, and queries span both
+static int test_day_rollover(void)
+{
+	HistoryRange all;
+	HistoryStats stats;
+
+	remove_files();
+	// Start 50 ticks before midnight
+	uint64_t midnight = (TIME_MS / MS_PER_DAY + 1) * MS_PER_DAY;
+	int first = (int)((midnight - TIME_MS) / 1000) - 50;
+
+	int failed = history_open(dir) != 0;
+	failed |= append_ticks(first, 100) != 0;
+	failed |= history_close() != 0;
+
+	history_range_all(&all);
+	int rows = run_query(&all, &stats);
+	HistoryRange after = all;
+	after.time_min = midnight;
+	int late = run_query(&after, &stats);
+	if (failed || count_files() != 4 || rows != expect.count ||
+	    late <= 0 || late >= rows) {
+		fprintf(stderr, "FAIL: day rollover - %d files, %d rows, %d after midnight\n",
+			count_files(), rows, late);
+		return 1;
+	}
+
+	printf("PASS: day rollover\n");
+	return 0;
+}
+
+// Test: reopening appends, and a torn index entry is cut off
+static int test_reopen(void)
+{
+	HistoryRange all;
+	HistoryStats stats;
+	char name[sizeof(dir) + 32];
+	int failed = 0;
+
+	remove_files();
+	for (int run = 0; run < 2; run++) {
+		failed |= history_open(dir) != 0;
+		failed |= append_ticks(run * 10, 10) != 0;
+		failed |= history_close() != 0;
+	}
+
+	// A run killed while writing an index entry
+	snprintf(name, sizeof(name), "%s/20231114.pbi", dir);
+	int fd = open(name, O_WRONLY | O_APPEND);
+	failed |= fd < 0 || write(fd, "torn", 4) != 4;
+	if (fd >= 0) {
+		close(fd);
+	}
+	failed |= history_open(dir) != 0;
+	failed |= append_ticks(20, 10) != 0;
+	failed |= history_close() != 0;
+
+	history_range_all(&all);
+	int rows = run_query(&all, &stats);
+	if (failed || rows != expect.count || stats.blocks != 3) {
+		fprintf(stderr, "FAIL: reopen - %d of %d rows in %lu blocks\n",
+			rows, expect.count, (unsigned long)stats.blocks);
+		return 1;
+	}
+
+	printf("PASS: reopen\n");
+	return 0;
+}
+
+// Test: the columns compress to a few bytes per row
+static int test_size(void)
+{
+	char name[sizeof(dir) + 32];
+
+	remove_files();
+	int failed = history_open(dir) != 0;
+	failed |= append_ticks(0, TICKS) != 0;
+	failed |= history_close() != 0;
+
+	snprintf(name, sizeof(name), "%s/20231114.pbh", dir);
+	FILE *f = fopen(name, "rb");
+	long size = -1;
+	if (f && fseek(f, 0, SEEK_END) == 0) {
+		size = ftell(f);
+	}
+	if (f) {
+		fclose(f);
+	}
+
+	double per_row = (double)size / expect.count;
+	if (failed || size <= 0 || per_row > 6.0) {
+		fprintf(stderr, "FAIL: size - %.2f bytes per row\n", per_row);
+		return 1;
+	}
+
+	printf("PASS: size (%.2f bytes per row)\n", per_row);
+	return 0;
+}
+
+int main(void)
+{
+	int failures = 0;
+
+	printf("Running unit tests for the history store...\n");
+
+	if (!mkdtemp(dir)) {
+		fprintf(stderr, "FAIL: cannot create temporary directory\n");
+		return 1;
+	}
+
+	size_t max_rows = (size_t)ROWS * TICKS;
+	expect.time_ms = malloc(max_rows * sizeof(*expect.time_ms));
+	expect.pid = malloc(max_rows * sizeof(*expect.pid));
+	expect.cpu = malloc(max_rows * sizeof(*expect.cpu));
+	expect.rss = malloc(max_rows * sizeof(*expect.rss));
+	if (!expect.time_ms || !expect.pid || !expect.cpu || !expect.rss ||
+	    process_table_init(&frame.table, ROWS) != 0) {
+		fprintf(stderr, "FAIL: out of memory\n");
+		rmdir(dir);
+		return 1;
+	}
+
+	failures += test_round_trip();
+	failures += test_skips_stale();
+	failures += test_range_query();
+	failures += test_day_rollover();
+	failures += test_reopen();
+	failures += test_size();
+
+	remove_files();
+	rmdir(dir);
+	process_table_free(&frame.table);
+	free(expect.time_ms);
+	free(expect.pid);
+	free(expect.cpu);
+	free(expect.rss);
+
+	if (failures == 0) {
+		printf("All history store tests passed.\n");
+		return 0;
+	} else {
+		fprintf(stderr, "%d test(s) failed.\n", failures);
+		return 1;
+	}
+}
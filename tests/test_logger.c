@@ -0,0 +1,221 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../src/include/logger.h"
+
+#define THREADS 8
+#define PER_THREAD 5000
+
+static char dir[] = "/tmp/test_logger_XXXXXX";
+
+/**
+ * read_log() - Read the whole log file
+ *
+ * Return: NUL-terminated contents (to be freed), or NULL
+ */
+static char *read_log(void)
+{
+	FILE *f = fopen("logs/log1.log", "rb");
+	if (!f) {
+		return NULL;
+	}
+
+	size_t len = 0, cap = 1 << 16;
+	char *buf = malloc(cap);
+	size_t n;
+	while (buf && (n = fread(buf + len, 1, cap - len - 1, f)) > 0) {
+		len += n;
+		if (cap - len - 1 == 0) {
+			char *grown = realloc(buf, cap * 2);
+			if (!grown) {
+				free(buf);
+				buf = NULL;
+				break;
+			}
+			buf = grown;
+			cap *= 2;
+		}
+	}
+	fclose(f);
+	if (buf) {
+		buf[len] = '\0';
+	}
+	return buf;
+}
+
+// Test: messages come out in order, formatted as before
+static int test_order(void)
+{
+	char message[32];
+
+	for (int i = 0; i < 100; i++) {
+		snprintf(message, sizeof(message), "order %d", i);
+		log_info(message);
+	}
+	log_debug("below the level");
+	log_flush();
+
+	char *log = read_log();
+	const char *p = log;
+	int failed = !log;
+	for (int i = 0; i < 100 && !failed; i++) {
+		snprintf(message, sizeof(message), ": order %d\n", i);
+		const char *line = strstr(p, "[INFO] ");
+		const char *found = strstr(p, message);
+		failed = !line || line != p || !found ||
+			 (size_t)(found - line) > 40;
+		p = found ? found + strlen(message) : p;
+	}
+	failed |= log && strstr(log, "below the level") != NULL;
+	free(log);
+
+	if (failed) {
+		fprintf(stderr, "FAIL: order\n");
+		return 1;
+	}
+
+	printf("PASS: order\n");
+	return 0;
+}
+
+static void *log_burst(void *arg)
+{
+	int id = (int)(long)arg;
+	char message[32];
+
+	for (int i = 0; i < PER_THREAD; i++) {
+		snprintf(message, sizeof(message), "burst t%d n%d", id, i);
+		log_warning(message);
+	}
+	return NULL;
+}
+
+// Test: concurrent bursts lose nothing that is not counted as dropped
+static int test_concurrent(void)
+{
+	pthread_t threads[THREADS];
+	uint64_t dropped_before = log_dropped();
+
+	for (long i = 0; i < THREADS; i++) {
+		pthread_create(&threads[i], NULL, log_burst, (void *)i);
+	}
+	for (int i = 0; i < THREADS; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	log_flush();
+	uint64_t dropped = log_dropped() - dropped_before;
+
+	char *log = read_log();
+	int last[THREADS];
+	int written = 0;
+	bool out_of_order = false;
+	for (int i = 0; i < THREADS; i++) {
+		last[i] = -1;
+	}
+	for (const char *p = log; p && (p = strstr(p, "burst t")); p++) {
+		int id, n;
+		if (sscanf(p, "burst t%d n%d", &id, &n) != 2 || id < 0 ||
+		    id >= THREADS) {
+			continue;
+		}
+		out_of_order |= n <= last[id];
+		last[id] = n;
+		written++;
+	}
+	bool reported = log && (dropped == 0 ||
+				strstr(log, "log messages dropped") != NULL);
+	free(log);
+
+	if (!log || out_of_order || !reported ||
+	    (uint64_t)written + dropped != THREADS * PER_THREAD) {
+		fprintf(stderr, "FAIL: concurrent - %d written, %lu dropped of %d\n",
+			written, (unsigned long)dropped, THREADS * PER_THREAD);
+		return 1;
+	}
+
+	printf("PASS: concurrent (%d written, %lu dropped)\n", written,
+	       (unsigned long)dropped);
+	return 0;
+}
+
+// Test: log_fatal() returns only once its message is in the file
+static int test_fatal_flush(void)
+{
+	log_info("before fatal");
+	log_fatal("test fatal message");
+
+	char *log = read_log();
+	bool found = log && strstr(log, ": before fatal\n") &&
+		     strstr(log, "[FATAL] ") &&
+		     strstr(log, ": test fatal message\n");
+	free(log);
+
+	if (!found) {
+		fprintf(stderr, "FAIL: fatal flush\n");
+		return 1;
+	}
+
+	printf("PASS: fatal flush\n");
+	return 0;
+}
+
+// Test: a call costs a queue push, not a formatted write
+static int test_call_cost(void)
+{
+	struct timespec start, end;
+	int calls = 500; // well within the queue
+
+	log_flush();
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < calls; i++) {
+		log_info("cost of a call");
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	log_flush();
+
+	double ns = ((double)(end.tv_sec - start.tv_sec) * 1e9 +
+		     (double)(end.tv_nsec - start.tv_nsec)) / calls;
+	if (ns > 20000.0) {
+		fprintf(stderr, "FAIL: call cost - %.0f ns per call\n", ns);
+		return 1;
+	}
+
+	printf("PASS: call cost (%.0f ns per call)\n", ns);
+	return 0;
+}
+
+int main(void)
+{
+	int failures = 0;
+
+	printf("Running unit tests for the logger...\n");
+
+	// The log goes to logs/ under the working directory
+	if (!mkdtemp(dir) || chdir(dir) != 0) {
+		fprintf(stderr, "FAIL: cannot create temporary directory\n");
+		return 1;
+	}
+
+	failures += test_order();
+	failures += test_concurrent();
+	failures += test_fatal_flush();
+	failures += test_call_cost();
+
+	unlink("logs/log1.log");
+	rmdir("logs");
+	if (chdir("/") == 0) {
+		rmdir(dir);
+	}
+
+	if (failures == 0) {
+		printf("All logger tests passed.\n");
+		return 0;
+	} else {
+		fprintf(stderr, "%d test(s) failed.\n", failures);
+		return 1;
+	}
+}
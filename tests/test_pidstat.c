@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "../src/include/pidstat.h"
+
+#define FIELDS (PIDSTAT_MASK(PIDSTAT_UTIME) | PIDSTAT_MASK(PIDSTAT_STIME) | \
+		PIDSTAT_MASK(PIDSTAT_STARTTIME) | PIDSTAT_MASK(PIDSTAT_RSS))
+
+static const char *sample_tail =
+	" S 1 1234 1234 0 -1 4194560 1500 0 3 0 250 75 0 0 20 0 4 0 "
+	"987654 123456789 3210 18446744073709551615 1 1 0 0 0 0 0 4096 "
+	"17663 0 0 0 17 2 0 0 0 0 0 0 0 0 0 0 0 0 0\n";
+
+static int check_line(const char *comm)
+{
+	char line[PIDSTAT_BUF_SIZE];
+	int len = snprintf(line, sizeof(line), "4321 (%s)%s", comm,
+			   sample_tail);
+
+	PidStat st;
+	if (pidstat_parse(line, (size_t)len, FIELDS, &st) != 0) {
+		fprintf(stderr, "FAIL: parse '%s' - rejected\n", comm);
+		return 1;
+	}
+
+	if (st.field[PIDSTAT_PID] != 4321 || st.state != 'S' ||
+	    st.comm_len != strlen(comm) ||
+	    memcmp(st.comm, comm, st.comm_len) != 0 ||
+	    st.field[PIDSTAT_UTIME] != 250 || st.field[PIDSTAT_STIME] != 75 ||
+	    st.field[PIDSTAT_STARTTIME] != 987654 ||
+	    st.field[PIDSTAT_RSS] != 3210) {
+		fprintf(stderr, "FAIL: parse '%s' - wrong fields\n", comm);
+		return 1;
+	}
+
+	printf("PASS: parse '%s'\n", comm);
+	return 0;
+}
+
+// Test: fields past rss and negative values decode correctly
+static int test_all_fields(void)
+{
+	char line[PIDSTAT_BUF_SIZE];
+	int len = snprintf(line, sizeof(line), "7 (x)%s", sample_tail);
+
+	PidStat st;
+	uint64_t mask = PIDSTAT_MASK(8) | PIDSTAT_MASK(52);
+	if (pidstat_parse(line, (size_t)len, mask, &st) != 0 ||
+	    (int64_t)st.field[8] != -1 || st.field[52] != 0) {
+		fprintf(stderr, "FAIL: all_fields\n");
+		return 1;
+	}
+
+	printf("PASS: all_fields\n");
+	return 0;
+}
+
+// Test: truncated or malformed lines are rejected
+static int test_malformed(void)
+{
+	const char *bad[] = {
+		"",
+		"12 (noclose S 1 2 3",
+		"12 (short) S 1 2 3\n",
+		"abc (x) S 1\n",
+	};
+
+	PidStat st;
+	for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+		if (pidstat_parse(bad[i], strlen(bad[i]), FIELDS, &st) == 0) {
+			fprintf(stderr, "FAIL: malformed - accepted '%s'\n",
+				bad[i]);
+			return 1;
+		}
+	}
+
+	printf("PASS: malformed\n");
+	return 0;
+}
+
+int main(void)
+{
+	int failures = 0;
+
+	printf("Running unit tests for stat parsing...\n");
+
+	failures += check_line("bash");
+	failures += check_line("Web Content");
+	failures += check_line("a) S 1 (b");
+	failures += check_line("");
+	failures += test_all_fields();
+	failures += test_malformed();
+
+	if (failures == 0) {
+		printf("All stat parsing tests passed.\n");
+		return 0;
+	} else {
+		fprintf(stderr, "%d test(s) failed.\n", failures);
+		return 1;
+	}
+}
@@ -0,0 +1,460 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "../src/include/collector.h"
+#include "../src/include/fdcache.h"
+#include "../src/include/process.h"
+#include "../src/include/uring.h"
+
+static void set_proc(ProcessTable *t, int row, int pid, uint64_t starttime,
+		     uint64_t utime, uint64_t stime)
+{
+	t->pid[row] = pid;
+	t->starttime[row] = starttime;
+	t->utime[row] = utime;
+	t->stime[row] = stime;
+	t->mem_bytes[row] = 1024 * 1024;
+	t->flags[row] = 0;
+	t->name[row] = 0;
+	t->order[row] = (uint32_t)row;
+	if (row >= t->count) {
+		t->count = row + 1;
+	}
+}
+
+// Percent of one core that @ticks clock ticks are over one second
+static double one_second(double ticks)
+{
+	return ticks * 100.0 / (double)sysconf(_SC_CLK_TCK);
+}
+
+static bool cpu_is(const ProcessTable *t, int row, double expected)
+{
+	return (t->flags[row] & PROC_CPU_VALID) &&
+	       fabs(t->cpu_percent[row] - expected) < 1e-9;
+}
+
+// Snapshots one second apart, as collect_processes() would stamp them
+static void one_second_apart(ProcessTable *prev, ProcessTable *curr)
+{
+	prev->sample_ns = 5000000000u;
+	curr->sample_ns = 6000000000u;
+}
+
+// Test: a process present in both snapshots gets its CPU delta
+static int test_matching_pid(void)
+{
+	ProcessTable prev, curr;
+	process_table_init(&prev, 2);
+	process_table_init(&curr, 2);
+
+	set_proc(&prev, 0, 100, 5000, 10, 10);
+	set_proc(&prev, 1, 200, 6000, 50, 0);
+	// Reverse order: matching must not depend on row position
+	set_proc(&curr, 0, 200, 6000, 60, 0);
+	set_proc(&curr, 1, 100, 5000, 30, 20);
+	one_second_apart(&prev, &curr);
+
+	compute_process_stats(&curr, &prev, 1, 4 * 1024 * 1024);
+
+	int failed = 0;
+	if (!cpu_is(&curr, 0, one_second(10)) ||
+	    !cpu_is(&curr, 1, one_second(30))) {
+		fprintf(stderr, "FAIL: matching_pid - wrong CPU delta\n");
+		failed = 1;
+	} else if (!(curr.flags[0] & PROC_MEM_VALID) ||
+		   curr.mem_percent[0] != 25.0) {
+		fprintf(stderr, "FAIL: matching_pid - wrong mem percent\n");
+		failed = 1;
+	}
+
+	process_table_free(&prev);
+	process_table_free(&curr);
+	if (!failed) {
+		printf("PASS: matching_pid\n");
+	}
+	return failed;
+}
+
+// Test: CPU% uses the measured time between samples and the core count
+static int test_measured_interval(void)
+{
+	ProcessTable prev, curr;
+	process_table_init(&prev, 1);
+	process_table_init(&curr, 1);
+
+	double hz = (double)sysconf(_SC_CLK_TCK);
+	set_proc(&prev, 0, 100, 5000, 0, 0);
+	// One core busy for a 100 ms tick that actually took 250 ms
+	set_proc(&curr, 0, 100, 5000, (uint64_t)(hz / 4), 0);
+	prev.sample_ns = 1000000000u;
+	curr.sample_ns = 1250000000u;
+
+	compute_process_stats(&curr, &prev, 4, 4 * 1024 * 1024);
+
+	// 100% of one core is 25% of four cores
+	int failed = !cpu_is(&curr, 0, 25.0);
+
+	// Identical timestamps give no CPU% rather than a division by zero
+	curr.sample_ns = prev.sample_ns;
+	compute_process_stats(&curr, &prev, 4, 4 * 1024 * 1024);
+	failed |= (curr.flags[0] & PROC_CPU_VALID) != 0;
+
+	process_table_free(&prev);
+	process_table_free(&curr);
+	if (failed) {
+		fprintf(stderr, "FAIL: measured_interval\n");
+		return 1;
+	}
+
+	printf("PASS: measured_interval\n");
+	return 0;
+}
+
+// Test: a skipped process is averaged over the time since its last read
+static int test_stale_rows(void)
+{
+	ProcessTable prev, curr;
+	process_table_init(&prev, 2);
+	process_table_init(&curr, 2);
+
+	double hz = (double)sysconf(_SC_CLK_TCK);
+	// Row 0 was carried into prev unread; its numbers are from t=0
+	set_proc(&prev, 0, 100, 5000, 0, 0);
+	prev.flags[0] = PROC_STALE;
+	prev.read_ns[0] = 0;
+	set_proc(&prev, 1, 200, 6000, 0, 0);
+	prev.sample_ns = 1000000000u;
+
+	// Row 0 used one CPU second by t=2s; row 1 is carried over unread
+	set_proc(&curr, 0, 100, 5000, (uint64_t)hz, 0);
+	set_proc(&curr, 1, 200, 6000, 0, 0);
+	curr.flags[1] = PROC_STALE | PROC_CPU_VALID;
+	curr.cpu_percent[1] = 12.5;
+	curr.sample_ns = 2000000000u;
+
+	compute_process_stats(&curr, &prev, 1, 4 * 1024 * 1024);
+
+	int failed = !cpu_is(&curr, 0, 50.0) || !cpu_is(&curr, 1, 12.5) ||
+		     !(curr.flags[1] & PROC_STALE);
+
+	process_table_free(&prev);
+	process_table_free(&curr);
+	if (failed) {
+		fprintf(stderr, "FAIL: stale_rows\n");
+		return 1;
+	}
+
+	printf("PASS: stale_rows\n");
+	return 0;
+}
+
+// Test: a reused PID is not credited with the previous owner's jiffies
+static int test_reused_pid(void)
+{
+	ProcessTable prev, curr;
+	process_table_init(&prev, 1);
+	process_table_init(&curr, 1);
+
+	set_proc(&prev, 0, 300, 1000, 5000, 5000);
+	set_proc(&curr, 0, 300, 9000, 1, 1);
+	one_second_apart(&prev, &curr);
+
+	compute_process_stats(&curr, &prev, 1, 4 * 1024 * 1024);
+
+	int failed = 0;
+	if ((curr.flags[0] & PROC_CPU_VALID) || curr.cpu_percent[0] != 0.0) {
+		fprintf(stderr, "FAIL: reused_pid - matched previous owner\n");
+		failed = 1;
+	}
+
+	process_table_free(&prev);
+	process_table_free(&curr);
+	if (!failed) {
+		printf("PASS: reused_pid\n");
+	}
+	return failed;
+}
+
+// Test: matching stays correct when the index has to hold many PIDs
+static int test_many_pids(void)
+{
+	const int count = 20000;
+	ProcessTable prev, curr;
+	if (process_table_init(&prev, count) != 0 ||
+	    process_table_init(&curr, count) != 0) {
+		fprintf(stderr, "FAIL: many_pids - out of memory\n");
+		return 1;
+	}
+
+	for (int i = 0; i < count; i++) {
+		set_proc(&prev, i, i + 1, 100 + i, 0, 0);
+		set_proc(&curr, count - 1 - i, i + 1, 100 + i, i % 7, 0);
+	}
+
+	one_second_apart(&prev, &curr);
+	compute_process_stats(&curr, &prev, 1, 1024 * 1024);
+
+	int failures = 0;
+	for (int i = 0; i < count; i++) {
+		int expected = (curr.pid[i] - 1) % 7;
+		if (!cpu_is(&curr, i, one_second(expected))) {
+			failures++;
+		}
+	}
+
+	process_table_free(&prev);
+	process_table_free(&curr);
+
+	if (failures) {
+		fprintf(stderr, "FAIL: many_pids - %d mismatches\n", failures);
+		return 1;
+	}
+
+	printf("PASS: many_pids\n");
+	return 0;
+}
+
+// Test: growing the arena keeps existing rows and is counted
+static int test_table_growth(void)
+{
+	ProcessTable t;
+	if (process_table_init(&t, 4) != 0) {
+		fprintf(stderr, "FAIL: table_growth - out of memory\n");
+		return 1;
+	}
+
+	int initial = t.capacity;
+	for (int i = 0; i < initial; i++) {
+		set_proc(&t, i, i + 1, 7 * i, i, 2 * i);
+	}
+
+	const int rows = 150000;
+	if (process_table_reserve(&t, rows) != 0 || t.capacity < rows) {
+		fprintf(stderr, "FAIL: table_growth - reserve failed\n");
+		process_table_free(&t);
+		return 1;
+	}
+
+	int failed = t.grow_count != 1;
+	for (int i = 0; i < initial && !failed; i++) {
+		if (t.pid[i] != i + 1 || t.starttime[i] != (uint64_t)(7 * i) ||
+		    t.stime[i] != (uint64_t)(2 * i) || t.order[i] != (uint32_t)i) {
+			failed = 1;
+		}
+	}
+	for (int i = initial; i < rows; i++) {
+		set_proc(&t, i, i + 1, 0, 0, 0);
+	}
+	failed |= t.count != rows;
+
+	process_table_free(&t);
+	if (failed) {
+		fprintf(stderr, "FAIL: table_growth - rows lost while growing\n");
+		return 1;
+	}
+
+	printf("PASS: table_growth\n");
+	return 0;
+}
+
+static int count_pid(const ProcessTable *t, int pid)
+{
+	int found = 0;
+	for (int i = 0; i < t->count; i++) {
+		found += t->pid[i] == pid;
+	}
+	return found;
+}
+
+static int check_children(const ProcessTable *t, const pid_t *pids, int n)
+{
+	for (int i = 0; i < n; i++) {
+		if (count_pid(t, pids[i]) != 1) {
+			return 1;
+		}
+	}
+	for (int i = 0; i < t->count; i++) {
+		if (t->order[i] != (uint32_t)i ||
+		    (t->pid[i] == pids[0] &&
+		     strcmp(process_name(t, i), "test_process") != 0)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// Test: parallel and io_uring collection see every child once, like serial
+static int test_staged_collect(void)
+{
+	const int children = 300;
+	pid_t pids[300];
+	int gate[2];
+	if (pipe(gate) != 0) {
+		fprintf(stderr, "FAIL: staged_collect - pipe failed\n");
+		return 1;
+	}
+
+	int forked = 0;
+	for (; forked < children; forked++) {
+		pids[forked] = fork();
+		if (pids[forked] < 0) {
+			break;
+		}
+		if (pids[forked] == 0) {
+			char c;
+			close(gate[1]);
+			ssize_t n = read(gate[0], &c, 1);
+			_exit(n < 0);
+		}
+	}
+
+	ProcessTable t;
+	process_table_init(&t, 16);
+
+	collect_processes(&t);
+	int failed = check_children(&t, pids, forked);
+
+	collector_start(4);
+	collect_processes(&t);
+	failed |= collector_threads() != 4 || check_children(&t, pids, forked);
+	collector_stop();
+
+	// A small ring splits the PIDs into several batches; the first tick
+	// opens descriptors, the second reads them all through the ring
+	bool have_uring = uring_open(64) == 0;
+	if (have_uring) {
+		collect_processes(&t);
+		collect_processes(&t);
+		failed |= check_children(&t, pids, forked);
+		uring_close();
+	}
+
+	close(gate[0]);
+	close(gate[1]);
+	for (int i = 0; i < forked; i++) {
+		waitpid(pids[i], NULL, 0);
+	}
+	fdcache_cleanup();
+	process_table_free(&t);
+
+	if (failed || forked != children) {
+		fprintf(stderr, "FAIL: staged_collect - rows differ from serial\n");
+		return 1;
+	}
+
+	printf("PASS: staged_collect%s\n", have_uring ? "" : " (io_uring unavailable)");
+	return 0;
+}
+
+static bool is_stale(const ProcessTable *t, int pid)
+{
+	for (int i = 0; i < t->count; i++) {
+		if (t->pid[i] == pid) {
+			return t->flags[i] & PROC_STALE;
+		}
+	}
+	return false;
+}
+
+// Test: quiet processes back off, pinned ones are read every tick
+static int test_adaptive_sampling(void)
+{
+	const int children = 8;
+	pid_t pids[8];
+	int gate[2];
+	if (pipe(gate) != 0) {
+		fprintf(stderr, "FAIL: adaptive_sampling - pipe failed\n");
+		return 1;
+	}
+
+	int forked = 0;
+	for (; forked < children; forked++) {
+		pids[forked] = fork();
+		if (pids[forked] < 0) {
+			break;
+		}
+		if (pids[forked] == 0) {
+			char c;
+			close(gate[1]);
+			ssize_t n = read(gate[0], &c, 1);
+			_exit(n < 0);
+		}
+	}
+
+	PidMap pinned;
+	pidmap_init(&pinned);
+	pidmap_insert(&pinned, pids[0], 0, 0);
+	SamplePolicy policy = { .max_backoff = 4, .pinned = &pinned };
+
+	ProcessTable tables[2];
+	process_table_init(&tables[0], 16);
+	process_table_init(&tables[1], 16);
+	ProcessTable *prev = &tables[0];
+	ProcessTable *curr = &tables[1];
+	collect_processes(prev);
+
+	// Children are read at ticks 1 and 3, carried at 2, 4, 5 and 6
+	static const bool carried[] = { false, true, false, true, true, true };
+	int failed = forked != children;
+	for (int tick = 0; tick < 6 && !failed; tick++) {
+		collect_processes_adaptive(curr, prev, &policy);
+		failed |= check_children(curr, pids, forked);
+		failed |= is_stale(curr, pids[0]);
+		failed |= is_stale(curr, pids[1]) != carried[tick];
+		ProcessTable *swap = prev;
+		prev = curr;
+		curr = swap;
+	}
+
+	// Full accuracy reads everything again
+	policy.max_backoff = 1;
+	collect_processes_adaptive(curr, prev, &policy);
+	failed |= curr->stale_count != 0 || check_children(curr, pids, forked);
+
+	close(gate[0]);
+	close(gate[1]);
+	for (int i = 0; i < forked; i++) {
+		waitpid(pids[i], NULL, 0);
+	}
+	fdcache_cleanup();
+	pidmap_free(&pinned);
+	process_table_free(&tables[0]);
+	process_table_free(&tables[1]);
+
+	if (failed) {
+		fprintf(stderr, "FAIL: adaptive_sampling\n");
+		return 1;
+	}
+
+	printf("PASS: adaptive_sampling\n");
+	return 0;
+}
+
+int main(void)
+{
+	int failures = 0;
+
+	printf("Running unit tests for process stats...\n");
+
+	failures += test_matching_pid();
+	failures += test_reused_pid();
+	failures += test_measured_interval();
+	failures += test_stale_rows();
+	failures += test_many_pids();
+	failures += test_table_growth();
+	failures += test_staged_collect();
+	failures += test_adaptive_sampling();
+
+	if (failures == 0) {
+		printf("All process stats tests passed.\n");
+		return 0;
+	} else {
+		fprintf(stderr, "%d test(s) failed.\n", failures);
+		return 1;
+	}
+}
@@ -0,0 +1,168 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "../src/include/procevents.h"
+
+#define CHILDREN 16
+
+// Identity the live set has for a PID, 0 if it is not tracked
+static uint64_t live_id(int pid)
+{
+	const PidList *live = procevents_pids();
+	for (int i = 0; i < live->count; i++) {
+		if (live->pids[i] == pid) {
+			return live->ids[i];
+		}
+	}
+	return 0;
+}
+
+// Test: short-lived children are tracked from fork to exit and counted
+static int test_short_lived_children(void)
+{
+	PidList scan = {0};
+	if (procdir_list_pids(&scan) < 0) {
+		fprintf(stderr, "FAIL: short_lived_children - cannot list /proc\n");
+		return 1;
+	}
+	procevents_drain();
+	procevents_seed(&scan);
+	pidlist_free(&scan);
+
+	ProcEventCounts before;
+	procevents_counts(&before);
+
+	// Children block on the pipe until released, so they exist at drain
+	int gate[2];
+	if (pipe(gate) != 0) {
+		fprintf(stderr, "FAIL: short_lived_children - pipe failed\n");
+		return 1;
+	}
+
+	pid_t pids[CHILDREN];
+	for (int i = 0; i < CHILDREN; i++) {
+		pids[i] = fork();
+		if (pids[i] == 0) {
+			char c;
+			close(gate[1]);
+			ssize_t n = read(gate[0], &c, 1);
+			_exit(n < 0);
+		}
+	}
+
+	// Events are delivered asynchronously; give the socket a moment
+	usleep(100000);
+	procevents_drain();
+
+	int failed = 0;
+	uint64_t forked_id[CHILDREN];
+	for (int i = 0; i < CHILDREN; i++) {
+		forked_id[i] = live_id(pids[i]);
+		if (!procevents_is_live(pids[i])) {
+			fprintf(stderr, "FAIL: short_lived_children - fork of %d missed\n",
+				pids[i]);
+			failed = 1;
+		}
+	}
+
+	close(gate[0]);
+	close(gate[1]); // EOF releases the children
+	for (int i = 0; i < CHILDREN; i++) {
+		waitpid(pids[i], NULL, 0);
+	}
+
+	usleep(100000);
+	procevents_drain();
+
+	// Exits only renew the identity; the collector drops unreadable PIDs
+	for (int i = 0; i < CHILDREN; i++) {
+		if (live_id(pids[i]) == forked_id[i]) {
+			fprintf(stderr, "FAIL: short_lived_children - exit of %d missed\n",
+				pids[i]);
+			failed = 1;
+		}
+		procevents_forget(pids[i]);
+	}
+
+	ProcEventCounts after;
+	procevents_counts(&after);
+	if (after.forks - before.forks < CHILDREN ||
+	    after.exits - before.exits < CHILDREN) {
+		fprintf(stderr, "FAIL: short_lived_children - counted %lu forks, %lu exits\n",
+			after.forks - before.forks, after.exits - before.exits);
+		failed = 1;
+	}
+
+	if (!failed) {
+		printf("PASS: short_lived_children\n");
+	}
+	return failed;
+}
+
+static void *wait_for_gate(void *arg)
+{
+	char c;
+	ssize_t n = read(*(int *)arg, &c, 1);
+	_exit(n < 0);
+}
+
+// Test: a process whose leader thread exits is still tracked
+static int test_leader_exit(void)
+{
+	int gate[2];
+	if (pipe(gate) != 0) {
+		fprintf(stderr, "FAIL: leader_exit - pipe failed\n");
+		return 1;
+	}
+
+	pid_t pid = fork();
+	if (pid == 0) {
+		pthread_t thread;
+		close(gate[1]);
+		if (pthread_create(&thread, NULL, wait_for_gate, &gate[0]) != 0) {
+			_exit(1);
+		}
+		pthread_exit(NULL); // the other thread keeps the process alive
+	}
+
+	usleep(100000);
+	procevents_drain();
+	int failed = !procevents_is_live(pid);
+	if (failed) {
+		fprintf(stderr, "FAIL: leader_exit - %d dropped while alive\n", pid);
+	}
+
+	close(gate[0]);
+	close(gate[1]);
+	waitpid(pid, NULL, 0);
+	procevents_forget(pid);
+
+	if (!failed) {
+		printf("PASS: leader_exit\n");
+	}
+	return failed;
+}
+
+int main(void)
+{
+	printf("Running unit tests for proc connector tracking...\n");
+
+	if (procevents_open() != 0) {
+		printf("SKIP: proc connector unavailable (needs CAP_NET_ADMIN)\n");
+		return 0;
+	}
+
+	int failures = test_short_lived_children();
+	failures += test_leader_exit();
+	procevents_close();
+
+	if (failures == 0) {
+		printf("All proc connector tests passed.\n");
+		return 0;
+	} else {
+		fprintf(stderr, "%d test(s) failed.\n", failures);
+		return 1;
+	}
+}
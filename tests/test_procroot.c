@@ -0,0 +1,326 @@
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../src/include/cmdline.h"
+#include "../src/include/cpu.h"
+#include "../src/include/mem.h"
+#include "../src/include/procdir.h"
+#include "../src/include/process.h"
+#include "../tools/procfake.h"
+
+#define PROCS 300
+#define CORES 4 // procfake's core count
+
+static char dir[] = "/tmp/test_procroot_XXXXXX";
+static ProcFake pf;
+static ProcessTable prev, curr;
+
+static int find_row(const ProcessTable *t, int pid)
+{
+	for (int i = 0; i < t->count; i++) {
+		if (t->pid[i] == pid) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/**
+ * advance() - Step the fake tree and collect it one second after prev
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int advance(void)
+{
+	ProcessTable tmp = prev;
+	prev = curr;
+	curr = tmp;
+
+	if (procfake_step(&pf) != 0 || collect_processes(&curr) < 0) {
+		return -1;
+	}
+	curr.sample_ns = prev.sample_ns + 1000000000u;
+	compute_process_stats(&curr, &prev, CORES, read_total_mem_bytes());
+	return 0;
+}
+
+// Test: every fake process is listed, odd names included
+static int test_listing(void)
+{
+	static const struct {
+		int pid;
+		const char *name;
+	} names[] = {
+		{ 1, "proc1" },
+		{ 97, "odd) (name" },
+		{ 194, "ends)" },
+		{ 291, "((" },
+	};
+
+	if (collect_processes(&curr) < 0 || curr.count != PROCS) {
+		fprintf(stderr, "FAIL: listing - %d of %d processes\n", curr.count,
+			PROCS);
+		return 1;
+	}
+	curr.sample_ns = 1000000000u;
+	for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+		int row = find_row(&curr, names[i].pid);
+		if (row < 0 || strcmp(process_name(&curr, row), names[i].name) != 0) {
+			fprintf(stderr, "FAIL: listing - pid %d is '%s', not '%s'\n",
+				names[i].pid, row < 0 ? "missing" :
+				process_name(&curr, row), names[i].name);
+			return 1;
+		}
+	}
+
+	printf("PASS: listing (%d processes)\n", curr.count);
+	return 0;
+}
+
+// Test: CPU usage follows the scripted busy time
+static int test_cpu_follows_busy(void)
+{
+	const char *script =
+		"# pid 50 spins on one core from tick 1\n"
+		"1 busy 50 100\n"
+		"1 rss 50 2560\n";
+
+	FILE *f = fmemopen((void *)script, strlen(script), "r");
+	int bad = f ? procfake_load_script(&pf, f) : -1;
+	if (f) {
+		fclose(f);
+	}
+	if (bad != 0 || advance() != 0) {
+		fprintf(stderr, "FAIL: cpu follows busy - script line %d\n", bad);
+		return 1;
+	}
+
+	int busy = find_row(&curr, 50);
+	int light = find_row(&curr, 40); // 4 + 1 jiffies a tick
+	int idle = find_row(&curr, 41);
+	// utime plus a quarter of it as stime, over CORES cores
+	double want_busy = 125.0 / CORES;
+	double want_light = 5.0 / CORES;
+	if (busy < 0 || light < 0 || idle < 0 ||
+	    !(curr.flags[busy] & PROC_CPU_VALID) ||
+	    fabs(curr.cpu_percent[busy] - want_busy) > 1e-6 ||
+	    fabs(curr.cpu_percent[light] - want_light) > 1e-6 ||
+	    curr.cpu_percent[idle] != 0.0 ||
+	    curr.mem_bytes[busy] != 2560 * get_page_size()) {
+		fprintf(stderr, "FAIL: cpu follows busy - %.2f%% and %.2f%%\n",
+			busy < 0 ? -1.0 : curr.cpu_percent[busy],
+			light < 0 ? -1.0 : curr.cpu_percent[light]);
+		return 1;
+	}
+
+	printf("PASS: cpu follows busy\n");
+	return 0;
+}
+
+// Test: a process that exits between ticks is gone from the next one
+static int test_vanished(void)
+{
+	int failed = procfake_exit(&pf, 5) != 0 || advance() != 0;
+	if (failed || find_row(&curr, 5) >= 0 || curr.count != PROCS - 1) {
+		fprintf(stderr, "FAIL: vanished - %d processes\n", curr.count);
+		return 1;
+	}
+
+	printf("PASS: vanished\n");
+	return 0;
+}
+
+// Test: a reused PID is a new process, not a continuation of the old one
+static int test_pid_reuse(void)
+{
+	int before = find_row(&curr, 50);
+	uint64_t old_start = before < 0 ? 0 : curr.starttime[before];
+
+	int failed = procfake_spawn(&pf, 50, "reborn") != 0 || advance() != 0;
+	int row = find_row(&curr, 50);
+	if (failed || before < 0 || row < 0 ||
+	    curr.starttime[row] == old_start ||
+	    strcmp(process_name(&curr, row), "reborn") != 0 ||
+	    (curr.flags[row] & PROC_CPU_VALID)) {
+		fprintf(stderr, "FAIL: pid reuse\n");
+		return 1;
+	}
+
+	// From the following tick on it is tracked as usual
+	failed = procfake_rename(&pf, 50, "with space") != 0 || advance() != 0;
+	row = find_row(&curr, 50);
+	if (failed || row < 0 || !(curr.flags[row] & PROC_CPU_VALID) ||
+	    strcmp(process_name(&curr, row), "with space") != 0) {
+		fprintf(stderr, "FAIL: pid reuse - not tracked after reuse\n");
+		return 1;
+	}
+
+	printf("PASS: pid reuse\n");
+	return 0;
+}
+
+// Test: a backed-off PID reused by a new process is read, not carried
+static int test_backed_off_reuse(void)
+{
+	SamplePolicy policy = { .max_backoff = 8 };
+	int pid = 43; // idle
+	int row = -1;
+
+	// Step until the old process is quiet enough to skip the next read
+	for (int tick = 0; tick < 8 && (row < 0 || curr.wait[row] == 0);
+	     tick++) {
+		ProcessTable tmp = prev;
+		prev = curr;
+		curr = tmp;
+		if (procfake_step(&pf) != 0 ||
+		    collect_processes_adaptive(&curr, &prev, &policy) < 0) {
+			fprintf(stderr, "FAIL: backed-off reuse - collection\n");
+			return 1;
+		}
+		row = find_row(&curr, pid);
+	}
+	if (row < 0 || curr.wait[row] == 0) {
+		fprintf(stderr, "FAIL: backed-off reuse - pid %d never backed off\n",
+			pid);
+		return 1;
+	}
+	uint64_t old_start = curr.starttime[row];
+
+	ProcessTable tmp = prev;
+	prev = curr;
+	curr = tmp;
+	int failed = procfake_spawn(&pf, pid, "reborn") != 0 ||
+		     procfake_step(&pf) != 0 ||
+		     collect_processes_adaptive(&curr, &prev, &policy) < 0;
+	row = find_row(&curr, pid);
+	if (failed || row < 0 || (curr.flags[row] & PROC_STALE) ||
+	    curr.starttime[row] == old_start ||
+	    strcmp(process_name(&curr, row), "reborn") != 0) {
+		fprintf(stderr, "FAIL: backed-off reuse - pid %d is '%s'%s\n", pid,
+			row < 0 ? "missing" : process_name(&curr, row),
+			row >= 0 && (curr.flags[row] & PROC_STALE) ?
+			" (stale)" : "");
+		return 1;
+	}
+
+	printf("PASS: backed-off reuse\n");
+	return 0;
+}
+
+// Test: a shown command line follows exec() and title rewrites
+static int test_cmdline_refresh(void)
+{
+	int pid = 60;
+	int row = find_row(&curr, pid);
+	const char *cmd = row < 0 ? NULL :
+			  cmdline_get(pid, curr.starttime[row],
+				      process_name(&curr, row));
+	if (!cmd || strcmp(cmd, "/usr/bin/proc60 --fake") != 0) {
+		fprintf(stderr, "FAIL: cmdline refresh - first read '%s'\n",
+			cmd ? cmd : "missing");
+		return 1;
+	}
+
+	// exec(): same starttime, new comm and command line
+	int failed = procfake_rename(&pf, pid, "execd") != 0 || advance() != 0;
+	cmdline_sweep(&curr);
+	row = find_row(&curr, pid);
+	cmd = failed || row < 0 ? NULL :
+	      cmdline_get(pid, curr.starttime[row], process_name(&curr, row));
+	if (!cmd || strcmp(cmd, "/usr/bin/execd --fake") != 0) {
+		fprintf(stderr, "FAIL: cmdline refresh - after exec '%s'\n",
+			cmd ? cmd : "missing");
+		return 1;
+	}
+
+	// A new title under the same comm shows up within a few snapshots
+	static const char title[] = "execd: idle";
+	int fd = openat(pf.dir_fd, "60/cmdline", O_WRONLY | O_TRUNC | O_CLOEXEC);
+	failed = fd < 0 || write(fd, title, sizeof(title)) != sizeof(title);
+	if (fd >= 0) {
+		close(fd);
+	}
+	int snapshots = 0;
+	while (!failed && snapshots < 10 && strcmp(cmd, title) != 0) {
+		failed = advance() != 0;
+		cmdline_sweep(&curr);
+		row = find_row(&curr, pid);
+		cmd = failed || row < 0 ? "" :
+		      cmdline_get(pid, curr.starttime[row],
+				  process_name(&curr, row));
+		snapshots++;
+	}
+	if (failed || strcmp(cmd, title) != 0) {
+		fprintf(stderr, "FAIL: cmdline refresh - title '%s'\n", cmd);
+		return 1;
+	}
+
+	printf("PASS: cmdline refresh (title after %d snapshots)\n", snapshots);
+	return 0;
+}
+
+// Test: system-wide counters are read from the same tree
+static int test_system_files(void)
+{
+	CpuStat a = {0}, b = {0};
+
+	int failed = cpu_stat_read(&a) != 0 || procfake_step(&pf) != 0 ||
+		     cpu_stat_read(&b) != 0;
+	uint64_t total = failed ? 0 : cpu_times_total(&b.total) -
+				      cpu_times_total(&a.total);
+	if (failed || b.core_count != CORES || total != 100 * CORES ||
+	    b.processes != pf.forks ||
+	    read_total_mem_bytes() != pf.mem_total_kb * 1024) {
+		fprintf(stderr, "FAIL: system files - %d cores, %lu jiffies\n",
+			b.core_count, (unsigned long)total);
+		failed = 1;
+	}
+	cpu_stat_free(&a);
+	cpu_stat_free(&b);
+
+	if (!failed) {
+		printf("PASS: system files\n");
+	}
+	return failed;
+}
+
+int main(void)
+{
+	int failures = 0;
+
+	printf("Running unit tests for the proc root...\n");
+
+	if (!mkdtemp(dir) || procfake_create(&pf, dir, PROCS, 1000) != 0 ||
+	    procdir_set_root(dir) != 0) {
+		fprintf(stderr, "FAIL: cannot build a fake /proc\n");
+		return 1;
+	}
+	process_table_init(&prev, PROCS);
+	process_table_init(&curr, PROCS);
+
+	failures += test_listing();
+	failures += test_cpu_follows_busy();
+	failures += test_vanished();
+	failures += test_pid_reuse();
+	failures += test_backed_off_reuse();
+	failures += test_cmdline_refresh();
+	failures += test_system_files();
+
+	process_table_free(&prev);
+	process_table_free(&curr);
+	cmdline_cleanup();
+	cpu_stat_close();
+	procdir_close();
+	procfake_remove(&pf, dir);
+
+	if (failures == 0) {
+		printf("All proc root tests passed.\n");
+		return 0;
+	} else {
+		fprintf(stderr, "%d test(s) failed.\n", failures);
+		return 1;
+	}
+}
@@ -0,0 +1,394 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../src/include/record.h"
+
+#define FRAMES 200
+#define ROWS 300
+#define CORES 4
+#define TOTAL_MEM (8ull << 30)
+#define TIME_MS 1700000000000ull
+
+static char path[] = "/tmp/test_record_XXXXXX";
+static Frame frames[FRAMES];
+
+static uint32_t rng = 12345;
+
+static uint32_t next_random(void)
+{
+	rng = rng * 1103515245u + 12345u;
+	return rng >> 8;
+}
+
+// Model of the process list the frames are generated from
+static struct {
+	int32_t pid[ROWS * 2];
+	uint64_t starttime[ROWS * 2];
+	uint64_t utime[ROWS * 2];
+	uint64_t mem[ROWS * 2];
+	char name[ROWS * 2][16];
+	int count;
+	int32_t next_pid;
+} model;
+
+static void model_spawn(int seq)
+{
+	int i = model.count++;
+	model.pid[i] = model.next_pid++;
+	model.starttime[i] = (uint64_t)seq * 100 + (uint64_t)i;
+	model.utime[i] = 0;
+	model.mem[i] = 4096u * (1 + next_random() % 1000);
+	snprintf(model.name[i], sizeof(model.name[i]), "proc%u",
+		 next_random() % 40);
+}
+
+// Advance the model by one tick: a few exits, forks, execs and busy rows
+static void model_step(int seq)
+{
+	for (int n = 0; n < 3 && model.count > 1; n++) {
+		int i = (int)(next_random() % (uint32_t)model.count);
+		model.count--;
+		model.pid[i] = model.pid[model.count];
+		model.starttime[i] = model.starttime[model.count];
+		model.utime[i] = model.utime[model.count];
+		model.mem[i] = model.mem[model.count];
+		memcpy(model.name[i], model.name[model.count], 16);
+	}
+	for (int n = 0; n < 3; n++) {
+		model_spawn(seq);
+	}
+	int exec = (int)(next_random() % (uint32_t)model.count);
+	snprintf(model.name[exec], sizeof(model.name[exec]), "exec%d", seq);
+	for (int n = 0; n < 10; n++) {
+		int i = (int)(next_random() % (uint32_t)model.count);
+		model.utime[i] += next_random() % 50;
+		model.mem[i] += 4096u * (next_random() % 4);
+	}
+}
+
+static int make_frame(Frame *f, int seq)
+{
+	memset(f, 0, sizeof(*f));
+	if (process_table_init(&f->table, ROWS * 2) != 0) {
+		return -1;
+	}
+
+	ProcessTable *t = &f->table;
+	t->names_len = 0;
+	process_table_add_name(t, "", 0);
+	for (int i = 0; i < model.count; i++) {
+		t->pid[i] = model.pid[i];
+		t->starttime[i] = model.starttime[i];
+		t->utime[i] = model.utime[i];
+		t->stime[i] = model.utime[i] / 3;
+		t->mem_bytes[i] = model.mem[i];
+		t->cpu_percent[i] = (double)(model.utime[i] % 977) / 10.0;
+		t->mem_percent[i] = (double)model.mem[i] / (double)TOTAL_MEM * 100.0;
+		t->flags[i] = PROC_MEM_VALID | (i % 5 ? PROC_CPU_VALID : 0) |
+			      (i % 7 == 0 ? PROC_STALE : 0);
+		t->name[i] = process_table_add_name(t, model.name[i],
+						    strlen(model.name[i]));
+		t->order[i] = (uint32_t)i;
+	}
+	t->count = model.count;
+	t->stale_count = model.count / 7;
+	t->sample_ns = (uint64_t)seq * 1000000000u;
+
+	CpuStat *st = &f->cpu_curr;
+	st->cores = calloc(CORES, sizeof(*st->cores));
+	if (!st->cores) {
+		return -1;
+	}
+	st->core_count = CORES;
+	st->core_capacity = CORES;
+	st->total.user = 1000u * (uint64_t)seq;
+	st->total.idle = 3000u * (uint64_t)seq;
+	for (int c = 0; c < CORES; c++) {
+		st->cores[c].user = 250u * (uint64_t)seq + (uint64_t)c;
+		st->cores[c].idle = 750u * (uint64_t)seq;
+	}
+	st->ctxt = 5000u * (uint64_t)seq;
+	st->processes = 3u * (uint64_t)seq;
+	st->procs_running = (uint64_t)seq % 5;
+
+	f->elapsed_s = 1.0;
+	f->cpu_load = 25.0 + seq % 10;
+	f->used_mem_bytes = TOTAL_MEM / 2 + (uint64_t)seq;
+	f->uptime_days = 1;
+	f->uptime_hours = 2;
+	f->uptime_minutes = seq % 60;
+	f->have_events = true;
+	f->events.forks = 3;
+	f->events.exits = 3;
+	f->events.execs = 1;
+	f->table_capacity = ROWS * 2;
+	f->seq = (uint64_t)seq;
+	return 0;
+}
+
+static int make_frames(void)
+{
+	model.count = 0;
+	model.next_pid = 100;
+	for (int i = 0; i < ROWS; i++) {
+		model_spawn(0);
+	}
+	for (int i = 0; i < FRAMES; i++) {
+		model_step(i + 1);
+		if (make_frame(&frames[i], i + 1) != 0) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static bool same_times(const CpuTimes *a, const CpuTimes *b)
+{
+	return memcmp(a, b, sizeof(*a)) == 0;
+}
+
+static bool same_stat(const CpuStat *a, const CpuStat *b)
+{
+	if (a->core_count != b->core_count || !same_times(&a->total, &b->total) ||
+	    a->ctxt != b->ctxt || a->processes != b->processes ||
+	    a->procs_running != b->procs_running) {
+		return false;
+	}
+	for (int c = 0; c < a->core_count; c++) {
+		if (!same_times(&a->cores[c], &b->cores[c])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Compare a replayed frame with the frame that was recorded
+static bool same_frame(const Frame *got, const Frame *want, const Frame *before)
+{
+	const ProcessTable *a = &got->table;
+	const ProcessTable *b = &want->table;
+
+	if (got->seq != want->seq || a->count != b->count ||
+	    a->stale_count != b->stale_count || a->sample_ns != b->sample_ns ||
+	    got->cpu_load != want->cpu_load ||
+	    got->used_mem_bytes != want->used_mem_bytes ||
+	    got->uptime_minutes != want->uptime_minutes ||
+	    got->events.forks != want->events.forks ||
+	    !same_stat(&got->cpu_curr, &want->cpu_curr) ||
+	    !same_stat(&got->cpu_prev, before ? &before->cpu_curr :
+						&want->cpu_curr)) {
+		return false;
+	}
+
+	for (int i = 0; i < a->count; i++) {
+		double cpu_err = a->cpu_percent[i] - b->cpu_percent[i];
+		double mem_err = a->mem_percent[i] - b->mem_percent[i];
+		if (a->pid[i] != b->pid[i] || a->starttime[i] != b->starttime[i] ||
+		    a->utime[i] != b->utime[i] || a->stime[i] != b->stime[i] ||
+		    a->mem_bytes[i] != b->mem_bytes[i] ||
+		    a->flags[i] != b->flags[i] ||
+		    cpu_err > 0.005 || cpu_err < -0.005 ||
+		    mem_err > 1e-9 || mem_err < -1e-9 ||
+		    strcmp(process_name(a, i), process_name(b, i)) != 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static int record_all(uint64_t ring_bytes)
+{
+	if (record_open(path, ring_bytes, TOTAL_MEM) != 0) {
+		return -1;
+	}
+	for (int i = 0; i < FRAMES; i++) {
+		if (record_frame(&frames[i], TIME_MS + (uint64_t)i * 1000) != 0) {
+			record_close();
+			return -1;
+		}
+	}
+	record_close();
+	return 0;
+}
+
+// Replay every frame in order, then in a scattered order
+static int check_replay(int *count)
+{
+	Frame got = {0};
+	int failed = 0;
+
+	if (replay_open(path) != 0 ||
+	    process_table_init(&got.table, PROCESS_TABLE_INITIAL_ROWS) != 0) {
+		return 1;
+	}
+	*count = replay_count();
+	int first = FRAMES - *count;
+
+	for (int pass = 0; pass < 2 && !failed; pass++) {
+		for (int n = 0; n < *count && !failed; n++) {
+			int k = pass == 0 ? n : (int)((uint32_t)n * 37u % (uint32_t)*count);
+			int i = first + k;
+			const Frame *before = i > 0 && k > 0 ? &frames[i - 1] : NULL;
+			if (replay_load(k, &got) != 0 ||
+			    replay_time_ms(k) != TIME_MS + (uint64_t)i * 1000 ||
+			    !same_frame(&got, &frames[i], before)) {
+				fprintf(stderr, "frame %d (seq %d) differs\n", k, i + 1);
+				failed = 1;
+			}
+		}
+	}
+
+	if (replay_total_mem_bytes() != TOTAL_MEM) {
+		failed = 1;
+	}
+	process_table_free(&got.table);
+	cpu_stat_free(&got.cpu_prev);
+	cpu_stat_free(&got.cpu_curr);
+	replay_close();
+	return failed;
+}
+
+// Test: every frame replays exactly, in order and by random access
+static int test_round_trip(void)
+{
+	int count = 0;
+	if (record_all(16u << 20) != 0 || check_replay(&count) != 0 ||
+	    count != FRAMES) {
+		fprintf(stderr, "FAIL: round trip - %d of %d frames\n", count,
+			FRAMES);
+		return 1;
+	}
+
+	printf("PASS: round trip\n");
+	return 0;
+}
+
+// Test: a small ring keeps the newest frames, starting at a key record
+static int test_wrap(void)
+{
+	int count = 0;
+	unlink(path);
+	if (record_all(32u << 10) != 0 || check_replay(&count) != 0 ||
+	    count == 0 || count >= FRAMES) {
+		fprintf(stderr, "FAIL: wrap - %d of %d frames replayable\n",
+			count, FRAMES);
+		return 1;
+	}
+
+	printf("PASS: wrap (%d of %d frames kept)\n", count, FRAMES);
+	return 0;
+}
+
+// Test: reopening a ring of the same size appends to it
+static int test_reopen(void)
+{
+	unlink(path);
+	int failed = 0;
+
+	for (int run = 0; run < 2 && !failed; run++) {
+		failed |= record_open(path, 4u << 20, TOTAL_MEM) != 0;
+		for (int i = 0; i < 10 && !failed; i++) {
+			failed |= record_frame(&frames[i], TIME_MS) != 0;
+		}
+		record_close();
+	}
+	failed |= replay_open(path) != 0 || replay_count() != 20;
+	replay_close();
+
+	// A different size starts over
+	failed |= record_open(path, 8u << 20, TOTAL_MEM) != 0;
+	record_close();
+	failed |= replay_open(path) != 0 || replay_count() != 0;
+	replay_close();
+
+	if (failed) {
+		fprintf(stderr, "FAIL: reopen\n");
+		return 1;
+	}
+
+	printf("PASS: reopen\n");
+	return 0;
+}
+
+// Ring head offset, read from the file header
+static uint64_t ring_head(void)
+{
+	uint64_t head = 0;
+	FILE *f = fopen(path, "rb");
+	if (f) {
+		if (fseek(f, 24, SEEK_SET) != 0 ||
+		    fread(&head, sizeof(head), 1, f) != 1) {
+			head = 0;
+		}
+		fclose(f);
+	}
+	return head;
+}
+
+// Test: an unchanged frame costs its header and CPU counters, not rows
+static int test_delta_size(void)
+{
+	unlink(path);
+	int failed = record_open(path, 4u << 20, TOTAL_MEM) != 0;
+	failed |= record_frame(&frames[0], TIME_MS) != 0;
+	record_close();
+	uint64_t key = ring_head();
+
+	failed |= record_open(path, 4u << 20, TOTAL_MEM) != 0;
+	failed |= record_frame(&frames[0], TIME_MS) != 0;
+	for (int i = 0; i < 10; i++) {
+		failed |= record_frame(&frames[0], TIME_MS) != 0;
+	}
+	record_close();
+	uint64_t delta = (ring_head() - 2 * key) / 10;
+
+	if (failed || delta > 192 || key < ROWS * 8) {
+		fprintf(stderr, "FAIL: delta size - %lu bytes per unchanged frame\n",
+			(unsigned long)delta);
+		return 1;
+	}
+
+	printf("PASS: delta size (key %lu bytes, unchanged delta %lu bytes)\n",
+	       (unsigned long)key, (unsigned long)delta);
+	return 0;
+}
+
+int main(void)
+{
+	int failures = 0;
+
+	printf("Running unit tests for the flight recorder...\n");
+
+	int fd = mkstemp(path);
+	if (fd < 0) {
+		fprintf(stderr, "FAIL: cannot create temporary file\n");
+		return 1;
+	}
+	close(fd);
+
+	if (make_frames() != 0) {
+		fprintf(stderr, "FAIL: out of memory\n");
+		unlink(path);
+		return 1;
+	}
+
+	failures += test_round_trip();
+	failures += test_wrap();
+	failures += test_reopen();
+	failures += test_delta_size();
+
+	for (int i = 0; i < FRAMES; i++) {
+		process_table_free(&frames[i].table);
+		cpu_stat_free(&frames[i].cpu_curr);
+	}
+	unlink(path);
+
+	if (failures == 0) {
+		printf("All flight recorder tests passed.\n");
+		return 0;
+	} else {
+		fprintf(stderr, "%d test(s) failed.\n", failures);
+		return 1;
+	}
+}
@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "../src/include/selfstat.h"
+#include "../src/include/syscount.h"
+
+// Worst-case error of a bucket midpoint, with some slack
+#define TOLERANCE 0.125
+
+static int near(uint64_t got, uint64_t want)
+{
+	double diff = (double)got - (double)want;
+	return (diff < 0 ? -diff : diff) <= (double)want * TOLERANCE;
+}
+
+// Test: p50 and p99 of a known spread land in the right buckets
+static int test_percentiles(void)
+{
+	SelfStats s;
+
+	selfstat_reset();
+	for (int i = 1; i <= 100; i++) {
+		selfstat_record(PHASE_SORT, (uint64_t)i * 1000);
+	}
+	selfstat_read(&s);
+	if (s.samples[PHASE_SORT] != 100 || !near(s.p50_ns[PHASE_SORT], 50000) ||
+	    !near(s.p99_ns[PHASE_SORT], 99000)) {
+		fprintf(stderr, "FAIL: percentiles - %u samples, p50 %lu, p99 %lu\n",
+			s.samples[PHASE_SORT], (unsigned long)s.p50_ns[PHASE_SORT],
+			(unsigned long)s.p99_ns[PHASE_SORT]);
+		return 1;
+	}
+	if (s.samples[PHASE_COLLECT] != 0 || s.p99_ns[PHASE_COLLECT] != 0) {
+		fprintf(stderr, "FAIL: percentiles - unrecorded phase has samples\n");
+		return 1;
+	}
+
+	printf("PASS: percentiles\n");
+	return 0;
+}
+
+// Test: old samples roll out once two windows of new ones came in
+static int test_rolling_window(void)
+{
+	SelfStats s;
+
+	selfstat_reset();
+	for (int i = 0; i < 3 * SELFSTAT_WINDOW; i++) {
+		selfstat_record(PHASE_RENDER, 1000000);
+	}
+	for (int i = 0; i < 2 * SELFSTAT_WINDOW; i++) {
+		selfstat_record(PHASE_RENDER, 10000);
+	}
+	selfstat_read(&s);
+	if (s.samples[PHASE_RENDER] < SELFSTAT_WINDOW ||
+	    s.samples[PHASE_RENDER] > 2 * SELFSTAT_WINDOW ||
+	    !near(s.p99_ns[PHASE_RENDER], 10000)) {
+		fprintf(stderr, "FAIL: rolling window - %u samples, p99 %lu\n",
+			s.samples[PHASE_RENDER],
+			(unsigned long)s.p99_ns[PHASE_RENDER]);
+		return 1;
+	}
+
+	printf("PASS: rolling window\n");
+	return 0;
+}
+
+// Test: a tick reports the /proc traffic since the previous one
+static int test_tick_traffic(void)
+{
+	SelfStats s;
+
+	selfstat_reset();
+	syscount_add(7, 7000);
+	selfstat_end_tick();
+	syscount_add(3, 512);
+	selfstat_end_tick();
+	selfstat_read(&s);
+	if (s.proc_syscalls != 3 || s.proc_bytes != 512) {
+		fprintf(stderr, "FAIL: tick traffic - %lu syscalls, %lu bytes\n",
+			(unsigned long)s.proc_syscalls, (unsigned long)s.proc_bytes);
+		return 1;
+	}
+
+	printf("PASS: tick traffic\n");
+	return 0;
+}
+
+// Test: resident memory and CPU usage of a busy process are seen
+static int test_resources(void)
+{
+	SelfStats s;
+
+	selfstat_reset();
+	selfstat_read(&s);
+	uint64_t start = selfstat_now();
+	volatile uint64_t spin = 0;
+	while (selfstat_now() - start < 600000000u) {
+		spin++;
+	}
+	selfstat_read(&s);
+	if (s.rss_bytes == 0 || s.cpu_percent < 50.0 || s.cpu_percent > 200.0) {
+		fprintf(stderr, "FAIL: resources - RSS %lu, CPU %.1f%%\n",
+			(unsigned long)s.rss_bytes, s.cpu_percent);
+		return 1;
+	}
+
+	printf("PASS: resources (CPU %.1f%%)\n", s.cpu_percent);
+	return 0;
+}
+
+int main(void)
+{
+	int failures = 0;
+
+	printf("Running unit tests for self statistics...\n");
+
+	failures += test_percentiles();
+	failures += test_rolling_window();
+	failures += test_tick_traffic();
+	failures += test_resources();
+
+	if (failures == 0) {
+		printf("All self statistics tests passed.\n");
+		return 0;
+	} else {
+		fprintf(stderr, "%d test(s) failed.\n", failures);
+		return 1;
+	}
+}
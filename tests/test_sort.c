@@ -5,33 +5,69 @@
 #include "../src/include/process.h"
 #include "../src/include/sort.h"
 
-// Test data: synthetic ProcessInfo arrays
-static void create_test_data(ProcessInfo *procs, int count)
+#define TEST_ROWS 5
+
+// Test data: synthetic process table backed by static columns
+static int32_t pid_col[TEST_ROWS];
+static uint64_t mem_bytes_col[TEST_ROWS];
+static double cpu_col[TEST_ROWS];
+static double mem_col[TEST_ROWS];
+static uint8_t flags_col[TEST_ROWS];
+static uint32_t order_col[TEST_ROWS];
+
+static void create_test_data(ProcessTable *procs, int count)
 {
+	memset(procs, 0, sizeof(*procs));
+	procs->count = count;
+	procs->capacity = TEST_ROWS;
+	procs->pid = pid_col;
+	procs->mem_bytes = mem_bytes_col;
+	procs->cpu_percent = cpu_col;
+	procs->mem_percent = mem_col;
+	procs->flags = flags_col;
+	procs->order = order_col;
+
 	for (int i = 0; i < count; i++) {
-		procs[i].pid = 1000 + i;
-		snprintf(procs[i].name, sizeof(procs[i].name), "proc%d", i);
-		procs[i].cpu_percent = (double)(count - i) * 10.0;
-		procs[i].mem_percent = (double)(i + 1) * 5.0;
-		procs[i].cpu_valid = true;
-		procs[i].mem_valid = true;
-		procs[i].mem_bytes = (i + 1) * 1024 * 1024;
-		procs[i].cmdline[0] = '\0';
-		procs[i].cmd_valid = false;
+		procs->pid[i] = 1000 + i;
+		procs->cpu_percent[i] = (double)(count - i) * 10.0;
+		procs->mem_percent[i] = (double)(i + 1) * 5.0;
+		procs->flags[i] = PROC_CPU_VALID | PROC_MEM_VALID;
+		procs->mem_bytes[i] = (i + 1) * 1024 * 1024;
+		procs->order[i] = (uint32_t)i;
 	}
 }
 
+// Check that order is a permutation of all rows
+static bool is_permutation(const ProcessTable *procs)
+{
+	bool seen[TEST_ROWS] = {false};
+	for (int i = 0; i < procs->count; i++) {
+		uint32_t row = procs->order[i];
+		if (row >= (uint32_t)procs->count || seen[row]) {
+			return false;
+		}
+		seen[row] = true;
+	}
+	return true;
+}
+
 // Test: sort_by_cpu descending (default)
 static int test_sort_cpu_desc(void)
 {
-	ProcessInfo procs[5];
-	create_test_data(procs, 5);
+	ProcessTable procs;
+	create_test_data(&procs, TEST_ROWS);
+
+	sort_by_cpu(&procs, false);
 
-	sort_by_cpu(procs, 5, false);
+	if (!is_permutation(&procs)) {
+		fprintf(stderr, "FAIL: sort_cpu_desc - order is not a permutation\n");
+		return 1;
+	}
 
 	// After sort: highest CPU first
 	for (int i = 0; i < 4; i++) {
-		if (procs[i].cpu_percent < procs[i + 1].cpu_percent) {
+		if (procs.cpu_percent[procs.order[i]] <
+		    procs.cpu_percent[procs.order[i + 1]]) {
 			fprintf(stderr, "FAIL: sort_cpu_desc - order incorrect\n");
 			return 1;
 		}
@@ -44,14 +80,20 @@ static int test_sort_cpu_desc(void)
 // Test: sort_by_cpu ascending (reversed)
 static int test_sort_cpu_asc(void)
 {
-	ProcessInfo procs[5];
-	create_test_data(procs, 5);
+	ProcessTable procs;
+	create_test_data(&procs, TEST_ROWS);
+
+	sort_by_cpu(&procs, true);
 
-	sort_by_cpu(procs, 5, true);
+	if (!is_permutation(&procs)) {
+		fprintf(stderr, "FAIL: sort_cpu_asc - order is not a permutation\n");
+		return 1;
+	}
 
 	// After sort: lowest CPU first
 	for (int i = 0; i < 4; i++) {
-		if (procs[i].cpu_percent > procs[i + 1].cpu_percent) {
+		if (procs.cpu_percent[procs.order[i]] >
+		    procs.cpu_percent[procs.order[i + 1]]) {
 			fprintf(stderr, "FAIL: sort_cpu_asc - order incorrect\n");
 			return 1;
 		}
@@ -64,14 +106,20 @@ static int test_sort_cpu_asc(void)
 // Test: sort_by_mem descending (default)
 static int test_sort_mem_desc(void)
 {
-	ProcessInfo procs[5];
-	create_test_data(procs, 5);
+	ProcessTable procs;
+	create_test_data(&procs, TEST_ROWS);
+
+	sort_by_mem(&procs, false);
 
-	sort_by_mem(procs, 5, false);
+	if (!is_permutation(&procs)) {
+		fprintf(stderr, "FAIL: sort_mem_desc - order is not a permutation\n");
+		return 1;
+	}
 
 	// After sort: highest MEM first
 	for (int i = 0; i < 4; i++) {
-		if (procs[i].mem_percent < procs[i + 1].mem_percent) {
+		if (procs.mem_percent[procs.order[i]] <
+		    procs.mem_percent[procs.order[i + 1]]) {
 			fprintf(stderr, "FAIL: sort_mem_desc - order incorrect\n");
 			return 1;
 		}
@@ -84,14 +132,20 @@ static int test_sort_mem_desc(void)
 // Test: sort_by_mem ascending (reversed)
 static int test_sort_mem_asc(void)
 {
-	ProcessInfo procs[5];
-	create_test_data(procs, 5);
+	ProcessTable procs;
+	create_test_data(&procs, TEST_ROWS);
 
-	sort_by_mem(procs, 5, true);
+	sort_by_mem(&procs, true);
+
+	if (!is_permutation(&procs)) {
+		fprintf(stderr, "FAIL: sort_mem_asc - order is not a permutation\n");
+		return 1;
+	}
 
 	// After sort: lowest MEM first
 	for (int i = 0; i < 4; i++) {
-		if (procs[i].mem_percent > procs[i + 1].mem_percent) {
+		if (procs.mem_percent[procs.order[i]] >
+		    procs.mem_percent[procs.order[i + 1]]) {
 			fprintf(stderr, "FAIL: sort_mem_asc - order incorrect\n");
 			return 1;
 		}
@@ -101,6 +155,125 @@ static int test_sort_mem_asc(void)
 	return 0;
 }
 
+#define WINDOW_ROWS 1000
+
+// Test: sort_window matches a full sort on the requested window
+static int test_sort_window(void)
+{
+	static double cpu[WINDOW_ROWS], mem[WINDOW_ROWS];
+	static uint32_t full_order[WINDOW_ROWS], window_order[WINDOW_ROWS];
+	static bool seen[WINDOW_ROWS];
+	const int windows[][2] = { {0, 20}, {35, 40}, {0, 1}, {900, 50} };
+
+	srand(42);
+	for (int i = 0; i < WINDOW_ROWS; i++) {
+		// Few distinct values, so ties are common
+		cpu[i] = (double)(rand() % 50) / 4.0;
+		mem[i] = (double)(rand() % 500);
+	}
+
+	ProcessTable full = { .count = WINDOW_ROWS, .capacity = WINDOW_ROWS,
+			      .cpu_percent = cpu, .mem_percent = mem,
+			      .order = full_order };
+	ProcessTable window = full;
+	window.order = window_order;
+
+	for (int r = 0; r < 2; r++) {
+		for (size_t w = 0; w < sizeof(windows) / sizeof(windows[0]); w++) {
+			int offset = windows[w][0];
+			int height = windows[w][1];
+			int end = offset + height;
+
+			sort_by_cpu(&full, r);
+			sort_window(&window, SORT_CPU, r, offset, height);
+
+			for (int i = offset; i < end; i++) {
+				if (window_order[i] != full_order[i]) {
+					fprintf(stderr, "FAIL: sort_window - row %d differs (offset %d, reversed %d)\n",
+						i, offset, r);
+					return 1;
+				}
+			}
+
+			memset(seen, 0, sizeof(seen));
+			for (int i = 0; i < WINDOW_ROWS; i++) {
+				if (window_order[i] >= WINDOW_ROWS ||
+				    seen[window_order[i]]) {
+					fprintf(stderr, "FAIL: sort_window - order is not a permutation\n");
+					return 1;
+				}
+				seen[window_order[i]] = true;
+			}
+		}
+	}
+
+	printf("PASS: sort_window\n");
+	return 0;
+}
+
+// Test: sort_rows orders a subset like a full sort, restricted to it
+static int test_sort_rows(void)
+{
+	static double cpu[WINDOW_ROWS], mem[WINDOW_ROWS];
+	static uint32_t full_order[WINDOW_ROWS], expected[WINDOW_ROWS];
+	static uint32_t rows[WINDOW_ROWS], out[WINDOW_ROWS];
+	static bool member[WINDOW_ROWS];
+	const int windows[][2] = { {0, 20}, {35, 40}, {300, 33}, {0, 200} };
+
+	srand(7);
+	for (int i = 0; i < WINDOW_ROWS; i++) {
+		cpu[i] = (double)(rand() % 50) / 4.0;
+		mem[i] = (double)(rand() % 100);
+	}
+	ProcessTable t = { .count = WINDOW_ROWS, .capacity = WINDOW_ROWS,
+			   .cpu_percent = cpu, .mem_percent = mem,
+			   .order = full_order };
+
+	// Every third row, as a filter would leave them: in table order
+	int count = 0;
+	for (int i = 0; i < WINDOW_ROWS; i += 3) {
+		rows[count++] = (uint32_t)i;
+		member[i] = true;
+	}
+
+	for (int r = 0; r < 2; r++) {
+		sort_by_mem(&t, r);
+		int n = 0;
+		for (int i = 0; i < WINDOW_ROWS; i++) {
+			if (member[full_order[i]]) {
+				expected[n++] = full_order[i];
+			}
+		}
+
+		for (size_t w = 0; w < sizeof(windows) / sizeof(windows[0]); w++) {
+			int offset = windows[w][0];
+			int height = windows[w][1];
+
+			sort_rows(&t, SORT_MEM, r, rows, count, offset, height, out);
+			for (int i = offset; i < offset + height && i < count; i++) {
+				if (out[i] != expected[i]) {
+					fprintf(stderr, "FAIL: sort_rows - row %d differs (offset %d, reversed %d)\n",
+						i, offset, r);
+					return 1;
+				}
+			}
+
+			bool seen[WINDOW_ROWS] = {false};
+			for (int i = 0; i < count; i++) {
+				if (out[i] >= WINDOW_ROWS || !member[out[i]] ||
+				    seen[out[i]]) {
+					fprintf(stderr, "FAIL: sort_rows - not a permutation of the subset\n");
+					return 1;
+				}
+				seen[out[i]] = true;
+			}
+		}
+	}
+
+	printf("PASS: sort_rows\n");
+	return 0;
+}
+
 int main(void)
 {
 	int failures = 0;
@@ -111,6 +284,8 @@ int main(void)
 	failures += test_sort_cpu_asc();
 	failures += test_sort_mem_desc();
 	failures += test_sort_mem_asc();
+	failures += test_sort_window();
+	failures += test_sort_rows();
 
 	if (failures == 0) {
 		printf("All sorting tests passed.\n");
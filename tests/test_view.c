@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/include/process.h"
+#include "../src/include/view.h"
+
+#define ROWS 8
+
+typedef struct {
+	int pid;
+	uint64_t starttime;
+	const char *name;
+} Proc;
+
+static ProcessTable table;
+static FilterView view;
+
+// Fill the table with @procs as a snapshot taken at second @tick
+static void snapshot(const Proc *procs, int count, int tick)
+{
+	table.count = 0;
+	table.names_len = 0;
+	for (int i = 0; i < count; i++) {
+		table.pid[i] = procs[i].pid;
+		table.starttime[i] = procs[i].starttime;
+		table.name[i] = process_table_add_name(&table, procs[i].name,
+						       strlen(procs[i].name));
+		table.order[i] = (uint32_t)i;
+		table.count++;
+	}
+	table.sample_ns = (uint64_t)tick * 1000000000u;
+}
+
+// Matching PIDs, in row order, as "pid pid ..."
+static const char *match_pids(void)
+{
+	static char buf[128];
+	int len = 0;
+
+	buf[0] = '\0';
+	for (int i = 0; i < view.count; i++) {
+		len += snprintf(buf + len, sizeof(buf) - (size_t)len, "%s%d",
+				i ? " " : "", table.pid[view.rows[i]]);
+	}
+	return buf;
+}
+
+static const Proc first[] = {
+	{ 1, 10, "init" },
+	{ 20, 20, "bash" },
+	{ 21, 21, "sshd" },
+	{ 30, 30, "bashful" },
+	{ 31, 31, "zsh" },
+};
+
+// Test: the rows of a first snapshot are matched in table order
+static int test_first_snapshot(void)
+{
+	snapshot(first, 5, 1);
+	int count = view_update(&view, &table, "bash");
+	if (count != 2 || strcmp(match_pids(), "20 30") != 0) {
+		fprintf(stderr, "FAIL: first snapshot - %d matches (%s)\n",
+			count, match_pids());
+		return 1;
+	}
+
+	printf("PASS: first snapshot\n");
+	return 0;
+}
+
+// Test: drawing the same snapshot again reuses the rows as they are
+static int test_same_snapshot(void)
+{
+	// Not a new snapshot, so the changed name is not looked at
+	table.name[2] = process_table_add_name(&table, "bash", 4);
+	int count = view_update(&view, &table, "bash");
+	if (count != 2 || strcmp(match_pids(), "20 30") != 0) {
+		fprintf(stderr, "FAIL: same snapshot - %d matches (%s)\n", count,
+			match_pids());
+		return 1;
+	}
+
+	printf("PASS: same snapshot\n");
+	return 0;
+}
+
+// Test: the next snapshot is matched again, renamed processes included
+static int test_next_snapshot(void)
+{
+	static const Proc next[] = {
+		{ 1, 10, "init" },
+		{ 20, 20, "bash" },
+		{ 21, 21, "bash" },     // renamed
+		{ 31, 31, "zsh" },      // 30 exited
+		{ 40, 40, "bashbug" },  // new
+		{ 41, 41, "top" },      // new
+	};
+
+	snapshot(next, 6, 2);
+	int count = view_update(&view, &table, "bash");
+	if (count != 3 || strcmp(match_pids(), "20 21 40") != 0) {
+		fprintf(stderr, "FAIL: next snapshot - %d matches (%s)\n",
+			count, match_pids());
+		return 1;
+	}
+
+	printf("PASS: next snapshot\n");
+	return 0;
+}
+
+// Test: a new term matches every name again; no term matches nothing
+static int test_term_change(void)
+{
+	int count = view_update(&view, &table, "sh");
+	if (count != 4 || strcmp(match_pids(), "20 21 31 40") != 0) {
+		fprintf(stderr, "FAIL: term change - %d matches (%s)\n",
+			count, match_pids());
+		return 1;
+	}
+
+	count = view_update(&view, &table, "");
+	int again = view_update(&view, &table, "sh");
+	if (count != 0 || again != 4) {
+		fprintf(stderr, "FAIL: term change - cleared %d, again %d\n",
+			count, again);
+		return 1;
+	}
+
+	printf("PASS: term change\n");
+	return 0;
+}
+
+int main(void)
+{
+	int failures = 0;
+
+	printf("Running unit tests for the filter view...\n");
+
+	if (process_table_init(&table, ROWS) != 0) {
+		fprintf(stderr, "FAIL: out of memory\n");
+		return 1;
+	}
+	view_init(&view);
+
+	failures += test_first_snapshot();
+	failures += test_same_snapshot();
+	failures += test_next_snapshot();
+	failures += test_term_change();
+
+	view_free(&view);
+	process_table_free(&table);
+
+	if (failures == 0) {
+		printf("All filter view tests passed.\n");
+		return 0;
+	} else {
+		fprintf(stderr, "%d test(s) failed.\n", failures);
+		return 1;
+	}
+}
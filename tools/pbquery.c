@@ -0,0 +1,397 @@
+#define _GNU_SOURCE // strptime()
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "history.h"
+#include "pidmap.h"
+
+/*
+ * pbquery: time range plus predicate queries over a --history directory.
+ * Prints matching rows as CSV, or one line per PID with --summary.
+ */
+
+// Per-PID totals for --summary
+typedef struct {
+	int pid;
+	uint64_t rows;
+	uint64_t first_ms;
+	uint64_t last_ms;
+	uint64_t cpu_sum;    // hundredths of a percent
+	uint32_t cpu_max;
+	uint64_t rss_max;
+} PidSummary;
+
+typedef struct {
+	bool summary;
+	PidMap index;        // pid -> slot in pids
+	PidSummary *pids;
+	int count;
+	int capacity;
+} QueryState;
+
+static void print_usage(FILE *out, const char *prog)
+{
+	fprintf(out,
+		"Usage: %s [OPTION]... DIR\n"
+		"Print the rows of the history in DIR (see --history) that match.\n"
+		"\n"
+		"  -f, --from TIME     first time to include\n"
+		"  -t, --to TIME       last time to include\n"
+		"  -w, --where PRED    only rows matching PRED, such as cpu>80,\n"
+		"                      rss>=512M or pid=1234; may be repeated\n"
+		"  -s, --summary       one line per PID instead of every row\n"
+		"  -h, --help          show this help and exit\n"
+		"\n"
+		"TIME is seconds since the epoch, \"YYYY-MM-DD HH:MM[:SS]\" or\n"
+		"\"HH:MM[:SS]\" today, in local time. PRED compares cpu (percent),\n"
+		"rss (bytes, with an optional K, M or G suffix) or pid using <, <=,\n"
+		"=, >= or >. Query statistics are printed on stderr.\n",
+		prog);
+}
+
+/**
+ * parse_time() - Parse a --from or --to argument
+ * @arg: Option argument
+ * @out: Milliseconds since the epoch
+ *
+ * Return: 0 on success, -1 if @arg is not a time
+ */
+static int parse_time(const char *arg, uint64_t *out)
+{
+	char *end;
+	unsigned long long secs = strtoull(arg, &end, 10);
+	if (end != arg && *end == '\0') {
+		*out = secs * 1000;
+		return 0;
+	}
+
+	struct tm tm;
+	time_t now = time(NULL);
+	localtime_r(&now, &tm);
+	tm.tm_sec = 0;
+	end = strptime(arg, "%Y-%m-%d %H:%M", &tm);
+	if (!end) {
+		// A failed parse may have changed some fields
+		localtime_r(&now, &tm);
+		tm.tm_sec = 0;
+		end = strptime(arg, "%H:%M", &tm);
+	}
+	if (end && *end == ':') {
+		end = strptime(end, ":%S", &tm);
+	}
+	if (!end || *end != '\0') {
+		return -1;
+	}
+
+	tm.tm_isdst = -1;
+	time_t t = mktime(&tm);
+	if (t < 0) {
+		return -1;
+	}
+	*out = (uint64_t)t * 1000;
+	return 0;
+}
+
+/**
+ * narrow() - Intersect a column's bounds with a comparison
+ * @min: Lower bound to raise
+ * @max: Upper bound to lower
+ * @op: "<", "<=", "=", ">=" or ">"
+ * @v: Value compared to
+ * @limit: Largest value of the column
+ *
+ * Return: 0 on success, -1 if @op is unknown
+ */
+static int narrow(uint64_t *min, uint64_t *max, const char *op, uint64_t v,
+		  uint64_t limit)
+{
+	uint64_t lo = 0, hi = limit;
+
+	if (v > limit) {
+		v = limit;
+	}
+	if (strcmp(op, "<") == 0) {
+		if (v == 0) {
+			lo = 1; // nothing matches
+			hi = 0;
+		} else {
+			hi = v - 1;
+		}
+	} else if (strcmp(op, "<=") == 0) {
+		hi = v;
+	} else if (strcmp(op, "=") == 0) {
+		lo = v;
+		hi = v;
+	} else if (strcmp(op, ">=") == 0) {
+		lo = v;
+	} else if (strcmp(op, ">") == 0) {
+		if (v == limit) {
+			lo = 1;
+			hi = 0;
+		} else {
+			lo = v + 1;
+		}
+	} else {
+		return -1;
+	}
+
+	if (lo > *min) {
+		*min = lo;
+	}
+	if (hi < *max) {
+		*max = hi;
+	}
+	return 0;
+}
+
+/**
+ * parse_where() - Add a --where predicate to the query bounds
+ * @arg: Option argument, such as "cpu>80"
+ * @want: Query bounds to narrow
+ *
+ * Return: 0 on success, -1 if @arg is not a predicate
+ */
+static int parse_where(const char *arg, HistoryRange *want)
+{
+	size_t name_len = strcspn(arg, "<=>");
+	size_t op_len = strspn(arg + name_len, "<=>");
+	if (name_len == 0 || op_len == 0 || op_len > 2) {
+		return -1;
+	}
+
+	char op[3] = { 0 };
+	memcpy(op, arg + name_len, op_len);
+	const char *value = arg + name_len + op_len;
+	char *end;
+
+	if (strncmp(arg, "cpu", name_len) == 0 && name_len == 3) {
+		double percent = strtod(value, &end);
+		if (end == value || *end != '\0' || percent < 0.0 ||
+		    percent > 1e7) {
+			return -1;
+		}
+		uint64_t min = want->cpu_min, max = want->cpu_max;
+		if (narrow(&min, &max, op, (uint64_t)(percent * 100.0 + 0.5),
+			   UINT32_MAX) != 0) {
+			return -1;
+		}
+		want->cpu_min = (uint32_t)min;
+		want->cpu_max = (uint32_t)max;
+	} else if (strncmp(arg, "rss", name_len) == 0 && name_len == 3) {
+		uint64_t bytes = strtoull(value, &end, 10);
+		if (end == value) {
+			return -1;
+		}
+		const char *units = "KMG";
+		const char *unit = *end ? strchr(units, *end) : NULL;
+		if (unit) {
+			bytes <<= 10 * (unit - units + 1);
+			end++;
+		}
+		if (*end != '\0') {
+			return -1;
+		}
+		return narrow(&want->rss_min, &want->rss_max, op, bytes,
+			      UINT64_MAX);
+	} else if (strncmp(arg, "pid", name_len) == 0 && name_len == 3) {
+		long pid = strtol(value, &end, 10);
+		if (end == value || *end != '\0' || pid < 0 || pid > INT32_MAX) {
+			return -1;
+		}
+		uint64_t min = want->pid_min < 0 ? 0 : (uint64_t)want->pid_min;
+		uint64_t max = want->pid_max < 0 ? 0 : (uint64_t)want->pid_max;
+		if (narrow(&min, &max, op, (uint64_t)pid, INT32_MAX) != 0) {
+			return -1;
+		}
+		want->pid_min = (int32_t)min;
+		want->pid_max = (int32_t)max;
+		if (min > max) {
+			want->pid_max = want->pid_min - 1;
+		}
+	} else {
+		return -1;
+	}
+	return 0;
+}
+
+static void format_time(uint64_t time_ms, char *buf, size_t size)
+{
+	time_t t = (time_t)(time_ms / 1000);
+	struct tm tm;
+
+	localtime_r(&t, &tm);
+	size_t n = strftime(buf, size, "%Y-%m-%d %H:%M:%S", &tm);
+	snprintf(buf + n, size - n, ".%03u", (unsigned)(time_ms % 1000));
+}
+
+static PidSummary *summary_slot(QueryState *q, int pid)
+{
+	int slot = pidmap_find(&q->index, pid, 0);
+	if (slot >= 0) {
+		return &q->pids[slot];
+	}
+
+	if (q->count == q->capacity) {
+		int capacity = q->capacity ? q->capacity * 2 : 1024;
+		PidSummary *pids = realloc(q->pids, (size_t)capacity * sizeof(*pids));
+		if (!pids) {
+			return NULL;
+		}
+		q->pids = pids;
+		q->capacity = capacity;
+	}
+	if (pidmap_insert(&q->index, pid, 0, q->count) != 0) {
+		return NULL;
+	}
+
+	PidSummary *s = &q->pids[q->count++];
+	memset(s, 0, sizeof(*s));
+	s->pid = pid;
+	s->first_ms = UINT64_MAX;
+	return s;
+}
+
+static int on_rows(void *ctx, const HistoryRows *rows)
+{
+	QueryState *q = ctx;
+	char when[32];
+
+	for (int i = 0; i < rows->count; i++) {
+		if (!q->summary) {
+			format_time(rows->time_ms[i], when, sizeof(when));
+			printf("%s,%d,%u.%02u,%llu\n", when, rows->pid[i],
+			       rows->cpu[i] / 100, rows->cpu[i] % 100,
+			       (unsigned long long)rows->rss[i]);
+			continue;
+		}
+
+		PidSummary *s = summary_slot(q, rows->pid[i]);
+		if (!s) {
+			fprintf(stderr, "Out of memory\n");
+			return 1;
+		}
+		s->rows++;
+		if (rows->time_ms[i] < s->first_ms) {
+			s->first_ms = rows->time_ms[i];
+		}
+		if (rows->time_ms[i] > s->last_ms) {
+			s->last_ms = rows->time_ms[i];
+		}
+		s->cpu_sum += rows->cpu[i];
+		if (rows->cpu[i] > s->cpu_max) {
+			s->cpu_max = rows->cpu[i];
+		}
+		if (rows->rss[i] > s->rss_max) {
+			s->rss_max = rows->rss[i];
+		}
+	}
+	return 0;
+}
+
+static int summary_cmp(const void *a, const void *b)
+{
+	const PidSummary *x = a, *y = b;
+	return (x->pid > y->pid) - (x->pid < y->pid);
+}
+
+static void print_summary(QueryState *q)
+{
+	char first[32], last[32];
+
+	qsort(q->pids, (size_t)q->count, sizeof(*q->pids), summary_cmp);
+	printf("pid,rows,first,last,cpu_avg,cpu_max,rss_max\n");
+	for (int i = 0; i < q->count; i++) {
+		const PidSummary *s = &q->pids[i];
+		uint64_t avg = (s->cpu_sum + s->rows / 2) / s->rows;
+		format_time(s->first_ms, first, sizeof(first));
+		format_time(s->last_ms, last, sizeof(last));
+		printf("%d,%llu,%s,%s,%llu.%02llu,%u.%02u,%llu\n", s->pid,
+		       (unsigned long long)s->rows, first, last,
+		       (unsigned long long)(avg / 100),
+		       (unsigned long long)(avg % 100),
+		       s->cpu_max / 100, s->cpu_max % 100,
+		       (unsigned long long)s->rss_max);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option long_opts[] = {
+		{"from", required_argument, NULL, 'f'},
+		{"to", required_argument, NULL, 't'},
+		{"where", required_argument, NULL, 'w'},
+		{"summary", no_argument, NULL, 's'},
+		{"help", no_argument, NULL, 'h'},
+		{NULL, 0, NULL, 0},
+	};
+	QueryState q = { 0 };
+	HistoryRange want;
+	int opt;
+
+	history_range_all(&want);
+	while ((opt = getopt_long(argc, argv, "f:t:w:sh", long_opts, NULL)) != -1) {
+		switch (opt) {
+		case 'f':
+			if (parse_time(optarg, &want.time_min) != 0) {
+				fprintf(stderr, "%s: invalid time '%s'\n", argv[0], optarg);
+				return 2;
+			}
+			break;
+		case 't':
+			if (parse_time(optarg, &want.time_max) != 0) {
+				fprintf(stderr, "%s: invalid time '%s'\n", argv[0], optarg);
+				return 2;
+			}
+			want.time_max += 999; // the whole second
+			break;
+		case 'w':
+			if (parse_where(optarg, &want) != 0) {
+				fprintf(stderr, "%s: invalid predicate '%s'\n", argv[0], optarg);
+				return 2;
+			}
+			break;
+		case 's':
+			q.summary = true;
+			break;
+		case 'h':
+			print_usage(stdout, argv[0]);
+			return 0;
+		default:
+			print_usage(stderr, argv[0]);
+			return 2;
+		}
+	}
+	if (optind != argc - 1) {
+		print_usage(stderr, argv[0]);
+		return 2;
+	}
+
+	pidmap_init(&q.index);
+	if (!q.summary) {
+		printf("time,pid,cpu_percent,rss_bytes\n");
+	}
+
+	HistoryStats stats;
+	int ret = history_query(argv[optind], &want, on_rows, &q, &stats);
+	if (ret == -1) {
+		perror(argv[optind]);
+	} else if (ret == 0 && q.summary) {
+		print_summary(&q);
+	}
+	fflush(stdout);
+
+	fprintf(stderr, "%llu of %llu blocks read (%.1f MiB mapped), "
+			"%llu rows read, %llu matched\n",
+		(unsigned long long)stats.blocks_read,
+		(unsigned long long)stats.blocks,
+		stats.bytes_mapped / (1024.0 * 1024.0),
+		(unsigned long long)stats.rows_read,
+		(unsigned long long)stats.rows_matched);
+
+	pidmap_free(&q.index);
+	free(q.pids);
+	return ret == 0 ? 0 : 1;
+}
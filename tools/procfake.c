@@ -0,0 +1,574 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "procfake.h"
+
+#define PROCFAKE_CORES 4
+#define PROCFAKE_MEM_TOTAL_KB (16ull * 1024 * 1024)
+#define PROCFAKE_PAGE_KB 4
+#define PROCFAKE_BOOT_TIME 1700000000
+
+enum {
+	OP_BUSY,
+	OP_RSS,
+	OP_EXIT,
+	OP_SPAWN,
+	OP_RENAME,
+};
+
+static const char *const op_names[] = {
+	[OP_BUSY] = "busy",
+	[OP_RSS] = "rss",
+	[OP_EXIT] = "exit",
+	[OP_SPAWN] = "spawn",
+	[OP_RENAME] = "rename",
+};
+
+/**
+ * write_file() - Replace a file's contents in place
+ * @dir_fd: Root of the tree
+ * @path: File relative to @dir_fd; created if missing
+ * @buf: New contents
+ * @len: Length of @buf
+ *
+ * The new bytes are written over the old ones before the file is cut to
+ * length, so a concurrent reader never sees it empty.
+ *
+ * Return: 0 on success, -1 on error (errno is set)
+ */
+static int write_file(int dir_fd, const char *path, const char *buf,
+		      size_t len)
+{
+	int fd = openat(dir_fd, path, O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		return -1;
+	}
+
+	int ret = pwrite(fd, buf, len, 0) == (ssize_t)len &&
+		  ftruncate(fd, (off_t)len) == 0 ? 0 : -1;
+	int err = errno;
+	close(fd);
+	errno = err;
+	return ret;
+}
+
+static int write_stat(ProcFake *pf, const FakeProc *p)
+{
+	char path[32], buf[512];
+
+	snprintf(path, sizeof(path), "%d/stat", p->pid);
+	int len = snprintf(buf, sizeof(buf),
+			   "%d (%s) %c 1 %d %d 0 -1 4194560 0 0 0 0 %llu %llu "
+			   "0 0 20 0 1 0 %llu %llu %llu 18446744073709551615 "
+			   "0 0 0 0 0 0 0 0 0 0 0 0 17 %d 0 0 0 0 0 0 0 0 0 0 0 0 0\n",
+			   p->pid, p->comm, p->busy ? 'R' : 'S', p->pid, p->pid,
+			   (unsigned long long)p->utime,
+			   (unsigned long long)p->stime,
+			   (unsigned long long)p->starttime,
+			   (unsigned long long)p->rss_pages * PROCFAKE_PAGE_KB * 1024 * 4,
+			   (unsigned long long)p->rss_pages, p->pid % pf->cores);
+	return write_file(pf->dir_fd, path, buf, (size_t)len);
+}
+
+static int write_cmdline(ProcFake *pf, const FakeProc *p)
+{
+	char path[32], buf[64];
+
+	snprintf(path, sizeof(path), "%d/cmdline", p->pid);
+	int len = snprintf(buf, sizeof(buf), "/usr/bin/%s%c--fake%c", p->comm,
+			   '\0', '\0');
+	return write_file(pf->dir_fd, path, buf, (size_t)len);
+}
+
+/**
+ * write_system() - Rewrite stat, meminfo and uptime
+ * @pf: Tree
+ *
+ * The CPU counters follow the busy time of the processes: whatever they
+ * used this tick is user time, spread evenly over the cores, and the
+ * rest of the tick is idle.
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int write_system(ProcFake *pf, uint64_t busy_total)
+{
+	char buf[4096];
+	int len = 0;
+
+	uint64_t cores = (uint64_t)pf->cores;
+	uint64_t capacity = cores * (uint64_t)pf->tick_jiffies;
+	if (busy_total > capacity) {
+		busy_total = capacity;
+	}
+	pf->cpu_user += busy_total;
+	pf->cpu_idle += capacity - busy_total;
+
+	len += snprintf(buf + len, sizeof(buf) - (size_t)len,
+			"cpu  %llu 0 0 %llu 0 0 0 0 0 0\n",
+			(unsigned long long)pf->cpu_user,
+			(unsigned long long)pf->cpu_idle);
+	for (int c = 0; c < pf->cores; c++) {
+		len += snprintf(buf + len, sizeof(buf) - (size_t)len,
+				"cpu%d %llu 0 0 %llu 0 0 0 0 0 0\n", c,
+				(unsigned long long)(pf->cpu_user / cores),
+				(unsigned long long)(pf->cpu_idle / cores));
+	}
+	len += snprintf(buf + len, sizeof(buf) - (size_t)len,
+			"intr 0\nctxt %llu\nbtime %d\nprocesses %llu\n"
+			"procs_running 1\nprocs_blocked 0\nsoftirq 0\n",
+			(unsigned long long)pf->jiffies * 10, PROCFAKE_BOOT_TIME,
+			(unsigned long long)pf->forks);
+	if (write_file(pf->dir_fd, "stat", buf, (size_t)len) != 0) {
+		return -1;
+	}
+
+	uint64_t used_kb = 0;
+	for (int pid = 1; pid < pf->pid_limit; pid++) {
+		if (pf->procs[pid].alive) {
+			used_kb += pf->procs[pid].rss_pages * PROCFAKE_PAGE_KB;
+		}
+	}
+	uint64_t avail_kb = used_kb < pf->mem_total_kb ?
+			    pf->mem_total_kb - used_kb : 0;
+	len = snprintf(buf, sizeof(buf),
+		       "MemTotal:       %llu kB\nMemFree:        %llu kB\n"
+		       "MemAvailable:   %llu kB\n",
+		       (unsigned long long)pf->mem_total_kb,
+		       (unsigned long long)avail_kb,
+		       (unsigned long long)avail_kb);
+	if (write_file(pf->dir_fd, "meminfo", buf, (size_t)len) != 0) {
+		return -1;
+	}
+
+	len = snprintf(buf, sizeof(buf), "%llu.%02llu %llu.00\n",
+		       (unsigned long long)(pf->jiffies / PROCFAKE_HZ),
+		       (unsigned long long)(pf->jiffies % PROCFAKE_HZ),
+		       (unsigned long long)(pf->cpu_idle / PROCFAKE_HZ));
+	return write_file(pf->dir_fd, "uptime", buf, (size_t)len);
+}
+
+static int reserve_pid(ProcFake *pf, int pid)
+{
+	if (pid < pf->pid_limit) {
+		return 0;
+	}
+
+	int limit = pf->pid_limit ? pf->pid_limit : 1024;
+	while (limit <= pid) {
+		limit *= 2;
+	}
+	FakeProc *procs = realloc(pf->procs, (size_t)limit * sizeof(*procs));
+	uint8_t *marks = realloc(pf->dirty, (size_t)limit);
+	if (procs) {
+		pf->procs = procs;
+	}
+	if (marks) {
+		pf->dirty = marks;
+	}
+	if (!procs || !marks) {
+		return -1;
+	}
+
+	memset(pf->procs + pf->pid_limit, 0,
+	       (size_t)(limit - pf->pid_limit) * sizeof(*procs));
+	memset(pf->dirty + pf->pid_limit, 0, (size_t)(limit - pf->pid_limit));
+	pf->pid_limit = limit;
+	return 0;
+}
+
+static void set_comm(FakeProc *p, const char *comm)
+{
+	strncpy(p->comm, comm, PROCFAKE_COMM_MAX - 1);
+	p->comm[PROCFAKE_COMM_MAX - 1] = '\0';
+}
+
+/**
+ * procfake_exit() - Remove a process from the tree
+ * @pf: Tree
+ * @pid: Process to remove; a missing one is ignored
+ *
+ * Return: 0 on success, -1 on error (errno is set)
+ */
+int procfake_exit(ProcFake *pf, int pid)
+{
+	char path[32], hidden[32];
+
+	if (pid <= 0 || pid >= pf->pid_limit || !pf->procs[pid].alive) {
+		return 0;
+	}
+
+	// A descriptor still open on the old stat reads nothing from now on
+	snprintf(path, sizeof(path), "%d/stat", pid);
+	if (write_file(pf->dir_fd, path, "", 0) != 0) {
+		return -1;
+	}
+	unlinkat(pf->dir_fd, path, 0);
+	snprintf(path, sizeof(path), "%d/cmdline", pid);
+	unlinkat(pf->dir_fd, path, 0);
+	// Keep the emptied directory, so a new process cannot get its inode
+	snprintf(path, sizeof(path), "%d", pid);
+	snprintf(hidden, sizeof(hidden), ".%d", pid);
+	if (renameat(pf->dir_fd, path, pf->dir_fd, hidden) != 0 &&
+	    unlinkat(pf->dir_fd, path, AT_REMOVEDIR) != 0) {
+		return -1;
+	}
+
+	pf->procs[pid].alive = false;
+	pf->dirty[pid] = 0;
+	pf->alive--;
+	return 0;
+}
+
+/**
+ * procfake_spawn() - Add a process, or reuse a live PID for a new one
+ * @pf: Tree
+ * @pid: Process ID (> 0)
+ * @comm: Name, or NULL for "procN"
+ *
+ * Return: 0 on success, -1 on error (errno is set)
+ */
+int procfake_spawn(ProcFake *pf, int pid, const char *comm)
+{
+	char path[32], name[PROCFAKE_COMM_MAX];
+
+	if (pid <= 0) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (reserve_pid(pf, pid) != 0) {
+		errno = ENOMEM;
+		return -1;
+	}
+	if (procfake_exit(pf, pid) != 0) {
+		return -1;
+	}
+
+	snprintf(path, sizeof(path), "%d", pid);
+	if (mkdirat(pf->dir_fd, path, 0755) != 0 && errno != EEXIST) {
+		return -1;
+	}
+
+	FakeProc *p = &pf->procs[pid];
+	memset(p, 0, sizeof(*p));
+	p->pid = pid;
+	p->alive = true;
+	// Tell a reused PID apart from its previous owner
+	p->starttime = pf->jiffies + pf->forks;
+	p->rss_pages = 100 + (uint64_t)pid % 1000;
+	if (!comm) {
+		snprintf(name, sizeof(name), "proc%d", pid % 1000);
+		comm = name;
+	}
+	set_comm(p, comm);
+	pf->alive++;
+	pf->forks++;
+
+	if (write_stat(pf, p) != 0 || write_cmdline(pf, p) != 0) {
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * procfake_rename() - Change the name of a process, as exec() would
+ * @pf: Tree
+ * @pid: Process ID; a missing one is ignored
+ * @comm: New name, cut to PROCFAKE_COMM_MAX - 1 bytes
+ *
+ * Return: 0 on success, -1 on error (errno is set)
+ */
+int procfake_rename(ProcFake *pf, int pid, const char *comm)
+{
+	if (pid <= 0 || pid >= pf->pid_limit || !pf->procs[pid].alive) {
+		return 0;
+	}
+
+	FakeProc *p = &pf->procs[pid];
+	set_comm(p, comm);
+	pf->dirty[pid] = 0;
+	return write_stat(pf, p) == 0 && write_cmdline(pf, p) == 0 ? 0 : -1;
+}
+
+/**
+ * procfake_create() - Build a tree with processes 1 to @count
+ * @pf: Tree to initialize
+ * @dir: Directory to build it in; created if missing
+ * @count: Number of processes
+ * @tick_ms: Wall time one procfake_step() stands for
+ *
+ * A few names are odd on purpose: with spaces, with parentheses, or
+ * ending in ')'. Every tenth process is busy.
+ *
+ * Return: 0 on success, -1 on error (errno is set)
+ */
+int procfake_create(ProcFake *pf, const char *dir, int count, int tick_ms)
+{
+	static const char *const odd_names[] = {
+		"with space", "odd) (name", "ends)", "((", "x",
+	};
+
+	memset(pf, 0, sizeof(*pf));
+	pf->dir_fd = -1;
+	pf->cores = PROCFAKE_CORES;
+	pf->mem_total_kb = PROCFAKE_MEM_TOTAL_KB;
+	pf->tick_jiffies = tick_ms * PROCFAKE_HZ / 1000;
+	pf->jiffies = 1000;
+
+	if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+		return -1;
+	}
+	pf->dir_fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (pf->dir_fd < 0 || reserve_pid(pf, count) != 0) {
+		procfake_free(pf);
+		return -1;
+	}
+
+	for (int pid = 1; pid <= count; pid++) {
+		const char *comm = pid % 97 == 0 ? odd_names[pid / 97 % 5] : NULL;
+		if (procfake_spawn(pf, pid, comm) != 0) {
+			procfake_free(pf);
+			return -1;
+		}
+		pf->procs[pid].busy = pid % 10 == 0 ? (uint32_t)(pid / 10 % 5) : 0;
+	}
+	if (write_system(pf, 0) != 0) {
+		procfake_free(pf);
+		return -1;
+	}
+	return 0;
+}
+
+static int event_cmp(const void *a, const void *b)
+{
+	const FakeEvent *x = a, *y = b;
+	if (x->step != y->step) {
+		return x->step < y->step ? -1 : 1;
+	}
+	// Keep script order within a step
+	return (x < y) ? -1 : (x > y);
+}
+
+/**
+ * parse_line() - Parse one script command
+ * @line: NUL-terminated line without its newline
+ * @ev: Parsed command
+ *
+ * Return: 1 for a command, 0 for a blank or comment line, -1 on error
+ */
+static int parse_line(char *line, FakeEvent *ev)
+{
+	char op[16], pids[32];
+	unsigned long long step;
+	int used = 0;
+
+	while (*line == ' ' || *line == '\t') {
+		line++;
+	}
+	if (*line == '\0' || *line == '#') {
+		return 0;
+	}
+	if (sscanf(line, "%llu %15s %31s %n", &step, op, pids, &used) < 3) {
+		return -1;
+	}
+
+	memset(ev, 0, sizeof(*ev));
+	ev->step = step;
+	ev->op = -1;
+	for (int i = 0; i < (int)(sizeof(op_names) / sizeof(op_names[0])); i++) {
+		if (strcmp(op, op_names[i]) == 0) {
+			ev->op = i;
+		}
+	}
+	if (ev->op < 0) {
+		return -1;
+	}
+
+	char *end;
+	ev->pid_min = (int)strtol(pids, &end, 10);
+	ev->pid_max = *end == '-' ? (int)strtol(end + 1, &end, 10) : ev->pid_min;
+	if (*end != '\0' || ev->pid_min <= 0 || ev->pid_max < ev->pid_min) {
+		return -1;
+	}
+
+	const char *arg = used ? line + used : "";
+	switch (ev->op) {
+	case OP_BUSY:
+	case OP_RSS:
+		ev->value = strtoull(arg, &end, 10);
+		if (end == arg) {
+			return -1;
+		}
+		break;
+	case OP_RENAME:
+		if (*arg == '\0') {
+			return -1;
+		}
+		/* fall through */
+	case OP_SPAWN:
+		strncpy(ev->comm, arg, PROCFAKE_COMM_MAX - 1);
+		break;
+	}
+	return 1;
+}
+
+/**
+ * procfake_load_script() - Read the commands that drive procfake_step()
+ * @pf: Tree
+ * @script: Script stream
+ *
+ * Return: 0 on success, or the (1-based) number of the first bad line
+ */
+int procfake_load_script(ProcFake *pf, FILE *script)
+{
+	char line[256];
+	int capacity = pf->event_count;
+	int number = 0;
+
+	while (fgets(line, sizeof(line), script)) {
+		number++;
+		line[strcspn(line, "\r\n")] = '\0';
+
+		FakeEvent ev;
+		int ret = parse_line(line, &ev);
+		if (ret < 0) {
+			return number;
+		}
+		if (ret == 0) {
+			continue;
+		}
+
+		if (pf->event_count == capacity) {
+			capacity = capacity ? capacity * 2 : 64;
+			FakeEvent *events = realloc(pf->events,
+						    (size_t)capacity * sizeof(*events));
+			if (!events) {
+				return number;
+			}
+			pf->events = events;
+		}
+		pf->events[pf->event_count++] = ev;
+	}
+
+	qsort(pf->events, (size_t)pf->event_count, sizeof(*pf->events),
+	      event_cmp);
+	return 0;
+}
+
+static int apply_event(ProcFake *pf, const FakeEvent *ev)
+{
+	for (int pid = ev->pid_min; pid <= ev->pid_max; pid++) {
+		bool alive = pid < pf->pid_limit && pf->procs[pid].alive;
+		int ret = 0;
+
+		switch (ev->op) {
+		case OP_BUSY:
+			if (alive) {
+				pf->procs[pid].busy = (uint32_t)ev->value;
+				pf->dirty[pid] = 1;
+			}
+			break;
+		case OP_RSS:
+			if (alive) {
+				pf->procs[pid].rss_pages = ev->value;
+				pf->dirty[pid] = 1;
+			}
+			break;
+		case OP_EXIT:
+			ret = procfake_exit(pf, pid);
+			break;
+		case OP_SPAWN:
+			ret = procfake_spawn(pf, pid, ev->comm[0] ? ev->comm : NULL);
+			break;
+		case OP_RENAME:
+			ret = procfake_rename(pf, pid, ev->comm);
+			break;
+		}
+		if (ret != 0) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * procfake_step() - Advance the tree by one tick
+ * @pf: Tree
+ *
+ * Applies the script commands of the new tick, adds every busy process's
+ * jiffies, and rewrites the stat files that changed plus the system files.
+ *
+ * Return: 0 on success, -1 on error (errno is set)
+ */
+int procfake_step(ProcFake *pf)
+{
+	pf->step++;
+	pf->jiffies += (uint64_t)pf->tick_jiffies;
+
+	while (pf->next_event < pf->event_count &&
+	       pf->events[pf->next_event].step <= pf->step) {
+		if (apply_event(pf, &pf->events[pf->next_event++]) != 0) {
+			return -1;
+		}
+	}
+
+	uint64_t busy_total = 0;
+	for (int pid = 1; pid < pf->pid_limit; pid++) {
+		FakeProc *p = &pf->procs[pid];
+		if (!p->alive) {
+			continue;
+		}
+		if (p->busy) {
+			p->utime += p->busy;
+			p->stime += p->busy / 4;
+			busy_total += p->busy + p->busy / 4;
+			pf->dirty[pid] = 1;
+		}
+		if (pf->dirty[pid]) {
+			pf->dirty[pid] = 0;
+			if (write_stat(pf, p) != 0) {
+				return -1;
+			}
+		}
+	}
+	return write_system(pf, busy_total);
+}
+
+/**
+ * procfake_remove() - Delete the tree and release the generator state
+ * @pf: Tree
+ * @dir: Directory the tree was built in
+ */
+void procfake_remove(ProcFake *pf, const char *dir)
+{
+	char path[32];
+
+	for (int pid = 1; pid < pf->pid_limit; pid++) {
+		procfake_exit(pf, pid);
+		snprintf(path, sizeof(path), ".%d", pid);
+		unlinkat(pf->dir_fd, path, AT_REMOVEDIR);
+	}
+	unlinkat(pf->dir_fd, "stat", 0);
+	unlinkat(pf->dir_fd, "meminfo", 0);
+	unlinkat(pf->dir_fd, "uptime", 0);
+	procfake_free(pf);
+	rmdir(dir);
+}
+
+/**
+ * procfake_free() - Release the generator state; the tree stays on disk
+ * @pf: Tree
+ */
+void procfake_free(ProcFake *pf)
+{
+	if (pf->dir_fd >= 0) {
+		close(pf->dir_fd);
+	}
+	free(pf->procs);
+	free(pf->dirty);
+	free(pf->events);
+	memset(pf, 0, sizeof(*pf));
+	pf->dir_fd = -1;
+}
@@ -0,0 +1,86 @@
+#ifndef PROCFAKE_H
+#define PROCFAKE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Synthetic /proc tree for tests and benchmarks (see --proc-root).
+ *
+ * procfake_create() writes stat, meminfo and uptime plus a [pid]/stat and
+ * [pid]/cmdline for every process into a directory; procfake_step()
+ * advances the counters by one tick and rewrites what changed. Files are
+ * rewritten in place, so descriptors the collector keeps open see the new
+ * contents; an exiting process has its stat emptied before it is removed,
+ * which a held descriptor reads as a vanished process, like ESRCH from
+ * the kernel. Its emptied directory is kept as .[pid] until the PID exits
+ * again, so that, as on procfs, the directory of a reused PID has a new
+ * inode number.
+ *
+ * A script drives the evolution, one command per line:
+ *   STEP busy PIDS N     PIDS gain N jiffies of utime per tick
+ *   STEP rss PIDS N      PIDS' resident set becomes N pages
+ *   STEP exit PIDS       PIDS disappear
+ *   STEP spawn PIDS [COMM]
+ *                        PIDS appear, or are reused by a new process (a
+ *                        new starttime) if they exist
+ *   STEP rename PIDS COMM
+ *                        exec(): the rest of the line is the new comm,
+ *                        spaces and parentheses included
+ * PIDS is a PID or an inclusive range A-B; commands apply before the
+ * counters of tick STEP are advanced. '#' starts a comment line.
+ */
+
+#define PROCFAKE_COMM_MAX 16 // like TASK_COMM_LEN, NUL included
+#define PROCFAKE_HZ 100
+
+typedef struct {
+	int pid;
+	bool alive;
+	char comm[PROCFAKE_COMM_MAX];
+	uint64_t starttime;  // jiffies since boot
+	uint64_t utime;
+	uint64_t stime;
+	uint64_t rss_pages;
+	uint32_t busy;       // utime jiffies gained per tick
+} FakeProc;
+
+typedef struct {
+	uint64_t step;
+	int op;
+	int pid_min;
+	int pid_max;
+	uint64_t value;
+	char comm[PROCFAKE_COMM_MAX];
+} FakeEvent;
+
+typedef struct {
+	int dir_fd;
+	FakeProc *procs;     // indexed by PID; procs[0] is unused
+	uint8_t *dirty;      // indexed by PID; files to rewrite this tick
+	int pid_limit;       // procs and dirty have room for PIDs below this
+	int alive;
+	FakeEvent *events;   // sorted by step
+	int event_count;
+	int next_event;
+	uint64_t step;       // ticks advanced so far
+	uint64_t jiffies;    // since boot
+	int tick_jiffies;    // jiffies per tick
+	int cores;
+	uint64_t cpu_user;   // jiffies, all cores together
+	uint64_t cpu_idle;
+	uint64_t mem_total_kb;
+	uint64_t forks;
+} ProcFake;
+
+int procfake_create(ProcFake *pf, const char *dir, int count, int tick_ms);
+int procfake_load_script(ProcFake *pf, FILE *script);
+int procfake_step(ProcFake *pf);
+int procfake_spawn(ProcFake *pf, int pid, const char *comm);
+int procfake_exit(ProcFake *pf, int pid);
+int procfake_rename(ProcFake *pf, int pid, const char *comm);
+void procfake_remove(ProcFake *pf, const char *dir);
+void procfake_free(ProcFake *pf);
+
+#endif